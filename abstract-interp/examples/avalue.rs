@@ -0,0 +1,81 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Micro-benchmarks for the `Avalue` operations of the Kset domain.
+//!
+//! Usage: cargo run --release --example avalue [ITERATIONS]
+//!
+//! Runs the lattice operations and a few transfer functions ITERATIONS times (default: 1000000)
+//! on sets with one, half the maximal and the maximal number of values and prints the average
+//! time per call in nanoseconds, along with the result.
+
+extern crate panopticon_abstract_interp;
+extern crate panopticon_core;
+
+use panopticon_abstract_interp::{Avalue, Kset, ProgramPoint};
+use panopticon_core::Operation;
+use std::env;
+use std::time::Instant;
+
+/// `len` values starting at `first`, `step` apart.
+fn kset(first: u64, step: u64, len: u64) -> Kset {
+    Kset::from_values((0..len).map(|i| (first + i * step, 32)))
+}
+
+fn bench<F: Fn() -> Kset>(name: &str, len: u64, iterations: usize, f: F) {
+    let start = Instant::now();
+    let mut last = Kset::Meet;
+
+    for _ in 0..iterations {
+        last = f();
+    }
+
+    let d = start.elapsed();
+    let ns = (d.as_secs() as f64 * 1e9 + d.subsec_nanos() as f64) / iterations as f64;
+
+    println!("{:>16} {:>6} {:>10.1}  {}", name, len, ns, last);
+}
+
+fn main() {
+    let iterations = env::args().nth(1).and_then(|x| x.parse::<usize>().ok()).unwrap_or(1_000_000);
+    let pp = ProgramPoint { address: 0, position: 0 };
+
+    println!("{:>16} {:>6} {:>10}  {}", "operation", "values", "ns/call", "result");
+
+    for &len in &[1, 5, 10] {
+        // two overlapping sets, the union still fits
+        let a = kset(0, 2, len);
+        let b = kset(len, 2, len / 2);
+        let small = kset(1, 1, if len > 1 { 2 } else { 1 });
+
+        bench("combine", len, iterations, || a.combine(&b));
+        bench("narrow", len, iterations, || a.narrow(&a.combine(&b)));
+        bench(
+            "more_exact",
+            len,
+            iterations,
+            || if a.combine(&b).more_exact(&a) { a.clone() } else { Kset::Meet }
+        );
+        bench("extract", len, iterations, || a.extract(8, 0));
+        bench("move", len, iterations, || Kset::execute(&pp, &Operation::Move(a.clone())));
+        bench("add", len, iterations, || Kset::execute(&pp, &Operation::Add(a.clone(), small.clone())));
+        bench("xor", len, iterations, || Kset::execute(&pp, &Operation::ExclusiveOr(a.clone(), small.clone())));
+        bench("less unsigned", len, iterations, || Kset::execute(&pp, &Operation::LessUnsigned(a.clone(), small.clone())));
+        bench("phi", len, iterations, || Kset::execute(&pp, &Operation::Phi(vec![a.clone(), b.clone(), small.clone()])));
+    }
+}
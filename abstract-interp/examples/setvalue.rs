@@ -0,0 +1,149 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Compares pinning values with `approximate` and `Interpretation`.
+//!
+//! Usage: cargo run --release --example setvalue [LOOPS]
+//!
+//! Builds a function with LOOPS (default: 1000) small loops one after another. Each loop counts
+//! its own variable with a step read from an input and adds it to a running sum. The example pins
+//! and clears the inputs of the first, the middle and the last loop and prints how long computing
+//! the whole function and updating the interpretation take for each edit. Pinning the input of
+//! the first loop changes the sums after all loops, pinning the last one only the final sum.
+
+extern crate panopticon_abstract_interp;
+extern crate panopticon_core;
+extern crate panopticon_data_flow;
+extern crate panopticon_graph_algos;
+
+use panopticon_abstract_interp::{Interpretation, Kset, approximate};
+use panopticon_core::{BasicBlock, ControlFlowGraph, ControlFlowTarget, Function, Guard, Lvalue, Mnemonic, Name, Operation, Region, Rvalue, Statement};
+use panopticon_data_flow::ssa_convertion;
+use panopticon_graph_algos::MutableGraphTrait;
+use std::collections::HashMap;
+use std::env;
+use std::time::{Duration, Instant};
+
+fn var(name: String, size: usize) -> Lvalue {
+    Lvalue::Variable { name: Name::from(name), size: size, subscript: None }
+}
+
+fn block(addr: &mut u64, stmts: Vec<(Lvalue, Operation<Rvalue>)>) -> ControlFlowTarget {
+    let mnes = stmts
+        .into_iter()
+        .map(
+            |(assignee, op)| {
+                *addr += 1;
+                Mnemonic::new(*addr - 1..*addr, "test".to_string(), "".to_string(), vec![].iter(), vec![Statement { op: op, assignee: assignee }].iter()).unwrap()
+            }
+        )
+        .collect();
+
+    ControlFlowTarget::Resolved(BasicBlock::from_vec(mnes))
+}
+
+/// Function with `loops` loops of the form
+///
+/// ```c
+/// i = 0;
+/// do { i = i + in; } while(i < 100);
+/// sum = sum + i;
+/// ```
+fn function(loops: usize) -> Function {
+    let mut cfg = ControlFlowGraph::new();
+    let mut addr = 0;
+    let sum = var("sum".to_string(), 32);
+    let flag = var("flag".to_string(), 1);
+    let g = Guard::from_flag(&flag.clone().into()).unwrap();
+    let entry = cfg.add_vertex(block(&mut addr, vec![(sum.clone(), Operation::Move(Rvalue::new_u32(0)))]));
+    let mut prev = entry;
+
+    for l in 0..loops {
+        let i = var(format!("i{}", l), 32);
+        let input = var(format!("in{}", l), 32);
+        let init = cfg.add_vertex(block(&mut addr, vec![(i.clone(), Operation::Move(Rvalue::new_u32(0)))]));
+        let body = cfg.add_vertex(
+            block(
+                &mut addr,
+                vec![
+                    (i.clone(), Operation::Add(i.clone().into(), input.clone().into())),
+                    (flag.clone(), Operation::LessUnsigned(i.clone().into(), Rvalue::new_u32(100))),
+                ],
+            )
+        );
+        let exit = cfg.add_vertex(block(&mut addr, vec![(sum.clone(), Operation::Add(sum.clone().into(), i.clone().into()))]));
+
+        cfg.add_edge(Guard::always(), prev, init);
+        cfg.add_edge(Guard::always(), init, body);
+        cfg.add_edge(g.clone(), body, body);
+        cfg.add_edge(g.negation(), body, exit);
+        prev = exit;
+    }
+
+    let mut func = Function::undefined(0, None, &Region::undefined("ram".to_owned(), addr + 1), Some("loops".to_owned()));
+
+    *func.cfg_mut() = cfg;
+    func.set_entry_point_ref(entry);
+    ssa_convertion(&mut func).unwrap();
+    func
+}
+
+fn seconds(d: Duration) -> f64 {
+    d.as_secs() as f64 + d.subsec_nanos() as f64 * 1e-9
+}
+
+fn main() {
+    let loops = env::args().nth(1).and_then(|x| x.parse::<usize>().ok()).unwrap_or(1000);
+    let func = function(loops);
+    let start = Instant::now();
+    let mut interp = Interpretation::<Kset>::new(&func);
+
+    println!("{} loops, {} statements, initial fixed point in {:.3}s", loops, func.statements().count(), seconds(start.elapsed()));
+    println!("{:>8} {:>8} {:>12} {:>12} {:>6}", "input", "value", "approximate", "incremental", "same");
+
+    let mut fixed = HashMap::new();
+    let inputs = vec![0, loops / 2, loops - 1];
+    let pin = inputs.iter().map(|&l| (l, Some(Kset::from_values(vec![(3, 32)])))).chain(inputs.iter().map(|&l| (l, None)));
+
+    for (l, value) in pin {
+        let var = (Name::from(format!("in{}", l)), 0);
+
+        match value.clone() {
+            Some(v) => fixed.insert(var.clone(), v),
+            None => fixed.remove(&var),
+        };
+
+        let start = Instant::now();
+        let expected = approximate::<Kset>(&func, &fixed).unwrap();
+        let full = start.elapsed();
+        let start = Instant::now();
+
+        interp.set_input(var.clone(), value.clone());
+
+        let incremental = start.elapsed();
+
+        println!(
+            "{:>8} {:>8} {:>12.6} {:>12.6} {:>6}",
+            var.0,
+            if value.is_some() { "3" } else { "-" },
+            seconds(full),
+            seconds(incremental),
+            interp.values() == expected
+        );
+    }
+}
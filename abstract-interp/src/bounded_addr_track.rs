@@ -35,8 +35,7 @@
 
 use {Avalue, Constraint, ProgramPoint};
 
-use panopticon_core::{Operation, Rvalue, il};
-use std::borrow::Cow;
+use panopticon_core::{Name, Operation, Rvalue, il};
 
 /// Maximum global version limit for each region
 pub const VERSION_LIMIT: usize = 10;
@@ -52,13 +51,13 @@ pub enum BoundedAddrTrack {
     /// Pointer pointing somewhere into `region`
     Region {
         /// Name of pointed to region and pointer version. None stands for the global region.
-        region: Option<(Cow<'static, str>, usize)>,
+        region: Option<(Name, usize)>,
     },
     /// Pointer pointing to `offset` inside `region`. `offset_size` is the size of the **pointer**
     /// in bits.
     Offset {
         /// Name of pointed to region and pointer version. None stands for the global region.
-        region: Option<(Cow<'static, str>, usize)>,
+        region: Option<(Name, usize)>,
         /// Offset into region.
         offset: u64,
         /// Size of the pointer in bits. Not the value pointed to.
@@ -112,7 +111,7 @@ impl Avalue for BoundedAddrTrack {
     fn execute(
         _pp: &ProgramPoint,
         op: &Operation<Self>, /*, reg: Option<&Region>,
-               symbolic: &HashMap<Range<u64>,Cow<'static,str>>, initial: &HashMap<(Cow<'static,str>,usize),Self>*/
+               symbolic: &HashMap<Range<u64>,Name>, initial: &HashMap<(Name,usize),Self>*/
     ) -> Self {
         fn execute(op: Operation<Rvalue>) -> BoundedAddrTrack {
             let tmp = il::execute(op);
@@ -566,7 +565,7 @@ mod tests {
                 0 => BoundedAddrTrack::Meet,
                 1 | 2 => {
                     let reg = if g.gen::<bool>() {
-                        let n = Cow::Owned(g.gen_ascii_chars().take(1).collect());
+                        let n = Name::from(g.gen_ascii_chars().take(1).collect::<String>());
                         let o = g.gen_range(0, 11);
 
                         Some((n, o))
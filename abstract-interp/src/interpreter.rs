@@ -16,18 +16,18 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-use panopticon_core::{ControlFlowGraph, ControlFlowRef, ControlFlowTarget, Function, Guard, Lvalue, Operation, Result, Rvalue, Statement};
+use panopticon_core::{ControlFlowGraph, ControlFlowRef, ControlFlowTarget, Function, Guard, Lvalue, Name, Operation, Result, Rvalue, Statement};
 use panopticon_data_flow::flag_operations;
 use panopticon_graph_algos::{BidirectionalGraphTrait, GraphTrait, IncidenceGraphTrait, VertexListGraphTrait};
-use panopticon_graph_algos::dominator::immediate_dominator;
-use panopticon_graph_algos::order::{HierarchicalOrdering, weak_topo_order};
+use panopticon_graph_algos::order::HierarchicalOrdering;
 use serde::{Serialize,Deserialize};
-use std::borrow::Cow;
 use std::cmp::max;
 use std::collections::{HashMap, HashSet};
 use std::fmt::Debug;
 use std::hash::Hash;
 use std::iter::FromIterator;
+use std::mem;
+use std::ops::Range;
 
 /// Linear constraint.
 pub enum Constraint {
@@ -63,6 +63,11 @@ pub trait Avalue: Clone + PartialEq + Eq + Hash + Debug + Serialize + for<'a> De
     fn narrow(&self, &Self) -> Self;
     /// Widens `self` with the argument.
     fn widen(&self, other: &Self) -> Self;
+    /// Widens `self` with the argument, but not beyond the thresholds if the domain can make use
+    /// of them. `thresholds` are the constants the function compares against.
+    fn widen_with_thresholds(&self, other: &Self, _: &[Rvalue]) -> Self {
+        self.widen(other)
+    }
     /// Computes the lowest upper bound of self and the argument.
     fn combine(&self, &Self) -> Self;
     /// Returns true if `self` <= `other`.
@@ -76,169 +81,616 @@ pub trait Avalue: Clone + PartialEq + Eq + Hash + Debug + Serialize + for<'a> De
 /// Does an abstract interpretation of `func` using the abstract domain `A`. The function uses a
 /// fixed point iteration and the widening strategy outlined in
 /// Bourdoncle: "Efficient chaotic iteration strategies with widenings".
-pub fn approximate<A: Avalue>(func: &Function, fixed: &HashMap<(Cow<'static, str>, usize), A>) -> Result<HashMap<Lvalue, A>> {
-    let wto = weak_topo_order(func.entry_point_ref(), func.cfg());
-    let edge_ops = flag_operations(func);
-    fn stabilize<A: Avalue>(
-        h: &Vec<Box<HierarchicalOrdering<ControlFlowRef>>>,
-        graph: &ControlFlowGraph,
-        constr: &HashMap<Lvalue, A>,
-        sizes: &HashMap<Cow<'static, str>, usize>,
-        ret: &mut HashMap<(Cow<'static, str>, usize), A>,
-        fixed: &HashMap<(Cow<'static, str>, usize), A>,
-    ) -> Result<()> {
-        let mut stable = true;
-        let mut iter_cnt = 0;
-        let head = if let Some(h) = h.first() {
-            match &**h {
-                &HierarchicalOrdering::Element(ref vx) => vx.clone(),
-                &HierarchicalOrdering::Component(ref vec) => return stabilize(vec, graph, constr, sizes, ret, fixed),
+pub fn approximate<A: Avalue>(func: &Function, fixed: &HashMap<(Name, usize), A>) -> Result<HashMap<Lvalue, A>> {
+    Ok(Interpretation::with_inputs(func, fixed).values())
+}
+
+/// Bounds on the fixed point iteration.
+#[derive(Clone,Copy,Debug,PartialEq,Eq)]
+pub struct Limits {
+    /// Statements executed before giving up or `None` if unbounded.
+    pub steps: Option<usize>,
+    /// Iterations of a component before all its basic blocks are widened instead of only its
+    /// head.
+    pub component_iterations: usize,
+}
+
+impl Default for Limits {
+    fn default() -> Limits {
+        Limits { steps: None, component_iterations: 10 }
+    }
+}
+
+/// How the last fixed point computation converged.
+#[derive(Clone,Debug,Default,PartialEq,Eq)]
+pub struct Convergence {
+    /// Statements executed.
+    pub steps: usize,
+    /// Components stabilized. Nested components count once per iteration of their parent.
+    pub components: usize,
+    /// Iterations of all components.
+    pub iterations: usize,
+    /// Most iterations a single component needed.
+    pub max_iterations: usize,
+    /// Values changed by widening.
+    pub widenings: usize,
+    /// Components that exceeded `Limits::component_iterations`.
+    pub exhausted: usize,
+}
+
+/// Operand of a compiled statement.
+#[derive(Clone,PartialEq,Eq,Debug,Serialize,Deserialize)]
+enum Operand {
+    /// SSA variable by ID. Reads of a part of the variable are `Some((size, offset))`.
+    Variable { id: usize, extract: Option<(usize, usize)> },
+    /// Anything else, passed to `Avalue::abstract_value`.
+    Value(Rvalue),
+}
+
+/// Assignment to a SSA variable.
+#[derive(Clone,Debug)]
+struct Definition {
+    point: ProgramPoint,
+    assignee: usize,
+    op: Operation<Operand>,
+}
+
+/// Weak topological order of the basic blocks, pointing into the list of definitions. The
+/// definitions of a basic block, and of all blocks of a component, are adjacent.
+#[derive(Clone,Debug)]
+enum Schedule {
+    Block(Range<usize>),
+    Component {
+        /// First child is the head.
+        children: Vec<Schedule>,
+        /// First definition of each child.
+        starts: Vec<usize>,
+        /// Index of the last child that is a component itself.
+        last_component: Option<usize>,
+        definitions: Range<usize>,
+    },
+}
+
+impl Schedule {
+    fn definitions(&self) -> Range<usize> {
+        match self {
+            &Schedule::Block(ref r) => r.clone(),
+            &Schedule::Component { ref definitions, .. } => definitions.clone(),
+        }
+    }
+}
+
+/// Part of the sorted slice `dirty` that falls into `range`.
+fn dirty_in<'a>(dirty: &'a [usize], range: &Range<usize>) -> &'a [usize] {
+    let lower = |x: usize| match dirty.binary_search(&x) {
+        Ok(i) | Err(i) => i,
+    };
+
+    &dirty[lower(range.start)..lower(range.end)]
+}
+
+/// Fixed point of an abstract interpretation that can be updated when inputs change.
+///
+/// Computing the fixed point with `approximate` executes the whole function. An `Interpretation`
+/// keeps the values of all SSA variables together with their def-use chains. Changing an input
+/// with `set_input` only resets the definitions that depend on it, directly or through other
+/// definitions, and reruns the iteration strategy of `approximate` on these. Basic blocks and
+/// components without such definitions are skipped, so the update takes time proportional to
+/// the part of the function the input influences.
+///
+/// Values that don't depend on the changed input are kept. A fresh run may iterate loops more
+/// often because of the new input and widen these differently.
+///
+/// Loop heads are widened with the constants the function compares against as thresholds, so
+/// domains like `Kset` can tell loops that end early from ones that run too long to track. A
+/// component still unstable after `Limits::component_iterations` is widened at every basic block.
+#[derive(Clone,Debug)]
+pub struct Interpretation<A: Avalue> {
+    names: Vec<(Name, usize)>,
+    ids: HashMap<(Name, usize), usize>,
+    /// Largest size of each variable name, the sizes reported by `values`.
+    sizes: HashMap<Name, usize>,
+    /// Definitions in the weak topological order of their basic blocks.
+    definitions: Vec<Definition>,
+    schedule: Schedule,
+    /// Definitions reading each variable.
+    users: Vec<Vec<usize>>,
+    /// Definitions assigning each variable.
+    assignments: Vec<Vec<usize>>,
+    /// Constraints on variables implied by the guards of the control flow graph.
+    constraints: Vec<(usize, A)>,
+    values: Vec<Option<A>>,
+    fixed: Vec<Option<A>>,
+    /// Definitions left to execute before giving up or `None` if unbounded.
+    steps: Option<usize>,
+    /// True if a definition had to be skipped because `steps` ran out.
+    out_of_steps: bool,
+    component_iterations: usize,
+    /// Constants used in comparisons, sorted.
+    thresholds: Vec<Rvalue>,
+    convergence: Convergence,
+}
+
+impl<A: Avalue> Interpretation<A> {
+    /// Computes the fixed point of `func` without fixed inputs.
+    pub fn new(func: &Function) -> Interpretation<A> {
+        Self::with_inputs(func, &HashMap::new())
+    }
+
+    /// Computes the fixed point of `func`, fixing the variables in `fixed` to the given values.
+    pub fn with_inputs(func: &Function, fixed: &HashMap<(Name, usize), A>) -> Interpretation<A> {
+        let mut ret = Self::compile(func, fixed);
+        let all = (0..ret.definitions.len()).collect::<Vec<_>>();
+        let vars = HashSet::from_iter(ret.definitions.iter().map(|d| d.assignee));
+
+        ret.run(&all, &vars);
+        ret
+    }
+
+    /// Like `with_inputs`, but fails if computing the fixed point needs more than `steps`
+    /// executions of a single statement. Updates of the returned interpretation are unbounded.
+    pub fn with_budget(func: &Function, fixed: &HashMap<(Name, usize), A>, steps: usize) -> Result<Interpretation<A>> {
+        Self::with_limits(func, fixed, Limits { steps: Some(steps), ..Limits::default() })
+    }
+
+    /// Like `with_inputs`, but iterates within `limits`. Fails if `limits.steps` are exceeded.
+    /// Updates of the returned interpretation use the same component iterations, but are not
+    /// bounded in steps.
+    pub fn with_limits(func: &Function, fixed: &HashMap<(Name, usize), A>, limits: Limits) -> Result<Interpretation<A>> {
+        let mut ret = Self::compile(func, fixed);
+        let all = (0..ret.definitions.len()).collect::<Vec<_>>();
+        let vars = HashSet::from_iter(ret.definitions.iter().map(|d| d.assignee));
+
+        ret.steps = limits.steps;
+        ret.component_iterations = limits.component_iterations;
+        ret.run(&all, &vars);
+
+        match limits.steps {
+            Some(steps) if ret.out_of_steps => Err(format!("abstract interpretation of {} exceeded {} steps", func.name, steps).into()),
+            _ => {
+                ret.steps = None;
+                Ok(ret)
             }
-        } else {
-            return Ok(());
+        }
+    }
+
+    fn compile(func: &Function, fixed: &HashMap<(Name, usize), A>) -> Interpretation<A> {
+        let mut ret = Interpretation {
+            names: vec![],
+            ids: HashMap::new(),
+            sizes: HashMap::new(),
+            definitions: vec![],
+            schedule: Schedule::Block(0..0),
+            users: vec![],
+            assignments: vec![],
+            constraints: vec![],
+            values: vec![],
+            fixed: vec![],
+            steps: None,
+            out_of_steps: false,
+            component_iterations: Limits::default().component_iterations,
+            thresholds: vec![],
+            convergence: Convergence::default(),
         };
 
-        loop {
-            for x in h.iter() {
-                match &**x {
-                    &HierarchicalOrdering::Element(ref vx) => {
-                        stable &= !execute(
-                            *vx,
-                            iter_cnt >= 2 && *vx == head,
-                            graph,
-                            constr,
-                            sizes,
-                            ret,
-                            fixed,
-                        )?
-                    }
-                    &HierarchicalOrdering::Component(ref vec) => {
-                        stabilize(&*vec, graph, constr, sizes, ret, fixed)?;
-                        stable = true;
+        for vx in func.cfg().vertices() {
+            if let Some(&ControlFlowTarget::Resolved(ref bb)) = func.cfg().vertex_label(vx) {
+                let sizes = &mut ret.sizes;
+
+                bb.execute(
+                    |i| if let Lvalue::Variable { ref name, ref size, .. } = i.assignee {
+                        let t = *size;
+                        let s = *sizes.get(name).unwrap_or(&t);
+                        sizes.insert(name.clone(), max(s, t));
                     }
-                }
+                );
             }
+        }
 
-            if stable {
-                for (lv, a) in constr.iter() {
-                    if let &Lvalue::Variable { ref name, subscript: Some(ref subscript), .. } = lv {
-                        let nam = (name.clone(), *subscript);
+        ret.schedule = match *func.weak_topo_order() {
+            HierarchicalOrdering::Component(ref v) => ret.compile_partition(v, func.cfg()),
+            HierarchicalOrdering::Element(vx) => ret.compile_block(vx, func.cfg()),
+        };
 
-                        if let Some(ref mut x) = ret.get_mut(&nam) {
-                            let n = x.narrow(&a);
-                            **x = n;
-                        }
-                    }
+        ret.thresholds.sort();
+        ret.thresholds.dedup();
+
+        for (lv, a) in constraints::<A>(func) {
+            if let Lvalue::Variable { name, subscript: Some(subscript), .. } = lv {
+                if let Some(&id) = ret.ids.get(&(name, subscript)) {
+                    ret.constraints.push((id, a));
                 }
+            }
+        }
+
+        for (k, v) in fixed.iter() {
+            let id = ret.intern(k);
+            ret.fixed[id] = Some(v.clone());
+        }
+
+        ret
+    }
+
+    /// Fixes the variable `var` to `value`, or lets the interpretation compute it again if
+    /// `value` is `None`, and updates all values depending on it.
+    pub fn set_input(&mut self, var: (Name, usize), value: Option<A>) {
+        self.update(vec![(var, value)]);
+    }
+
+    /// Replaces all fixed variables with `inputs`. Only the values depending on variables whose
+    /// input changed are computed again.
+    pub fn set_inputs(&mut self, inputs: &HashMap<(Name, usize), A>) {
+        let mut changes = vec![];
+
+        for (id, f) in self.fixed.iter().enumerate() {
+            if f.is_some() && !inputs.contains_key(&self.names[id]) {
+                changes.push((self.names[id].clone(), None));
+            }
+        }
+        for (k, v) in inputs.iter() {
+            let cur = self.ids.get(k).and_then(|&id| self.fixed[id].as_ref());
 
-                //execute(*vx,do_widen && vx == head,graph,ret),
-                return Ok(());
+            if cur != Some(v) {
+                changes.push((k.clone(), Some(v.clone())));
             }
+        }
 
-            stable = true;
-            iter_cnt += 1;
+        self.update(changes);
+    }
+
+    /// Statistics of the initial fixed point computation or the last update.
+    pub fn convergence(&self) -> &Convergence {
+        &self.convergence
+    }
+
+    /// Current inputs.
+    pub fn inputs(&self) -> HashMap<(Name, usize), A> {
+        HashMap::from_iter(self.fixed.iter().enumerate().filter_map(|(id, f)| f.as_ref().map(|f| (self.names[id].clone(), f.clone()))))
+    }
+
+    /// Abstract value of every variable, fixed inputs included. Same as the result of
+    /// `approximate`.
+    pub fn values(&self) -> HashMap<Lvalue, A> {
+        let mut ret = HashMap::new();
+
+        for (id, &(ref name, subscript)) in self.names.iter().enumerate() {
+            if let Some(a) = self.fixed[id].as_ref().or(self.values[id].as_ref()) {
+                if let Some(sz) = self.sizes.get(name) {
+                    ret.insert(Lvalue::Variable { name: name.clone(), subscript: Some(subscript), size: *sz }, a.clone());
+                }
+            }
+        }
+
+        ret
+    }
+
+    fn intern(&mut self, var: &(Name, usize)) -> usize {
+        if let Some(&id) = self.ids.get(var) {
+            return id;
         }
+
+        let id = self.names.len();
+
+        self.names.push(var.clone());
+        self.ids.insert(var.clone(), id);
+        self.users.push(vec![]);
+        self.assignments.push(vec![]);
+        self.values.push(None);
+        self.fixed.push(None);
+        id
     }
-    fn execute<A: Avalue>(
-        t: ControlFlowRef,
-        do_widen: bool,
-        graph: &ControlFlowGraph,
-        _: &HashMap<Lvalue, A>,
-        sizes: &HashMap<Cow<'static, str>, usize>,
-        ret: &mut HashMap<(Cow<'static, str>, usize), A>,
-        fixed: &HashMap<(Cow<'static, str>, usize), A>,
-    ) -> Result<bool> {
-        if let Some(&ControlFlowTarget::Resolved(ref bb)) = graph.vertex_label(t) {
-            let mut change = false;
+
+    fn compile_block(&mut self, vx: ControlFlowRef, graph: &ControlFlowGraph) -> Schedule {
+        let start = self.definitions.len();
+
+        if let Some(&ControlFlowTarget::Resolved(ref bb)) = graph.vertex_label(vx) {
             let mut pos = 0usize;
+
             bb.execute(
                 |i| {
-                    if let Statement {
-                               ref op,
-                               assignee: Lvalue::Variable { ref name, subscript: Some(ref subscript), .. },
-                           } = *i {
-                        let pp = ProgramPoint { address: bb.area.start, position: pos };
-                        let op = lift(op, &|x| res::<A>(x, sizes, &ret, fixed));
-                        let new = A::execute(&pp, &op);
-                        let assignee = (name.clone(), *subscript);
-                        let cur = ret.get(&assignee).cloned();
-
-                        debug!("{:?} {:?}: {:?} = {:?}", pp, assignee, op, new);
-                        debug!("    prev: {:?}", cur);
-
-                        if let Some(cur) = cur {
-                            if do_widen {
-                                let w = cur.widen(&new);
-
-                                debug!("    widen to {:?}", w);
-
-                                if w != cur {
-                                    change = true;
-                                    ret.insert(assignee, w.clone());
-                                    debug!("    new value {:?}", w);
+                    if let Statement { ref op, assignee: Lvalue::Variable { ref name, subscript: Some(ref subscript), .. } } = *i {
+                        let def = self.definitions.len();
+
+                        match op {
+                            &Operation::Equal(..) |
+                            &Operation::LessOrEqualSigned(..) |
+                            &Operation::LessOrEqualUnsigned(..) |
+                            &Operation::LessSigned(..) |
+                            &Operation::LessUnsigned(..) => {
+                                for v in op.operands() {
+                                    if let &Rvalue::Constant { .. } = v {
+                                        self.thresholds.push(v.clone());
+                                    }
                                 }
-                            } else if !cur.more_exact(&new) && cur != new {
-                                change = true;
-                                ret.insert(assignee, new.clone());
-                                debug!("    new value {:?}", new);
-                            } else {
-                                debug!("    {:?} is more exact than {:?}", cur, new);
                             }
-                        } else {
-                            change = true;
-                            ret.insert(assignee, new.clone());
-                            debug!("    new value {:?}", new);
+                            _ => {}
+                        }
+
+                        for v in op.operands() {
+                            if let &Rvalue::Variable { ref name, subscript: Some(subscript), .. } = v {
+                                let id = self.intern(&(name.clone(), subscript));
+                                self.users[id].push(def);
+                            }
                         }
+
+                        let assignee = self.intern(&(name.clone(), *subscript));
+                        let op = {
+                            let ids = &self.ids;
+                            let sizes = &self.sizes;
+
+                            lift(
+                                op,
+                                &|v| if let &Rvalue::Variable { ref name, subscript: Some(subscript), size, offset } = v {
+                                    let extract = if offset > 0 || size != *sizes.get(name).unwrap_or(&0) {
+                                        Some((size, offset))
+                                    } else {
+                                        None
+                                    };
+
+                                    Operand::Variable { id: ids[&(name.clone(), subscript)], extract: extract }
+                                } else {
+                                    Operand::Value(v.clone())
+                                }
+                            )
+                        };
+
+                        self.assignments[assignee].push(def);
+                        self.definitions.push(Definition { point: ProgramPoint { address: bb.area.start, position: pos }, assignee: assignee, op: op });
                     }
 
                     pos += 1;
                 }
             );
+        }
 
-            Ok(change)
-        } else {
-            Ok(false)
+        Schedule::Block(start..self.definitions.len())
+    }
+
+    fn compile_partition(&mut self, h: &Vec<Box<HierarchicalOrdering<ControlFlowRef>>>, graph: &ControlFlowGraph) -> Schedule {
+        // a partition starting with a component is iterated like that component alone
+        if let Some(&HierarchicalOrdering::Component(ref vec)) = h.first().map(|x| &**x) {
+            return self.compile_partition(vec, graph);
         }
+
+        let start = self.definitions.len();
+        let mut children = vec![];
+        let mut starts = vec![];
+        let mut last_component = None;
+
+        for (i, x) in h.iter().enumerate() {
+            starts.push(self.definitions.len());
+            children.push(
+                match &**x {
+                    &HierarchicalOrdering::Element(vx) => self.compile_block(vx, graph),
+                    &HierarchicalOrdering::Component(ref vec) => {
+                        last_component = Some(i);
+                        self.compile_partition(vec, graph)
+                    }
+                }
+            );
+        }
+
+        Schedule::Component { children: children, starts: starts, last_component: last_component, definitions: start..self.definitions.len() }
     }
-    fn res<A: Avalue>(
-        v: &Rvalue,
-        sizes: &HashMap<Cow<'static, str>, usize>,
-        env: &HashMap<(Cow<'static, str>, usize), A>,
-        fixed: &HashMap<(Cow<'static, str>, usize), A>,
-    ) -> A {
-        if let &Rvalue::Variable {
-                   ref name,
-                   subscript: Some(ref subscript),
-                   ref size,
-                   ref offset,
-               } = v {
-            let nam = (name.clone(), *subscript);
-            let t = fixed.get(&nam).or_else(|| env.get(&nam)).unwrap_or(&A::initial()).clone();
-
-            if *offset > 0 || *size != *sizes.get(&nam.0).unwrap_or(&0) {
-                t.extract(*size, *offset)
-            } else {
-                t
+
+    /// Resets everything depending on the changed variables and computes it again.
+    fn update(&mut self, changes: Vec<((Name, usize), Option<A>)>) {
+        let mut dirty = HashSet::<usize>::new();
+        let mut vars = HashSet::<usize>::new();
+        let mut todo = vec![];
+
+        for (var, value) in changes {
+            let id = self.intern(&var);
+
+            self.fixed[id] = value;
+            todo.extend(self.users[id].iter().cloned());
+        }
+
+        // forward slice along the def-use chains
+        while let Some(def) = todo.pop() {
+            if dirty.insert(def) {
+                let var = self.definitions[def].assignee;
+
+                if vars.insert(var) {
+                    todo.extend(self.users[var].iter().cloned());
+                    todo.extend(self.assignments[var].iter().cloned());
+                }
             }
-        } else {
-            A::abstract_value(v)
         }
-    };
-    let mut ret = HashMap::<(Cow<'static, str>, usize), A>::new();
-    let mut sizes = HashMap::<Cow<'static, str>, usize>::new();
-    let mut constr = HashMap::<Lvalue, A>::new();
 
-    for vx in func.cfg().vertices() {
-        if let Some(&ControlFlowTarget::Resolved(ref bb)) = func.cfg().vertex_label(vx) {
-            bb.execute(
-                |i| if let Lvalue::Variable { ref name, ref size, .. } = i.assignee {
-                    let t = *size;
-                    let s = *sizes.get(name).unwrap_or(&t);
-                    sizes.insert(name.clone(), max(s, t));
+        for &var in vars.iter() {
+            self.values[var] = None;
+        }
+
+        let mut dirty = dirty.into_iter().collect::<Vec<_>>();
+
+        dirty.sort();
+        self.run(&dirty, &vars);
+    }
+
+    fn run(&mut self, dirty: &[usize], vars: &HashSet<usize>) {
+        self.convergence = Convergence::default();
+
+        if dirty.is_empty() {
+            return;
+        }
+
+        let schedule = mem::replace(&mut self.schedule, Schedule::Block(0..0));
+
+        match schedule {
+            Schedule::Block(ref r) => {
+                self.execute(r, false, dirty);
+            }
+            ref c @ Schedule::Component { .. } => {
+                self.stabilize(c, dirty, vars);
+
+                // Narrowing once the outermost component is stable. Narrowing nested components
+                // lets their parent widen the same values again, forever.
+                for &(var, ref a) in self.constraints.iter() {
+                    if vars.contains(&var) {
+                        if let Some(ref mut x) = self.values[var] {
+                            let n = x.narrow(a);
+                            *x = n;
+                        }
+                    }
+                }
+            }
+        }
+
+        self.schedule = schedule;
+    }
+
+    fn stabilize(&mut self, comp: &Schedule, dirty: &[usize], vars: &HashSet<usize>) {
+        let (children, starts, last_component) = match comp {
+            &Schedule::Component { ref children, ref starts, last_component, .. } => (children, starts, last_component),
+            &Schedule::Block(_) => unreachable!(),
+        };
+        let dirty = dirty_in(dirty, &comp.definitions());
+        // children containing dirty definitions. The others would not change.
+        let mut todo = Vec::<usize>::new();
+
+        for &def in dirty {
+            // last child starting at or before `def`. Children without definitions share their
+            // start with the next one.
+            let mut lo = 0;
+            let mut hi = starts.len();
+
+            while lo < hi {
+                let mid = (lo + hi) / 2;
+
+                if starts[mid] <= def {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+
+            let child = lo - 1;
+
+            if todo.last() != Some(&child) {
+                todo.push(child);
+            }
+        }
+
+        let mut iter_cnt = 0;
+
+        loop {
+            let mut stable = true;
+            // past the budget every block is widened, not only the head
+            let exhausted = iter_cnt >= self.component_iterations;
+
+            if iter_cnt == self.component_iterations {
+                self.convergence.exhausted += 1;
+            }
+
+            for &i in todo.iter() {
+                match &children[i] {
+                    &Schedule::Block(ref r) => {
+                        let change = self.execute(r, iter_cnt >= 2 && (i == 0 || exhausted), dirty);
+
+                        // stabilizing a nested component discards the changes before it
+                        if change && last_component.map(|c| i > c).unwrap_or(true) {
+                            stable = false;
+                        }
+                    }
+                    c @ &Schedule::Component { .. } => self.stabilize(c, dirty, vars),
+                }
+            }
+
+            if stable {
+                self.convergence.components += 1;
+                self.convergence.iterations += iter_cnt + 1;
+                self.convergence.max_iterations = max(self.convergence.max_iterations, iter_cnt + 1);
+                return;
+            }
+
+            iter_cnt += 1;
+        }
+    }
+
+    /// Executes the dirty definitions in `range`. Returns true if a value changed.
+    fn execute(&mut self, range: &Range<usize>, do_widen: bool, dirty: &[usize]) -> bool {
+        let mut change = false;
+
+        for &def in dirty_in(dirty, range) {
+            // out of budget. Nothing changes anymore, so all components stabilize.
+            if let Some(ref mut steps) = self.steps {
+                if *steps == 0 {
+                    self.out_of_steps = true;
+                    return false;
+                }
+                *steps -= 1;
+            }
+            self.convergence.steps += 1;
+
+            let new = {
+                let values = &self.values;
+                let fixed = &self.fixed;
+                let d = &self.definitions[def];
+                let op = lift(
+                    &d.op,
+                    &|x| match x {
+                        &Operand::Variable { id, extract } => {
+                            let t = fixed[id].as_ref().or(values[id].as_ref()).cloned().unwrap_or(A::initial());
+
+                            match extract {
+                                Some((size, offset)) => t.extract(size, offset),
+                                None => t,
+                            }
+                        }
+                        &Operand::Value(ref v) => A::abstract_value(v),
+                    }
+                );
+                let new = A::execute(&d.point, &op);
+
+                debug!("{:?} {:?}: {:?} = {:?}", d.point, self.names[d.assignee], op, new);
+                new
+            };
+            let assignee = self.definitions[def].assignee;
+            let cur = self.values[assignee].take();
+
+            debug!("    prev: {:?}", cur);
+
+            self.values[assignee] = Some(
+                match cur {
+                    Some(cur) => {
+                        if do_widen {
+                            let w = cur.widen_with_thresholds(&new, &self.thresholds);
+
+                            debug!("    widen to {:?}", w);
+
+                            if w != cur {
+                                change = true;
+                                self.convergence.widenings += 1;
+                                debug!("    new value {:?}", w);
+                            }
+                            w
+                        } else if !cur.more_exact(&new) && cur != new {
+                            change = true;
+                            debug!("    new value {:?}", new);
+                            new
+                        } else {
+                            debug!("    {:?} is more exact than {:?}", cur, new);
+                            cur
+                        }
+                    }
+                    None => {
+                        change = true;
+                        debug!("    new value {:?}", new);
+                        new
+                    }
                 }
             );
         }
+
+        change
     }
+}
+
+/// Constraints on variables implied by the guards of `func`'s control flow graph.
+fn constraints<A: Avalue>(func: &Function) -> HashMap<Lvalue, A> {
+    let edge_ops = flag_operations(func);
+    let mut constr = HashMap::<Lvalue, A>::new();
 
     for vx in func.cfg().vertices() {
         for e in func.cfg().in_edges(vx) {
@@ -310,48 +762,17 @@ pub fn approximate<A: Avalue>(func: &Function, fixed: &HashMap<(Cow<'static, str
         }
     }
 
-    match wto {
-        HierarchicalOrdering::Component(ref v) => {
-            stabilize(v, &func.cfg(), &constr, &sizes, &mut ret, fixed)?;
-        }
-        HierarchicalOrdering::Element(ref v) => {
-            execute(
-                *v,
-                false,
-                &func.cfg(),
-                &constr,
-                &sizes,
-                &mut ret,
-                fixed,
-            )?;
-        }
-    }
-
-    for (k, v) in fixed.iter() {
-        ret.insert(k.clone(), v.clone());
-    }
-
-    Ok(
-        HashMap::from_iter(
-            ret.iter()
-                .filter_map(
-                    |(&(ref name, ref subscript), val)| if let Some(sz) = sizes.get(name) {
-                        Some((Lvalue::Variable { name: name.clone(), subscript: Some(*subscript), size: *sz }, val.clone()))
-                    } else {
-                        None
-                    }
-                )
-        )
-    )
+    constr
 }
 
 /// Given a function and an abstract interpretation result this functions returns that variable
 /// names and abstract values that live after the function returns.
-pub fn results<A: Avalue>(func: &Function, vals: &HashMap<Lvalue, A>) -> HashMap<(Cow<'static, str>, usize), A> {
+pub fn results<A: Avalue>(func: &Function, vals: &HashMap<Lvalue, A>) -> HashMap<(Name, usize), A> {
     let cfg = func.cfg();
-    let idom = immediate_dominator(func.entry_point_ref(), cfg);
-    let mut ret = HashMap::<(Cow<'static, str>, usize), A>::new();
-    let mut names = HashSet::<Cow<'static, str>>::new();
+    let order = func.block_order();
+    let idom = func.immediate_dominators();
+    let mut ret = HashMap::<(Name, usize), A>::new();
+    let mut names = HashSet::<Name>::new();
 
     for vx in cfg.vertices() {
         if let Some(&ControlFlowTarget::Resolved(ref bb)) = cfg.vertex_label(vx) {
@@ -384,7 +805,7 @@ pub fn results<A: Avalue>(func: &Function, vals: &HashMap<Lvalue, A>) -> HashMap
                         );
 
                         if !hit {
-                            let next_bb = idom.get(&bbv.1).cloned();
+                            let next_bb = order.index.get(&bbv.1).and_then(|&b| idom[b]).map(|d| order.blocks[d]);
                             let fixpoint = {
                                 next_bb == Some(bbv.1)
                             };
@@ -452,7 +873,6 @@ mod tests {
     use panopticon_core::{BasicBlock, Bound, ControlFlowGraph, ControlFlowTarget, Function, Guard, Lvalue, Mnemonic, Operation, Region, Rvalue, Statement};
     use panopticon_data_flow::ssa_convertion;
     use panopticon_graph_algos::MutableGraphTrait;
-    use std::borrow::Cow;
 
     #[derive(Debug,Clone,PartialEq,Eq,Hash,Serialize,Deserialize)]
     enum Sign {
@@ -642,9 +1062,9 @@ mod tests {
      */
     #[test]
     fn signedness_analysis() {
-        let x_var = Lvalue::Variable { name: Cow::Borrowed("x"), size: 32, subscript: None };
-        let n_var = Lvalue::Variable { name: Cow::Borrowed("n"), size: 32, subscript: None };
-        let flag = Lvalue::Variable { name: Cow::Borrowed("flag"), size: 1, subscript: None };
+        let x_var = Lvalue::Variable { name: Name::new("x"), size: 32, subscript: None };
+        let n_var = Lvalue::Variable { name: Name::new("n"), size: 32, subscript: None };
+        let flag = Lvalue::Variable { name: Name::new("flag"), size: 1, subscript: None };
         let bb0 = BasicBlock::from_vec(
             vec![
                 Mnemonic::new(
@@ -766,8 +1186,8 @@ mod tests {
         let vals = approximate::<Sign>(&func, &HashMap::new()).ok().unwrap();
         let res = results::<Sign>(&func, &vals);
 
-        assert_eq!(res[&(Cow::Borrowed("x"), 32)], Sign::Join);
-        assert_eq!(res[&(Cow::Borrowed("n"), 32)], Sign::Positive);
+        assert_eq!(res[&(Name::new("x"), 32)], Sign::Join);
+        assert_eq!(res[&(Name::new("n"), 32)], Sign::Positive);
     }
 
     /*
@@ -782,9 +1202,9 @@ mod tests {
      */
     #[test]
     fn signedness_narrow() {
-        let a_var = Lvalue::Variable { name: Cow::Borrowed("a"), size: 32, subscript: None };
-        let b_var = Lvalue::Variable { name: Cow::Borrowed("b"), size: 32, subscript: None };
-        let flag = Lvalue::Variable { name: Cow::Borrowed("flag"), size: 1, subscript: None };
+        let a_var = Lvalue::Variable { name: Name::new("a"), size: 32, subscript: None };
+        let b_var = Lvalue::Variable { name: Name::new("b"), size: 32, subscript: None };
+        let flag = Lvalue::Variable { name: Name::new("flag"), size: 1, subscript: None };
         let bb0 = BasicBlock::from_vec(
             vec![
                 Mnemonic::new(
@@ -942,7 +1362,116 @@ mod tests {
         println!("vals: {:?}", vals);
         println!("res: {:?}", res);
 
-        assert_eq!(res.get(&(Cow::Borrowed("a"), 32)), Some(&Sign::Positive));
-        assert_eq!(res.get(&(Cow::Borrowed("b"), 32)), Some(&Sign::Positive));
+        assert_eq!(res.get(&(Name::new("a"), 32)), Some(&Sign::Positive));
+        assert_eq!(res.get(&(Name::new("b"), 32)), Some(&Sign::Positive));
+    }
+
+    /*
+     * x = 0
+     * n = 1
+     * while(n <= ?) {
+     *   x = x + n
+     *   n = n + 1
+     * }
+     * y = x - n
+     * z = 0 - 1
+     */
+    #[test]
+    fn incremental() {
+        let x = Lvalue::Variable { name: Name::new("x"), size: 32, subscript: None };
+        let n = Lvalue::Variable { name: Name::new("n"), size: 32, subscript: None };
+        let y = Lvalue::Variable { name: Name::new("y"), size: 32, subscript: None };
+        let z = Lvalue::Variable { name: Name::new("z"), size: 32, subscript: None };
+        let flag = Lvalue::Variable { name: Name::new("flag"), size: 1, subscript: None };
+        let mne = |addr: u64, op: Operation<Rvalue>, assignee: &Lvalue| {
+            Mnemonic::new(addr..addr + 1, "test".to_string(), "".to_string(), vec![].iter(), vec![Statement { op: op, assignee: assignee.clone() }].iter())
+                .ok()
+                .unwrap()
+        };
+        let bb0 = BasicBlock::from_vec(
+            vec![
+                mne(0, Operation::Move(Rvalue::new_u64(0)), &x),
+                mne(1, Operation::Move(Rvalue::new_u64(1)), &n),
+                mne(2, Operation::LessOrEqualSigned(n.clone().into(), Rvalue::Undefined), &flag),
+            ]
+        );
+        let bb1 = BasicBlock::from_vec(
+            vec![
+                mne(3, Operation::Add(x.clone().into(), n.clone().into()), &x),
+                mne(4, Operation::Add(n.clone().into(), Rvalue::new_u64(1)), &n),
+                mne(5, Operation::LessOrEqualSigned(n.clone().into(), Rvalue::Undefined), &flag),
+            ]
+        );
+        let bb2 = BasicBlock::from_vec(
+            vec![
+                mne(6, Operation::Subtract(x.clone().into(), n.clone().into()), &y),
+                mne(7, Operation::Subtract(Rvalue::new_u64(0), Rvalue::new_u64(1)), &z),
+            ]
+        );
+        let mut cfg = ControlFlowGraph::new();
+        let v0 = cfg.add_vertex(ControlFlowTarget::Resolved(bb0));
+        let v1 = cfg.add_vertex(ControlFlowTarget::Resolved(bb1));
+        let v2 = cfg.add_vertex(ControlFlowTarget::Resolved(bb2));
+        let g = Guard::from_flag(&flag.clone().into()).ok().unwrap();
+
+        cfg.add_edge(g.negation(), v0, v2);
+        cfg.add_edge(g.negation(), v1, v2);
+        cfg.add_edge(g.clone(), v0, v1);
+        cfg.add_edge(g.clone(), v1, v1);
+
+        let mut func = Function::undefined(0, None, &Region::undefined("ram".to_owned(), 100), Some("test".to_owned()));
+
+        *func.cfg_mut() = cfg;
+        func.set_entry_point_ref(v0);
+
+        assert!(ssa_convertion(&mut func).is_ok());
+
+        let mut inc = Interpretation::<Sign>::new(&func);
+        let vars = inc.values()
+            .keys()
+            .filter_map(
+                |lv| if let &Lvalue::Variable { ref name, subscript: Some(s), .. } = lv {
+                    Some((name.clone(), s))
+                } else {
+                    None
+                }
+            )
+            .collect::<Vec<_>>();
+        let mut fixed = HashMap::new();
+
+        assert_eq!(inc.values(), approximate::<Sign>(&func, &fixed).ok().unwrap());
+
+        for var in vars.iter() {
+            for val in vec![Sign::Negative, Sign::Zero, Sign::Positive, Sign::Join] {
+                fixed.insert(var.clone(), val.clone());
+                inc.set_input(var.clone(), Some(val));
+                assert_eq!(inc.values(), approximate::<Sign>(&func, &fixed).ok().unwrap());
+                assert_eq!(inc.inputs(), fixed);
+            }
+        }
+
+        for var in vars.iter() {
+            fixed.remove(var);
+            inc.set_input(var.clone(), None);
+            assert_eq!(inc.values(), approximate::<Sign>(&func, &fixed).ok().unwrap());
+        }
+
+        fixed.insert(vars[0].clone(), Sign::Negative);
+        fixed.insert(vars[1].clone(), Sign::Zero);
+        inc.set_inputs(&fixed);
+        assert_eq!(inc.values(), approximate::<Sign>(&func, &fixed).ok().unwrap());
+
+        fixed.remove(&vars[0]);
+        inc.set_inputs(&fixed);
+        assert_eq!(inc.values(), approximate::<Sign>(&func, &fixed).ok().unwrap());
+
+        assert!(Interpretation::<Sign>::with_budget(&func, &fixed, 3).is_err());
+        assert_eq!(Interpretation::<Sign>::with_budget(&func, &fixed, 1000).ok().unwrap().values(), inc.values());
+
+        // a budget of exactly the steps needed suffices
+        let steps = Interpretation::<Sign>::with_inputs(&func, &fixed).convergence().steps;
+
+        assert_eq!(Interpretation::<Sign>::with_budget(&func, &fixed, steps).ok().unwrap().values(), inc.values());
+        assert!(Interpretation::<Sign>::with_budget(&func, &fixed, steps - 1).is_err());
     }
 }
@@ -15,21 +15,173 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
-
 //! Kindler et.al style Kset domain.
 //!
-//! TODO
+//! Sets are stored inline and kept sorted, so abstract values never allocate and the lattice
+//! operations are linear merges. Arithmetic on sets of equally sized values is computed on plain
+//! `u64` arrays instead of going through `execute`.
 
 use {Avalue, Constraint, ProgramPoint};
 
 use panopticon_core::{Operation, Rvalue, execute};
-use std::collections::HashSet;
+use serde::{Deserialize, Deserializer, Serialize, Serializer};
+use serde::de::Error;
 use std::fmt;
-use std::iter::FromIterator;
+use std::hash::{Hash, Hasher};
+use std::ops::Deref;
+use std::result;
 
 /// Largest Kset cardinality before Join.
 const KSET_MAXIMAL_CARDINALITY: usize = 10;
 
+/// Concrete values of a `Kset::Set` and their size in bits. Sorted, free of duplicates and never
+/// larger than `KSET_MAXIMAL_CARDINALITY`.
+#[derive(Clone,Copy)]
+pub struct KsetValues {
+    len: usize,
+    values: [(u64, usize); KSET_MAXIMAL_CARDINALITY],
+}
+
+impl KsetValues {
+    fn new() -> KsetValues {
+        KsetValues { len: 0, values: [(0, 0); KSET_MAXIMAL_CARDINALITY] }
+    }
+
+    /// Appends `v`. Callers keep the values sorted. Returns false if the set is full.
+    fn push(&mut self, v: (u64, usize)) -> bool {
+        if self.len == KSET_MAXIMAL_CARDINALITY {
+            false
+        } else {
+            self.values[self.len] = v;
+            self.len += 1;
+            true
+        }
+    }
+
+    /// Sorts `buf` and removes duplicates. Returns `None` if too many values remain.
+    fn compact(buf: &mut [(u64, usize)]) -> Option<KsetValues> {
+        let mut ret = KsetValues::new();
+
+        buf.sort_unstable();
+
+        for &v in buf.iter() {
+            if ret.len == 0 || ret.values[ret.len - 1] != v {
+                if !ret.push(v) {
+                    return None;
+                }
+            }
+        }
+
+        Some(ret)
+    }
+
+    /// Merges two sorted sets. Returns `None` if the union is too large.
+    fn union(a: &[(u64, usize)], b: &[(u64, usize)]) -> Option<KsetValues> {
+        let mut ret = KsetValues::new();
+        let mut i = 0;
+        let mut j = 0;
+
+        while i < a.len() || j < b.len() {
+            let v = if j == b.len() || (i < a.len() && a[i] < b[j]) {
+                i += 1;
+                a[i - 1]
+            } else if i == a.len() || b[j] < a[i] {
+                j += 1;
+                b[j - 1]
+            } else {
+                i += 1;
+                j += 1;
+                a[i - 1]
+            };
+
+            if !ret.push(v) {
+                return None;
+            }
+        }
+
+        Some(ret)
+    }
+
+    fn intersection(a: &[(u64, usize)], b: &[(u64, usize)]) -> KsetValues {
+        let mut ret = KsetValues::new();
+        let mut i = 0;
+        let mut j = 0;
+
+        while i < a.len() && j < b.len() {
+            if a[i] < b[j] {
+                i += 1;
+            } else if b[j] < a[i] {
+                j += 1;
+            } else {
+                ret.push(a[i]);
+                i += 1;
+                j += 1;
+            }
+        }
+
+        ret
+    }
+
+    /// True if all values of `a` are in `b`.
+    fn is_subset(a: &[(u64, usize)], b: &[(u64, usize)]) -> bool {
+        let mut j = 0;
+
+        for x in a.iter() {
+            while j < b.len() && b[j] < *x {
+                j += 1;
+            }
+            if j == b.len() || b[j] != *x {
+                return false;
+            }
+        }
+
+        true
+    }
+}
+
+impl Deref for KsetValues {
+    type Target = [(u64, usize)];
+
+    fn deref(&self) -> &[(u64, usize)] {
+        &self.values[0..self.len]
+    }
+}
+
+impl PartialEq for KsetValues {
+    fn eq(&self, other: &KsetValues) -> bool {
+        **self == **other
+    }
+}
+
+impl Eq for KsetValues {}
+
+impl Hash for KsetValues {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        (**self).hash(state)
+    }
+}
+
+impl fmt::Debug for KsetValues {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_list().entries(self.iter()).finish()
+    }
+}
+
+// Serialized like the `Vec` older versions used.
+impl Serialize for KsetValues {
+    fn serialize<S: Serializer>(&self, serializer: S) -> result::Result<S::Ok, S::Error> {
+        (**self).serialize(serializer)
+    }
+}
+
+impl<'de> Deserialize<'de> for KsetValues {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> result::Result<KsetValues, D::Error> {
+        let mut v = Vec::<(u64, usize)>::deserialize(deserializer)?;
+
+        KsetValues::compact(&mut v).ok_or_else(|| D::Error::custom("too many values in Kset"))
+    }
+}
+
 /// Kindler et.al style Kset domain. Domain elements are sets of concrete values. Sets have a
 /// maximum cardinality. Every set larger than that is equal the lattice join. The partial order is
 /// set inclusion.
@@ -39,11 +191,34 @@ pub enum Kset {
     Join,
     /// Set of concrete values and their size in bits. The set is never empty and never larger than
     /// `KSET_MAXIMAL_CARDINALITY`.
-    Set(Vec<(u64, usize)>),
+    Set(KsetValues),
     /// Lattice meet, equal to the empty set.
     Meet,
 }
 
+impl Kset {
+    /// Set of the concrete values `values` and their sizes in bits. Returns `Kset::Join` if there
+    /// are more than `KSET_MAXIMAL_CARDINALITY` distinct values and `Kset::Meet` if there are none.
+    pub fn from_values<I: IntoIterator<Item = (u64, usize)>>(values: I) -> Kset {
+        Kset::from_buffer(&mut values.into_iter().collect::<Vec<_>>())
+    }
+
+    fn from_buffer(buf: &mut [(u64, usize)]) -> Kset {
+        match KsetValues::compact(buf) {
+            Some(ref v) if v.len == 0 => Kset::Meet,
+            Some(v) => Kset::Set(v),
+            None => Kset::Join,
+        }
+    }
+
+    fn singleton(value: u64, size: usize) -> Kset {
+        let mut v = KsetValues::new();
+
+        v.push((if size < 64 { value % (1u64 << size) } else { value }, size));
+        Kset::Set(v)
+    }
+}
+
 impl fmt::Display for Kset {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
         match self {
@@ -52,7 +227,7 @@ impl fmt::Display for Kset {
             &Kset::Set(ref vec) if vec.len() == 1 => write!(f, "{{0x{:x}}}", vec[0].0),
             &Kset::Set(ref vec) => {
                 write!(f, "{{0x{:x}", vec[0].0)?;
-                for &(v, _) in vec.iter() {
+                for &(v, _) in vec.iter().skip(1) {
                     write!(f, ", 0x{:x}", v)?;
                 }
                 write!(f, "}}")
@@ -66,7 +241,7 @@ impl PartialEq for Kset {
     fn eq(&self, other: &Kset) -> bool {
         match (self, other) {
             (&Kset::Meet, &Kset::Meet) => true,
-            (&Kset::Set(ref a), &Kset::Set(ref b)) => a.len() == b.len() && a.iter().zip(b.iter()).all(|(a, b)| a == b),
+            (&Kset::Set(ref a), &Kset::Set(ref b)) => a == b,
             (&Kset::Join, &Kset::Join) => true,
             _ => false,
         }
@@ -76,16 +251,7 @@ impl PartialEq for Kset {
 impl Avalue for Kset {
     fn abstract_value(v: &Rvalue) -> Self {
         if let &Rvalue::Constant { ref value, ref size } = v {
-            Kset::Set(
-                vec![
-                    (if *size < 64 {
-                         *value % (1u64 << *size)
-                     } else {
-                         *value
-                     },
-                     *size),
-                ]
-            )
+            Kset::singleton(*value, *size)
         } else {
             Kset::Join
         }
@@ -93,16 +259,7 @@ impl Avalue for Kset {
 
     fn abstract_constraint(constr: &Constraint) -> Self {
         if let &Constraint::Equal(Rvalue::Constant { ref value, ref size }) = constr {
-            Kset::Set(
-                vec![
-                    (if *size < 64 {
-                         *value % (1u64 << *size)
-                     } else {
-                         *value
-                     },
-                     *size),
-                ]
-            )
+            Kset::singleton(*value, *size)
         } else {
             Kset::Join
         }
@@ -114,65 +271,86 @@ impl Avalue for Kset {
                 (&Kset::Join, _) => Kset::Join,
                 (_, &Kset::Join) => Kset::Join,
                 (&Kset::Set(ref a), &Kset::Set(ref b)) => {
-                    let mut ret = HashSet::<(u64, usize)>::new();
+                    let mut buf = [(0, 0); KSET_MAXIMAL_CARDINALITY * KSET_MAXIMAL_CARDINALITY];
+                    let mut len = 0;
+
                     for &(_x, _xs) in a.iter() {
                         let x = Rvalue::Constant { value: _x, size: _xs };
                         for &(_y, _ys) in b.iter() {
                             let y = Rvalue::Constant { value: _y, size: _ys };
                             if let Rvalue::Constant { value, size } = f(x.clone(), y) {
-                                ret.insert((value, size));
-                                if ret.len() > KSET_MAXIMAL_CARDINALITY {
-                                    return Kset::Join;
-                                }
+                                buf[len] = (value, size);
+                                len += 1;
                             }
                         }
                     }
 
-                    if ret.is_empty() {
-                        Kset::Meet
-                    } else {
-                        let mut v = ret.drain().collect::<Vec<(u64, usize)>>();
-                        v.sort();
-                        Kset::Set(v)
-                    }
+                    Kset::from_buffer(&mut buf[0..len])
                 }
                 _ => Kset::Meet,
             }
         };
+        // Same as `permute` for operations that never fail on constants. If all values have the
+        // same size `f` is applied to the cross product in a tight loop without any `Rvalue`s.
+        fn pairwise<F: Fn(u64, u64) -> u64>(_a: &Kset, _b: &Kset, f: F, g: &Fn(Rvalue, Rvalue) -> Rvalue) -> Kset {
+            if let (&Kset::Set(ref a), &Kset::Set(ref b)) = (_a, _b) {
+                let size = a.first().map(|x| x.1).unwrap_or(0);
+
+                if !a.is_empty() && !b.is_empty() && a.iter().chain(b.iter()).all(|&(_, s)| s == size) {
+                    let mask = if size < 64 { (1u64 << size) - 1 } else { !0 };
+
+                    // constants, the common case
+                    if a.len() == 1 && b.len() == 1 {
+                        let mut ret = KsetValues::new();
+
+                        ret.push((f(a[0].0, b[0].0) & mask, size));
+                        return Kset::Set(ret);
+                    }
+
+                    let mut ys = [0u64; KSET_MAXIMAL_CARDINALITY];
+                    let mut buf = [(0, size); KSET_MAXIMAL_CARDINALITY * KSET_MAXIMAL_CARDINALITY];
+
+                    for (y, &(v, _)) in ys.iter_mut().zip(b.iter()) {
+                        *y = v;
+                    }
+
+                    for (row, &(x, _)) in buf.chunks_mut(b.len()).zip(a.iter()) {
+                        for (r, &y) in row.iter_mut().zip(ys[0..b.len()].iter()) {
+                            r.0 = f(x, y) & mask;
+                        }
+                    }
+
+                    return Kset::from_buffer(&mut buf[0..a.len() * b.len()]);
+                }
+            }
+
+            permute(_a, _b, g)
+        };
         fn map(_a: &Kset, f: &Fn(Rvalue) -> Rvalue) -> Kset {
             if let &Kset::Set(ref a) = _a {
-                let mut s = HashSet::<(u64, usize)>::from_iter(
-                    a.iter()
-                        .filter_map(
-                            |&(a, _as)| if let Rvalue::Constant { value, size } = f(Rvalue::Constant { value: a, size: _as }) {
-                                Some((value, size))
-                            } else {
-                                None
-                            }
-                        )
-                );
-
-                if s.len() > KSET_MAXIMAL_CARDINALITY {
-                    Kset::Join
-                } else if s.is_empty() {
-                    Kset::Meet
-                } else {
-                    let mut v = s.drain().collect::<Vec<(_, _)>>();
-                    v.sort();
-                    Kset::Set(v)
+                let mut buf = [(0, 0); KSET_MAXIMAL_CARDINALITY];
+                let mut len = 0;
+
+                for &(a, _as) in a.iter() {
+                    if let Rvalue::Constant { value, size } = f(Rvalue::Constant { value: a, size: _as }) {
+                        buf[len] = (value, size);
+                        len += 1;
+                    }
                 }
+
+                Kset::from_buffer(&mut buf[0..len])
             } else {
                 _a.clone()
             }
         };
 
         match *op {
-            Operation::And(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::And(a, b))),
-            Operation::InclusiveOr(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::InclusiveOr(a, b))),
-            Operation::ExclusiveOr(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::ExclusiveOr(a, b))),
-            Operation::Add(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::Add(a, b))),
-            Operation::Subtract(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::Subtract(a, b))),
-            Operation::Multiply(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::Multiply(a, b))),
+            Operation::And(ref a, ref b) => pairwise(a, b, |x, y| x & y, &|a, b| execute(Operation::And(a, b))),
+            Operation::InclusiveOr(ref a, ref b) => pairwise(a, b, |x, y| x | y, &|a, b| execute(Operation::InclusiveOr(a, b))),
+            Operation::ExclusiveOr(ref a, ref b) => pairwise(a, b, |x, y| x ^ y, &|a, b| execute(Operation::ExclusiveOr(a, b))),
+            Operation::Add(ref a, ref b) => pairwise(a, b, |x, y| x.wrapping_add(y), &|a, b| execute(Operation::Add(a, b))),
+            Operation::Subtract(ref a, ref b) => pairwise(a, b, |x, y| x.wrapping_sub(y), &|a, b| execute(Operation::Subtract(a, b))),
+            Operation::Multiply(ref a, ref b) => pairwise(a, b, |x, y| x.wrapping_mul(y), &|a, b| execute(Operation::Multiply(a, b))),
             Operation::DivideSigned(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::DivideSigned(a, b))),
             Operation::DivideUnsigned(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::DivideUnsigned(a, b))),
             Operation::Modulo(ref a, ref b) => permute(a, b, &|a, b| execute(Operation::Modulo(a, b))),
@@ -213,10 +391,11 @@ impl Avalue for Kset {
             &Kset::Set(ref v) => {
                 match self {
                     &Kset::Meet => Kset::Meet,
-                    &Kset::Join => Kset::Set(v.clone()),
+                    &Kset::Join => Kset::Set(*v),
                     &Kset::Set(ref w) => {
-                        let set = HashSet::<&(u64, usize)>::from_iter(v.iter());
-                        Kset::Set(w.iter().filter(|x| set.contains(x)).cloned().collect::<Vec<_>>())
+                        let ret = KsetValues::intersection(w, v);
+
+                        if ret.len == 0 { Kset::Meet } else { Kset::Set(ret) }
                     }
                 }
             }
@@ -230,21 +409,61 @@ impl Avalue for Kset {
             (a, &Kset::Meet) => a.clone(),
             (&Kset::Meet, b) => b.clone(),
             (&Kset::Set(ref a), &Kset::Set(ref b)) => {
-                let mut ret = HashSet::<&(u64, usize)>::from_iter(a.iter().chain(b.iter())).iter().cloned().cloned().collect::<Vec<(u64, usize)>>();
-                ret.sort();
-                if ret.is_empty() {
-                    Kset::Meet
-                } else if ret.len() > KSET_MAXIMAL_CARDINALITY {
-                    Kset::Join
-                } else {
-                    Kset::Set(ret)
+                match KsetValues::union(a, b) {
+                    Some(v) => Kset::Set(v),
+                    None => Kset::Join,
                 }
             }
         }
     }
 
     fn widen(&self, s: &Self) -> Self {
-        s.clone()
+        self.widen_with_thresholds(s, &[])
+    }
+
+    // Sets only grow, so the iteration ends after at most KSET_MAXIMAL_CARDINALITY steps. If the
+    // new values continue counting up or down towards a threshold too far away to reach without
+    // exceeding the cardinality, the set goes to Join right away.
+    fn widen_with_thresholds(&self, s: &Self, thresholds: &[Rvalue]) -> Self {
+        let (a, u) = match (self, s) {
+            (&Kset::Set(ref a), &Kset::Set(ref b)) => {
+                match KsetValues::union(a, b) {
+                    Some(u) => (a, u),
+                    None => return Kset::Join,
+                }
+            }
+            _ => return self.combine(s),
+        };
+
+        if u.len == a.len || u.iter().any(|&(_, sz)| sz != u[0].1) {
+            return Kset::Set(u);
+        }
+
+        let (min, max) = (a[0].0, a[a.len - 1].0);
+        let up = u.iter().all(|&(v, _)| v >= min) && u[u.len - 1].0 > max;
+        let down = u.iter().all(|&(v, _)| v <= max) && u[0].0 < min;
+        let step = u.windows(2).map(|w| w[1].0 - w[0].0).min().unwrap_or(1);
+        let thres = thresholds.iter().filter_map(
+            |t| match t {
+                &Rvalue::Constant { value, size } if size == u[0].1 => Some(value),
+                _ => None,
+            }
+        );
+        // values still to come before the loop reaches the nearest threshold
+        let rest = if up {
+            let last = u[u.len - 1].0;
+            thres.filter(|&t| t >= last).min().map(|t| (t - last) / step + ((t - last) % step != 0) as u64)
+        } else if down {
+            let first = u[0].0;
+            thres.filter(|&t| t <= first).max().map(|t| (first - t) / step + ((first - t) % step != 0) as u64)
+        } else {
+            return Kset::Set(u);
+        };
+
+        match rest {
+            Some(r) if r > (KSET_MAXIMAL_CARDINALITY - u.len) as u64 => Kset::Join,
+            _ => Kset::Set(u),
+        }
     }
 
     fn initial() -> Self {
@@ -258,7 +477,7 @@ impl Avalue for Kset {
             match (self, a) {
                 (&Kset::Join, _) => true,
                 (_, &Kset::Meet) => true,
-                (&Kset::Set(ref a), &Kset::Set(ref b)) => HashSet::<&(u64, usize)>::from_iter(a.iter()).is_superset(&HashSet::from_iter(b.iter())),
+                (&Kset::Set(ref a), &Kset::Set(ref b)) => KsetValues::is_subset(b, a),
                 _ => false,
             }
         }
@@ -268,7 +487,15 @@ impl Avalue for Kset {
         match self {
             &Kset::Join => Kset::Join,
             &Kset::Meet => Kset::Meet,
-            &Kset::Set(ref v) => Kset::Set(v.iter().map(|&(v, _)| ((v >> offset) % (1 << (size - 1)), size)).collect::<Vec<_>>()),
+            &Kset::Set(ref v) => {
+                let mut buf = [(0, 0); KSET_MAXIMAL_CARDINALITY];
+
+                for (b, &(v, _)) in buf.iter_mut().zip(v.iter()) {
+                    *b = ((v >> offset) % (1 << (size - 1)), size);
+                }
+
+                Kset::from_buffer(&mut buf[0..v.len()])
+            }
         }
     }
 }
@@ -276,12 +503,11 @@ impl Avalue for Kset {
 #[cfg(test)]
 mod tests {
     use super::*;
-    use interpreter::{approximate, results};
-    use panopticon_core::{BasicBlock, ControlFlowGraph, ControlFlowTarget, Function, Guard, Lvalue, Mnemonic, Operation, Region, Rvalue, Statement};
+    use interpreter::{Interpretation, approximate, results};
+    use panopticon_core::{BasicBlock, ControlFlowGraph, ControlFlowTarget, Function, Guard, Lvalue, Mnemonic, Name, Operation, Region, Rvalue, Statement};
     use panopticon_data_flow::ssa_convertion;
     use panopticon_graph_algos::MutableGraphTrait;
-    use std::borrow::Cow;
-    use std::collections::HashMap;
+    use std::collections::{HashMap, HashSet};
 
     /*
      * a = 10
@@ -304,11 +530,11 @@ mod tests {
     fn kset_test() {
         let _ = ::env_logger::init();
 
-        let a_var = Lvalue::Variable { name: Cow::Borrowed("a"), size: 32, subscript: None };
-        let b_var = Lvalue::Variable { name: Cow::Borrowed("b"), size: 32, subscript: None };
-        let c_var = Lvalue::Variable { name: Cow::Borrowed("c"), size: 32, subscript: None };
-        let x_var = Lvalue::Variable { name: Cow::Borrowed("x"), size: 32, subscript: None };
-        let flag = Lvalue::Variable { name: Cow::Borrowed("flag"), size: 1, subscript: None };
+        let a_var = Lvalue::Variable { name: Name::new("a"), size: 32, subscript: None };
+        let b_var = Lvalue::Variable { name: Name::new("b"), size: 32, subscript: None };
+        let c_var = Lvalue::Variable { name: Name::new("c"), size: 32, subscript: None };
+        let x_var = Lvalue::Variable { name: Name::new("x"), size: 32, subscript: None };
+        let flag = Lvalue::Variable { name: Name::new("flag"), size: 1, subscript: None };
         let bb0 = BasicBlock::from_vec(
             vec![
                 Mnemonic::new(
@@ -541,21 +767,21 @@ mod tests {
         let vals = approximate::<Kset>(&func, &HashMap::new()).ok().unwrap();
         let res = results::<Kset>(&func, &vals);
 
-        assert_eq!(res[&(Cow::Borrowed("a"), 32)], Kset::Join);
-        assert_eq!(res[&(Cow::Borrowed("b"), 32)], Kset::Join);
+        assert_eq!(res[&(Name::new("a"), 32)], Kset::Join);
+        assert_eq!(res[&(Name::new("b"), 32)], Kset::Join);
         assert_eq!(
-            res[&(Cow::Borrowed("c"), 32)],
-            Kset::Set(vec![(2, 32), (3, 32), (4, 32)])
+            res[&(Name::new("c"), 32)],
+            Kset::from_values(vec![(2, 32), (3, 32), (4, 32)])
         );
-        assert_eq!(res[&(Cow::Borrowed("x"), 32)], Kset::Join);
+        assert_eq!(res[&(Name::new("x"), 32)], Kset::Join);
     }
 
     #[test]
     fn bit_extract() {
-        let p_var = Lvalue::Variable { name: Cow::Borrowed("p"), size: 22, subscript: None };
-        let r1_var = Lvalue::Variable { name: Cow::Borrowed("r1"), size: 8, subscript: None };
-        let r2_var = Lvalue::Variable { name: Cow::Borrowed("r2"), size: 8, subscript: None };
-        let next = Lvalue::Variable { name: Cow::Borrowed("R30:R31"), size: 22, subscript: None };
+        let p_var = Lvalue::Variable { name: Name::new("p"), size: 22, subscript: None };
+        let r1_var = Lvalue::Variable { name: Name::new("r1"), size: 8, subscript: None };
+        let r2_var = Lvalue::Variable { name: Name::new("r2"), size: 8, subscript: None };
+        let next = Lvalue::Variable { name: Name::new("R30:R31"), size: 22, subscript: None };
         let bb0 = BasicBlock::from_vec(
             vec![
                 Mnemonic::new(
@@ -677,4 +903,126 @@ mod tests {
             println!("{:?}", i);
         }
     }
+
+    /*
+     * i = 0
+     * while(i < bound) {
+     *   i = (i + 1) & mask
+     * }
+     */
+    fn counting_loop(bound: u32, mask: u32) -> Function {
+        let i = Lvalue::Variable { name: Name::new("i"), size: 32, subscript: None };
+        let flag = Lvalue::Variable { name: Name::new("flag"), size: 1, subscript: None };
+        let mne = |addr: u64, op: Operation<Rvalue>, assignee: &Lvalue| {
+            Mnemonic::new(addr..addr + 1, "test".to_string(), "".to_string(), vec![].iter(), vec![Statement { op: op, assignee: assignee.clone() }].iter())
+                .ok()
+                .unwrap()
+        };
+        let bb0 = BasicBlock::from_vec(vec![mne(0, Operation::Move(Rvalue::new_u32(0)), &i)]);
+        let bb1 = BasicBlock::from_vec(vec![mne(1, Operation::LessUnsigned(i.clone().into(), Rvalue::new_u32(bound)), &flag)]);
+        let bb2 = BasicBlock::from_vec(
+            vec![
+                mne(2, Operation::Add(i.clone().into(), Rvalue::new_u32(1)), &i),
+                mne(3, Operation::And(i.clone().into(), Rvalue::new_u32(mask)), &i),
+            ]
+        );
+        let bb3 = BasicBlock::from_vec(vec![mne(4, Operation::Move(i.clone().into()), &i)]);
+        let mut cfg = ControlFlowGraph::new();
+        let v0 = cfg.add_vertex(ControlFlowTarget::Resolved(bb0));
+        let v1 = cfg.add_vertex(ControlFlowTarget::Resolved(bb1));
+        let v2 = cfg.add_vertex(ControlFlowTarget::Resolved(bb2));
+        let v3 = cfg.add_vertex(ControlFlowTarget::Resolved(bb3));
+        let g = Guard::from_flag(&flag.into()).ok().unwrap();
+
+        cfg.add_edge(Guard::always(), v0, v1);
+        cfg.add_edge(g.clone(), v1, v2);
+        cfg.add_edge(Guard::always(), v2, v1);
+        cfg.add_edge(g.negation(), v1, v3);
+
+        let mut func = Function::undefined(0, None, &Region::undefined("ram".to_owned(), 100), Some("test".to_owned()));
+
+        *func.cfg_mut() = cfg;
+        func.set_entry_point_ref(v0);
+        assert!(ssa_convertion(&mut func).is_ok());
+        func
+    }
+
+    #[test]
+    fn threshold_widening() {
+        // wraps around before reaching the threshold
+        let func = counting_loop(5, 3);
+        let interp = Interpretation::<Kset>::new(&func);
+        let res = results::<Kset>(&func, &interp.values());
+
+        assert_eq!(res[&(Name::new("i"), 32)], Kset::from_values((0..4).map(|x| (x, 32))));
+        assert_eq!(interp.convergence().exhausted, 0);
+
+        // can't reach the threshold. No need to count to KSET_MAXIMAL_CARDINALITY
+        let func = counting_loop(100, 0xffffffff);
+        let interp = Interpretation::<Kset>::new(&func);
+        let res = results::<Kset>(&func, &interp.values());
+
+        assert_eq!(res[&(Name::new("i"), 32)], Kset::Join);
+        assert!(interp.convergence().max_iterations < KSET_MAXIMAL_CARDINALITY / 2);
+        assert!(interp.convergence().widenings > 0);
+    }
+
+    fn binop<T: Serialize + for<'a> Deserialize<'a> + Clone + Eq + fmt::Debug>(i: usize, a: T, b: T) -> Operation<T> {
+        match i {
+            0 => Operation::Add(a, b),
+            1 => Operation::Subtract(a, b),
+            2 => Operation::Multiply(a, b),
+            3 => Operation::And(a, b),
+            4 => Operation::InclusiveOr(a, b),
+            _ => Operation::ExclusiveOr(a, b),
+        }
+    }
+
+    fn kset(v: Vec<u8>, size: usize) -> Kset {
+        Kset::from_values(v.into_iter().take(KSET_MAXIMAL_CARDINALITY).map(|x| (x as u64, size)))
+    }
+
+    quickcheck! {
+        fn qc_pairwise(a: Vec<u8>, b: Vec<u8>, size: bool) -> bool {
+            let size = if size { 8 } else { 3 };
+            let a = kset(a, size);
+            let b = kset(b, size);
+            let pp = ProgramPoint { address: 0, position: 0 };
+
+            (0..6).all(|op| {
+                let expected = match (&a, &b) {
+                    (&Kset::Set(ref a), &Kset::Set(ref b)) => {
+                        let mut ret = HashSet::new();
+
+                        for &(x, xs) in a.iter() {
+                            for &(y, ys) in b.iter() {
+                                if let Rvalue::Constant { value, size } = execute(binop(op, Rvalue::Constant { value: x, size: xs }, Rvalue::Constant { value: y, size: ys })) {
+                                    ret.insert((value, size));
+                                }
+                            }
+                        }
+                        Kset::from_values(ret)
+                    }
+                    _ => Kset::Meet,
+                };
+                let got = Kset::execute(&pp, &binop(op, a.clone(), b.clone()));
+
+                got == expected
+            })
+        }
+    }
+
+    quickcheck! {
+        fn qc_merge(a: Vec<u8>, b: Vec<u8>) -> bool {
+            let x = kset(a.clone(), 8);
+            let y = kset(b.clone(), 8);
+            let a = a.into_iter().take(KSET_MAXIMAL_CARDINALITY).collect::<HashSet<u8>>();
+            let b = b.into_iter().take(KSET_MAXIMAL_CARDINALITY).collect::<HashSet<u8>>();
+            let union = Kset::from_values(a.union(&b).map(|&x| (x as u64, 8)));
+            let inter = Kset::from_values(a.intersection(&b).map(|&x| (x as u64, 8)));
+            let narrowed = if x == Kset::Meet || y == Kset::Meet { Kset::Meet } else { inter };
+
+            x.combine(&y) == union && x.narrow(&y) == narrowed && y.more_exact(&x) == (x != y && b.is_subset(&a))
+        }
+    }
 }
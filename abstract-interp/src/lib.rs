@@ -44,13 +44,13 @@ extern crate serde;
 #[macro_use] extern crate serde_derive;
 
 mod interpreter;
-pub use interpreter::{Avalue, Constraint, ProgramPoint, approximate, results, lift};
+pub use interpreter::{Avalue, Constraint, Convergence, Interpretation, Limits, ProgramPoint, approximate, results, lift};
 
 mod bounded_addr_track;
 pub use bounded_addr_track::BoundedAddrTrack;
 
 pub mod kset;
-pub use kset::Kset;
+pub use kset::{Kset, KsetValues};
 
 mod widening;
 pub use widening::Widening;
@@ -75,6 +75,10 @@ impl<A: Avalue> Avalue for Widening<A> {
         Widening { value: self.value.widen(&s.value), point: self.point.clone() }
     }
 
+    fn widen_with_thresholds(&self, s: &Self, thresholds: &[Rvalue]) -> Self {
+        Widening { value: self.value.widen_with_thresholds(&s.value, thresholds), point: self.point.clone() }
+    }
+
     fn combine(&self, s: &Self) -> Self {
         Widening {
             value: self.value.combine(&s.value),
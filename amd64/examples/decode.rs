@@ -0,0 +1,105 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Measures AMD64 decode throughput with and without the flattened `Region` fast path.
+//!
+//! Usage: cargo run --release --example decode [BINARY] [PASSES]
+//!
+//! Decodes every executable segment of BINARY (default: test-data/static) linearly, PASSES
+//! (default: 5) times. The "cells" run covers the `Region` with an empty writable layer, which
+//! forces the decoder back onto the cell iterator, i.e. the way every instruction was read before
+//! `Region::bytes_at` existed. The "skim" run uses the fast path too but leaves out the RREIL code
+//! like `Architecture::decode_mnemonics` does.
+
+extern crate panopticon_core;
+extern crate panopticon_amd64;
+
+use panopticon_amd64::{Amd64, Mode};
+use panopticon_core::{Architecture, Bound, Layer, Machine, Match, Region, Result, loader};
+use std::env;
+use std::path::Path;
+use std::str::FromStr;
+use std::time::{Duration, Instant};
+
+type Decoder = fn(&Region, u64, &Mode) -> Result<Match<Amd64>>;
+
+fn sweep(reg: &Region, areas: &[Bound], mode: Mode, passes: usize, decode: Decoder) -> (usize, u64, Duration) {
+    let start = Instant::now();
+    let mut insns = 0;
+    let mut bytes = 0;
+
+    for _ in 0..passes {
+        for area in areas {
+            let mut addr = area.start;
+
+            while addr < area.end {
+                let len = match decode(reg, addr, &mode) {
+                    Ok(m) if !m.tokens.is_empty() => m.tokens.len() as u64,
+                    _ => 1,
+                };
+
+                insns += 1;
+                bytes += len;
+                addr += len;
+            }
+        }
+    }
+
+    (insns, bytes, start.elapsed())
+}
+
+fn seconds(d: Duration) -> f64 {
+    d.as_secs() as f64 + d.subsec_nanos() as f64 * 1e-9
+}
+
+fn run(path: &Path, passes: usize) -> Result<()> {
+    let (proj, machine) = loader::load(path)?;
+    let mode = match machine {
+        Machine::Ia32 => Mode::Protected,
+        Machine::Amd64 => Mode::Long,
+        Machine::Avr => return Err("not an x86 binary".into()),
+    };
+    let fast = proj.region().clone();
+    let areas = fast.stack().iter().skip(1).filter(|x| !x.1.is_undefined()).map(|x| x.0.clone()).collect::<Vec<_>>();
+    let mut slow = fast.clone();
+
+    slow.cover(Bound::new(0, slow.size()), Layer::writable());
+
+    println!("{:>8} {:>12} {:>10} {:>12}", "path", "instructions", "seconds", "MB/s");
+
+    let runs: [(&str, &Region, Decoder); 3] = [("cells", &slow, Amd64::decode), ("flat", &fast, Amd64::decode), ("skim", &fast, Amd64::decode_mnemonics)];
+
+    for &(name, reg, decode) in runs.iter() {
+        let (insns, bytes, time) = sweep(reg, &areas, mode, passes, decode);
+        let secs = seconds(time);
+
+        println!("{:>8} {:>12} {:>10.3} {:>12.2}", name, insns, secs, bytes as f64 / secs / 1e6);
+    }
+
+    Ok(())
+}
+
+fn main() {
+    let args = env::args().collect::<Vec<_>>();
+    let path = args.get(1).cloned().unwrap_or("../test-data/static".to_string());
+    let passes = args.get(2).and_then(|x| usize::from_str(x).ok()).unwrap_or(5);
+
+    if let Err(e) = run(Path::new(&path), passes) {
+        println!("failed to decode {}: {}", path, e);
+    }
+}
@@ -55,21 +55,43 @@ impl Architecture for Amd64 {
     }
 
     fn decode(reg: &Region, start: u64, cfg: &Self::Configuration) -> Result<Match<Self>> {
-        let data = reg.iter();
-        let mut buf: Vec<u8> = vec![];
-        let mut i = data.seek(start);
+        Self::read(reg, start, cfg, true)
+    }
+
+    fn decode_mnemonics(reg: &Region, start: u64, cfg: &Self::Configuration) -> Result<Match<Self>> {
+        Self::read(reg, start, cfg, false)
+    }
+
+    fn cache_key(cfg: &Self::Configuration) -> Option<u64> {
+        Some(cfg.bits() as u64)
+    }
+}
+
+impl Amd64 {
+    fn read(reg: &Region, start: u64, cfg: &Mode, lift: bool) -> Result<Match<Self>> {
+        let fast = reg.bytes_at(start);
+        let mut slow: Vec<u8> = vec![];
         let p = start;
 
-        while let Some(Some(b)) = i.next() {
-            buf.push(b);
-            if buf.len() == 15 {
-                break;
+        // read directly from the layer unless the instruction may cross a layer boundary
+        let buf = if fast.len() >= 15 {
+            &fast[0..15]
+        } else {
+            let mut i = reg.iter().seek(start);
+
+            while let Some(Some(b)) = i.next() {
+                slow.push(b);
+                if slow.len() == 15 {
+                    break;
+                }
             }
-        }
+
+            &slow[..]
+        };
 
         debug!("disass @ {:#x}: {:?}", p, buf);
 
-        let ret = ::disassembler::read(*cfg, &buf, p).and_then(
+        let ret = ::disassembler::read_lifted(*cfg, buf, p, lift).and_then(
             |(len, mne, mut jmp)| {
                 Ok(
                     Match::<Amd64> {
@@ -2326,7 +2326,23 @@ fn select_opcode_ext(grp: isize, opc: usize, modrm: usize, pfx: SimdPrefix, mode
     )
 }
 
+/// True for opcodes whose semantic function emits a call or returns something else than
+/// `JumpSpec::FallThru`. These are always lifted to RREIL.
+fn changes_control_flow(opcode: &str) -> bool {
+    match opcode {
+        "call" | "jmp" | "jo" | "jno" | "jb" | "jae" | "je" | "jne" | "jbe" | "ja" | "js" | "jns" | "jp" | "jnp" | "jl" | "jle" | "jg" | "jge" |
+        "ret" | "retn" | "retf" | "retnf" | "iret" | "iretw" | "hlt" => true,
+        _ => false,
+    }
+}
+
 pub fn read(mode: Mode, buf: &[u8], addr: u64) -> Result<(u64, Mnemonic, Vec<(Rvalue, Guard)>)> {
+    read_lifted(mode, buf, addr, true)
+}
+
+/// Same as `read`, but only control flow instructions are lifted to RREIL if `lift` is false. All
+/// other mnemonics get their operands but no statements.
+pub fn read_lifted(mode: Mode, buf: &[u8], addr: u64, lift: bool) -> Result<(u64, Mnemonic, Vec<(Rvalue, Guard)>)> {
     use tables::*;
 
     let mut i = 0;
@@ -2784,6 +2800,7 @@ pub fn read(mode: Mode, buf: &[u8], addr: u64) -> Result<(u64, Mnemonic, Vec<(Rv
                     None
                 };
                 let ip = addr + i as u64 + 1;
+                let lift = lift || changes_control_flow(s);
                 let mut stmts = vec![];
                 let mut wstmts = vec![];
                 let mut ops = vec![];
@@ -2805,7 +2822,9 @@ pub fn read(mode: Mode, buf: &[u8], addr: u64) -> Result<(u64, Mnemonic, Vec<(Rv
 
                     match maybe_op {
                         Ok((rv, mut rst, wst)) => {
-                            stmts.append(&mut rst);
+                            if lift {
+                                stmts.append(&mut rst);
+                            }
                             wstmts.push(wst);
                             ops.push(rv);
                         }
@@ -2821,12 +2840,16 @@ pub fn read(mode: Mode, buf: &[u8], addr: u64) -> Result<(u64, Mnemonic, Vec<(Rv
                 //if prefix.repne { print!("repnz "); }
 
                 debug!("call {} with {:?}", s, ops);
-                let res = opc.call(
-                    &ops.get(0).cloned(),
-                    &ops.get(1).cloned(),
-                    &ops.get(2).cloned(),
-                    &ops.get(3).cloned(),
-                );
+                let res = if lift {
+                    opc.call(
+                        &ops.get(0).cloned(),
+                        &ops.get(1).cloned(),
+                        &ops.get(2).cloned(),
+                        &ops.get(3).cloned(),
+                    )
+                } else {
+                    Ok((vec![], JumpSpec::FallThru))
+                };
                 let (mut op_stmts, jmp_spec) = match res {
                     Ok(o) => o,
                     Err(e) => {
@@ -2836,7 +2859,7 @@ pub fn read(mode: Mode, buf: &[u8], addr: u64) -> Result<(u64, Mnemonic, Vec<(Rv
                 };
                 stmts.append(&mut op_stmts);
 
-                if ops.len() >= 2 {
+                if lift && ops.len() >= 2 {
                     stmts.append(&mut wstmts[0]);
                 }
 
@@ -25,7 +25,7 @@ extern crate regex;
 extern crate quickcheck;
 
 use panopticon_amd64::{AddressingMethod, JumpSpec, MnemonicSpec, Opcode, Operand, OperandSpec, OperandType, read_spec_register, semantic, tables};
-use panopticon_core::{Lvalue, Result, Rvalue, Statement, execute};
+use panopticon_core::{Lvalue, Name, Result, Rvalue, Statement, execute};
 
 use quickcheck::{Arbitrary, Gen, TestResult, Testable};
 use std::borrow::Cow;
@@ -472,7 +472,6 @@ fn rappel_xcheck(
     use std::io::{Read, Write};
     use regex::Regex;
     use std::collections::HashMap;
-    use std::borrow::Cow;
 
     println!("{:?}", start);
 
@@ -645,7 +644,7 @@ fn rappel_xcheck(
     assert_eq!(flags.len(), 6);
     println!("regs: {:?}", regs);
 
-    let mut ctx = HashMap::<Cow<'static, str>, u64>::new();
+    let mut ctx = HashMap::<Name, u64>::new();
 
     for stmt in stmts {
         let mut s = stmt.op;
@@ -693,7 +692,7 @@ fn rappel_xcheck(
     println!("{:?}", ctx);
 
     for (name, val) in regs {
-        let key = Cow::Owned(name.trim().clone().to_uppercase());
+        let key = Name::from(name.trim().to_uppercase());
 
         if Some(val) != ctx.get(&key).map(|x| *x as u64) {
             println!(
@@ -707,7 +706,7 @@ fn rappel_xcheck(
     }
 
     for (name, val) in flags {
-        let key = Cow::Owned(name.trim().clone().to_uppercase());
+        let key = Name::from(name.trim().to_uppercase());
         let soft = ctx.get(&key).map(|x| *x as u64);
 
         if soft.is_some() && Some(if val { 1 } else { 0 }) != soft {
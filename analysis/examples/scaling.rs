@@ -0,0 +1,83 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Measures how `analyze` scales with the number of threads.
+//!
+//! Usage: cargo run --release --example scaling [BINARY] [MAX THREADS]
+//!
+//! Disassembles BINARY (default: test-data/static) with 1, 2, 4, ... up to MAX THREADS (default:
+//! 32) threads and prints wall clock time and speedup relative to the single threaded run.
+
+extern crate panopticon_core;
+extern crate panopticon_analysis;
+extern crate panopticon_amd64;
+extern crate panopticon_avr;
+
+use panopticon_amd64 as amd64;
+use panopticon_analysis::analyze;
+use panopticon_avr as avr;
+use panopticon_core::{Machine, Program, Result, loader};
+use std::env;
+use std::path::Path;
+use std::str::FromStr;
+use std::time::{Duration, Instant};
+
+fn run(path: &Path, threads: usize) -> Result<(Program, Duration)> {
+    let (mut proj, machine) = loader::load(path)?;
+    let program = proj.code.pop().ok_or("no program")?;
+    let reg = proj.region().clone();
+    let start = Instant::now();
+    let program = match machine {
+        Machine::Avr => analyze::<avr::Avr>(program, reg, avr::Mcu::atmega103(), threads),
+        Machine::Ia32 => analyze::<amd64::Amd64>(program, reg, amd64::Mode::Protected, threads),
+        Machine::Amd64 => analyze::<amd64::Amd64>(program, reg, amd64::Mode::Long, threads),
+    }?;
+
+    Ok((program, start.elapsed()))
+}
+
+fn seconds(d: Duration) -> f64 {
+    d.as_secs() as f64 + d.subsec_nanos() as f64 * 1e-9
+}
+
+fn main() {
+    let args = env::args().collect::<Vec<_>>();
+    let path = args.get(1).cloned().unwrap_or("../test-data/static".to_string());
+    let max_threads = args.get(2).and_then(|x| usize::from_str(x).ok()).unwrap_or(32);
+    let mut threads = 1;
+    let mut baseline = None;
+
+    println!("{:>8} {:>10} {:>10} {:>8}", "threads", "functions", "seconds", "speedup");
+
+    while threads <= max_threads {
+        match run(Path::new(&path), threads) {
+            Ok((program, time)) => {
+                let secs = seconds(time);
+                let base = *baseline.get_or_insert(secs);
+
+                println!("{:>8} {:>10} {:>10.3} {:>8.2}", threads, program.functions().count(), secs, base / secs);
+            }
+            Err(e) => {
+                println!("failed to analyze {}: {}", path, e);
+                return;
+            }
+        }
+
+        threads *= 2;
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Measures the throughput of the signature scanner.
+//!
+//! Usage: cargo run --release --example signatures [DIRECTORY] [MEGABYTES] [SIGNATURES]
+//!
+//! Concatenates all files in DIRECTORY (default: test-data) until the image is MEGABYTES (default:
+//! 256) large and scans it for SIGNATURES (default: 1000) random patterns and a few common x86
+//! prologues. Prints the time and throughput of each run.
+
+extern crate panopticon_core;
+extern crate panopticon_analysis;
+
+use panopticon_analysis::{Signature, SignatureSet};
+use panopticon_core::{Region, Result};
+use std::env;
+use std::fs;
+use std::str::FromStr;
+use std::time::Instant;
+
+const PROLOGUES: &'static [&'static str] = &["55 48 89 e5", "55 89 e5", "53 48 83 ec ??", "41 57 41 56", "48 83 ec ?? 48 89 5c 24 ??", "f3 0f 1e fa"];
+
+fn image(dir: &str, size: usize) -> Result<Vec<u8>> {
+    let mut files = vec![];
+
+    for entry in fs::read_dir(dir)? {
+        let path = entry?.path();
+
+        if path.is_file() {
+            let reg = Region::open("".to_string(), &path)?;
+
+            for (_, bytes) in reg.defined_bytes() {
+                files.extend_from_slice(bytes);
+            }
+        }
+    }
+
+    if files.is_empty() {
+        return Err(format!("no files in {}", dir).into());
+    }
+
+    let mut ret = Vec::with_capacity(size);
+
+    while ret.len() < size {
+        let len = std::cmp::min(files.len(), size - ret.len());
+        ret.extend_from_slice(&files[..len]);
+    }
+
+    Ok(ret)
+}
+
+fn signatures(num: usize) -> Vec<Signature> {
+    let mut state = 0x2545f4914f6cdd1du64;
+    let mut next = || {
+        state = state.wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407);
+        (state >> 33) as u32
+    };
+    let mut ret = PROLOGUES.iter().map(|p| Signature::new(None, p).unwrap()).collect::<Vec<_>>();
+
+    for i in 0..num {
+        let len = 4 + next() as usize % 28;
+        let mut pattern = (0..len).map(|_| if next() % 8 == 0 { None } else { Some(next() as u8) }).collect::<Vec<_>>();
+
+        pattern[0] = Some(next() as u8);
+        ret.push(Signature { name: Some(format!("sig_{}", i)), pattern: pattern });
+    }
+
+    ret
+}
+
+fn main() {
+    let args = env::args().collect::<Vec<_>>();
+    let dir = args.get(1).cloned().unwrap_or("../test-data".to_string());
+    let megs = args.get(2).and_then(|x| usize::from_str(x).ok()).unwrap_or(256);
+    let num = args.get(3).and_then(|x| usize::from_str(x).ok()).unwrap_or(1000);
+    let bytes = match image(&dir, megs << 20) {
+        Ok(b) => b,
+        Err(e) => {
+            println!("failed to read {}: {}", dir, e);
+            return;
+        }
+    };
+    let reg = Region::wrap("image".to_string(), bytes);
+    let set = SignatureSet::new(signatures(num));
+
+    println!("{:>6} {:>10} {:>10} {:>8} {:>8}", "run", "signatures", "matches", "seconds", "GB/s");
+
+    for run in 0..5 {
+        let start = Instant::now();
+        let matches = set.scan(&reg);
+        let time = start.elapsed();
+        let secs = time.as_secs() as f64 + time.subsec_nanos() as f64 * 1e-9;
+
+        println!("{:>6} {:>10} {:>10} {:>8.3} {:>8.2}", run, set.len(), matches.len(), secs, (megs << 20) as f64 / secs / 1e9);
+    }
+}
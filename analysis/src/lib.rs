@@ -25,11 +25,24 @@ extern crate panopticon_core;
 extern crate panopticon_data_flow;
 extern crate panopticon_graph_algos;
 extern crate futures;
-extern crate chashmap;
 extern crate rayon;
 extern crate uuid;
 extern crate parking_lot;
 
+#[cfg(test)]
+extern crate panopticon_amd64;
+
+mod worklist;
+
 mod pipeline;
-pub use pipeline::pipeline;
-pub use pipeline::analyze;
+pub use pipeline::{Priorities, pipeline, prioritized_pipeline};
+pub use pipeline::{analyze, analyze_with_progress};
+
+mod sweep;
+pub use sweep::{Bitmap, BitmapIterator, CHUNK_SIZE, SweepArea, SweepIndex, seed, sweep};
+
+mod signature;
+pub use signature::{Signature, SignatureMatch, SignatureSet, apply_signatures};
+
+mod strings;
+pub use strings::{Encoding, MIN_STRING_LENGTH, StringEntry, StringIndex};
@@ -16,185 +16,293 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-use futures::{Future, Sink, Stream, stream};
+use futures::{Future, Sink, Stream};
 use futures::sync::mpsc;
 use panopticon_core::{Architecture, CallTarget, Error, Function, Program, Result, Region, Rvalue};
 use panopticon_data_flow::ssa_convertion;
-use std::collections::HashSet;
+use parking_lot::Mutex;
+use rayon;
 use std::fmt::Debug;
-use std::thread;
 use std::sync::Arc;
-use uuid::Uuid;
-use std::result;
-use parking_lot::{Mutex, RwLock};
+use std::sync::atomic::{AtomicUsize, Ordering as AtomicOrdering};
+use std::thread;
+use worklist::{Job, Priority, Worklist};
 
+/// Disassembles all functions reachable from the `Todo` entries in `program` on `threads` threads
+/// and returns the completed program. If `threads` is 0 as many threads as the calling rayon
+/// pool has are used.
+///
+/// Each call runs on a thread pool of its own. Its threads block while waiting for work, so they
+/// must not be shared with other tasks; `analyze` can be called from inside a parallel iterator.
+/// Callers running several analyses at once should split the available threads between them.
+/// Each thread keeps the functions it disassembled for itself, new call targets are pushed into a
+/// shared work queue. The call graph is assembled after all threads are done.
 pub fn analyze<A: Architecture + Debug + Sync + 'static>(
     program: Program,
     region: Region,
     config: A::Configuration,
+    threads: usize,
 ) -> Result<Program>
 where
     A::Configuration: Debug + Sync,
 {
-    use rayon::prelude::*;
-    use chashmap::CHashMap;
+    analyze_with_progress::<A, _>(program, region, config, threads, |_, _| {})
+}
 
-    struct Init {
-        name: Option<String>,
-        entry: u64,
-        uuid: Uuid,
-    }
+/// Like `analyze`, but calls `progress` with the number of functions finished and the number of
+/// functions discovered so far after each function. `progress` is called from all threads.
+pub fn analyze_with_progress<A, P>(
+    program: Program,
+    region: Region,
+    config: A::Configuration,
+    threads: usize,
+    progress: P,
+) -> Result<Program>
+where
+    A: Architecture + Debug + Sync + 'static,
+    A::Configuration: Debug + Sync,
+    P: Fn(usize, usize) + Sync,
+{
+    use rayon::{Configuration, ThreadPool};
 
-    let attempts = CHashMap::<u64, result::Result<(), Error>>::new();
-    let targets = CHashMap::<u64, bool>::new();
-    let failures = RwLock::new(0);
-    info!("initializing first wave");
-    let functions =
-        program
-        .call_graph
-        .into_iter()
-        .filter_map(
-            |ct| match ct {
-                &CallTarget::Todo(Rvalue::Constant { value: entry, .. }, ref name, ref uuid) => {
-                    Some(Init { entry, name: name.clone(), uuid: *uuid })
-                }
-                _ => None,
+    let threads = if threads == 0 { rayon::current_num_threads() } else { threads };
+    let pool = match ThreadPool::new(Configuration::new().num_threads(threads)) {
+        Ok(pool) => pool,
+        Err(e) => return Err(format!("failed to start disassembler threads: {}", e).into()),
+    };
+    let worklist = Worklist::new();
+    let failures = AtomicUsize::new(0);
+    let finished = AtomicUsize::new(0);
+    let mut aliases = Vec::<(u64, String)>::new();
+
+    for ct in program.call_graph().into_iter() {
+        if let &CallTarget::Todo(Rvalue::Constant { value: entry, .. }, ref name, ref uuid) = ct {
+            if !worklist.push(entry, name.clone(), Some(uuid.clone()), Priority::Normal) {
+                aliases.push((entry, name.clone().unwrap_or(format!("func_{:#x}", entry))));
             }
-        ).collect::<Vec<Init>>();
-
-    // we now lock the program
-    let program = Mutex::new(program);
-
-    info!("begin first wave {}", functions.len());
-    functions.into_par_iter().for_each(| Init { entry, name, uuid }| {
-        let name = &name;
-        attempts.upsert(entry,
-                        || {
-                            match Function::with_uuid::<A>(entry, &uuid, &region, name.clone(), config.clone()) {
-                                Ok(mut f) => {
-                                    for address in f.collect_call_addresses() {
-                                        targets.upsert(address, || { true }, |_| ());
-                                    }
-                                    let _ = ssa_convertion(&mut f);
-                                    {
-                                        let mut program = program.lock();
-                                        let _ = program.insert(f);
+        }
+    }
+
+    info!("analyzing {} entry points on {} threads", worklist.len(), pool.current_num_threads());
+
+    let functions = Mutex::new(Vec::<Vec<Function>>::new());
+
+    pool.install(
+        || {
+            rayon::scope(
+                |s| for _ in 0..rayon::current_num_threads() {
+                    let worklist = &worklist;
+                    let region = &region;
+                    let config = &config;
+                    let failures = &failures;
+                    let finished = &finished;
+                    let functions = &functions;
+                    let progress = &progress;
+
+                    s.spawn(
+                        move |_| {
+                            let mut local = Vec::new();
+
+                            while let Some(job) = worklist.pop() {
+                                let entry = job.entry;
+
+                                match disassemble::<A>(job, worklist, region, config.clone(), true) {
+                                    Ok(f) => local.push(f),
+                                    Err(e) => {
+                                        debug!("failed to disassemble function at {:#x}: {}", entry, e);
+                                        failures.fetch_add(1, AtomicOrdering::Relaxed);
                                     }
-                                    Ok(())
-                                },
-                                Err(e) => { *failures.write() += 1; Err(e) },
-                            }
-                        },
-                        |f2| {
-                            match f2 {
-                                &mut Ok(_) => {
-                                    let name = name.clone().unwrap_or(format!("func_{:#x}", entry));
-                                    let mut program = program.lock();
-                                    let f2 = program.find_function_mut(|f| f.start() == entry).unwrap();
-                                    info!("New alias ({}) found at {:#x} with canonical name {:?}", &name, entry, &f2.name);
-                                    f2.add_alias(name);
-                                },
-                                _ => ()
+                                }
+
+                                worklist.done();
+                                progress(finished.fetch_add(1, AtomicOrdering::Relaxed) + 1, worklist.len());
                             }
-                        });
-    });
-
-    info!("first wave done: success: {} failures: {} targets: {}", attempts.len(), *failures.read(), targets.len());
-
-    let mut targets = targets.into_iter().map(|(x, _)| x).collect::<Vec<u64>>();
-    while !targets.is_empty() {
-        info!("targets - ({})", targets.len());
-        let new_targets = CHashMap::<u64, bool>::new();
-        targets.into_par_iter().for_each(| address | {
-            attempts.upsert(address, || {
-                match Function::new::<A>(address, &region, None, config.clone()) {
-                    Ok(mut f) => {
-                        for address in f.collect_call_addresses() {
-                            new_targets.upsert(address, || { true }, |_| ());
-                        }
-                        let _ = ssa_convertion(&mut f);
-                        {
-                            let mut program = program.lock();
-                            let _ = program.insert(f);
+
+                            functions.lock().push(local);
                         }
-                        Ok(())
-                    },
-                    Err(e) => { let mut failures = failures.write(); *failures += 1; Err(e) }
+                    );
                 }
-            },
-            |_| ());
-        });
-        targets = new_targets.into_iter().map(|(x, _)| x).collect::<Vec<u64>>();
+            )
+        }
+    );
+
+    let mut program = program;
+
+    for f in functions.into_inner().into_iter().flat_map(|x| x.into_iter()) {
+        program.insert(f);
     }
 
-    let mut program = program.into_inner();
-    info!("Finished analysis: {} failures {}", attempts.len(), *failures.read());
+    for (entry, name) in aliases {
+        if let Some(f) = program.find_function_mut(|f| f.start() == entry) {
+            info!("New alias ({}) found at {:#x} with canonical name {:?}", &name, entry, &f.name);
+            f.add_alias(name);
+        }
+    }
+
+    info!("Finished analysis: {} functions, {} failures", worklist.len(), failures.load(AtomicOrdering::Relaxed));
     program.update_plt();
     Ok(program)
 }
 
+/// Disassembles `job` and queues all functions it calls. If `lift` is false the RREIL code is
+/// left out and the function is not converted into SSA form.
+fn disassemble<A: Architecture>(job: Job, worklist: &Worklist, region: &Region, config: A::Configuration, lift: bool) -> Result<Function> {
+    let Job { entry, name, uuid } = job;
+    let mut f = match uuid {
+        Some(uuid) if lift => Function::with_uuid::<A>(entry, &uuid, region, name, config)?,
+        None if lift => Function::new::<A>(entry, region, name, config)?,
+        uuid => Function::new_unlifted::<A>(entry, uuid, region, name, config)?,
+    };
+
+    for address in f.collect_call_addresses() {
+        worklist.push(address, None, None, Priority::Normal);
+    }
+
+    if lift {
+        let _ = ssa_convertion(&mut f);
+    }
+
+    Ok(f)
+}
+
+/// Handle to a running `pipeline`.
+#[derive(Clone)]
+pub struct Priorities {
+    worklist: Arc<Worklist>,
+    lift: Arc<Fn(&mut Function) -> Result<()> + Send + Sync>,
+}
+
+impl Priorities {
+    /// Disassembles the function at `entry` before all others not yet started.
+    pub fn prioritize(&self, entry: u64) {
+        self.worklist.prioritize(entry);
+    }
+
+    /// Lifts a function sent by `prioritized_pipeline` to RREIL and converts it into SSA form.
+    /// Does nothing if `func` is already lifted.
+    pub fn lift(&self, func: &mut Function) -> Result<()> {
+        if func.is_lifted() {
+            Ok(())
+        } else {
+            (self.lift)(func)
+        }
+    }
+
+    /// Number of distinct functions queued so far, including the finished ones.
+    pub fn queued(&self) -> usize {
+        self.worklist.len()
+    }
+}
+
 /// Starts disassembling insructions in `region` and puts them into `program`. Returns a stream of
 /// of newly discovered functions.
-pub fn pipeline<A: Architecture + Debug + 'static>(
+pub fn pipeline<A: Architecture + Debug + Sync + 'static>(
     program: Arc<Program>,
     region: Region,
     config: A::Configuration,
 ) -> Box<Stream<Item = Function, Error = ()> + Send>
 where
-    A::Configuration: Debug,
+    A::Configuration: Debug + Sync,
+{
+    spawn_pipeline::<A>(program, region, config, true).0
+}
+
+/// Like `pipeline`, but functions are disassembled on a thread pool and can be moved to the
+/// front of the queue using the returned `Priorities` handle. Functions are sent down the stream
+/// in the order they finish.
+///
+/// To get the control flow graphs out quickly the functions are not lifted to RREIL, except for
+/// their calls. Use `Priorities::lift` before analysing them.
+pub fn prioritized_pipeline<A: Architecture + Debug + Sync + 'static>(
+    program: Arc<Program>,
+    region: Region,
+    config: A::Configuration,
+) -> (Box<Stream<Item = Function, Error = ()> + Send>, Priorities)
+where
+    A::Configuration: Debug + Sync,
+{
+    spawn_pipeline::<A>(program, region, config, false)
+}
+
+fn spawn_pipeline<A: Architecture + Debug + Sync + 'static>(
+    program: Arc<Program>,
+    region: Region,
+    config: A::Configuration,
+    lift: bool,
+) -> (Box<Stream<Item = Function, Error = ()> + Send>, Priorities)
+where
+    A::Configuration: Debug + Sync,
 {
+    use rayon::{Configuration, ThreadPool};
+
     let (tx, rx) = mpsc::channel::<Function>(10);
+    let worklist = Arc::new(Worklist::new());
+
+    for ct in program.call_graph().into_iter() {
+        if let &CallTarget::Todo(Rvalue::Constant { value: entry, .. }, ref maybe_name, ref uuid) = ct {
+            worklist.push(entry, maybe_name.clone(), Some(uuid.clone()), Priority::Normal);
+        }
+    }
+
+    let lifter = {
+        let region = region.clone();
+        let config = config.clone();
+
+        move |func: &mut Function| -> Result<()> {
+            func.lift::<A>(&region, config.clone())?;
+            let _ = ssa_convertion(func);
+            Ok(())
+        }
+    };
+    let prio = Priorities { worklist: worklist.clone(), lift: Arc::new(lifter) };
+
     thread::spawn(
         move || {
-            let mut finished_functions = HashSet::<u64>::new();
-            let mut targets: Vec<u64> = Vec::new();
-            let mut failures: Vec<(u64, Error)> = Vec::new();
-            // TODO: this is the exact code below, modulo how we construct the function
-            for ct in program.call_graph.into_iter() {
-                match ct {
-                    &CallTarget::Todo(Rvalue::Constant { value: entry, .. }, ref maybe_name, ref uuid) => {
-                        finished_functions.insert(entry);
-                        match Function::with_uuid::<A>(entry, uuid, &region, maybe_name.clone(), config.clone()) {
-                            Ok(mut f) => {
-                                let addresses = f.collect_call_addresses();
-                                targets.extend_from_slice(&addresses);
-                                let _ = ssa_convertion(&mut f);
-                                let tx = tx.clone();
-                                tx.send_all(stream::iter(vec![Ok(f)])).wait().unwrap().0;
-                            },
-                            Err(e) => { failures.push((entry, e)); },
-                        }
-                    }
-                    _ => (),
+            let pool = match ThreadPool::new(Configuration::new()) {
+                Ok(pool) => pool,
+                Err(e) => {
+                    error!("failed to start disassembler threads: {}", e);
+                    return;
                 }
-            }
+            };
+            let failures = Mutex::new(Vec::<(u64, Error)>::new());
+
+            info!("disassembling on {} threads", pool.current_num_threads());
+            pool.install(
+                || {
+                    rayon::scope(
+                        |s| for _ in 0..rayon::current_num_threads() {
+                            let tx = tx.clone();
+                            let worklist = &worklist;
+                            let region = &region;
+                            let config = &config;
+                            let failures = &failures;
 
-            while !targets.is_empty() {
-                info!("disassemble({}) {:?}", targets.len(), &targets);
-                let mut new_targets = Vec::new();
-                for address in targets.drain(..) {
-                    info!("checking if {} is in {:?}", address, &finished_functions);
-                    if !finished_functions.contains(&address) {
-                        finished_functions.insert(address);
-                        info!("adding func_0x{:x}", address);
-                        match Function::new::<A>(address, &region, None, config.clone()) {
-                            Ok(mut f) => {
-                                let addresses = f.collect_call_addresses();
-                                new_targets.extend_from_slice(&addresses);
-                                let _ = ssa_convertion(&mut f);
-                                {
-                                    let tx = tx.clone();
-                                    tx.send_all(stream::iter(vec![Ok(f)])).wait().unwrap().0;
+                            s.spawn(
+                                move |_| while let Some(job) = worklist.pop() {
+                                    let entry = job.entry;
+
+                                    match disassemble::<A>(job, worklist, region, config.clone(), lift) {
+                                        Ok(f) => {
+                                            // receiver gone, nobody is interested in the rest
+                                            if tx.clone().send(f).wait().is_err() {
+                                                worklist.cancel();
+                                            }
+                                        }
+                                        Err(e) => failures.lock().push((entry, e)),
+                                    }
+
+                                    worklist.done();
                                 }
-                            },
-                            Err(e) => failures.push((address, e)),
+                            );
                         }
-                    }
+                    )
                 }
-                targets = new_targets;
-            }
+            );
+
+            info!("pipeline finished: {} functions, {} failures", worklist.len(), failures.lock().len());
         }
     );
 
-    Box::new(rx)
+    (Box::new(rx), prio)
 }
@@ -0,0 +1,425 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Byte signatures for function prologues and library code.
+//!
+//! A `Signature` is a sequence of bytes and wildcards, optionally with the name of the function
+//! it identifies. A `SignatureSet` matches any number of them in one pass over the defined bytes
+//! of a `Region`.
+//!
+//! Every signature is anchored at a pair of adjacent bytes inside of it, picking bytes that are
+//! uncommon in machine code if possible. The set keeps a bit for each of the 65536 possible pairs.
+//! The scanner reads the input two bytes at a time, tests the bit and only looks at the
+//! signatures anchored at a pair if it is set. Most of the input is rejected by that single test,
+//! so the cost hardly depends on the number of signatures. Large inputs are split into pieces that
+//! are scanned in parallel.
+//!
+//! Named matches are turned into entry points and function names by `apply_signatures`.
+
+use panopticon_core::{Bound, CallTarget, Program, Region, Result, Rvalue};
+use std::cmp::{max, min};
+use uuid::Uuid;
+
+/// Number of bytes scanned by a single thread at once.
+const PIECE_SIZE: usize = 1 << 20;
+
+/// Bytes that are too common in machine code to be good anchors.
+const COMMON: &'static [u8] = &[0x00, 0xff, 0x48, 0x89, 0x8b, 0x0f, 0xcc, 0x90, 0xe8, 0x24, 0x45, 0x4c];
+
+/// A byte pattern with wildcards.
+#[derive(Clone,Debug,PartialEq,Eq)]
+pub struct Signature {
+    /// Name of the function starting with this pattern, if known
+    pub name: Option<String>,
+    /// Bytes to match, `None` matches any byte
+    pub pattern: Vec<Option<u8>>,
+}
+
+impl Signature {
+    /// Parses a pattern of space separated hex bytes. `??` is a wildcard. The pattern must include
+    /// at least one byte that isn't a wildcard.
+    pub fn new(name: Option<String>, pattern: &str) -> Result<Signature> {
+        let pattern = pattern
+            .split_whitespace()
+            .map(
+                |b| if b == "??" {
+                    Ok(None)
+                } else if b.len() == 2 {
+                    u8::from_str_radix(b, 16).map(Some).map_err(|_| format!("invalid byte '{}' in signature", b).into())
+                } else {
+                    Err(format!("invalid byte '{}' in signature", b).into())
+                }
+            )
+            .collect::<Result<Vec<Option<u8>>>>()?;
+
+        if pattern.iter().all(|b| b.is_none()) {
+            return Err("signature without a single fixed byte".into());
+        }
+
+        Ok(Signature { name: name, pattern: pattern })
+    }
+
+    /// Returns true if `bytes` starts with this pattern.
+    pub fn is_match(&self, bytes: &[u8]) -> bool {
+        self.pattern.len() <= bytes.len() && self.pattern.iter().zip(bytes.iter()).all(|(p, b)| p.map_or(true, |p| p == *b))
+    }
+
+    // offset of the least common pair of bytes in the pattern. The second byte may be a wildcard.
+    fn anchor(&self) -> usize {
+        let score = |b: Option<u8>| match b {
+            Some(b) if COMMON.contains(&b) => 1,
+            Some(_) => 0,
+            None => 3,
+        };
+
+        (0..self.pattern.len())
+            .filter(|&i| self.pattern[i].is_some())
+            .min_by_key(|&i| score(self.pattern[i]) + score(self.pattern.get(i + 1).cloned().unwrap_or(None)))
+            .unwrap_or(0)
+    }
+}
+
+/// Occurrence of a signature.
+#[derive(Clone,Copy,Debug,PartialEq,Eq,PartialOrd,Ord)]
+pub struct SignatureMatch {
+    /// Address of the first byte
+    pub address: u64,
+    /// Index of the signature in its `SignatureSet`
+    pub signature: usize,
+}
+
+/// Set of signatures matched together.
+#[derive(Clone,Debug)]
+pub struct SignatureSet {
+    signatures: Vec<Signature>,
+    /// One bit for each pair of bytes some signature is anchored at
+    pairs: Vec<u64>,
+    /// Start of the anchors for each pair in `anchors`
+    first: Vec<u32>,
+    /// Signature index and anchor offset, sorted by pair
+    anchors: Vec<(u32, u32)>,
+    longest: usize,
+}
+
+impl SignatureSet {
+    /// Prepares `signatures` for matching.
+    pub fn new(signatures: Vec<Signature>) -> SignatureSet {
+        let mut by_pair = Vec::<(u16, u32, u32)>::new();
+
+        for (idx, sig) in signatures.iter().enumerate() {
+            let off = sig.anchor();
+            let lo = sig.pattern[off].unwrap() as u16;
+
+            match sig.pattern.get(off + 1).cloned().unwrap_or(None) {
+                Some(hi) => by_pair.push((lo | (hi as u16) << 8, idx as u32, off as u32)),
+                None => {
+                    for hi in 0..256u16 {
+                        by_pair.push((lo | hi << 8, idx as u32, off as u32));
+                    }
+                }
+            }
+        }
+
+        by_pair.sort();
+
+        let mut pairs = vec![0u64; 1024];
+        let mut first = vec![0u32; 0x10001];
+
+        for &(p, _, _) in by_pair.iter() {
+            pairs[(p >> 6) as usize] |= 1 << (p & 63);
+            first[p as usize + 1] += 1;
+        }
+
+        for i in 0..0x10000 {
+            first[i + 1] += first[i];
+        }
+
+        SignatureSet {
+            longest: signatures.iter().map(|s| s.pattern.len()).max().unwrap_or(0),
+            signatures: signatures,
+            pairs: pairs,
+            first: first,
+            anchors: by_pair.into_iter().map(|(_, s, o)| (s, o)).collect(),
+        }
+    }
+
+    /// Parses a list of signatures, one per line. Each line is a pattern as accepted by
+    /// `Signature::new`, optionally prefixed by the function name and a colon. Empty lines and
+    /// lines starting with `#` are ignored.
+    ///
+    /// ```
+    /// use panopticon_analysis::SignatureSet;
+    ///
+    /// let set = SignatureSet::parse("# x86-64\n55 48 89 e5\nmemset: 48 89 f8 ?? ?? 48 83 fa 08").unwrap();
+    /// assert_eq!(set.len(), 2);
+    /// ```
+    pub fn parse(text: &str) -> Result<SignatureSet> {
+        let mut sigs = vec![];
+
+        for line in text.lines().map(|l| l.trim()) {
+            if line.is_empty() || line.starts_with('#') {
+                continue;
+            }
+
+            let sig = match line.find(':') {
+                Some(pos) => Signature::new(Some(line[..pos].trim().to_string()), &line[pos + 1..])?,
+                None => Signature::new(None, line)?,
+            };
+
+            sigs.push(sig);
+        }
+
+        Ok(SignatureSet::new(sigs))
+    }
+
+    /// Number of signatures.
+    pub fn len(&self) -> usize {
+        self.signatures.len()
+    }
+
+    /// Returns true if the set has no signatures.
+    pub fn is_empty(&self) -> bool {
+        self.signatures.is_empty()
+    }
+
+    /// The `idx`th signature.
+    pub fn signature(&self, idx: usize) -> &Signature {
+        &self.signatures[idx]
+    }
+
+    /// Finds all signatures in `bytes`, read from address `base`. Only matches starting in the
+    /// first `own` bytes are reported.
+    fn scan_slice(&self, base: u64, bytes: &[u8], own: usize, out: &mut Vec<SignatureMatch>) {
+        let pairs = &self.pairs[..];
+        let mut prev = match bytes.first() {
+            Some(&b) => b as usize,
+            None => return,
+        };
+
+        for (i, &b) in bytes[1..].iter().enumerate() {
+            let pair = prev | (b as usize) << 8;
+
+            if pairs[pair >> 6] & (1 << (pair & 63)) != 0 {
+                self.verify(base, bytes, own, i, pair, out);
+            }
+            prev = b as usize;
+        }
+
+        // the second byte of the last pair is taken to be zero
+        if pairs[prev >> 6] & (1 << (prev & 63)) != 0 {
+            self.verify(base, bytes, own, bytes.len() - 1, prev, out);
+        }
+    }
+
+    // checks all signatures anchored at `pair`, found at `bytes[i]`
+    fn verify(&self, base: u64, bytes: &[u8], own: usize, i: usize, pair: usize, out: &mut Vec<SignatureMatch>) {
+        for &(sig, off) in self.anchors[self.first[pair] as usize..self.first[pair + 1] as usize].iter() {
+            let off = off as usize;
+
+            if off <= i && i - off < own && self.signatures[sig as usize].is_match(&bytes[i - off..]) {
+                out.push(SignatureMatch { address: base + (i - off) as u64, signature: sig as usize });
+            }
+        }
+    }
+
+    /// Finds all signatures in the defined bytes of `region`. Signatures spanning two `Layer`s
+    /// are not found. Matches are sorted by address.
+    pub fn scan(&self, region: &Region) -> Vec<SignatureMatch> {
+        self.scan_runs(region.defined_bytes())
+    }
+
+    /// Like `scan`, but only looks at the address ranges in `areas`, for example
+    /// `Program::executable`.
+    pub fn scan_areas(&self, region: &Region, areas: &[Bound]) -> Vec<SignatureMatch> {
+        let runs = region
+            .defined_bytes()
+            .into_iter()
+            .flat_map(
+                |(start, bytes)| {
+                    let end = start + bytes.len() as u64;
+
+                    areas
+                        .iter()
+                        .filter_map(
+                            move |a| {
+                                let from = max(start, a.start);
+                                let to = min(end, a.end);
+
+                                if from < to { Some((from, &bytes[(from - start) as usize..(to - start) as usize])) } else { None }
+                            }
+                        )
+                        .collect::<Vec<_>>()
+                }
+            )
+            .collect::<Vec<_>>();
+
+        self.scan_runs(runs)
+    }
+
+    fn scan_runs(&self, runs: Vec<(u64, &[u8])>) -> Vec<SignatureMatch> {
+        use rayon::prelude::*;
+
+        if self.signatures.is_empty() {
+            return vec![];
+        }
+
+        let mut pieces = vec![];
+
+        for (start, bytes) in runs {
+            let mut off = 0;
+
+            while off < bytes.len() {
+                let own = min(PIECE_SIZE, bytes.len() - off);
+                let end = min(bytes.len(), off + own + self.longest - 1);
+
+                pieces.push((start + off as u64, &bytes[off..end], own));
+                off += own;
+            }
+        }
+
+        let mut ret = pieces
+            .par_iter()
+            .map(
+                |&(base, bytes, own)| {
+                    let mut out = vec![];
+                    self.scan_slice(base, bytes, own, &mut out);
+                    out
+                }
+            )
+            .collect::<Vec<_>>()
+            .into_iter()
+            .flat_map(|x| x.into_iter())
+            .collect::<Vec<_>>();
+
+        ret.sort();
+        ret
+    }
+}
+
+/// Adds the start addresses of all matches in `matches` to `program`. Unknown addresses become
+/// new `Todo` entries. Named signatures also name functions and todos that don't have a name
+/// from the symbol table yet. Returns the number of new entry points.
+pub fn apply_signatures(program: &mut Program, set: &SignatureSet, matches: &[SignatureMatch]) -> usize {
+    let mut ret = 0;
+
+    for m in matches {
+        let name = set.signature(m.signature).name.clone();
+
+        match program.find_call_target_by_entry(m.address) {
+            Some(vx) => {
+                if let Some(name) = name {
+                    let default = format!("func_{:#x}", m.address);
+
+                    program.update_target(
+                        vx, |ct| match ct {
+                            &mut CallTarget::Todo(_, ref mut n @ None, _) => *n = Some(name),
+                            &mut CallTarget::Concrete(ref mut f) if f.name == default => {
+                                f.add_alias(default);
+                                f.name = name;
+                            }
+                            _ => {}
+                        }
+                    );
+                }
+            }
+            None => {
+                program.add_target(CallTarget::Todo(Rvalue::new_u64(m.address), name, Uuid::new_v4()));
+                ret += 1;
+            }
+        }
+    }
+
+    ret
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use panopticon_core::{Bound, Function, Layer, OpaqueLayer, Program, Region};
+    use panopticon_graph_algos::VertexListGraphTrait;
+
+    #[test]
+    fn parse() {
+        assert!(Signature::new(None, "55 ?? 8").is_err());
+        assert!(Signature::new(None, "?? ??").is_err());
+        assert!(SignatureSet::parse("foo: 55 xx").is_err());
+
+        let set = SignatureSet::parse("\n# comment\n55 48 89 e5\n  strlen : 31 c0 ?? 0f\n").unwrap();
+
+        assert_eq!(set.len(), 2);
+        assert_eq!(set.signature(0), &Signature { name: None, pattern: vec![Some(0x55), Some(0x48), Some(0x89), Some(0xe5)] });
+        assert_eq!(set.signature(1).name, Some("strlen".to_string()));
+        assert_eq!(set.signature(1).pattern, vec![Some(0x31), Some(0xc0), None, Some(0x0f)]);
+    }
+
+    #[test]
+    fn scan() {
+        let set = SignatureSet::parse("55 48 89 e5\nend: ?? c3\nwild: e8 ?? ?? ?? ??\nfoo: 01 02 03").unwrap();
+        let mut bytes = vec![0x55, 0x48, 0x89, 0xe5, 0xe8, 5, 6, 7, 8, 0xc3];
+        let across = 103 + PIECE_SIZE - 1;
+
+        bytes.extend(vec![0; 3 * PIECE_SIZE / 2]);
+        bytes[across..across + 3].copy_from_slice(&[1, 2, 3]);
+        bytes.extend(vec![0x55, 0x48, 0x89, 0xe5, 0xc3]);
+
+        let len = bytes.len() as u64;
+        let mut reg = Region::new("".to_string(), OpaqueLayer::wrap(bytes));
+
+        // a signature across two layers isn't found, one across two pieces is
+        assert!(reg.cover(Bound::new(100, 102), Layer::wrap(vec![1, 2])));
+        assert!(reg.cover(Bound::new(102, 103), Layer::wrap(vec![3])));
+
+        let found = set.scan(&reg).into_iter().map(|m| (m.address, m.signature)).collect::<Vec<_>>();
+        let tail = len - 5;
+
+        assert_eq!(found, vec![(0, 0), (4, 2), (8, 1), (across as u64, 3), (tail, 0), (tail + 3, 1)]);
+
+        let found = set.scan_areas(&reg, &[Bound::new(1, 9), Bound::new(tail, len)]).into_iter().map(|m| (m.address, m.signature)).collect::<Vec<_>>();
+
+        assert_eq!(found, vec![(4, 2), (tail, 0), (tail + 3, 1)]);
+    }
+
+    #[test]
+    fn apply() {
+        let set = SignatureSet::parse("memcpy: 55 48\n90 90").unwrap();
+        let reg = Region::wrap("".to_string(), vec![0x90, 0x90, 0x55, 0x48, 0x55, 0x48]);
+        let matches = set.scan(&reg);
+        let mut prog = Program::new("prog");
+        let func = Function::undefined(4, None, &reg, None);
+
+        prog.add_target(CallTarget::Todo(Rvalue::new_u64(2), None, Uuid::new_v4()));
+        prog.add_target(CallTarget::Todo(Rvalue::new_u64(4), Some("sym".to_string()), func.uuid().clone()));
+
+        assert_eq!(matches.len(), 3);
+        assert_eq!(apply_signatures(&mut prog, &set, &matches), 1);
+
+        let names = prog.call_graph()
+            .vertex_labels()
+            .map(
+                |ct| match ct {
+                    &CallTarget::Todo(Rvalue::Constant { value, .. }, ref name, _) => (value, name.clone()),
+                    _ => unreachable!(),
+                }
+            )
+            .collect::<::std::collections::BTreeMap<_, _>>();
+
+        assert_eq!(names.get(&0), Some(&None));
+        assert_eq!(names.get(&2), Some(&Some("memcpy".to_string())));
+        assert_eq!(names.get(&4), Some(&Some("sym".to_string())));
+    }
+}
@@ -0,0 +1,492 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Printable strings inside a memory image and the code referencing them.
+//!
+//! `StringIndex::scan` finds runs of printable ASCII characters and UTF-16LE strings made of
+//! ASCII code units in all defined bytes of a `Region`. Runs are extended eight bytes at a time
+//! by classifying all bytes of a 64 bit word with a handful of integer operations. Only the ends
+//! of a run are looked at byte by byte. Large regions are split into pieces that are scanned in
+//! parallel.
+//!
+//! Strings are kept sorted by address and, as a permutation, by content. This allows looking up
+//! all strings inside an address range or starting with a prefix with a binary search. The text
+//! of all strings is stored in a single buffer.
+//!
+//! Cross references are added per function. Every constant operand of a mnemonic or its RREIL
+//! code that points into a string is recorded as a reference from the mnemonic's address. Adding
+//! the references of a function again replaces the ones recorded for it before.
+
+use panopticon_core::{Bound, Function, Program, Region, Rvalue};
+use std::cmp::{Ordering, min};
+use std::collections::{BTreeMap, HashMap};
+use std::ops::Range;
+use uuid::Uuid;
+
+/// Strings shorter than this number of characters are ignored by default.
+pub const MIN_STRING_LENGTH: usize = 4;
+
+/// Number of bytes scanned by a single thread at once.
+const PIECE_SIZE: usize = 1 << 20;
+
+const LOW_BITS: u64 = 0x0101010101010101;
+const HIGH_BITS: u64 = 0x8080808080808080;
+
+/// Character encoding of a string.
+#[derive(Clone,Copy,Debug,PartialEq,Eq,Hash)]
+pub enum Encoding {
+    /// One byte per character
+    Ascii,
+    /// Two bytes per character, little endian
+    Utf16,
+}
+
+/// A string found in a `Region`.
+#[derive(Clone,Copy,Debug,PartialEq,Eq)]
+pub struct StringEntry {
+    /// Address of the first character
+    pub address: u64,
+    /// Number of bytes occupied
+    pub size: u32,
+    /// Character encoding
+    pub encoding: Encoding,
+    text_start: u32,
+    text_len: u32,
+}
+
+impl StringEntry {
+    /// Bytes occupied by the string.
+    pub fn area(&self) -> Bound {
+        Bound::new(self.address, self.address + self.size as u64)
+    }
+}
+
+/// Strings of a memory image, sorted by address and by content, and references to them.
+#[derive(Clone,Debug,Default)]
+pub struct StringIndex {
+    entries: Vec<StringEntry>,
+    text: String,
+    /// Indices into `entries` sorted by text
+    by_text: Vec<u32>,
+    /// Pairs of index into `entries` and address of the referencing mnemonic, with the number of
+    /// functions the mnemonic is part of
+    xrefs: BTreeMap<(u32, u64), usize>,
+    /// References recorded for each function
+    by_function: HashMap<Uuid, Vec<(u32, u64)>>,
+}
+
+fn is_printable(b: u8) -> bool {
+    (b >= 0x20 && b < 0x7f) || b == b'\t'
+}
+
+fn has_zero_byte(w: u64) -> bool {
+    w.wrapping_sub(LOW_BITS) & !w & HIGH_BITS != 0
+}
+
+/// Returns true if all eight bytes of `w` are in 0x20..0x7f. Tabs are handled by the caller.
+fn is_printable_word(w: u64) -> bool {
+    // bytes below 0x80 don't carry into their neighbour when adding 0x60
+    w & HIGH_BITS == 0 && w.wrapping_add(0x6060606060606060) & HIGH_BITS == HIGH_BITS && !has_zero_byte(w ^ 0x7f7f7f7f7f7f7f7f)
+}
+
+/// Returns true if `w` consists of four printable little endian UTF-16 code units.
+fn is_printable_utf16_word(w: u64) -> bool {
+    // replace the (zero) high bytes with 'A' to reuse the ASCII test
+    w & 0xff00ff00ff00ff00 == 0 && is_printable_word(w | 0x4100410041004100)
+}
+
+fn read_word(bytes: &[u8], pos: usize) -> u64 {
+    let b = &bytes[pos..pos + 8];
+
+    (b[0] as u64) | (b[1] as u64) << 8 | (b[2] as u64) << 16 | (b[3] as u64) << 24 | (b[4] as u64) << 32 | (b[5] as u64) << 40 |
+    (b[6] as u64) << 48 | (b[7] as u64) << 56
+}
+
+fn is_printable_unit(bytes: &[u8], pos: usize, encoding: Encoding) -> bool {
+    match encoding {
+        Encoding::Ascii => is_printable(bytes[pos]),
+        Encoding::Utf16 => pos + 1 < bytes.len() && is_printable(bytes[pos]) && bytes[pos + 1] == 0,
+    }
+}
+
+/// Returns the end of the run of printable characters starting at `pos`.
+fn end_of_run(bytes: &[u8], mut pos: usize, encoding: Encoding) -> usize {
+    let step = if encoding == Encoding::Ascii { 1 } else { 2 };
+
+    loop {
+        while pos + 8 <= bytes.len() {
+            let w = read_word(bytes, pos);
+            let ok = match encoding {
+                Encoding::Ascii => is_printable_word(w),
+                Encoding::Utf16 => is_printable_utf16_word(w),
+            };
+
+            if !ok {
+                break;
+            }
+            pos += 8;
+        }
+
+        // the word contained a tab, a non-printable character or the end of the input
+        let stop = min(bytes.len(), pos + 8);
+
+        while pos < stop && is_printable_unit(bytes, pos, encoding) {
+            pos += step;
+        }
+
+        if pos < stop || pos >= bytes.len() || !is_printable_unit(bytes, pos, encoding) {
+            return pos;
+        }
+    }
+}
+
+/// Finds all strings starting in `bytes[from..to]`. Returns offset, size and text of each.
+fn scan_piece(bytes: &[u8], from: usize, to: usize, min_len: usize, encoding: Encoding, out: &mut Vec<(usize, usize, String)>) {
+    let step = if encoding == Encoding::Ascii { 1 } else { 2 };
+
+    for align in 0..step {
+        let mut pos = from + align;
+
+        // the string at the start of the piece belongs to the previous one
+        if pos >= step && is_printable_unit(bytes, pos - step, encoding) {
+            while pos < to && is_printable_unit(bytes, pos, encoding) {
+                pos += step;
+            }
+        }
+
+        while pos < to {
+            if !is_printable_unit(bytes, pos, encoding) {
+                pos += step;
+                continue;
+            }
+
+            let end = end_of_run(bytes, pos, encoding);
+
+            if (end - pos) / step >= min_len {
+                let text = bytes[pos..end].chunks(step).map(|c| c[0] as char).collect::<String>();
+
+                out.push((pos, end - pos, text));
+            }
+
+            pos = end;
+        }
+    }
+}
+
+impl StringIndex {
+    /// Returns an empty index.
+    pub fn new() -> StringIndex {
+        StringIndex::default()
+    }
+
+    /// Finds all ASCII and UTF-16LE strings at least `min_len` characters long in the defined
+    /// bytes of `region`. Strings crossing two `Layer`s are split.
+    pub fn scan(region: &Region, min_len: usize) -> StringIndex {
+        use rayon::prelude::*;
+
+        let min_len = if min_len == 0 { 1 } else { min_len };
+        let mut pieces = vec![];
+
+        for (start, bytes) in region.defined_bytes() {
+            let mut off = 0;
+
+            while off < bytes.len() {
+                let to = min(bytes.len(), off + PIECE_SIZE);
+
+                pieces.push((start, bytes, off, to, Encoding::Ascii));
+                pieces.push((start, bytes, off, to, Encoding::Utf16));
+                off = to;
+            }
+        }
+
+        let mut found = pieces
+            .par_iter()
+            .map(
+                |&(start, bytes, from, to, encoding)| {
+                    let mut out = vec![];
+
+                    scan_piece(bytes, from, to, min_len, encoding, &mut out);
+                    out.into_iter().map(|(off, size, text)| (start + off as u64, size as u32, encoding, text)).collect::<Vec<_>>()
+                }
+            )
+            .collect::<Vec<_>>()
+            .into_iter()
+            .flat_map(|x| x.into_iter())
+            .collect::<Vec<_>>();
+
+        found.sort_by(|a, b| (a.0, a.1).cmp(&(b.0, b.1)));
+
+        let mut ret = StringIndex::new();
+
+        ret.text.reserve(found.iter().map(|x| x.3.len()).sum());
+
+        for (address, size, encoding, text) in found {
+            let entry = StringEntry {
+                address: address,
+                size: size,
+                encoding: encoding,
+                text_start: ret.text.len() as u32,
+                text_len: text.len() as u32,
+            };
+
+            ret.text.push_str(&text);
+            ret.entries.push(entry);
+        }
+
+        let mut by_text = (0..ret.entries.len() as u32).collect::<Vec<_>>();
+
+        by_text.sort_by(|&a, &b| ret.text(a as usize).cmp(ret.text(b as usize)).then(a.cmp(&b)));
+        ret.by_text = by_text;
+        ret
+    }
+
+    /// Number of strings.
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    /// Returns true if there are no strings.
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// All strings sorted by address.
+    pub fn entries(&self) -> &[StringEntry] {
+        &self.entries
+    }
+
+    /// The `idx`th string in address order.
+    pub fn get(&self, idx: usize) -> Option<&StringEntry> {
+        self.entries.get(idx)
+    }
+
+    /// Text of the `idx`th string in address order.
+    pub fn text(&self, idx: usize) -> &str {
+        let e = &self.entries[idx];
+        &self.text[e.text_start as usize..(e.text_start + e.text_len) as usize]
+    }
+
+    /// Index of the string covering `address`.
+    pub fn find(&self, address: u64) -> Option<usize> {
+        match self.entries.binary_search_by(|e| e.address.cmp(&address)) {
+            Ok(idx) => Some(idx),
+            Err(0) => None,
+            Err(idx) => if address < self.entries[idx - 1].area().end { Some(idx - 1) } else { None },
+        }
+    }
+
+    /// Indices of all strings starting inside `area`, in address order.
+    pub fn in_area(&self, area: &Bound) -> Range<usize> {
+        let lower = |addr: u64| match self.entries.binary_search_by(|e| if e.address < addr { Ordering::Less } else { Ordering::Greater }) {
+            Ok(idx) | Err(idx) => idx,
+        };
+
+        lower(area.start)..lower(area.end)
+    }
+
+    /// Indices of all strings starting with `prefix`, sorted by text.
+    pub fn with_prefix(&self, prefix: &str) -> &[u32] {
+        let lower = match self.by_text.binary_search_by(|&i| if self.text(i as usize) < prefix { Ordering::Less } else { Ordering::Greater }) {
+            Ok(idx) | Err(idx) => idx,
+        };
+        let upper = match self.by_text[lower..].binary_search_by(|&i| if self.text(i as usize).starts_with(prefix) { Ordering::Less } else { Ordering::Greater }) {
+            Ok(idx) | Err(idx) => lower + idx,
+        };
+
+        &self.by_text[lower..upper]
+    }
+
+    /// Records all references from `func` into strings, replacing the ones recorded for it before.
+    /// Returns the number of new references.
+    pub fn add_xrefs(&mut self, func: &Function) -> usize {
+        let refs = self.xrefs_of(func);
+        self.replace_xrefs(func.uuid().clone(), refs)
+    }
+
+    /// Records all references from the functions of `program` into strings, replacing the ones
+    /// recorded for them before. Returns the number of new references.
+    pub fn add_program_xrefs(&mut self, program: &Program) -> usize {
+        use rayon::prelude::*;
+
+        let funcs = program.functions().collect::<Vec<_>>();
+        let refs = funcs.par_iter().map(|f| (f.uuid().clone(), self.xrefs_of(f))).collect::<Vec<_>>();
+
+        refs.into_iter().map(|(uuid, r)| self.replace_xrefs(uuid, r)).sum()
+    }
+
+    /// Drops all references recorded for the function `uuid`.
+    pub fn remove_xrefs(&mut self, uuid: &Uuid) {
+        for r in self.by_function.remove(uuid).unwrap_or(vec![]) {
+            let last = match self.xrefs.get_mut(&r) {
+                Some(cnt) => {
+                    *cnt -= 1;
+                    *cnt == 0
+                }
+                None => false,
+            };
+
+            if last {
+                self.xrefs.remove(&r);
+            }
+        }
+    }
+
+    fn replace_xrefs(&mut self, uuid: Uuid, refs: Vec<(u32, u64)>) -> usize {
+        let new = refs.iter().filter(|r| !self.xrefs.contains_key(r)).count();
+
+        self.remove_xrefs(&uuid);
+
+        for r in refs.iter() {
+            *self.xrefs.entry(*r).or_insert(0) += 1;
+        }
+
+        if !refs.is_empty() {
+            self.by_function.insert(uuid, refs);
+        }
+
+        new
+    }
+
+    fn xrefs_of(&self, func: &Function) -> Vec<(u32, u64)> {
+        let mut ret = vec![];
+
+        if self.entries.is_empty() {
+            return ret;
+        }
+
+        for bb in func.basic_blocks() {
+            for mne in bb.mnemonics.iter() {
+                let stmt_ops = mne.instructions.iter().flat_map(|s| s.op.operands().into_iter());
+
+                for rv in mne.operands.iter().chain(stmt_ops) {
+                    if let &Rvalue::Constant { value, .. } = rv {
+                        if let Some(idx) = self.find(value) {
+                            ret.push((idx as u32, mne.area.start));
+                        }
+                    }
+                }
+            }
+        }
+
+        ret.sort();
+        ret.dedup();
+        ret
+    }
+
+    /// Addresses of all mnemonics referencing the `idx`th string.
+    pub fn xrefs(&self, idx: usize) -> Vec<u64> {
+        self.xrefs.range((idx as u32, 0)..).take_while(|&(&(i, _), _)| i == idx as u32).map(|(&(_, a), _)| a).collect()
+    }
+
+    /// Number of references to the `idx`th string.
+    pub fn num_xrefs(&self, idx: usize) -> usize {
+        self.xrefs.range((idx as u32, 0)..).take_while(|&(&(i, _), _)| i == idx as u32).count()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use panopticon_amd64 as amd64;
+    use panopticon_core::{Bound, Function, Layer, Region};
+
+    #[test]
+    fn words() {
+        assert!(is_printable_word(read_word(b"Hello, W", 0)));
+        assert!(is_printable_word(read_word(b" ~~~~~~~", 0)));
+        assert!(!is_printable_word(read_word(b"Hello,\x7fW", 0)));
+        assert!(!is_printable_word(read_word(b"Hello,\x1fW", 0)));
+        assert!(!is_printable_word(read_word(b"\xc8ello, W", 0)));
+        assert!(!is_printable_word(read_word(b"Hello,\tW", 0)));
+        assert!(is_printable_utf16_word(read_word(b"a\0b\0 \0~\0", 0)));
+        assert!(!is_printable_utf16_word(read_word(b"a\0b\0c\x01d\0", 0)));
+        assert!(!is_printable_utf16_word(read_word(b"a\0b\0\0\0d\0", 0)));
+    }
+
+    #[test]
+    fn scan() {
+        let mut bytes = b"\x01\x02abc\0Hello,\tWorld!\0\xff\xffW\0i\0d\0e\0\0\0".to_vec();
+        let long = 3 * PIECE_SIZE / 2;
+
+        bytes.extend(vec![b'x'; long]);
+        bytes.extend(b"\0tail");
+
+        let mut reg = Region::wrap("".to_string(), bytes);
+
+        // strings across layers are split
+        assert!(reg.cover(Bound::new(100, 103), Layer::wrap(b"\0ab".to_vec())));
+
+        let idx = StringIndex::scan(&reg, 4);
+        let found = (0..idx.len()).map(|i| (idx.get(i).unwrap().address, idx.get(i).unwrap().encoding, idx.text(i).len())).collect::<Vec<_>>();
+
+        assert_eq!(
+            found,
+            vec![
+                (6, Encoding::Ascii, 13),
+                (22, Encoding::Utf16, 4),
+                (32, Encoding::Ascii, 68),
+                (103, Encoding::Ascii, long - 71),
+                (33 + long as u64, Encoding::Ascii, 4),
+            ]
+        );
+        assert_eq!(idx.text(0), "Hello,\tWorld!");
+        assert_eq!(idx.text(1), "Wide");
+        assert_eq!(idx.get(1).unwrap().size, 8);
+
+        assert_eq!(idx.find(25), Some(1));
+        assert_eq!(idx.find(31), None);
+        assert_eq!(idx.in_area(&Bound::new(7, 104)), 1..4);
+        assert_eq!(idx.with_prefix("Hel"), &[0]);
+        assert_eq!(idx.with_prefix("x"), &[2, 3]);
+        assert_eq!(idx.with_prefix("xy"), &[] as &[u32]);
+        assert_eq!(idx.with_prefix(""), &[0, 1, 4, 2, 3]);
+        assert_eq!(StringIndex::scan(&reg, 3).with_prefix("abc"), &[0]);
+    }
+
+    #[test]
+    fn xrefs() {
+        // push 0x10; push 0x13; ret
+        let mut bytes = vec![0x68, 0x10, 0, 0, 0, 0x68, 0x13, 0, 0, 0, 0xc3, 0, 0, 0, 0, 0];
+
+        bytes.extend(b"some string\0".iter().cloned());
+
+        let reg = Region::wrap("".to_string(), bytes.clone());
+        let mut idx = StringIndex::scan(&reg, 4);
+        let func = Function::new::<amd64::Amd64>(0, &reg, None, amd64::Mode::Long).unwrap();
+
+        assert_eq!(idx.len(), 1);
+        assert_eq!(idx.add_xrefs(&func), 2);
+        assert_eq!(idx.add_xrefs(&func), 0);
+        assert_eq!(idx.xrefs(0), vec![0, 5]);
+        assert_eq!(idx.num_xrefs(0), 2);
+        assert_eq!(idx.num_xrefs(1), 0);
+
+        // push 0x10; push 0; ret
+        bytes[6] = 0;
+
+        let other = Function::new::<amd64::Amd64>(0, &reg, None, amd64::Mode::Long).unwrap();
+        let changed = Function::with_uuid::<amd64::Amd64>(0, func.uuid(), &Region::wrap("".to_string(), bytes), None, amd64::Mode::Long).unwrap();
+
+        assert_eq!(idx.add_xrefs(&other), 0);
+        assert_eq!(idx.add_xrefs(&changed), 0);
+        assert_eq!(idx.xrefs(0), vec![0, 5]);
+
+        idx.remove_xrefs(other.uuid());
+        assert_eq!(idx.xrefs(0), vec![0]);
+    }
+}
@@ -0,0 +1,396 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Linear sweep pre-pass.
+//!
+//! Recursive disassembly only finds code reachable from known entry points. `sweep` decodes the
+//! executable areas of a program front to back instead. The areas are split into chunks of
+//! `CHUNK_SIZE` bytes that are decoded in parallel on the rayon thread pool. Afterwards the
+//! chunks are stitched together: a chunk whose first instructions overlap the last instruction
+//! of its predecessor is decoded again from where the predecessor stopped until both agree on an
+//! instruction boundary.
+//!
+//! The result is a `SweepIndex` of instruction boundaries and call targets. Call targets that fall
+//! on an instruction boundary are candidate function starts, `seed` adds them to a `Program` as
+//! new entry points for `analyze` and `pipeline`.
+
+use panopticon_core::{Architecture, Bound, CallTarget, Operation, Program, Region, Rvalue};
+use std::mem::size_of;
+use uuid::Uuid;
+
+/// Number of bytes decoded by a single thread at once.
+pub const CHUNK_SIZE: u64 = 64 * 1024;
+
+/// Set of addresses inside an address range. Uses one bit per byte.
+#[derive(Clone,Debug)]
+pub struct Bitmap {
+    area: Bound,
+    words: Vec<u64>,
+}
+
+impl Bitmap {
+    /// Creates an empty set for addresses inside `area`.
+    pub fn new(area: Bound) -> Bitmap {
+        let len = ((area.end.saturating_sub(area.start) + 63) / 64) as usize;
+
+        Bitmap { area: area, words: vec![0; len] }
+    }
+
+    /// Address range covered by this set.
+    pub fn area(&self) -> &Bound {
+        &self.area
+    }
+
+    /// Adds `addr` to the set. Returns false if `addr` is outside of `area()`.
+    pub fn insert(&mut self, addr: u64) -> bool {
+        if addr < self.area.start || addr >= self.area.end {
+            return false;
+        }
+
+        let off = addr - self.area.start;
+        self.words[(off / 64) as usize] |= 1 << (off % 64);
+        true
+    }
+
+    /// Returns true if `addr` is in the set.
+    pub fn contains(&self, addr: u64) -> bool {
+        if addr < self.area.start || addr >= self.area.end {
+            return false;
+        }
+
+        let off = addr - self.area.start;
+        self.words[(off / 64) as usize] & (1 << (off % 64)) != 0
+    }
+
+    /// Number of addresses in the set.
+    pub fn len(&self) -> usize {
+        self.words.iter().map(|w| w.count_ones() as usize).sum()
+    }
+
+    /// Returns true if the set is empty.
+    pub fn is_empty(&self) -> bool {
+        self.words.iter().all(|&w| w == 0)
+    }
+
+    /// Iterates all addresses in the set in ascending order.
+    pub fn iter(&self) -> BitmapIterator {
+        BitmapIterator { bitmap: self, word: 0, bits: self.words.first().cloned().unwrap_or(0) }
+    }
+}
+
+/// Iterator over the addresses in a `Bitmap`.
+pub struct BitmapIterator<'a> {
+    bitmap: &'a Bitmap,
+    word: usize,
+    bits: u64,
+}
+
+impl<'a> Iterator for BitmapIterator<'a> {
+    type Item = u64;
+
+    fn next(&mut self) -> Option<u64> {
+        while self.bits == 0 {
+            self.word += 1;
+
+            match self.bitmap.words.get(self.word) {
+                Some(&w) => self.bits = w,
+                None => return None,
+            }
+        }
+
+        let bit = self.bits.trailing_zeros() as u64;
+
+        self.bits &= self.bits - 1;
+        Some(self.bitmap.area.start + self.word as u64 * 64 + bit)
+    }
+}
+
+/// Linear sweep results for a single executable area.
+#[derive(Clone,Debug)]
+pub struct SweepArea {
+    /// Start addresses of all instructions
+    pub instructions: Bitmap,
+    /// Targets of constant calls
+    pub calls: Bitmap,
+    /// Call targets that are instruction boundaries as well
+    pub functions: Bitmap,
+}
+
+/// Instruction boundaries, call targets and candidate function starts found by `sweep`.
+#[derive(Clone,Debug,Default)]
+pub struct SweepIndex {
+    /// Results for each area passed to `sweep`
+    pub areas: Vec<SweepArea>,
+}
+
+impl SweepIndex {
+    fn area(&self, addr: u64) -> Option<&SweepArea> {
+        self.areas.iter().find(|a| a.instructions.area().start <= addr && a.instructions.area().end > addr)
+    }
+
+    /// Returns true if the linear sweep found an instruction starting at `addr`.
+    pub fn is_instruction(&self, addr: u64) -> bool {
+        self.area(addr).map_or(false, |a| a.instructions.contains(addr))
+    }
+
+    /// Returns true if some instruction calls `addr`.
+    pub fn is_call_target(&self, addr: u64) -> bool {
+        self.area(addr).map_or(false, |a| a.calls.contains(addr))
+    }
+
+    /// Candidate function starts in ascending order.
+    pub fn function_starts(&self) -> Vec<u64> {
+        self.areas.iter().flat_map(|a| a.functions.iter()).collect()
+    }
+
+    /// Number of instructions found.
+    pub fn num_instructions(&self) -> usize {
+        self.areas.iter().map(|a| a.instructions.len()).sum()
+    }
+}
+
+/// Decoded part of an area.
+#[derive(Default)]
+struct Sweep {
+    /// Start and end of each instruction, ascending
+    instructions: Vec<(u64, u64)>,
+    /// Address of the calling instruction and the call target
+    calls: Vec<(u64, u64)>,
+    /// Address the sweep stopped at
+    end: u64,
+}
+
+// decodes the instructions starting in `from..to`. Undecodable tokens are skipped. Stops early if
+// an instruction starts at the same address as one of `sync` and returns the index of that.
+fn sweep_range<A: Architecture>(region: &Region, from: u64, to: u64, config: &A::Configuration, sync: &[(u64, u64)]) -> (Sweep, Option<usize>) {
+    let step = size_of::<A::Token>() as u64;
+    let mut ret = Sweep::default();
+    let mut addr = from;
+
+    while addr < to {
+        if let Ok(idx) = sync.binary_search_by_key(&addr, |&(s, _)| s) {
+            ret.end = addr;
+            return (ret, Some(idx));
+        }
+
+        let end = match A::decode_mnemonics(region, addr, config) {
+            Ok(m) => {
+                let end = m.mnemonics.iter().map(|mne| mne.area.end).max().unwrap_or(addr);
+
+                for mne in m.mnemonics.iter() {
+                    for stmt in mne.instructions.iter() {
+                        if let Operation::Call(Rvalue::Constant { value, .. }) = stmt.op {
+                            ret.calls.push((addr, value));
+                        }
+                    }
+                }
+
+                end
+            }
+            Err(_) => addr,
+        };
+
+        if end > addr {
+            ret.instructions.push((addr, end));
+            addr = end;
+        } else {
+            addr += step;
+        }
+    }
+
+    ret.end = addr;
+    (ret, None)
+}
+
+/// Linear sweeps the address ranges `areas` of `region` using `A::decode_mnemonics` in CPU
+/// configuration `config`. The work is split into chunks of `CHUNK_SIZE` bytes that are decoded on
+/// the current rayon thread pool. Usually called with `Program::executable`.
+pub fn sweep<A: Architecture>(region: &Region, areas: &[Bound], config: A::Configuration) -> SweepIndex
+where
+    A::Configuration: Sync,
+{
+    use rayon::prelude::*;
+
+    let chunks = areas
+        .iter()
+        .enumerate()
+        .flat_map(
+            |(idx, area)| {
+                let mut ret = vec![];
+                let mut start = area.start;
+
+                while start < area.end {
+                    let end = if area.end - start > CHUNK_SIZE { start + CHUNK_SIZE } else { area.end };
+
+                    ret.push((idx, start, end));
+                    start = end;
+                }
+
+                ret
+            }
+        )
+        .collect::<Vec<_>>();
+    let sweeps = chunks
+        .par_iter()
+        .map(|&(_, start, end)| sweep_range::<A>(region, start, end, &config, &[]).0)
+        .collect::<Vec<_>>();
+
+    // stitch the chunks together
+    let mut instructions = areas.iter().map(|a| Bitmap::new(a.clone())).collect::<Vec<_>>();
+    let mut call_targets = vec![];
+    let mut next = None;
+
+    for (&(idx, start, end), sweep) in chunks.iter().zip(sweeps.into_iter()) {
+        let cont = match next {
+            Some((i, addr)) if i == idx && addr > start => addr,
+            _ => start,
+        };
+        let pos = sweep.instructions.iter().position(|&(s, _)| s >= cont).unwrap_or(sweep.instructions.len());
+        let aligned = sweep.instructions.get(pos).map_or(false, |&(s, _)| s == cont);
+        let first = if aligned || cont >= end {
+            pos
+        } else {
+            let (fix, synced) = sweep_range::<A>(region, cont, end, &config, &sweep.instructions[pos..]);
+
+            for &(s, _) in fix.instructions.iter() {
+                instructions[idx].insert(s);
+            }
+            call_targets.extend(fix.calls.into_iter().map(|(_, t)| t));
+
+            match synced {
+                Some(i) => pos + i,
+                None => {
+                    next = Some((idx, fix.end));
+                    continue;
+                }
+            }
+        };
+
+        if first < sweep.instructions.len() {
+            let from = sweep.instructions[first].0;
+
+            for &(s, _) in sweep.instructions[first..].iter() {
+                instructions[idx].insert(s);
+            }
+            call_targets.extend(sweep.calls.iter().filter(|&&(s, _)| s >= from).map(|&(_, t)| t));
+            next = Some((idx, sweep.end));
+        }
+    }
+
+    let mut ret = SweepIndex {
+        areas: instructions
+            .into_iter()
+            .map(
+                |instructions| {
+                    let area = instructions.area().clone();
+
+                    SweepArea { instructions: instructions, calls: Bitmap::new(area.clone()), functions: Bitmap::new(area) }
+                }
+            )
+            .collect(),
+    };
+
+    for tgt in call_targets {
+        if let Some(area) = ret.areas.iter_mut().find(|a| a.calls.area().start <= tgt && a.calls.area().end > tgt) {
+            area.calls.insert(tgt);
+
+            if area.instructions.contains(tgt) {
+                area.functions.insert(tgt);
+            }
+        }
+    }
+
+    ret
+}
+
+/// Adds a `Todo` call target to `program` for every candidate function start in `index` that
+/// isn't known yet. Returns the number of new entry points.
+pub fn seed(program: &mut Program, index: &SweepIndex) -> usize {
+    let mut ret = 0;
+
+    for entry in index.function_starts() {
+        if program.find_call_target_by_entry(entry).is_none() {
+            program.add_target(CallTarget::Todo(Rvalue::new_u64(entry), None, Uuid::new_v4()));
+            ret += 1;
+        }
+    }
+
+    ret
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use panopticon_amd64 as amd64;
+    use panopticon_core::{Bound, OpaqueLayer, Program, Region};
+
+    #[test]
+    fn bitmap() {
+        let mut bm = Bitmap::new(Bound::new(0x100, 0x1c0));
+
+        assert!(bm.is_empty());
+        assert!(bm.insert(0x100));
+        assert!(bm.insert(0x13f));
+        assert!(bm.insert(0x140));
+        assert!(bm.insert(0x1bf));
+        assert!(!bm.insert(0x1c0));
+        assert!(!bm.insert(0xff));
+        assert!(bm.contains(0x13f));
+        assert!(!bm.contains(0x141));
+        assert_eq!(bm.len(), 4);
+        assert_eq!(bm.iter().collect::<Vec<_>>(), vec![0x100, 0x13f, 0x140, 0x1bf]);
+    }
+
+    #[test]
+    fn sweep_and_seed() {
+        // call 0x10; ret; 10 x nop; push rbp; ret
+        let mut bytes = vec![0xe8, 0x0b, 0x00, 0x00, 0x00, 0xc3];
+        bytes.extend(vec![0x90; 10]);
+        bytes.extend(vec![0x55, 0xc3]);
+
+        let len = bytes.len() as u64;
+        let reg = Region::new("".to_string(), OpaqueLayer::wrap(bytes));
+        let index = sweep::<amd64::Amd64>(&reg, &[Bound::new(0, len)], amd64::Mode::Long);
+
+        assert_eq!(index.num_instructions(), 14);
+        assert!(index.is_instruction(5));
+        assert!(!index.is_instruction(1));
+        assert!(index.is_call_target(0x10));
+        assert_eq!(index.function_starts(), vec![0x10]);
+
+        let mut prog = Program::new("prog");
+
+        assert_eq!(seed(&mut prog, &index), 1);
+        assert_eq!(seed(&mut prog, &index), 0);
+        assert!(prog.find_call_target_by_entry(0x10).is_some());
+    }
+
+    #[test]
+    fn stitch_chunks() {
+        // mov eax, 1 repeated, the chunk boundaries fall inside of instructions
+        let bytes = (0..30000).flat_map(|_| vec![0xb8, 0x01, 0x00, 0x00, 0x00]).collect::<Vec<u8>>();
+        let len = bytes.len() as u64;
+        let reg = Region::new("".to_string(), OpaqueLayer::wrap(bytes));
+        let index = sweep::<amd64::Amd64>(&reg, &[Bound::new(0, len)], amd64::Mode::Long);
+
+        assert_eq!(index.num_instructions(), 30000);
+        assert!(index.is_instruction(CHUNK_SIZE - 1));
+        assert!(!index.is_instruction(CHUNK_SIZE));
+        assert!(index.is_instruction(2 * CHUNK_SIZE - 2));
+    }
+}
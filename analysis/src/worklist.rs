@@ -0,0 +1,220 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Queue of function entry points shared by all disassembler threads.
+//!
+//! Every address is handed out at most once. Workers block in `pop` until either new work arrives
+//! or all other workers went idle, so no thread has to wait for a whole "wave" of functions to
+//! finish before starting on the call targets found by its neighbours.
+
+use parking_lot::{Condvar, Mutex};
+use std::cmp::Ordering;
+use std::collections::{BinaryHeap, HashMap, HashSet};
+use uuid::Uuid;
+
+/// Order in which queued functions are disassembled.
+#[derive(Clone,Copy,Debug,PartialEq,Eq,PartialOrd,Ord)]
+pub enum Priority {
+    /// Functions found while following calls.
+    Normal,
+    /// Functions the user is looking at.
+    High,
+}
+
+/// A function waiting to be disassembled.
+#[derive(Clone,Debug,PartialEq,Eq)]
+pub struct Job {
+    /// Entry point.
+    pub entry: u64,
+    /// Name given by the loader or `None`.
+    pub name: Option<String>,
+    /// UUID the function should be created with or `None` for a new, random one.
+    pub uuid: Option<Uuid>,
+}
+
+#[derive(PartialEq,Eq)]
+struct Ticket {
+    priority: Priority,
+    sequence: usize,
+    entry: u64,
+}
+
+impl Ord for Ticket {
+    fn cmp(&self, other: &Ticket) -> Ordering {
+        // higher priority first, FIFO inside the same priority
+        self.priority.cmp(&other.priority).then_with(|| other.sequence.cmp(&self.sequence))
+    }
+}
+
+impl PartialOrd for Ticket {
+    fn partial_cmp(&self, other: &Ticket) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+struct State {
+    tickets: BinaryHeap<Ticket>,
+    pending: HashMap<u64, Job>,
+    seen: HashSet<u64>,
+    running: usize,
+    sequence: usize,
+    cancelled: bool,
+}
+
+/// Prioritized, deduplicating work queue.
+pub struct Worklist {
+    state: Mutex<State>,
+    wakeup: Condvar,
+}
+
+impl Worklist {
+    /// Creates an empty queue.
+    pub fn new() -> Worklist {
+        Worklist {
+            state: Mutex::new(
+                State {
+                    tickets: BinaryHeap::new(),
+                    pending: HashMap::new(),
+                    seen: HashSet::new(),
+                    running: 0,
+                    sequence: 0,
+                    cancelled: false,
+                }
+            ),
+            wakeup: Condvar::new(),
+        }
+    }
+
+    /// Queues the function at `entry`. Returns false if the address was queued before. Pushing an
+    /// address that is still waiting with a higher priority moves it up the queue.
+    pub fn push(&self, entry: u64, name: Option<String>, uuid: Option<Uuid>, priority: Priority) -> bool {
+        let mut state = self.state.lock();
+        let is_new = state.seen.insert(entry);
+
+        if is_new {
+            state.pending.insert(entry, Job { entry: entry, name: name, uuid: uuid });
+        }
+
+        if is_new || (priority > Priority::Normal && state.pending.contains_key(&entry)) {
+            let seq = state.sequence;
+
+            state.sequence += 1;
+            state.tickets.push(Ticket { priority: priority, sequence: seq, entry: entry });
+            self.wakeup.notify_one();
+        }
+
+        is_new
+    }
+
+    /// Moves `entry` to the front of the queue, queuing it if needed.
+    pub fn prioritize(&self, entry: u64) {
+        self.push(entry, None, None, Priority::High);
+    }
+
+    /// Takes the next function off the queue. Blocks while the queue is empty but other threads
+    /// are still working. Returns `None` once all work is done or the queue was cancelled. Every
+    /// returned job must be acknowledged with `done`.
+    pub fn pop(&self) -> Option<Job> {
+        let mut state = self.state.lock();
+
+        loop {
+            if state.cancelled {
+                return None;
+            }
+
+            while let Some(ticket) = state.tickets.pop() {
+                // tickets of reprioritized functions are left in the heap
+                if let Some(job) = state.pending.remove(&ticket.entry) {
+                    state.running += 1;
+                    return Some(job);
+                }
+            }
+
+            if state.running == 0 {
+                return None;
+            }
+
+            self.wakeup.wait(&mut state);
+        }
+    }
+
+    /// Marks a job returned by `pop` as finished.
+    pub fn done(&self) {
+        let mut state = self.state.lock();
+
+        state.running -= 1;
+        if state.running == 0 && state.pending.is_empty() {
+            self.wakeup.notify_all();
+        }
+    }
+
+    /// Stops handing out jobs. Jobs already running are not interrupted.
+    pub fn cancel(&self) {
+        self.state.lock().cancelled = true;
+        self.wakeup.notify_all();
+    }
+
+    /// Number of distinct addresses queued so far.
+    pub fn len(&self) -> usize {
+        self.state.lock().seen.len()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn order() {
+        let wl = Worklist::new();
+
+        assert!(wl.push(1, Some("a".to_string()), None, Priority::Normal));
+        assert!(wl.push(2, None, None, Priority::Normal));
+        assert!(wl.push(3, None, None, Priority::Normal));
+        assert!(!wl.push(1, None, None, Priority::Normal));
+        wl.prioritize(3);
+
+        let job = wl.pop().unwrap();
+        assert_eq!(job.entry, 3);
+        wl.push(4, None, None, Priority::Normal);
+        wl.done();
+
+        let job = wl.pop().unwrap();
+        assert_eq!(job, Job { entry: 1, name: Some("a".to_string()), uuid: None });
+        wl.done();
+        assert_eq!(wl.pop().unwrap().entry, 2);
+        wl.done();
+        assert_eq!(wl.pop().unwrap().entry, 4);
+        wl.done();
+        assert_eq!(wl.pop(), None);
+        assert_eq!(wl.len(), 4);
+
+        // already disassembled
+        wl.prioritize(3);
+        assert_eq!(wl.pop(), None);
+    }
+
+    #[test]
+    fn cancel() {
+        let wl = Worklist::new();
+
+        wl.push(1, None, None, Priority::Normal);
+        wl.cancel();
+        assert_eq!(wl.pop(), None);
+    }
+}
@@ -16,11 +16,19 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-use panopticon_core::{Architecture, Guard, Lvalue, Match, Region, Result, Rvalue, State, Statement};
-use std::borrow::Cow;
+use panopticon_core::{Architecture, Disassembler, Guard, Lvalue, Match, Name, Region, Result, Rvalue, State, Statement};
 use std::convert::Into;
+use std::sync::Arc;
 use syntax;
 
+/// Length of the longest AVR instruction in bytes (32 bit opcodes like `call` and `lds`).
+const MAX_INSTRUCTION_LEN: usize = 4;
+
+lazy_static! {
+    /// Rule trie compiled once and shared by all threads.
+    static ref DISASSEMBLER: Arc<Disassembler<Avr>> = syntax::disassembler();
+}
+
 #[derive(Clone,Debug)]
 pub enum Avr {}
 
@@ -34,15 +42,23 @@ impl Architecture for Avr {
 
     fn decode(reg: &Region, addr: u64, cfg: &Self::Configuration) -> Result<Match<Self>> {
         info!("disass @ {:x}", addr);
-        let disass = syntax::disassembler();
 
-        if let Some(st) = disass.next_match(&mut reg.iter().seek(addr), addr, cfg.clone()) {
+        if let Some(st) = DISASSEMBLER.next_match(&mut reg.iter_at(addr, MAX_INSTRUCTION_LEN), addr, cfg.clone()) {
             info!("    res: {:?}", st);
             Ok(st.into())
         } else {
             Err("Unrecognized instruction".into())
         }
     }
+
+    fn cache_key(cfg: &Self::Configuration) -> Option<u64> {
+        // a pending skip changes the semantics of the next instruction
+        if cfg.skip.is_none() {
+            Some(((cfg.pc_bits as u64) << 32) | cfg.flashend as u64)
+        } else {
+            None
+        }
+    }
 }
 
 #[derive(Clone,Debug)]
@@ -293,7 +309,7 @@ pub fn skip(n: &'static str, expect: bool) -> Box<Fn(&mut State<Avr>) -> bool> {
                     .unwrap();
 
                 (Rvalue::Variable {
-                     name: Cow::Borrowed("ioreg"),
+                     name: Name::new("ioreg"),
                      size: 1,
                      offset: bit as usize,
                      subscript: None,
@@ -389,7 +405,7 @@ pub fn binary_imm(n: &'static str, sem: fn(Lvalue, u64, &mut Mcu) -> Result<Vec<
                     )
                     .unwrap();
 
-                (Lvalue::Variable { name: Cow::Borrowed("ioreg"), size: 8, subscript: None }, Some(a))
+                (Lvalue::Variable { name: Name::new("ioreg"), size: 8, subscript: None }, Some(a))
             };
             let (k, kc) = if st.has_group("k") {
                 (st.get_group("k"), Rvalue::new_u8(st.get_group("k") as u8))
@@ -438,7 +454,7 @@ pub fn binary_ptr(
                 (&AddressRegister::Z, &AddressOffset::Displacement) => format!("Z+{}", maybe_q.clone().unwrap().1),
                 _ => unreachable!(),
             };
-            let addr_reg = Lvalue::Variable { name: Cow::Owned(reg_str), size: 16, subscript: None };
+            let addr_reg = Lvalue::Variable { name: Name::from(reg_str), size: 16, subscript: None };
             let reg = if st.has_group("D") {
                 reg(st, "D")
             } else if st.has_group("d") {
@@ -647,7 +663,6 @@ mod tests {
     use super::syntax::disassembler;
     use panopticon_core::{ControlFlowTarget, Function, Region, Rvalue};
     use panopticon_graph_algos::{BidirectionalGraphTrait, EdgeListGraphTrait, GraphTrait, IncidenceGraphTrait, VertexListGraphTrait};
-    use std::borrow::Cow;
     use std::collections::hash_map::DefaultHasher;
 
     use std::hash::{Hash, Hasher};
@@ -944,15 +959,15 @@ mod tests {
             (vec![0xa3,0xf7],"brvc",vec![Rvalue::Constant{ value: (0b1111111111111111111111-22+1) % 0x20000, size: 16 }]),
             (vec![0xc7,0xf3],"brie",vec![Rvalue::Constant{ value: (0b1111111111111111111111-14+1) % 0x20000, size: 16 }]),
             (vec![0x87,0xf7],"brid",vec![Rvalue::Constant{ value: (0b1111111111111111111111-30+1) % 0x20000, size: 16 }]),
-            (vec![0x9c,0x91],"ld",vec![rreil_rvalue!{ R25:8 }, Rvalue::Variable{ name: Cow::Borrowed("X"), size: 16, offset: 0, subscript: None }]),
-            (vec![0x8d,0x91],"ld",vec![rreil_rvalue!{ R24:8 }, Rvalue::Variable{ name: Cow::Borrowed("X+"), size: 16, offset: 0, subscript: None }]),
-            (vec![0x88,0x81],"ld",vec![rreil_rvalue!{ R24:8 }, Rvalue::Variable{ name: Cow::Borrowed("Y"), size: 16, offset: 0, subscript: None }]),
-            (vec![0xb0,0x81],"ld",vec![rreil_rvalue!{ R27:8 }, Rvalue::Variable{ name: Cow::Borrowed("Z"), size: 16, offset: 0, subscript: None }]),
-            (vec![0x01,0x90],"ld",vec![rreil_rvalue!{ R0:8 }, Rvalue::Variable{ name: Cow::Borrowed("Z+"), size: 16, offset: 0, subscript: None }]),
-            (vec![0x0d,0x92],"st",vec![Rvalue::Variable{ name: Cow::Borrowed("X+"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R0:8 }]),
-            (vec![0x88,0x83],"st",vec![Rvalue::Variable{ name: Cow::Borrowed("Y"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R24:8 }]),
-            (vec![0x80,0x83],"st",vec![Rvalue::Variable{ name: Cow::Borrowed("Z"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R24:8 }]),
-            (vec![0x81,0x93],"st",vec![Rvalue::Variable{ name: Cow::Borrowed("Z+"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R24:8 }]),
+            (vec![0x9c,0x91],"ld",vec![rreil_rvalue!{ R25:8 }, Rvalue::Variable{ name: Name::new("X"), size: 16, offset: 0, subscript: None }]),
+            (vec![0x8d,0x91],"ld",vec![rreil_rvalue!{ R24:8 }, Rvalue::Variable{ name: Name::new("X+"), size: 16, offset: 0, subscript: None }]),
+            (vec![0x88,0x81],"ld",vec![rreil_rvalue!{ R24:8 }, Rvalue::Variable{ name: Name::new("Y"), size: 16, offset: 0, subscript: None }]),
+            (vec![0xb0,0x81],"ld",vec![rreil_rvalue!{ R27:8 }, Rvalue::Variable{ name: Name::new("Z"), size: 16, offset: 0, subscript: None }]),
+            (vec![0x01,0x90],"ld",vec![rreil_rvalue!{ R0:8 }, Rvalue::Variable{ name: Name::new("Z+"), size: 16, offset: 0, subscript: None }]),
+            (vec![0x0d,0x92],"st",vec![Rvalue::Variable{ name: Name::new("X+"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R0:8 }]),
+            (vec![0x88,0x83],"st",vec![Rvalue::Variable{ name: Name::new("Y"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R24:8 }]),
+            (vec![0x80,0x83],"st",vec![Rvalue::Variable{ name: Name::new("Z"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R24:8 }]),
+            (vec![0x81,0x93],"st",vec![Rvalue::Variable{ name: Name::new("Z+"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R24:8 }]),
             (vec![0x03,0x2e],"mov",vec![rreil_rvalue!{ R0:8 },rreil_rvalue!{ R19:8 }]),
             (vec![0x10,0xe0],"ldi",vec![rreil_rvalue!{ R17:8 }, Rvalue::new_u8(0x00)]),
             (vec![0xcd,0xb7],"in",vec![rreil_rvalue!{ R28:8 }, rreil_rvalue!{ [0x3d]:8 }]),
@@ -988,11 +1003,11 @@ mod tests {
             (vec![0x13,0x97],"sbiw",vec![rreil_rvalue!{ R26:8 }, Rvalue::new_u8(0x03)]),
             (vec![0x09,0x94],"ijmp",vec![]),
             (vec![0x09,0x95],"icall",vec![]),
-            (vec![0x2a,0x88],"ldd",vec![rreil_rvalue!{ R2:8 }, Rvalue::Variable{ name: Cow::Borrowed("Y+18"), size: 16, offset: 0, subscript: None }]),
-            (vec![0x87,0x81],"ldd",vec![rreil_rvalue!{ R24:8 }, Rvalue::Variable{ name: Cow::Borrowed("Z+7"), size: 16, offset: 0, subscript: None }]),
+            (vec![0x2a,0x88],"ldd",vec![rreil_rvalue!{ R2:8 }, Rvalue::Variable{ name: Name::new("Y+18"), size: 16, offset: 0, subscript: None }]),
+            (vec![0x87,0x81],"ldd",vec![rreil_rvalue!{ R24:8 }, Rvalue::Variable{ name: Name::new("Z+7"), size: 16, offset: 0, subscript: None }]),
             (vec![0x80,0x91,0x62,0x00],"lds",vec![rreil_rvalue!{ R24:8 }, Rvalue::new_u16(0x0062)]),
-            (vec![0x99,0x83],"std",vec![Rvalue::Variable{ name: Cow::Borrowed("Y+1"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R25:8 }]),
-            (vec![0x84,0x83],"std",vec![Rvalue::Variable{ name: Cow::Borrowed("Z+4"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R24:8 }]),
+            (vec![0x99,0x83],"std",vec![Rvalue::Variable{ name: Name::new("Y+1"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R25:8 }]),
+            (vec![0x84,0x83],"std",vec![Rvalue::Variable{ name: Name::new("Z+4"), size: 16, offset: 0, subscript: None }, rreil_rvalue!{ R24:8 }]),
             (vec![0x90,0x93,0x7c,0x00],"sts",vec![Rvalue::new_u16(0x007C),rreil_rvalue!{ R25:8 }]),
             (vec![0xcf,0x93],"push",vec![rreil_rvalue!{ R28:8 }]),
             (vec![0xcf,0x91],"pop",vec![rreil_rvalue!{ R28:8 }]),
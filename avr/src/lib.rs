@@ -28,6 +28,8 @@ extern crate log;
 #[macro_use]
 extern crate panopticon_core;
 extern crate panopticon_graph_algos;
+#[macro_use]
+extern crate lazy_static;
 extern crate byteorder;
 
 mod syntax;
@@ -18,8 +18,7 @@
 
 use disassembler::{Avr, Mcu, optional_skip, reg, resolv};
 
-use panopticon_core::{Guard, Lvalue, Result, Rvalue, State, Statement};
-use std::borrow::Cow;
+use panopticon_core::{Guard, Lvalue, Name, Result, Rvalue, State, Statement};
 
 pub fn cpse(st: &mut State<Avr>) -> bool {
     let rd = reg(st, "cd");
@@ -443,7 +442,7 @@ pub fn eijmp(st: &mut State<Avr>) -> bool {
         .unwrap();
 
     let next = Rvalue::Variable {
-        name: Cow::Borrowed("q"),
+        name: Name::new("q"),
         size: 24,
         subscript: None,
         offset: 0,
@@ -455,7 +454,7 @@ pub fn eijmp(st: &mut State<Avr>) -> bool {
 }
 
 pub fn elpm(rd: Lvalue, off: usize, st: &mut State<Avr>) -> bool {
-    let zreg = Lvalue::Variable { name: Cow::Borrowed("Z"), size: 24, subscript: None };
+    let zreg = Lvalue::Variable { name: Name::new("Z"), size: 24, subscript: None };
 
     st.mnemonic(
         0,
@@ -576,7 +575,7 @@ pub fn fmulsu(rd: Lvalue, rr: Rvalue, _: &mut Mcu) -> Result<Vec<Statement>> {
 }
 
 pub fn icall(st: &mut State<Avr>) -> bool {
-    let zreg = Lvalue::Variable { name: Cow::Borrowed("Z"), size: 16, subscript: None };
+    let zreg = Lvalue::Variable { name: Name::new("Z"), size: 16, subscript: None };
 
     st.mnemonic(
             0,
@@ -604,7 +603,7 @@ pub fn icall(st: &mut State<Avr>) -> bool {
 }
 
 pub fn ijmp(st: &mut State<Avr>) -> bool {
-    let next = Lvalue::Variable { name: Cow::Borrowed("R30:R31"), size: 22, subscript: None };
+    let next = Lvalue::Variable { name: Name::new("R30:R31"), size: 22, subscript: None };
     st.mnemonic(
             2,
             "ijmp",
@@ -752,7 +751,7 @@ pub fn lds2(st: &mut State<Avr>) -> bool {
 }
 
 pub fn lpm(rd: Lvalue, off: usize, st: &mut State<Avr>) -> bool {
-    let zreg = Lvalue::Variable { name: Cow::Borrowed("Z"), size: 16, subscript: None };
+    let zreg = Lvalue::Variable { name: Name::new("Z"), size: 16, subscript: None };
 
     st.mnemonic(
             0,
@@ -1130,9 +1129,9 @@ pub fn sleep(_: &mut Mcu) -> Result<Vec<Statement>> {
 pub fn spm(rd: Lvalue, off: usize, st: &mut State<Avr>) -> bool {
     let zreg = Lvalue::Variable {
         name: if off == 0 {
-            Cow::Borrowed("Z")
+            Name::new("Z")
         } else {
-            Cow::Borrowed("Z+")
+            Name::new("Z+")
         },
         size: 16,
         subscript: None,
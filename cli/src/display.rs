@@ -351,7 +351,7 @@ pub fn print_mnemonic<W: Write + WriteColor>(fmt: &mut W, mnemonic: &Mnemonic, p
     let mut ops = mnemonic.operands.iter();
     color_bold!(fmt, Blue, mnemonic.opcode)?;
     write!(fmt, " ")?;
-    for token in &mnemonic.format_string {
+    for token in mnemonic.format_string.iter() {
         match token {
             &MnemonicFormatToken::Literal(ref s) => {
                 color_bold!(fmt, Green, s)?;
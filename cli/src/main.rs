@@ -9,6 +9,7 @@ extern crate panopticon_avr;
 extern crate panopticon_analysis;
 extern crate panopticon_graph_algos;
 extern crate futures;
+extern crate rayon;
 #[macro_use]
 extern crate log;
 extern crate env_logger;
@@ -16,9 +17,14 @@ extern crate termcolor;
 extern crate atty;
 
 use panopticon_amd64 as amd64;
-use panopticon_analysis::analyze;
+use panopticon_analysis::{SignatureSet, analyze_with_progress, apply_signatures, seed, sweep};
 use panopticon_avr as avr;
-use panopticon_core::{Machine, Function, FunctionKind, Program, Result, loader};
+use panopticon_core::{Architecture, CallTarget, Machine, Function, Program, Region, Result, loader};
+use panopticon_graph_algos::GraphTrait;
+use std::cmp::{max, min};
+use std::fmt::Debug;
+use std::fs::File;
+use std::io::{self, Read};
 use std::path::Path;
 use std::result;
 use structopt::StructOpt;
@@ -47,6 +53,12 @@ struct Args {
     dump_il: bool,
     #[structopt(long = "color", help = "Forces coloring, even when piping to a file, etc.")]
     color: bool,
+    /// Linear sweep the executable sections for additional functions
+    #[structopt(long = "sweep", help = "Look for functions not reachable from the symbols by linear sweeping all code first")]
+    sweep: bool,
+    /// Byte signatures of function prologues and library functions
+    #[structopt(long = "signatures", help = "Use the byte signatures in this file to find and name functions")]
+    signatures: Option<String>,
     /// Print every function the function calls
     #[structopt(short = "c", long = "calls", help = "Print every address of every function this function calls")]
     calls: bool,
@@ -116,31 +128,19 @@ fn print_reverse_deps<W: Write + WriteColor>(mut fmt: W, program: &Program, filt
     };
     match name_and_address {
         Some((addr, name)) => {
-            let mut reverse_deps: Vec<_> = program.functions().filter_map(|f| {
-                let call_addresses = f.collect_call_addresses();
-                debug!("Total call addresses for {}: {}", f.name, call_addresses.len());
-                if call_addresses.contains(&addr) {
-                    Some((f.start(), f.name.to_string()))
-                } else {
-                    for call_address in call_addresses {
-                        let function = program.find_function_by(|f| f.start() == call_address).expect(&format!("{} has a call address {:#x}, but there isn't a function with that address in the program object", f.name, call_address));
-                        debug!("Checking function {} with call address {:#x} for plt stub", function.name, call_address);
-                        match function.kind() {
-                            &FunctionKind::Stub { ref plt_address, ref name } => {
-                                debug!("Function {} is a plt stub for {}", function.name, name);
-                                if *plt_address == addr {
-                                    debug!("Function {} plt address {:#x} matches reverse dep address {:#x}, returning", f.name, plt_address, addr);
-                                    return Some((f.start(), f.name.to_string()))
-                                }
-                            },
-                            _ => ()
-                        }
-                    }
-                    None
-               }
+            // callers of the function itself and of all PLT stubs importing it
+            let mut targets = program.find_stubs(addr);
+            targets.extend(program.find_call_target_by_entry(addr));
+
+            let mut reverse_deps: Vec<_> = targets.into_iter().flat_map(|vx| program.callers(vx)).filter_map(|vx| {
+                match program.call_graph().vertex_label(vx) {
+                    Some(&CallTarget::Concrete(ref f)) => Some((f.start(), f.name.to_string())),
+                    _ => None,
+                }
             }).collect();
 
             reverse_deps.sort();
+            reverse_deps.dedup();
 
             write!(fmt, "Found ")?;
             color!(fmt, Green, reverse_deps.len().to_string())?;
@@ -162,24 +162,84 @@ fn print_reverse_deps<W: Write + WriteColor>(mut fmt: W, program: &Program, filt
     Ok(())
 }
 
-fn disassemble(binary: &str) -> Result<Program> {
-    let (mut proj, machine) = loader::load(Path::new(&binary))?;
-    let program = proj.code.pop().unwrap();
-    let reg = proj.region().clone();
-    info!("disassembly thread started");
-    Ok(match machine {
-        Machine::Avr => analyze::<avr::Avr>(program, reg.clone(), avr::Mcu::atmega103()),
-        Machine::Ia32 => analyze::<amd64::Amd64>(program, reg.clone(), amd64::Mode::Protected),
-        Machine::Amd64 => analyze::<amd64::Amd64>(program, reg.clone(), amd64::Mode::Long),
-    }?)
+/// Number of finished functions between two progress reports.
+const PROGRESS_INTERVAL: usize = 250;
+
+fn analyze_with<A: Architecture + Debug + Sync + 'static, P: Fn(usize, usize) + Sync>(mut program: Program, reg: Region, config: A::Configuration, linear_sweep: bool, signatures: Option<&SignatureSet>, threads: usize, progress: P) -> Result<Program>
+where
+    A::Configuration: Debug + Sync,
+{
+    if linear_sweep {
+        let index = sweep::<A>(&reg, &program.executable, config.clone());
+        let new = seed(&mut program, &index);
+        info!("linear sweep found {} instructions and {} new functions", index.num_instructions(), new);
+    }
+    if let Some(set) = signatures {
+        let matches = if program.executable.is_empty() { set.scan(&reg) } else { set.scan_areas(&reg, &program.executable) };
+        let new = apply_signatures(&mut program, set, &matches);
+        info!("{} signature matches, {} new functions", matches.len(), new);
+    }
+    analyze_with_progress::<A, _>(program, reg, config, threads, progress)
 }
 
-fn app_logic(fmt: &mut termcolor::Buffer, program: Program, args: Args) -> Result<()> {
-    let filter = Filter { name: args.function_filter, addr: args.address_filter.map(|addr| u64::from_str_radix(&addr, 16).unwrap()) };
+fn read_signatures(path: &str) -> Result<SignatureSet> {
+    let mut text = String::new();
+    File::open(path)?.read_to_string(&mut text)?;
+    SignatureSet::parse(&text)
+}
 
+/// Loads `binary` and analyzes all its programs concurrently. The threads of the rayon pool are
+/// split evenly between the programs analyzed at the same time. Fat binaries and archives report
+/// the progress of each member on stderr.
+fn disassemble(binary: &str, linear_sweep: bool, signatures: Option<&SignatureSet>) -> Result<Vec<Program>> {
+    use rayon::prelude::*;
+
+    let (mut proj, machines) = loader::load_all(Path::new(&binary))?;
+    let programs = proj.code.split_off(0);
+    let verbose = programs.len() > 1;
+    let jobs = programs
+        .into_iter()
+        .zip(machines.into_iter())
+        .map(|(program, machine)| {
+            let reg = proj.region_of(&program).clone();
+            (program, reg, machine)
+        })
+        .collect::<Vec<_>>();
+
+    // at most one program per thread is analyzed at once
+    let threads = max(1, rayon::current_num_threads() / max(1, min(jobs.len(), rayon::current_num_threads())));
+
+    info!("disassembly thread started for {} programs, {} threads each", jobs.len(), threads);
+    let results = jobs
+        .into_par_iter()
+        .map(|(program, reg, machine)| {
+            let name = program.name.clone();
+            let progress = |done: usize, queued: usize| if verbose && done % PROGRESS_INTERVAL == 0 {
+                let _ = writeln!(io::stderr(), "{}: {}/{} functions", name, done, queued);
+            };
+            let ret = match machine {
+                Machine::Avr => analyze_with::<avr::Avr, _>(program, reg, avr::Mcu::atmega103(), linear_sweep, signatures, threads, progress),
+                Machine::Ia32 => analyze_with::<amd64::Amd64, _>(program, reg, amd64::Mode::Protected, linear_sweep, signatures, threads, progress),
+                Machine::Amd64 => analyze_with::<amd64::Amd64, _>(program, reg, amd64::Mode::Long, linear_sweep, signatures, threads, progress),
+            };
+
+            if verbose {
+                match ret {
+                    Ok(ref program) => { let _ = writeln!(io::stderr(), "{}: finished, {} functions", name, program.functions().count()); }
+                    Err(ref e) => { let _ = writeln!(io::stderr(), "{}: failed: {}", name, e); }
+                }
+            }
+            ret
+        })
+        .collect::<Vec<_>>();
+
+    results.into_iter().collect()
+}
+
+fn app_logic(fmt: &mut termcolor::Buffer, program: &Program, args: &Args, filter: &Filter) -> Result<()> {
     debug!("Program.imports: {:#?}", program.imports);
     if args.reverse_deps && filter.filtering() {
-        return print_reverse_deps(fmt, &program, &filter);
+        return print_reverse_deps(fmt, program, filter);
     }
     let mut functions = program.functions().filter_map(|f| if filter.is_match(f) { Some(f) } else { None }).collect::<Vec<&Function>>();
     info!("disassembly thread finished with {} functions", functions.len());
@@ -195,7 +255,7 @@ fn app_logic(fmt: &mut termcolor::Buffer, program: Program, args: Args) -> Resul
         // sort them by start so we can use them later
         bbs.sort_by(|bb1, bb2| bb1.area.start.cmp(&bb2.area.start));
 
-        display::print_function(fmt, &function, &bbs, &program)?;
+        display::print_function(fmt, &function, &bbs, program)?;
         if args.calls {
             let calls = function.collect_call_addresses();
             write!(fmt, "Calls (")?;
@@ -216,11 +276,29 @@ fn app_logic(fmt: &mut termcolor::Buffer, program: Program, args: Args) -> Resul
 
 fn run(args: Args) -> Result<()> {
     exists_path_val(&args.binary)?;
-    let program = disassemble(&args.binary)?;
+    let signatures = match args.signatures {
+        Some(ref path) => Some(read_signatures(path)?),
+        None => None,
+    };
+    let programs = disassemble(&args.binary, args.sweep, signatures.as_ref())?;
+    let filter = Filter { name: args.function_filter.clone(), addr: args.address_filter.as_ref().map(|addr| u64::from_str_radix(addr, 16).unwrap()) };
     let cc = if args.color || atty::is(atty::Stream::Stdout) { ColorChoice::Auto } else { ColorChoice::Never };
     let writer = BufferWriter::stdout(cc);
     let mut fmt = writer.buffer();
-    app_logic(&mut fmt, program, args)?;
+
+    if programs.len() == 1 {
+        app_logic(&mut fmt, &programs[0], &args, &filter)?;
+    } else {
+        // archive members: a function filter usually applies to only some of them
+        for program in programs.iter() {
+            color_bold!(fmt, Cyan, program.name.clone())?;
+            writeln!(fmt, ":")?;
+            if let Err(e) = app_logic(&mut fmt, program, &args, &filter) {
+                writeln!(fmt, "{}", e)?;
+            }
+            writeln!(fmt, "")?;
+        }
+    }
     writer.print(&fmt)?;
     Ok(())
 }
@@ -195,7 +195,7 @@ macro_rules! rreil_memop {
     ( Load # $bank:ident # le # $sz:tt # {} , {} ; $($cdr:tt)*) => {{{{
         let mut stmt = vec![$crate::Statement{{
             op: $crate::Operation::Load(
-                ::std::borrow::Cow::Borrowed(stringify!($bank)),
+                $crate::Name::new(stringify!($bank)),
                 $crate::Endianess::Little,
                 rreil_imm!($sz),
                 rreil_rvalue!({})
@@ -215,7 +215,7 @@ macro_rules! rreil_memop {
     ( Load # $bank:ident # be # $sz:tt # {} , {} ; $($cdr:tt)*) => {{{{
         let mut stmt = vec![$crate::Statement{{
             op: $crate::Operation::Load(
-                ::std::borrow::Cow::Borrowed(stringify!($bank)),
+                $crate::Name::new(stringify!($bank)),
                 $crate::Endianess::Big,
                 rreil_imm!($sz),
                 rreil_rvalue!({})
@@ -239,7 +239,7 @@ macro_rules! rreil_memop {
     ( Store # $bank:ident # le # $sz:tt # {} , {} ; $($cdr:tt)*) => {{{{
         let mut stmt = vec![$crate::Statement{{
             op: $crate::Operation::Store(
-                ::std::borrow::Cow::Borrowed(stringify!($bank)),
+                $crate::Name::new(stringify!($bank)),
                 $crate::Endianess::Little,
                 rreil_imm!($sz),
                 rreil_rvalue!({}),
@@ -260,7 +260,7 @@ macro_rules! rreil_memop {
     ( Store # $bank:ident # be # $sz:tt # {} , {} ; $($cdr:tt)*) => {{{{
         let mut stmt = vec![$crate::Statement{{
             op: $crate::Operation::Store(
-                ::std::borrow::Cow::Borrowed(stringify!($bank)),
+                $crate::Name::new(stringify!($bank)),
                 $crate::Endianess::Big,
                 rreil_imm!($sz),
                 rreil_rvalue!({}),
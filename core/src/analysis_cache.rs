@@ -0,0 +1,295 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Cache of control flow analyses.
+//!
+//! Every `Function` owns an `AnalysisCache` holding the results of the structural analyses of its
+//! control flow graph: a frozen copy of its structure, the order of the basic blocks, the dominator tree, the dominance frontiers,
+//! the weak topological order and the loop nesting forest. Each is computed on first use and then
+//! shared by all passes (SSA conversion, liveness, abstract interpretation, ...) until the graph or
+//! the entry point changes. Changes to the contents of basic blocks or edge labels keep the cache
+//! intact.
+//!
+//! Results are handed out as `Arc`s, so a caller can keep them while the function is modified.
+
+use {ControlFlowGraph, ControlFlowRef, FrozenControlFlowGraph};
+use panopticon_graph_algos::{CompressedGraph, GraphTrait, IncidenceGraphTrait, VertexListGraphTrait};
+use panopticon_graph_algos::dominator::{dense_dominance_frontiers, dense_immediate_dominators};
+use panopticon_graph_algos::order::{HierarchicalOrdering, weak_topo_order};
+use panopticon_graph_algos::search::{TraversalOrder, TreeIterator};
+use std::collections::HashMap;
+use std::fmt;
+use std::sync::{Arc, Mutex};
+
+/// Basic blocks reachable from the entry point, numbered in reverse postorder.
+#[derive(Clone,Debug,PartialEq,Eq)]
+pub struct BlockOrder {
+    /// Basic blocks in reverse postorder. The entry point is first.
+    pub blocks: Vec<ControlFlowRef>,
+    /// Position of each basic block in `blocks`.
+    pub index: HashMap<ControlFlowRef, usize>,
+    /// Successors of each block, one per outgoing edge.
+    pub successors: Vec<Vec<usize>>,
+    /// Predecessors of each block, one per incoming edge from a reachable block.
+    pub predecessors: Vec<Vec<usize>>,
+}
+
+impl BlockOrder {
+    /// Numbers the vertices of `graph` reachable from `entry`. `graph` is the frozen copy of a
+    /// control flow graph, see `AnalysisCache::frozen_cfg`. Panics if `entry` is not part of it.
+    pub fn new(entry: ControlFlowRef, graph: &FrozenControlFlowGraph) -> BlockOrder {
+        let start = graph.vertices().find(|&vx| graph.vertex_label(vx) == Some(&entry)).unwrap();
+        let mut order = TreeIterator::new(start, TraversalOrder::Postorder, graph).collect::<Vec<_>>();
+
+        order.reverse();
+
+        let num = order.len();
+        let mut position = vec![None; graph.num_vertices()];
+        let mut successors = vec![Vec::new(); num];
+        let mut predecessors = vec![Vec::new(); num];
+
+        for (b, vx) in order.iter().enumerate() {
+            position[vx.0] = Some(b);
+        }
+
+        for (b, &vx) in order.iter().enumerate() {
+            for e in graph.out_edges(vx) {
+                if let Some(s) = position[graph.target(e).0] {
+                    successors[b].push(s);
+                    predecessors[s].push(b);
+                }
+            }
+        }
+
+        let blocks = order.iter().map(|&vx| *graph.vertex_label(vx).unwrap()).collect::<Vec<_>>();
+        let index = blocks.iter().enumerate().map(|(i, &vx)| (vx, i)).collect::<HashMap<_, _>>();
+
+        BlockOrder { blocks: blocks, index: index, successors: successors, predecessors: predecessors }
+    }
+
+    /// Reachable basic blocks in postorder.
+    pub fn postorder(&self) -> Vec<ControlFlowRef> {
+        self.blocks.iter().rev().cloned().collect()
+    }
+}
+
+/// Loops of a control flow graph, read off its weak topological order. Every component of the
+/// order is a loop and its head the loop header.
+#[derive(Clone,Debug,PartialEq,Eq,Default)]
+pub struct LoopForest {
+    /// Header of each loop. Loops come before the loops nested in them.
+    pub heads: Vec<ControlFlowRef>,
+    /// Innermost loop enclosing each loop, `None` for the outermost ones.
+    pub parents: Vec<Option<usize>>,
+    /// Innermost loop of each basic block that is part of a loop.
+    pub innermost: HashMap<ControlFlowRef, usize>,
+}
+
+impl LoopForest {
+    /// Extracts the loops from `wto`.
+    pub fn new(wto: &HierarchicalOrdering<ControlFlowRef>) -> LoopForest {
+        let mut ret = LoopForest::default();
+        let mut todo = match wto {
+            // the outermost component is the whole graph and no loop
+            &HierarchicalOrdering::Component(ref partition) => partition.iter().map(|x| (&**x, None)).collect::<Vec<_>>(),
+            &HierarchicalOrdering::Element(_) => vec![],
+        };
+
+        todo.reverse();
+
+        while let Some((h, parent)) = todo.pop() {
+            match h {
+                &HierarchicalOrdering::Element(vx) => {
+                    if let Some(l) = parent {
+                        ret.innermost.insert(vx, l);
+                    }
+                }
+                &HierarchicalOrdering::Component(ref partition) => {
+                    let l = ret.heads.len();
+                    let head = match partition.first().map(|x| &**x) {
+                        Some(&HierarchicalOrdering::Element(vx)) => vx,
+                        _ => continue,
+                    };
+
+                    ret.heads.push(head);
+                    ret.parents.push(parent);
+                    todo.extend(partition.iter().rev().map(|x| (&**x, Some(l))));
+                }
+            }
+        }
+
+        ret
+    }
+
+    /// Number of loops `vx` is part of.
+    pub fn depth(&self, vx: ControlFlowRef) -> usize {
+        let mut ret = 0;
+        let mut l = self.innermost.get(&vx).cloned();
+
+        while let Some(i) = l {
+            ret += 1;
+            l = self.parents[i];
+        }
+
+        ret
+    }
+
+    /// True if `vx` is the header of a loop.
+    pub fn is_head(&self, vx: ControlFlowRef) -> bool {
+        self.innermost.get(&vx).map(|&l| self.heads[l] == vx).unwrap_or(false)
+    }
+}
+
+#[derive(Clone,Default)]
+struct Entries {
+    frozen: Option<Arc<FrozenControlFlowGraph>>,
+    order: Option<Arc<BlockOrder>>,
+    idom: Option<Arc<Vec<Option<usize>>>>,
+    frontiers: Option<Arc<Vec<Vec<usize>>>>,
+    wto: Option<Arc<HierarchicalOrdering<ControlFlowRef>>>,
+    loops: Option<Arc<LoopForest>>,
+}
+
+/// Lazily computed analyses of a single control flow graph. Thread safe, the results are computed
+/// outside of the lock, so concurrent callers may compute the same entry twice.
+#[derive(Default)]
+pub struct AnalysisCache {
+    entries: Mutex<Entries>,
+}
+
+impl AnalysisCache {
+    /// Creates an empty cache.
+    pub fn new() -> AnalysisCache {
+        AnalysisCache::default()
+    }
+
+    /// Drops all results. Must be called whenever the graph or its entry point changes.
+    pub fn clear(&mut self) {
+        *self.entries.get_mut().unwrap() = Entries::default();
+    }
+
+    /// Returns true if no analysis has been computed since the last `clear`.
+    pub fn is_empty(&self) -> bool {
+        let e = self.entries.lock().unwrap();
+        e.frozen.is_none() && e.order.is_none() && e.idom.is_none() && e.frontiers.is_none() && e.wto.is_none() && e.loops.is_none()
+    }
+
+    fn lookup<T, G, F>(&self, get: G, compute: F) -> Arc<T>
+    where
+        G: Fn(&mut Entries) -> &mut Option<Arc<T>>,
+        F: FnOnce() -> T,
+    {
+        if let Some(ret) = get(&mut *self.entries.lock().unwrap()).clone() {
+            return ret;
+        }
+
+        let ret = Arc::new(compute());
+
+        *get(&mut *self.entries.lock().unwrap()) = Some(ret.clone());
+        ret
+    }
+
+    /// Structure of `graph` in compressed sparse row form. The vertices are labeled with the
+    /// `ControlFlowRef`s they stand for, in ascending order.
+    pub fn frozen_cfg(&self, graph: &ControlFlowGraph) -> Arc<FrozenControlFlowGraph> {
+        self.lookup(
+            |e| &mut e.frozen,
+            || {
+                let mut vertices = graph.vertices().collect::<Vec<_>>();
+
+                vertices.sort();
+
+                let index = vertices.iter().enumerate().map(|(i, &vx)| (vx, i)).collect::<HashMap<_, _>>();
+                let edges = vertices
+                    .iter()
+                    .enumerate()
+                    .flat_map(|(i, &vx)| graph.out_edges(vx).map(|e| ((), i, index[&graph.target(e)])).collect::<Vec<_>>())
+                    .collect();
+
+                CompressedGraph::new(vertices, edges)
+            },
+        )
+    }
+
+    /// Basic blocks reachable from `entry` in reverse postorder.
+    pub fn block_order(&self, entry: ControlFlowRef, graph: &ControlFlowGraph) -> Arc<BlockOrder> {
+        self.lookup(|e| &mut e.order, || BlockOrder::new(entry, &self.frozen_cfg(graph)))
+    }
+
+    /// Immediate dominators of the blocks in `block_order`, indexed like `BlockOrder::blocks`.
+    /// The entry point is its own dominator.
+    pub fn immediate_dominators(&self, entry: ControlFlowRef, graph: &ControlFlowGraph) -> Arc<Vec<Option<usize>>> {
+        self.lookup(
+            |e| &mut e.idom,
+            || {
+                let order = self.block_order(entry, graph);
+                dense_immediate_dominators(0, &order.successors)
+            },
+        )
+    }
+
+    /// Dominance frontiers of the blocks in `block_order`, indexed like `BlockOrder::blocks`.
+    pub fn dominance_frontiers(&self, entry: ControlFlowRef, graph: &ControlFlowGraph) -> Arc<Vec<Vec<usize>>> {
+        self.lookup(
+            |e| &mut e.frontiers,
+            || {
+                let order = self.block_order(entry, graph);
+                let idom = self.immediate_dominators(entry, graph);
+                dense_dominance_frontiers(&idom, &order.successors)
+            },
+        )
+    }
+
+    /// Bourdoncle's weak topological order of the blocks reachable from `entry`.
+    pub fn weak_topo_order(&self, entry: ControlFlowRef, graph: &ControlFlowGraph) -> Arc<HierarchicalOrdering<ControlFlowRef>> {
+        self.lookup(|e| &mut e.wto, || weak_topo_order(entry, graph))
+    }
+
+    /// Loop nesting forest of the blocks reachable from `entry`.
+    pub fn loop_forest(&self, entry: ControlFlowRef, graph: &ControlFlowGraph) -> Arc<LoopForest> {
+        self.lookup(
+            |e| &mut e.loops,
+            || {
+                let wto = self.weak_topo_order(entry, graph);
+                LoopForest::new(&wto)
+            },
+        )
+    }
+}
+
+// Copies share the results computed so far. They are only invalidated together with the graph.
+impl Clone for AnalysisCache {
+    fn clone(&self) -> AnalysisCache {
+        AnalysisCache { entries: Mutex::new(self.entries.lock().unwrap().clone()) }
+    }
+}
+
+impl fmt::Debug for AnalysisCache {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        let e = self.entries.lock().unwrap();
+
+        f.debug_struct("AnalysisCache")
+            .field("frozen", &e.frozen.is_some())
+            .field("order", &e.order.is_some())
+            .field("idom", &e.idom.is_some())
+            .field("frontiers", &e.frontiers.is_some())
+            .field("wto", &e.wto.is_some())
+            .field("loops", &e.loops.is_some())
+            .finish()
+    }
+}
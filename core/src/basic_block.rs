@@ -160,15 +160,14 @@ impl BasicBlock {
 #[cfg(test)]
 mod tests {
     use super::*;
-    use {Bound, Lvalue, Mnemonic, Operation, Rvalue, Statement};
-    use std::borrow::Cow;
+    use {Bound, Lvalue, Mnemonic, Name, Operation, Rvalue, Statement};
 
     #[test]
     fn construct() {
         let ops1 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -177,30 +176,30 @@ mod tests {
         let i1 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne1 = Mnemonic::new(
@@ -216,7 +215,7 @@ mod tests {
         let ops2 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -225,30 +224,30 @@ mod tests {
         let i2 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne2 = Mnemonic::new(
@@ -264,7 +263,7 @@ mod tests {
         let ops3 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -273,30 +272,30 @@ mod tests {
         let i3 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne3 = Mnemonic::new(
@@ -326,7 +325,7 @@ mod tests {
         let ops1 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -335,30 +334,30 @@ mod tests {
         let i1 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne1 = Mnemonic::new(
@@ -374,7 +373,7 @@ mod tests {
         let ops2 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -383,30 +382,30 @@ mod tests {
         let i2 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne2 = Mnemonic::new(
@@ -438,7 +437,7 @@ mod tests {
         let ops1 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -447,30 +446,30 @@ mod tests {
         let i1 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne1 = Mnemonic::new(
@@ -486,7 +485,7 @@ mod tests {
         let ops2 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -495,30 +494,30 @@ mod tests {
         let i2 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne2 = Mnemonic::new(
@@ -565,7 +564,7 @@ mod tests {
         let ops1 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -574,30 +573,30 @@ mod tests {
         let i1 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne1 = Mnemonic::new(
@@ -613,7 +612,7 @@ mod tests {
         let ops2 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 offset: 0,
                 size: 3,
                 subscript: None,
@@ -622,30 +621,30 @@ mod tests {
         let i2 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             offset: 0,
                             size: 8,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne2 = Mnemonic::new(
@@ -0,0 +1,282 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Cache of decoded instructions.
+//!
+//! Every `Region` owns a `DecodeCache` that is shared by all its clones, i.e. by all threads
+//! disassembling functions inside the same memory image. Overlapping functions and repeated
+//! calls to `Function::cont` look up instructions decoded before instead of running the decoder
+//! and the semantic lifting again. The cache is dropped when the contents of the `Region` change.
+//!
+//! Entries are keyed by architecture, CPU configuration (see `Architecture::cache_key`), address
+//! and whether the RREIL code was generated. The estimated size of all entries is kept below a configurable limit by evicting the
+//! oldest entries first.
+
+use {Architecture, Guard, Mnemonic, Region, Result, Rvalue, Statement};
+use std::any::TypeId;
+use std::collections::{HashMap, VecDeque};
+use std::fmt;
+use std::mem::size_of;
+use std::sync::{Arc, Mutex};
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+/// Default upper bound for the size of a cache in bytes.
+pub const DEFAULT_LIMIT: usize = 256 * 1024 * 1024;
+
+const SHARDS: usize = 16;
+
+/// Architecture independent part of a `Match`.
+#[derive(Clone,Debug)]
+pub struct Decoded {
+    /// Number of tokens read by the decoder.
+    pub tokens: usize,
+    /// Recognized mnemonics
+    pub mnemonics: Vec<Mnemonic>,
+    /// Jumps/branches originating from the recovered mnemonics
+    pub jumps: Vec<(u64, Rvalue, Guard)>,
+}
+
+impl Decoded {
+    /// Rough estimate of the heap and inline memory used by `self`.
+    fn size(&self) -> usize {
+        let mnes = self.mnemonics
+            .iter()
+            .map(
+                |m| {
+                    // opcodes, names and format strings are interned and not counted
+                    size_of::<Mnemonic>() + m.operands.len() * size_of::<Rvalue>() + m.instructions.len() * size_of::<Statement>()
+                }
+            )
+            .sum::<usize>();
+
+        size_of::<Decoded>() + mnes + self.jumps.len() * size_of::<(u64, Rvalue, Guard)>()
+    }
+}
+
+#[derive(Clone,Copy,PartialEq,Eq,Hash,Debug)]
+struct Key {
+    architecture: TypeId,
+    configuration: u64,
+    address: u64,
+    lifted: bool,
+}
+
+#[derive(Default)]
+struct Shard {
+    entries: HashMap<Key, Arc<Decoded>>,
+    order: VecDeque<(Key, usize)>,
+    size: usize,
+}
+
+/// Thread safe, size limited cache of decoded instructions.
+pub struct DecodeCache {
+    shards: Vec<Mutex<Shard>>,
+    limit: AtomicUsize,
+    hits: AtomicUsize,
+    misses: AtomicUsize,
+}
+
+impl DecodeCache {
+    /// Creates an empty cache holding at most about `limit` bytes.
+    pub fn new(limit: usize) -> DecodeCache {
+        DecodeCache {
+            shards: (0..SHARDS).map(|_| Mutex::new(Shard::default())).collect(),
+            limit: AtomicUsize::new(limit),
+            hits: AtomicUsize::new(0),
+            misses: AtomicUsize::new(0),
+        }
+    }
+
+    /// Returns the instruction(s) at `address` decoded with `A` in configuration `cfg`. Calls
+    /// `A::decode` on a cache miss. Decoding errors are not cached.
+    pub fn decode<A: Architecture>(&self, region: &Region, address: u64, cfg: &A::Configuration) -> Result<Arc<Decoded>> {
+        self.lookup::<A>(region, address, cfg, true)
+    }
+
+    /// Same as `decode` but calls `A::decode_mnemonics` on a cache miss.
+    pub fn decode_mnemonics<A: Architecture>(&self, region: &Region, address: u64, cfg: &A::Configuration) -> Result<Arc<Decoded>> {
+        self.lookup::<A>(region, address, cfg, false)
+    }
+
+    fn lookup<A: Architecture>(&self, region: &Region, address: u64, cfg: &A::Configuration, lifted: bool) -> Result<Arc<Decoded>> {
+        let key = match A::cache_key(cfg) {
+            Some(k) => Key { architecture: TypeId::of::<A>(), configuration: k, address: address, lifted: lifted },
+            None => return Self::decode_uncached::<A>(region, address, cfg, lifted).map(Arc::new),
+        };
+        let shard = &self.shards[(address as usize) % SHARDS];
+
+        if let Some(d) = shard.lock().unwrap().entries.get(&key).cloned() {
+            self.hits.fetch_add(1, Ordering::Relaxed);
+            return Ok(d);
+        }
+
+        self.misses.fetch_add(1, Ordering::Relaxed);
+
+        // decode without holding the lock, another thread may do the same work in the meantime
+        let decoded = Arc::new(Self::decode_uncached::<A>(region, address, cfg, lifted)?);
+        let size = decoded.size();
+        let limit = self.limit.load(Ordering::Relaxed) / SHARDS;
+        let mut shard = shard.lock().unwrap();
+
+        if let Some(d) = shard.entries.get(&key).cloned() {
+            return Ok(d);
+        }
+
+        if size <= limit {
+            while shard.size + size > limit {
+                match shard.order.pop_front() {
+                    Some((k, sz)) => {
+                        shard.entries.remove(&k);
+                        shard.size -= sz;
+                    }
+                    None => break,
+                }
+            }
+
+            shard.entries.insert(key, decoded.clone());
+            shard.order.push_back((key, size));
+            shard.size += size;
+        }
+
+        Ok(decoded)
+    }
+
+    fn decode_uncached<A: Architecture>(region: &Region, address: u64, cfg: &A::Configuration, lifted: bool) -> Result<Decoded> {
+        let m = if lifted { A::decode(region, address, cfg)? } else { A::decode_mnemonics(region, address, cfg)? };
+
+        Ok(Decoded { tokens: m.tokens.len(), mnemonics: m.mnemonics, jumps: m.jumps })
+    }
+
+    /// Changes the size limit. Entries are evicted lazily on the next insert.
+    pub fn set_limit(&self, limit: usize) {
+        self.limit.store(limit, Ordering::Relaxed);
+    }
+
+    /// Current size limit in bytes.
+    pub fn limit(&self) -> usize {
+        self.limit.load(Ordering::Relaxed)
+    }
+
+    /// Estimated size of all cached entries in bytes.
+    pub fn size(&self) -> usize {
+        self.shards.iter().map(|s| s.lock().unwrap().size).sum()
+    }
+
+    /// Number of cached entries.
+    pub fn len(&self) -> usize {
+        self.shards.iter().map(|s| s.lock().unwrap().entries.len()).sum()
+    }
+
+    /// Returns the number of cache hits and misses so far.
+    pub fn stats(&self) -> (usize, usize) {
+        (self.hits.load(Ordering::Relaxed), self.misses.load(Ordering::Relaxed))
+    }
+
+    /// Removes all entries.
+    pub fn clear(&self) {
+        for s in self.shards.iter() {
+            *s.lock().unwrap() = Shard::default();
+        }
+    }
+}
+
+impl Default for DecodeCache {
+    fn default() -> DecodeCache {
+        DecodeCache::new(DEFAULT_LIMIT)
+    }
+}
+
+impl fmt::Debug for DecodeCache {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        let (hits, misses) = self.stats();
+
+        write!(f, "DecodeCache {{ entries: {}, size: {}, limit: {}, hits: {}, misses: {} }}", self.len(), self.size(), self.limit(), hits, misses)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use {Bound, Match, Region, Result};
+
+    #[derive(Clone,Debug)]
+    enum TestArch {}
+    impl Architecture for TestArch {
+        type Token = u8;
+        type Configuration = ();
+
+        fn prepare(_: &Region, _: &()) -> Result<Vec<(&'static str, u64, &'static str)>> {
+            unimplemented!()
+        }
+
+        fn decode(reg: &Region, addr: u64, _: &()) -> Result<Match<Self>> {
+            match reg.iter().seek(addr).next() {
+                Some(Some(b)) => {
+                    let mne = Mnemonic::new(addr..addr + 1, format!("op{}", b), "".to_string(), vec![].iter(), vec![].iter())?;
+                    Ok(Match { tokens: vec![b], mnemonics: vec![mne], jumps: vec![], configuration: () })
+                }
+                _ => Err("undefined".into()),
+            }
+        }
+
+        fn cache_key(_: &()) -> Option<u64> {
+            Some(0)
+        }
+    }
+
+    #[test]
+    fn hit_and_evict() {
+        let reg = Region::wrap("ram".to_string(), (1..33).collect());
+        let cache = DecodeCache::default();
+
+        let a = cache.decode::<TestArch>(&reg, 1, &()).unwrap();
+        let b = cache.decode::<TestArch>(&reg, 1, &()).unwrap();
+
+        assert_eq!(a.mnemonics[0].opcode, "op2");
+        assert!(Arc::ptr_eq(&a, &b));
+        assert_eq!(cache.stats(), (1, 1));
+        assert!(cache.decode::<TestArch>(&reg, 100, &()).is_err());
+        assert_eq!(cache.len(), 1);
+
+        // room for a single entry per shard
+        cache.set_limit(a.size() * SHARDS);
+        cache.decode::<TestArch>(&reg, 1 + SHARDS as u64, &()).unwrap();
+        cache.decode::<TestArch>(&reg, 2, &()).unwrap();
+        cache.decode::<TestArch>(&reg, 3, &()).unwrap();
+        assert_eq!(cache.len(), 3);
+        assert!(cache.size() <= cache.limit());
+
+        cache.clear();
+        assert_eq!(cache.len(), 0);
+    }
+
+    #[test]
+    fn shared_by_region_clones() {
+        let mut reg = Region::wrap("ram".to_string(), vec![1, 2, 3, 4]);
+        let copy = reg.clone();
+
+        reg.decode_cache().decode::<TestArch>(&reg, 0, &()).unwrap();
+        assert_eq!(copy.decode_cache().len(), 1);
+
+        // new contents, new cache
+        reg.cover(Bound::new(0, 1), ::Layer::wrap(vec![9]));
+        assert_eq!(reg.decode_cache().len(), 0);
+        assert_eq!(reg.decode_cache().decode::<TestArch>(&reg, 0, &()).unwrap().mnemonics[0].opcode, "op9");
+        assert_eq!(copy.decode_cache().decode::<TestArch>(&copy, 0, &()).unwrap().mnemonics[0].opcode, "op1");
+    }
+}
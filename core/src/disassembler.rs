@@ -88,18 +88,20 @@
 
 use {Guard, Mnemonic, Region, Result, Rvalue, Statement};
 
-use num::traits::{NumCast, One, Zero};
+use num::traits::{NumCast, One, ToPrimitive, Zero};
 use panopticon_graph_algos::{AdjacencyList, EdgeListGraphTrait, GraphTrait, IncidenceGraphTrait, MutableGraphTrait, VertexListGraphTrait};
 use panopticon_graph_algos::adjacency_list::AdjacencyListVertexDescriptor;
+use std::cell::RefCell;
 use std::collections::HashMap;
 use std::fmt;
 use std::fmt::Debug;
-use std::mem::size_of;
+use std::marker::PhantomData;
+use std::mem::{self, size_of};
 use std::ops::{BitAnd, BitOr, Not, Shl, Shr};
 use std::sync::Arc;
 
 /// CPU architecture and instruction set.
-pub trait Architecture: Clone {
+pub trait Architecture: Clone + 'static {
     /// Unsigned integer type. This is tells [`Disassembler`] whenever mnemonics are read byte or
     /// word wise.
     type Token: Not<Output = Self::Token> + Clone + Zero + One + Debug + NumCast + BitOr<Output = Self::Token> + BitAnd<Output = Self::Token> + Shl<usize, Output = Self::Token> + Shr<usize, Output = Self::Token> + PartialEq + Eq + Send + Sync;
@@ -115,6 +117,20 @@ pub trait Architecture: Clone {
 
     /// Start to disassemble a single Opcode inside a given region at a given address.
     fn decode(&Region, u64, &Self::Configuration) -> Result<Match<Self>>;
+
+    /// Same as `decode`, but the mnemonics may lack their RREIL code. Only `Call` statements must
+    /// be kept, everything else is added later by `Function::lift`. Used to recover the control
+    /// flow graph of a function quickly. The default decodes everything.
+    fn decode_mnemonics(reg: &Region, addr: u64, cfg: &Self::Configuration) -> Result<Match<Self>> {
+        Self::decode(reg, addr, cfg)
+    }
+
+    /// Identifies a configuration in the `DecodeCache`. Decoding the same address with two
+    /// configurations that have the same key must yield the same mnemonics and jumps. Results of
+    /// configurations without a key are never cached. The default never caches.
+    fn cache_key(&Self::Configuration) -> Option<u64> {
+        None
+    }
 }
 
 /// Result of a single disassembly operation.
@@ -186,6 +202,18 @@ impl<A: Architecture> State<A> {
         }
     }
 
+    /// Clears everything semantic actions may have changed, keeping the allocated buffers.
+    fn reset(&mut self, a: u64, c: A::Configuration) {
+        self.address = a;
+        self.tokens.clear();
+        self.groups.clear();
+        self.mnemonics.clear();
+        self.jumps.clear();
+        self.mnemonic_origin = a;
+        self.jump_origin = a;
+        self.configuration = c;
+    }
+
     /// Returns the value of capture group `n`.
     /// # Panics
     /// Panics if no such capture group was defined.
@@ -298,6 +326,7 @@ pub struct Disassembler<A: Architecture> {
     start: AdjacencyListVertexDescriptor,
     end: HashMap<AdjacencyListVertexDescriptor, Arc<Action<A>>>,
     default: Option<Action<A>>,
+    compiled: Option<Arc<Table<A>>>,
 }
 
 impl<A: Architecture> Disassembler<A> {
@@ -307,7 +336,7 @@ impl<A: Architecture> Disassembler<A> {
         let mut g = AdjacencyList::new();
         let s = g.add_vertex(());
 
-        Disassembler { graph: g, start: s, end: HashMap::new(), default: None }
+        Disassembler { graph: g, start: s, end: HashMap::new(), default: None, compiled: None }
     }
     /// Converts to a dot file; useful for debugging
     pub fn to_dot(&self) {
@@ -369,6 +398,13 @@ impl<A: Architecture> Disassembler<A> {
         }
 
         self.end.insert(v, b);
+        self.compiled = None;
+    }
+
+    /// Compiles the rule trie into a flat dispatch table used by `next_match`. Adding rules
+    /// afterwards discards the table. `new_disassembler!` calls this after adding all rules.
+    pub fn compile(&mut self) {
+        self.compiled = Some(Arc::new(Table::new(self)));
     }
 
     /// Sets the default semantic action. This action will be called for each token that failed to
@@ -385,25 +421,19 @@ impl<A: Architecture> Disassembler<A> {
         A::Configuration: Clone + Debug,
         A: Debug,
     {
+        if let Some(ref table) = self.compiled {
+            if let Some(st) = table.next_match(i.clone(), offset, &cfg) {
+                return Some(st);
+            }
+
+            return self.default_match(i, offset, cfg);
+        }
+
         let mut matches = self.find(i.clone(), &State::<A>::new(offset, cfg.clone()));
         let l = matches.len();
 
         match l {
-            0 => {
-                if let Some(ref def) = self.default {
-                    let mut state = State::<A>::new(offset, cfg);
-                    let mut iter = i.clone();
-                    if let Some(tok) = Self::read_token(&mut iter) {
-                        state.tokens.push(tok);
-
-                        if def(&mut state) {
-                            return Some(state);
-                        }
-                    }
-                }
-
-                None
-            }
+            0 => self.default_match(i, offset, cfg),
             1 => Some(matches[0].clone().1),
             _ => {
                 // return longest match
@@ -413,25 +443,35 @@ impl<A: Architecture> Disassembler<A> {
         }
     }
 
+    fn default_match<Iter>(&self, i: &mut Iter, offset: u64, cfg: A::Configuration) -> Option<State<A>>
+    where
+        Iter: Iterator<Item = Option<u8>> + Clone,
+    {
+        if let Some(ref def) = self.default {
+            let mut state = State::<A>::new(offset, cfg);
+            let mut iter = i.clone();
+            if let Some(tok) = Self::read_token(&mut iter) {
+                state.tokens.push(tok);
+
+                if def(&mut state) {
+                    return Some(state);
+                }
+            }
+        }
+
+        None
+    }
+
     fn read_token<Iter>(i: &mut Iter) -> Option<A::Token>
     where
         Iter: Iterator<Item = Option<u8>>,
     {
         let mut tok = A::Token::zero();
-        // XXX: Hardcoded to little endian for AVR. Make configurable in Architecture trait
-        let cells = {
-            let mut x = i.take(size_of::<A::Token>()).collect::<Vec<_>>();
-            x.reverse();
-            x
-        };
-        let mut j = cells.iter();
 
-        for _ in 0..size_of::<A::Token>() {
-            if tok != A::Token::zero() {
-                tok = tok << 8;
-            }
-            if let Some(&Some(byte)) = j.next() {
-                tok = tok | <A::Token as NumCast>::from(byte).unwrap();
+        // XXX: Hardcoded to little endian for AVR. Make configurable in Architecture trait
+        for n in 0..size_of::<A::Token>() {
+            if let Some(Some(byte)) = i.next() {
+                tok = tok | (<A::Token as NumCast>::from(byte).unwrap() << (8 * n));
             } else {
                 return None;
             }
@@ -473,40 +513,7 @@ impl<A: Architecture> Disassembler<A> {
                                         let mut p = pats.clone();
                                         let mut st = state.clone();
 
-                                        // capture group
-                                        for &(ref name, ref mask) in capture.iter() {
-                                            let mut res = if let Some(p) = st.groups.iter().position(|x| x.0 == *name) {
-                                                st.groups[p].1
-                                            } else {
-                                                0u64
-                                            };
-
-                                            for rbit in 0..(size_of::<A::Token>() * 8) {
-                                                let bit = (size_of::<A::Token>() * 8) - rbit - 1;
-                                                let bit_mask = if bit > 0 {
-                                                    A::Token::one() << bit
-                                                } else {
-                                                    A::Token::one()
-                                                };
-
-                                                let a = bit_mask.clone() & mask.clone();
-
-                                                if a != A::Token::zero() {
-                                                    res <<= 1;
-
-                                                    if tok.clone() & a != A::Token::zero() {
-                                                        res |= 1;
-                                                    }
-                                                }
-                                            }
-
-                                            if let Some(p) = st.groups.iter().position(|x| x.0 == *name) {
-                                                st.groups[p].1 = res;
-                                            } else {
-                                                st.groups.push((name.clone(), res));
-                                            }
-                                        }
-
+                                        Self::capture(&mut st, capture, &tok);
                                         p.push(a);
                                         st.tokens.push(tok);
                                         new_states.push((p, st, self.graph.target(e), i));
@@ -530,6 +537,392 @@ impl<A: Architecture> Disassembler<A> {
 
         ret
     }
+
+    /// Appends the bits of `tok` selected by the capture groups to the groups in `st`.
+    fn capture(st: &mut State<A>, capture: &[(String, A::Token)], tok: &A::Token) {
+        for &(ref name, ref mask) in capture.iter() {
+            let mut res = if let Some(p) = st.groups.iter().position(|x| x.0 == *name) {
+                st.groups[p].1
+            } else {
+                0u64
+            };
+
+            for rbit in 0..(size_of::<A::Token>() * 8) {
+                let bit = (size_of::<A::Token>() * 8) - rbit - 1;
+                let bit_mask = if bit > 0 {
+                    A::Token::one() << bit
+                } else {
+                    A::Token::one()
+                };
+
+                let a = bit_mask.clone() & mask.clone();
+
+                if a != A::Token::zero() {
+                    res <<= 1;
+
+                    if tok.clone() & a != A::Token::zero() {
+                        res |= 1;
+                    }
+                }
+            }
+
+            if let Some(p) = st.groups.iter().position(|x| x.0 == *name) {
+                st.groups[p].1 = res;
+            } else {
+                st.groups.push((name.clone(), res));
+            }
+        }
+    }
+}
+
+/// Nodes with at least this many outgoing edges get a dispatch table.
+const DISPATCH_THRESHOLD: usize = 4;
+
+/// Tokens read from the input. Filled on demand and shared by all paths tried by `Table`. Kept as
+/// `u64` so the buffer can be part of `Scratch`.
+struct Tokens<'a, A: Architecture, Iter> {
+    iter: Iter,
+    tokens: &'a mut Vec<u64>,
+    eof: bool,
+    arch: PhantomData<A>,
+}
+
+impl<'a, A: Architecture, Iter: Iterator<Item = Option<u8>>> Tokens<'a, A, Iter> {
+    fn new(i: Iter, buf: &'a mut Vec<u64>) -> Tokens<'a, A, Iter> {
+        Tokens { iter: i, tokens: buf, eof: false, arch: PhantomData }
+    }
+
+    fn get(&mut self, n: usize) -> Option<A::Token> {
+        while !self.eof && self.tokens.len() <= n {
+            match Disassembler::<A>::read_token(&mut self.iter) {
+                Some(t) => self.tokens.push(t.to_u64().unwrap()),
+                None => self.eof = true,
+            }
+        }
+
+        self.tokens.get(n).map(|&t| <A::Token as NumCast>::from(t).unwrap())
+    }
+}
+
+enum TableEdge<A: Architecture> {
+    Terminal { mask: A::Token, pattern: A::Token, capture_group: Vec<(String, A::Token)>, target: usize },
+    /// Sub-disassembler, compiled together with the table.
+    Sub { table: Arc<Table<A>>, target: usize },
+}
+
+struct TableNode<A: Architecture> {
+    action: Option<Arc<Action<A>>>,
+    /// Outgoing edges, range into `Table::edges`.
+    edges: (usize, usize),
+    /// Index of the node's 256 buckets in `Table::buckets` if it has a dispatch table.
+    buckets: Option<usize>,
+}
+
+/// One edge of a path through a `Table`.
+#[derive(Clone,Copy)]
+enum Step {
+    Terminal(usize),
+    /// Edge into a sub-disassembler and the index of the path taken through it in
+    /// `Paths::candidates`.
+    Sub(usize, usize),
+}
+
+/// Path reaching a semantic action. Its edges are `Paths::steps[steps.0..steps.1]`.
+#[derive(Clone,Copy)]
+struct Candidate {
+    node: usize,
+    tokens: usize,
+    depth: usize,
+    /// Number of sub-disassemblers the path is nested in.
+    level: usize,
+    steps: (usize, usize),
+}
+
+/// Paths found by `Table::collect`, including those through sub-disassemblers.
+#[derive(Default)]
+struct Paths {
+    /// Edges from the start node to the one currently visited.
+    path: Vec<Step>,
+    steps: Vec<Step>,
+    candidates: Vec<Candidate>,
+}
+
+/// Buffers used by `Table::next_match`. Each thread keeps one, so decoding an instruction doesn't
+/// allocate once they have grown large enough.
+#[derive(Default)]
+struct Scratch {
+    tokens: Vec<u64>,
+    paths: Paths,
+    /// Candidates of the outermost table in the order they are tried.
+    order: Vec<usize>,
+}
+
+thread_local! {
+    static SCRATCH: RefCell<Scratch> = RefCell::new(Scratch::default());
+}
+
+/// Rule trie of a `Disassembler` compiled into arrays.
+///
+/// Nodes are numbered densely and their edges are stored contiguously. Nodes with many outgoing
+/// edges have 256 buckets indexed by the most significant byte of the next token. Each bucket
+/// lists the edges whose fixed bits agree with that byte, in the order the rules were added. The
+/// tables of sub-disassemblers are built along with the table and shared with them.
+///
+/// Matching first walks the table and collects all paths reaching a semantic action. Candidates
+/// are then tried from the longest to the shortest, running semantic actions until one accepts.
+/// This gives the same result as `Disassembler::find` followed by picking the longest match. The
+/// paths and tokens are kept in per thread buffers and a single `State` is reused for all
+/// candidates tried.
+struct Table<A: Architecture> {
+    nodes: Vec<TableNode<A>>,
+    edges: Vec<TableEdge<A>>,
+    buckets: Vec<(usize, usize)>,
+    bucket_edges: Vec<usize>,
+}
+
+impl<A: Architecture> Table<A> {
+    fn new(dis: &Disassembler<A>) -> Table<A> {
+        let mut index = HashMap::new();
+        let mut order = vec![dis.start];
+        let mut nodes = vec![];
+        let mut edges = vec![];
+        let mut buckets = vec![];
+        let mut bucket_edges = vec![];
+        let shift = size_of::<A::Token>() * 8 - 8;
+
+        index.insert(dis.start, 0);
+
+        // number the nodes in breadth first order
+        let mut i = 0;
+        while i < order.len() {
+            for e in dis.graph.out_edges(order[i]) {
+                let t = dis.graph.target(e);
+
+                if !index.contains_key(&t) {
+                    index.insert(t, order.len());
+                    order.push(t);
+                }
+            }
+            i += 1;
+        }
+
+        for vx in order.iter() {
+            let first = edges.len();
+
+            for e in dis.graph.out_edges(*vx) {
+                let target = index[&dis.graph.target(e)];
+
+                match dis.graph.edge_label(e) {
+                    Some(&Rule::Terminal { ref mask, ref pattern, ref capture_group }) => {
+                        edges.push(
+                            TableEdge::Terminal {
+                                mask: mask.clone(),
+                                pattern: pattern.clone(),
+                                capture_group: capture_group.clone(),
+                                target: target,
+                            }
+                        );
+                    }
+                    Some(&Rule::Sub(ref sub)) => {
+                        let table = match sub.compiled {
+                            Some(ref table) => table.clone(),
+                            None => Arc::new(Table::new(sub)),
+                        };
+
+                        edges.push(TableEdge::Sub { table: table, target: target });
+                    }
+                    None => {}
+                }
+            }
+
+            let last = edges.len();
+            let table = if last - first >= DISPATCH_THRESHOLD {
+                let start = buckets.len();
+
+                for byte in 0..256usize {
+                    let from = bucket_edges.len();
+
+                    for e in first..last {
+                        let hit = match edges[e] {
+                            TableEdge::Terminal { ref mask, ref pattern, .. } => {
+                                let m = Self::top_byte(mask, shift);
+                                byte & m == Self::top_byte(pattern, shift) & m
+                            }
+                            TableEdge::Sub { .. } => true,
+                        };
+
+                        if hit {
+                            bucket_edges.push(e);
+                        }
+                    }
+
+                    buckets.push((from, bucket_edges.len()));
+                }
+
+                Some(start)
+            } else {
+                None
+            };
+
+            nodes.push(TableNode { action: dis.end.get(vx).cloned(), edges: (first, last), buckets: table });
+        }
+
+        Table { nodes: nodes, edges: edges, buckets: buckets, bucket_edges: bucket_edges }
+    }
+
+    fn top_byte(tok: &A::Token, shift: usize) -> usize {
+        (tok.clone() >> shift).to_usize().unwrap_or(0) & 0xff
+    }
+
+    fn next_match<Iter>(&self, i: Iter, offset: u64, cfg: &A::Configuration) -> Option<State<A>>
+    where
+        Iter: Iterator<Item = Option<u8>>,
+    {
+        // the buffers are taken out while in use, semantic actions decoding on their own get
+        // fresh ones
+        let mut scratch = SCRATCH.with(|s| mem::replace(&mut *s.borrow_mut(), Scratch::default()));
+        let ret = {
+            let Scratch { ref mut tokens, ref mut paths, ref mut order } = scratch;
+            let mut toks = Tokens::<A, Iter>::new(i, tokens);
+
+            self.collect(&mut toks, paths, 0, 0, 0, 0, 0, 0);
+
+            // longest first, shallowest second, otherwise rules added earlier win
+            {
+                let c = &paths.candidates;
+
+                order.extend((0..c.len()).filter(|&i| c[i].level == 0));
+                order.sort_unstable_by(|&a, &b| c[b].tokens.cmp(&c[a].tokens).then(c[a].depth.cmp(&c[b].depth)).then(a.cmp(&b)));
+            }
+
+            let mut st = State::<A>::new(offset, cfg.clone());
+            let mut found = false;
+
+            for &c in order.iter() {
+                if self.replay(&mut toks, paths, c, 0, &mut st) {
+                    found = true;
+                    break;
+                }
+
+                st.reset(offset, cfg.clone());
+            }
+
+            if found { Some(st) } else { None }
+        };
+
+        scratch.tokens.clear();
+        scratch.paths.path.clear();
+        scratch.paths.steps.clear();
+        scratch.paths.candidates.clear();
+        scratch.order.clear();
+        SCRATCH.with(|s| *s.borrow_mut() = scratch);
+
+        ret
+    }
+
+    /// Collects all paths starting at `node` that reach a semantic action, in depth first order.
+    /// The edges of the current path before `prefix` belong to tables enclosing this one.
+    fn collect<Iter>(&self, toks: &mut Tokens<A, Iter>, paths: &mut Paths, node: usize, base: usize, pos: usize, depth: usize, level: usize, prefix: usize)
+    where
+        Iter: Iterator<Item = Option<u8>>,
+    {
+        let n = &self.nodes[node];
+
+        if n.action.is_some() {
+            let first = paths.steps.len();
+
+            paths.steps.extend_from_slice(&paths.path[prefix..]);
+            paths.candidates.push(Candidate { node: node, tokens: pos - base, depth: depth, level: level, steps: (first, paths.steps.len()) });
+        }
+
+        if n.edges.0 == n.edges.1 {
+            return;
+        }
+
+        let tok = toks.get(pos);
+        let (from, to, indirect) = match (n.buckets, tok.as_ref()) {
+            (Some(b), Some(t)) => {
+                let (f, t) = self.buckets[b + Self::top_byte(t, size_of::<A::Token>() * 8 - 8)];
+                (f, t, true)
+            }
+            _ => (n.edges.0, n.edges.1, false),
+        };
+
+        for i in from..to {
+            let e = if indirect { self.bucket_edges[i] } else { i };
+
+            match self.edges[e] {
+                TableEdge::Terminal { ref mask, ref pattern, target, .. } => {
+                    if let Some(ref t) = tok {
+                        if mask.clone() & t.clone() == *pattern {
+                            paths.path.push(Step::Terminal(e));
+                            self.collect(toks, paths, target, base, pos + 1, depth + 1, level, prefix);
+                            paths.path.pop();
+                        }
+                    }
+                }
+                TableEdge::Sub { ref table, target } => {
+                    let first = paths.candidates.len();
+                    let mark = paths.path.len();
+
+                    table.collect(toks, paths, 0, pos, pos, 0, level + 1, mark);
+
+                    // the sub-disassembler's matches are visited breadth first. Those of
+                    // sub-disassemblers nested in it have a higher level.
+                    let last = paths.candidates.len();
+                    let max_depth = paths.candidates[first..last].iter().filter(|c| c.level == level + 1).map(|c| c.depth).max();
+
+                    for d in 0..max_depth.map(|d| d + 1).unwrap_or(0) {
+                        for c in first..last {
+                            let sc = paths.candidates[c];
+
+                            if sc.level == level + 1 && sc.depth == d {
+                                paths.path.push(Step::Sub(e, c));
+                                self.collect(toks, paths, target, base, pos + sc.tokens, depth + 1, level, prefix);
+                                paths.path.pop();
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /// Rebuilds the `State` for candidate `c` starting at token `pos`. Returns false if one of the
+    /// semantic actions along the path rejected it.
+    fn replay<Iter>(&self, toks: &mut Tokens<A, Iter>, paths: &Paths, c: usize, mut pos: usize, st: &mut State<A>) -> bool
+    where
+        Iter: Iterator<Item = Option<u8>>,
+    {
+        let c = paths.candidates[c];
+
+        for i in c.steps.0..c.steps.1 {
+            match paths.steps[i] {
+                Step::Terminal(e) => {
+                    if let TableEdge::Terminal { ref capture_group, .. } = self.edges[e] {
+                        let tok = toks.get(pos).unwrap();
+
+                        Disassembler::<A>::capture(st, capture_group, &tok);
+                        st.tokens.push(tok);
+                        pos += 1;
+                    }
+                }
+                Step::Sub(e, sc) => {
+                    if let TableEdge::Sub { ref table, .. } = self.edges[e] {
+                        if !table.replay(toks, paths, sc, pos, st) {
+                            return false;
+                        }
+                        pos += paths.candidates[sc].tokens;
+                    }
+                }
+            }
+        }
+
+        match self.nodes[c.node].action {
+            Some(ref act) => act(st),
+            None => false,
+        }
+    }
 }
 
 impl<A: Architecture> Debug for Disassembler<A> {
@@ -731,6 +1124,7 @@ macro_rules! new_disassembler {
                 }
             })+
 
+            dis.compile();
             ::std::sync::Arc::<$crate::disassembler::Disassembler<$ty>>::new(dis)
         }
     };
@@ -753,6 +1147,7 @@ macro_rules! new_disassembler {
 
             fn __def(st: &mut State<$ty>) -> bool { ($def)(st) };
             dis.set_default(__def);
+            dis.compile();
 
             ::std::sync::Arc::<$crate::disassembler::Disassembler<$ty>>::new(dis)
         }
@@ -1238,4 +1633,58 @@ mod tests {
         assert_eq!(res.mnemonics[0].instructions.len(), 0);
         assert_eq!(res.jumps.len(), 0);
     }
+
+    #[test]
+    fn compiled_matches_trie() {
+        fn named(st: &mut State<TestArchShort>, n: &str) -> bool {
+            let l = st.tokens.len();
+            let groups = format!("{}{:?}", n, st.groups);
+            st.mnemonic(l, &groups, "", vec!(), &|_| { Ok(vec![]) }).unwrap();
+            true
+        }
+
+        let sub = new_disassembler!(TestArchShort =>
+            [ "1 a@......." ] = |st: &mut State<TestArchShort>| named(st, "s1"),
+            [ "1 a@......." , "b@........" ] = |st: &mut State<TestArchShort>| st.get_group("b") != 3,
+            [ 5 ] = |st: &mut State<TestArchShort>| named(st, "s2")
+        );
+        let rules = new_disassembler!(TestArchShort =>
+            [ 1 ] = |st: &mut State<TestArchShort>| named(st, "a"),
+            [ 1, "x@.... 1111" ] = |st: &mut State<TestArchShort>| named(st, "b"),
+            [ "0000 x@...." ] = |st: &mut State<TestArchShort>| named(st, "c"),
+            [ "0000 x@..1." , "x@........" ] = |st: &mut State<TestArchShort>| st.get_group("x") % 3 != 0 && named(st, "d"),
+            [ 2, sub ] = |st: &mut State<TestArchShort>| named(st, "e"),
+            [ 2, sub, 7 ] = |st: &mut State<TestArchShort>| named(st, "f"),
+            [ 2, 5 ] = |st: &mut State<TestArchShort>| named(st, "g"),
+            [ "..1. .... " ] = |st: &mut State<TestArchShort>| named(st, "h"),
+            [ "..1. ....", "11110000" ] = |_: &mut State<TestArchShort>| false,
+            _ = |st: &mut State<TestArchShort>| named(st, "default")
+        );
+        let compiled = Arc::try_unwrap(rules).ok().unwrap();
+        let mut trie = Disassembler::<TestArchShort>::new();
+
+        trie.graph = compiled.graph.clone();
+        trie.start = compiled.start;
+        trie.end = compiled.end.clone();
+        trie.default = compiled.default;
+        assert!(compiled.compiled.is_some());
+        assert!(trie.compiled.is_none());
+
+        let alphabet = [0u8, 1, 2, 3, 5, 7, 0b0000_0110, 0b0010_0000, 0b1000_0011, 0b1000_0101, 0xf0, 0xff];
+
+        for a in alphabet.iter() {
+            for b in alphabet.iter() {
+                for c in alphabet.iter() {
+                    for len in 1..4 {
+                        let bytes = vec![*a, *b, *c];
+                        let def = OpaqueLayer::wrap(bytes[0..len].to_vec());
+                        let x = compiled.next_match(&mut def.iter(), 0, ());
+                        let y = trie.next_match(&mut def.iter(), 0, ());
+
+                        assert_eq!(format!("{:?}", x), format!("{:?}", y), "input: {:?}", &bytes[0..len]);
+                    }
+                }
+            }
+        }
+    }
 }
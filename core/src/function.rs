@@ -29,12 +29,15 @@
 
 
 use {Architecture, BasicBlock, Guard, Mnemonic, Operation, Region, Result, Rvalue, Statement};
+use analysis_cache::{AnalysisCache, BlockOrder, LoopForest};
 
-use panopticon_graph_algos::{AdjacencyList, EdgeListGraphTrait, GraphTrait, MutableGraphTrait, VertexListGraphTrait};
+use panopticon_graph_algos::{AdjacencyList, BidirectionalGraphTrait, CompressedGraph, EdgeListGraphTrait, GraphTrait, IncidenceGraphTrait, MutableGraphTrait, VertexListGraphTrait};
 use panopticon_graph_algos::adjacency_list::{AdjacencyListEdgeDescriptor, AdjacencyListVertexDescriptor, VertexLabelIterator};
-use panopticon_graph_algos::search::{TraversalOrder, TreeIterator};
+use panopticon_graph_algos::order::HierarchicalOrdering;
 use std::borrow::Cow;
-use std::collections::{BTreeMap, HashMap, HashSet};
+use std::collections::{BTreeMap, BTreeSet, HashMap, HashSet};
+use std::mem;
+use std::sync::Arc;
 use uuid::Uuid;
 
 /// An iterator over every BasicBlock in a Function
@@ -81,6 +84,9 @@ pub type ControlFlowGraph = AdjacencyList<ControlFlowTarget, Guard>;
 pub type ControlFlowRef = AdjacencyListVertexDescriptor;
 /// Stable reference to an edge in the `ControlFlowGraph`
 pub type ControlFlowEdge = AdjacencyListEdgeDescriptor;
+/// Read-only copy of the structure of a `ControlFlowGraph`, see `Function::frozen_cfg`. Vertices
+/// are labeled with the node they correspond to in the control flow graph.
+pub type FrozenControlFlowGraph = CompressedGraph<ControlFlowRef, ()>;
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
 /// The kind of function this is, to distinguish plt stubs from regular functions.
@@ -114,6 +120,122 @@ pub struct Function {
     size: usize,
     /// What kind of function is this
     kind: FunctionKind,
+    /// True if the mnemonics lack their RREIL code, see `lift`
+    #[serde(default)]
+    unlifted: bool,
+    /// Addresses of the nodes in `cflow_graph`, built on the first call to `cont`
+    #[serde(skip)]
+    index: Option<CfgIndex>,
+    /// Structural analyses of `cflow_graph`, computed on demand
+    #[serde(skip)]
+    analyses: AnalysisCache,
+}
+
+/// Maps addresses to the nodes of a control flow graph. Lets `Function::cont` attach new code to
+/// an existing graph without rebuilding it.
+#[derive(Clone,Debug,Default)]
+struct CfgIndex {
+    /// Resolved basic blocks by start address
+    blocks: BTreeMap<u64, ControlFlowRef>,
+    /// Failed nodes by address
+    failed: HashMap<u64, ControlFlowRef>,
+    /// Unresolved nodes with constant targets
+    unresolved: HashMap<u64, Vec<ControlFlowRef>>,
+    /// Targets in `unresolved` the next `cont` needs to decode. Jumps added since the last call.
+    pending: HashSet<u64>,
+}
+
+impl CfgIndex {
+    fn new(g: &ControlFlowGraph) -> CfgIndex {
+        let mut ret = CfgIndex::default();
+
+        for vx in g.vertices() {
+            ret.insert(g, vx);
+        }
+
+        ret
+    }
+
+    fn insert(&mut self, g: &ControlFlowGraph, vx: ControlFlowRef) {
+        match g.vertex_label(vx) {
+            Some(&ControlFlowTarget::Resolved(ref bb)) => {
+                self.blocks.insert(bb.area.start, vx);
+            }
+            Some(&ControlFlowTarget::Failed(pos, _)) => {
+                self.failed.insert(pos, vx);
+            }
+            Some(&ControlFlowTarget::Unresolved(Rvalue::Constant { value, .. })) => {
+                self.unresolved.entry(value).or_insert(Vec::new()).push(vx);
+                self.pending.insert(value);
+            }
+            Some(&ControlFlowTarget::Unresolved(_)) | None => {}
+        }
+    }
+
+    fn remove(&mut self, g: &ControlFlowGraph, vx: ControlFlowRef) {
+        match g.vertex_label(vx) {
+            Some(&ControlFlowTarget::Resolved(ref bb)) => {
+                if self.blocks.get(&bb.area.start) == Some(&vx) {
+                    self.blocks.remove(&bb.area.start);
+                }
+            }
+            Some(&ControlFlowTarget::Failed(pos, _)) => {
+                if self.failed.get(&pos) == Some(&vx) {
+                    self.failed.remove(&pos);
+                }
+            }
+            Some(&ControlFlowTarget::Unresolved(Rvalue::Constant { value, .. })) => {
+                let empty = match self.unresolved.get_mut(&value) {
+                    Some(vxs) => {
+                        vxs.retain(|&x| x != vx);
+                        vxs.is_empty()
+                    }
+                    None => false,
+                };
+
+                if empty {
+                    self.unresolved.remove(&value);
+                    self.pending.remove(&value);
+                }
+            }
+            Some(&ControlFlowTarget::Unresolved(_)) | None => {}
+        }
+    }
+
+    /// Basic block covering `addr`.
+    fn block_at(&self, g: &ControlFlowGraph, addr: u64) -> Option<ControlFlowRef> {
+        if let Some(&vx) = self.blocks.get(&addr) {
+            return Some(vx);
+        }
+
+        self.blocks
+            .range(..addr)
+            .next_back()
+            .and_then(
+                |(_, &vx)| match g.vertex_label(vx) {
+                    Some(&ControlFlowTarget::Resolved(ref bb)) if bb.area.end > addr => Some(vx),
+                    _ => None,
+                }
+            )
+    }
+
+    /// Basic block ending at `addr`.
+    fn block_before(&self, g: &ControlFlowGraph, addr: u64) -> Option<ControlFlowRef> {
+        self.blocks
+            .range(..addr)
+            .next_back()
+            .and_then(
+                |(_, &vx)| match g.vertex_label(vx) {
+                    Some(&ControlFlowTarget::Resolved(ref bb)) if bb.area.end == addr => Some(vx),
+                    _ => None,
+                }
+            )
+    }
+
+    /// Basic block or error node a jump to `addr` ends up in.
+    fn target(&self, addr: u64) -> Option<ControlFlowRef> {
+        self.blocks.get(&addr).or_else(|| self.failed.get(&addr)).cloned()
+    }
 }
 
 #[derive(Clone,PartialEq,Eq,Debug)]
@@ -137,11 +259,14 @@ impl Function {
             region: region.name().clone(),
             size: 0,
             kind: FunctionKind::Regular,
+            unlifted: false,
+            index: None,
+            analyses: AnalysisCache::new(),
         }
     }
     // this private method is where the meat of making a function is;
     // almost all perf gains for function disassembly will be in here, and related functions like, assemble_cflow_graph, etc.
-    fn disassemble<A: Architecture>(start: u64, cflow_graph: &mut ControlFlowGraph, size: &mut usize, name: &str, uuid: &Uuid, region: &Region, init: A::Configuration) -> Result<ControlFlowRef> {
+    fn disassemble<A: Architecture>(start: u64, cflow_graph: &mut ControlFlowGraph, size: &mut usize, name: &str, uuid: &Uuid, region: &Region, init: A::Configuration, lift: bool) -> Result<ControlFlowRef> {
         let (mut mnemonics, mut by_source, mut by_destination) = Self::index_cflow_graph(cflow_graph, start);
 
         let mut todo = cflow_graph.vertex_labels().filter_map(|lb| {
@@ -181,35 +306,39 @@ impl Function {
                 }
             }
 
-            let maybe_match = A::decode(region, addr, &init);
+            let maybe_match = if lift {
+                region.decode_cache().decode::<A>(region, addr, &init)
+            } else {
+                region.decode_cache().decode_mnemonics::<A>(region, addr, &init)
+            };
 
             match maybe_match {
                 Ok(match_st) => {
                     if match_st.mnemonics.is_empty() {
                         mnemonics.entry(addr).or_insert(Vec::new()).push(MnemonicOrError::Error(addr, "Unrecognized instruction".into()));
                     } else {
-                        for mne in match_st.mnemonics {
+                        for mne in match_st.mnemonics.iter() {
                             debug!(
-                                "{:x}: {} ({:?})",
+                                "{:x}: {} ({} tokens)",
                                 mne.area.start,
                                 mne.opcode,
                                 match_st.tokens
                             );
                             *size += mne.size();
-                            mnemonics.entry(mne.area.start).or_insert(Vec::new()).push(MnemonicOrError::Mnemonic(mne));
+                            mnemonics.entry(mne.area.start).or_insert(Vec::new()).push(MnemonicOrError::Mnemonic(mne.clone()));
                         }
                     }
 
-                    for (origin, tgt, gu) in match_st.jumps {
+                    for &(origin, ref tgt, ref gu) in match_st.jumps.iter() {
                         debug!("jump to {:?}", tgt);
-                        match tgt {
+                        match *tgt {
                             Rvalue::Constant { value: ref c, .. } => {
                                 by_source.entry(origin).or_insert(Vec::new()).push((tgt.clone(), gu.clone()));
                                 by_destination.entry(*c).or_insert(Vec::new()).push((Rvalue::new_u64(origin), gu.clone()));
                                 todo.insert(*c);
                             }
                             _ => {
-                                by_source.entry(origin).or_insert(Vec::new()).push((tgt, gu.clone()));
+                                by_source.entry(origin).or_insert(Vec::new()).push((tgt.clone(), gu.clone()));
                             }
                         }
                     }
@@ -242,20 +371,367 @@ impl Function {
         }
     }
     /// Continue disassembling from `start`, at `region`, with CPU `configuration`, using the functions current, internal control flow graph.
+    /// The new mnemonics are lifted to RREIL only if the rest of the function is.
+    ///
+    /// Only the new code is decoded and assembled into basic blocks. These are linked into the existing graph, splitting the blocks
+    /// jumped into, so the running time depends on the amount of new code and not on the size of the function.
     pub fn cont<A: Architecture>(&mut self, start: u64, region: &Region, configuration: A::Configuration) -> Result<()> {
-        self.entry_point = Self::disassemble::<A>(start, &mut self.cflow_graph, &mut self.size, &self.name, &self.uuid, region, configuration)?;
-        Ok(())
+        let lift = !self.unlifted;
+        let old_entry = match self.cflow_graph.vertex_label(self.entry_point) {
+            Some(&ControlFlowTarget::Resolved(ref bb)) => Some(bb.area.start),
+            _ => None,
+        };
+        let mut index = match self.index.take() {
+            Some(index) => index,
+            None => CfgIndex::new(&self.cflow_graph),
+        };
+        let maybe_entry = Self::extend::<A>(start, old_entry, &mut self.cflow_graph, &mut index, region, configuration, lift);
+
+        self.index = Some(index);
+        self.analyses.clear();
+
+        match maybe_entry {
+            Some((entry_point, size)) => {
+                self.entry_point = entry_point;
+                self.size += size;
+                Ok(())
+            }
+            None => Err(format!("function ({}) {} has no entry point", self.name, self.uuid).into()),
+        }
+    }
+
+    // decodes all code reachable from `start` and the unresolved constant jumps in `g` that isn't part of `g` yet and links it
+    // into the graph. Returns the new entry point and the size of the new code. Leaves `g` untouched if `start` can't be decoded.
+    fn extend<A: Architecture>(
+        start: u64,
+        old_entry: Option<u64>,
+        g: &mut ControlFlowGraph,
+        index: &mut CfgIndex,
+        region: &Region,
+        init: A::Configuration,
+        lift: bool,
+    ) -> Option<(ControlFlowRef, usize)> {
+        let mut mnemonics = BTreeMap::<u64, Vec<MnemonicOrError>>::new();
+        let mut by_source = HashMap::<u64, Vec<(Rvalue, Guard)>>::new();
+        let mut by_destination = HashMap::<u64, Vec<(Rvalue, Guard)>>::new();
+        let mut splits = BTreeSet::<u64>::new();
+        let mut size = 0;
+        // unresolved jumps seen by an earlier call were decoded already
+        let seeds = mem::replace(&mut index.pending, HashSet::new());
+        let mut todo = seeds.clone();
+
+        todo.insert(start);
+
+        while let Some(addr) = todo.iter().next().cloned() {
+            assert!(todo.remove(&addr));
+
+            if index.failed.contains_key(&addr) || mnemonics.contains_key(&addr) {
+                continue;
+            }
+
+            // jump into a basic block of the existing graph
+            if let Some(vx) = index.block_at(g, addr) {
+                let known = match g.vertex_label(vx) {
+                    Some(&ControlFlowTarget::Resolved(ref bb)) => bb.mnemonics.iter().any(|mne| mne.area.start == addr),
+                    _ => false,
+                };
+
+                if known {
+                    splits.insert(addr);
+                } else {
+                    mnemonics.entry(addr).or_insert(Vec::new()).push(MnemonicOrError::Error(addr, "Jump inside instruction".into()));
+                }
+                continue;
+            }
+
+            // jump into an instruction decoded in this pass
+            let inside = mnemonics
+                .range(..addr)
+                .next_back()
+                .map_or(
+                    false,
+                    |(_, mnes)| {
+                        mnes.iter()
+                            .any(
+                                |moe| match moe {
+                                    &MnemonicOrError::Mnemonic(ref mne) => mne.area.end > addr,
+                                    &MnemonicOrError::Error(..) => false,
+                                }
+                            )
+                    }
+                );
+
+            if inside {
+                mnemonics.entry(addr).or_insert(Vec::new()).push(MnemonicOrError::Error(addr, "Jump inside instruction".into()));
+                continue;
+            }
+
+            let maybe_match = if lift {
+                region.decode_cache().decode::<A>(region, addr, &init)
+            } else {
+                region.decode_cache().decode_mnemonics::<A>(region, addr, &init)
+            };
+
+            match maybe_match {
+                Ok(match_st) => {
+                    if match_st.mnemonics.is_empty() {
+                        mnemonics.entry(addr).or_insert(Vec::new()).push(MnemonicOrError::Error(addr, "Unrecognized instruction".into()));
+                    } else {
+                        for mne in match_st.mnemonics.iter() {
+                            debug!(
+                                "{:x}: {} ({} tokens)",
+                                mne.area.start,
+                                mne.opcode,
+                                match_st.tokens
+                            );
+                            size += mne.size();
+                            mnemonics.entry(mne.area.start).or_insert(Vec::new()).push(MnemonicOrError::Mnemonic(mne.clone()));
+                        }
+                    }
+
+                    for &(origin, ref tgt, ref gu) in match_st.jumps.iter() {
+                        debug!("jump to {:?}", tgt);
+                        by_source.entry(origin).or_insert(Vec::new()).push((tgt.clone(), gu.clone()));
+
+                        if let Rvalue::Constant { value, .. } = *tgt {
+                            by_destination.entry(value).or_insert(Vec::new()).push((Rvalue::new_u64(origin), gu.clone()));
+                            todo.insert(value);
+                        }
+                    }
+                }
+                Err(e) => {
+                    error!("failed to disassemble: {}", e);
+                    mnemonics.entry(addr).or_insert(Vec::new()).push(MnemonicOrError::Error(addr, "Unrecognized instruction".into()));
+                }
+            }
+        }
+
+        let has_entry = splits.contains(&start) ||
+                        mnemonics
+                            .get(&start)
+                            .map_or(false, |mnes| mnes.iter().any(|moe| if let &MnemonicOrError::Mnemonic(_) = moe { true } else { false }));
+
+        if !has_entry {
+            index.pending = seeds;
+            return None;
+        }
+
+        // addresses unresolved jumps may point to now
+        let mut targets = seeds;
+
+        targets.extend(mnemonics.keys().cloned());
+        targets.extend(splits.iter().cloned());
+
+        // jumps from the existing graph into new code start a new basic block
+        for &c in mnemonics.keys() {
+            if let Some(vxs) = index.unresolved.get(&c) {
+                for &vx in vxs.iter() {
+                    for e in g.in_edges(vx) {
+                        if let Some(src) = Self::jump_source(g, g.source(e)) {
+                            by_destination.entry(c).or_insert(Vec::new()).push((Rvalue::new_u64(src), g.edge_label(e).unwrap().clone()));
+                        }
+                    }
+                }
+            }
+        }
+
+        for addr in splits {
+            if let Some(vx) = index.block_at(g, addr) {
+                Self::split_block(g, index, vx, addr);
+            }
+        }
+
+        // copy the new basic blocks into the graph. Jumps into the old code end in unresolved nodes in `sub`.
+        let sub = Self::assemble_cflow_graph(mnemonics, by_source, by_destination, start);
+        let mut vertices = HashMap::<ControlFlowRef, ControlFlowRef>::new();
+        let mut seams = BTreeSet::<u64>::new();
+
+        for vx in sub.vertices() {
+            let lb = sub.vertex_label(vx).unwrap();
+            let existing = match lb {
+                &ControlFlowTarget::Unresolved(Rvalue::Constant { value, .. }) if sub.out_degree(vx) == 0 => index.target(value),
+                _ => None,
+            };
+            let new_vx = match existing {
+                Some(old_vx) => old_vx,
+                None => {
+                    if let &ControlFlowTarget::Resolved(ref bb) = lb {
+                        seams.insert(bb.area.start);
+                        seams.insert(bb.area.end);
+                    }
+
+                    let new_vx = g.add_vertex(lb.clone());
+                    index.insert(g, new_vx);
+                    new_vx
+                }
+            };
+
+            vertices.insert(vx, new_vx);
+        }
+
+        for e in sub.edges() {
+            g.add_edge(sub.edge_label(e).unwrap().clone(), vertices[&sub.source(e)], vertices[&sub.target(e)]);
+        }
+
+        // replace unresolved jumps into code we know now
+        let resolved = targets
+            .iter()
+            .filter_map(|c| index.unresolved.get(c).and_then(|vxs| index.target(*c).map(|tgt| (tgt, vxs.clone()))))
+            .collect::<Vec<_>>();
+
+        for (tgt, vxs) in resolved {
+            for vx in vxs {
+                let ins = g.in_edges(vx).collect::<Vec<_>>();
+
+                for e in ins {
+                    let src = g.source(e);
+
+                    if let Some(gu) = g.remove_edge(e) {
+                        g.add_edge(gu, src, tgt);
+                    }
+                }
+
+                if g.out_degree(vx) == 0 {
+                    index.remove(g, vx);
+                    g.remove_vertex(vx);
+                }
+            }
+        }
+
+        // new code falling through into old code or vice versa
+        if let Some(old) = old_entry {
+            seams.insert(old);
+        }
+
+        for addr in seams {
+            if addr != start {
+                if let (Some(a), Some(b)) = (index.block_before(g, addr), index.blocks.get(&addr).cloned()) {
+                    Self::merge_blocks(g, index, a, b);
+                }
+            }
+        }
+
+        index.blocks.get(&start).map(|&vx| (vx, size))
+    }
+
+    // address of the last mnemonic before the jump
+    fn jump_source(g: &ControlFlowGraph, vx: ControlFlowRef) -> Option<u64> {
+        match g.vertex_label(vx) {
+            Some(&ControlFlowTarget::Resolved(ref bb)) => Some(bb.mnemonics.last().map_or(bb.area.start, |mne| mne.area.start)),
+            Some(&ControlFlowTarget::Failed(pos, _)) => Some(pos),
+            Some(&ControlFlowTarget::Unresolved(Rvalue::Constant { value, .. })) => Some(value),
+            Some(&ControlFlowTarget::Unresolved(_)) | None => None,
+        }
+    }
+
+    // address a jump to `vx` points to
+    fn jump_target(g: &ControlFlowGraph, vx: ControlFlowRef) -> Option<u64> {
+        match g.vertex_label(vx) {
+            Some(&ControlFlowTarget::Resolved(ref bb)) => Some(bb.area.start),
+            Some(&ControlFlowTarget::Failed(pos, _)) => Some(pos),
+            Some(&ControlFlowTarget::Unresolved(Rvalue::Constant { value, .. })) => Some(value),
+            Some(&ControlFlowTarget::Unresolved(_)) | None => None,
+        }
+    }
+
+    // splits the basic block `vx` in two at `addr`. The second half takes over all outgoing jumps.
+    fn split_block(g: &mut ControlFlowGraph, index: &mut CfgIndex, vx: ControlFlowRef, addr: u64) {
+        let tail = match g.vertex_label_mut(vx) {
+            Some(&mut ControlFlowTarget::Resolved(ref mut bb)) if bb.area.start < addr => {
+                match bb.mnemonics.iter().position(|mne| mne.area.start == addr) {
+                    Some(pos) => {
+                        let tail = bb.mnemonics.split_off(pos);
+
+                        bb.area.end = addr;
+                        BasicBlock::from_vec(tail)
+                    }
+                    None => return,
+                }
+            }
+            _ => return,
+        };
+        let tail = g.add_vertex(ControlFlowTarget::Resolved(tail));
+        let outs = g.out_edges(vx).collect::<Vec<_>>();
+
+        index.insert(g, tail);
+
+        for e in outs {
+            let tgt = g.target(e);
+
+            if let Some(gu) = g.remove_edge(e) {
+                g.add_edge(gu, tail, tgt);
+            }
+        }
+
+        g.add_edge(Guard::always(), vx, tail);
+    }
+
+    // appends `b` to the adjacent basic block `a` if `a` only jumps to `b` and no one else jumps to `b`.
+    fn merge_blocks(g: &mut ControlFlowGraph, index: &mut CfgIndex, a: ControlFlowRef, b: ControlFlowRef) {
+        let (last, next) = match (g.vertex_label(a), g.vertex_label(b)) {
+            (Some(&ControlFlowTarget::Resolved(ref bb_a)), Some(&ControlFlowTarget::Resolved(ref bb_b))) if a != b => {
+                (bb_a.mnemonics.last().map_or(bb_a.area.start, |mne| mne.area.start), bb_b.area.start)
+            }
+            _ => return,
+        };
+        let falls_thru = g.out_edges(a).all(|e| Self::jump_target(g, g.target(e)).map_or(true, |tgt| tgt == next));
+        let single_pred = g.in_edges(b).all(|e| Self::jump_source(g, g.source(e)).map_or(true, |src| src == last));
+
+        if !falls_thru || !single_pred {
+            return;
+        }
+
+        let outs = g.out_edges(b).map(|e| (e, g.target(e))).collect::<Vec<_>>();
+        let ins = g.in_edges(b).map(|e| (e, g.source(e))).collect::<Vec<_>>();
+        let mut edges = vec![];
+
+        for (e, tgt) in outs {
+            if let Some(gu) = g.remove_edge(e) {
+                edges.push((gu, a, if tgt == b { a } else { tgt }));
+            }
+        }
+
+        for (e, src) in ins {
+            if let Some(gu) = g.remove_edge(e) {
+                if src != a {
+                    edges.push((gu, src, a));
+                }
+            }
+        }
+
+        index.remove(g, b);
+
+        if let Some(ControlFlowTarget::Resolved(bb_b)) = g.remove_vertex(b) {
+            if let Some(&mut ControlFlowTarget::Resolved(ref mut bb_a)) = g.vertex_label_mut(a) {
+                bb_a.area.end = bb_b.area.end;
+                bb_a.mnemonics.extend(bb_b.mnemonics);
+            }
+        }
+
+        for (gu, src, tgt) in edges {
+            g.add_edge(gu, src, tgt);
+        }
     }
 
     /// Create and start disassembling a new function with `name`, inside memory `region`, starting at entry point `start`, with a random UUID.
     pub fn new<A: Architecture>(start: u64, region: &Region, name: Option<String>, init: A::Configuration) -> Result<Function> {
+        Self::build::<A>(start, None, region, name, init, true)
+    }
+
+    /// Same as `new`, but only decodes the mnemonics and their control flow using `Architecture::decode_mnemonics`. Call statements are kept,
+    /// all other RREIL code is generated by `lift`. Enough to display the function and to find its callees.
+    pub fn new_unlifted<A: Architecture>(start: u64, uuid: Option<Uuid>, region: &Region, name: Option<String>, init: A::Configuration) -> Result<Function> {
+        Self::build::<A>(start, uuid, region, name, init, false)
+    }
+
+    fn build<A: Architecture>(start: u64, uuid: Option<Uuid>, region: &Region, name: Option<String>, init: A::Configuration, lift: bool) -> Result<Function> {
         let mut cflow_graph = AdjacencyList::new();
         let entry_point = ControlFlowTarget::Unresolved(Rvalue::new_u64(start));
         cflow_graph.add_vertex(entry_point);
         let mut size = 0;
         let name = name.unwrap_or(format!("func_{:#x}", start));
-        let uuid = Uuid::new_v4();
-        let entry_point = Self::disassemble::<A>(start, &mut cflow_graph, &mut size, &name, &uuid, region, init)?;
+        let uuid = uuid.unwrap_or(Uuid::new_v4());
+        let entry_point = Self::disassemble::<A>(start, &mut cflow_graph, &mut size, &name, &uuid, region, init, lift)?;
         Ok(Function {
             name,
             aliases: Vec::new(),
@@ -265,9 +741,56 @@ impl Function {
             region: region.name().clone(),
             size,
             kind: FunctionKind::Regular,
+            unlifted: !lift,
+            index: None,
+            analyses: AnalysisCache::new(),
         })
     }
 
+    /// Generates the RREIL code of a function created with `new_unlifted`. `region` and `init` must be the same as the ones the function
+    /// was disassembled with. Mnemonics that fail to lift keep their partial code. Does nothing if the function is already lifted.
+    pub fn lift<A: Architecture>(&mut self, region: &Region, init: A::Configuration) -> Result<()> {
+        if !self.unlifted {
+            return Ok(());
+        }
+
+        // a single match may span more than one mnemonic, only its first address can be decoded
+        let mut lifted = HashMap::<u64, Vec<(Cow<'static, str>, Vec<Statement>)>>::new();
+        let vertices = self.cflow_graph.vertices().collect::<Vec<_>>();
+
+        for vx in vertices {
+            if let Some(&mut ControlFlowTarget::Resolved(ref mut bb)) = self.cflow_graph.vertex_label_mut(vx) {
+                for mne in bb.mnemonics.iter_mut() {
+                    if !lifted.contains_key(&mne.area.start) {
+                        match region.decode_cache().decode::<A>(region, mne.area.start, &init) {
+                            Ok(m) => {
+                                for l in m.mnemonics.iter() {
+                                    lifted.entry(l.area.start).or_insert(Vec::new()).push((l.opcode.clone(), l.instructions.clone()));
+                                }
+                            }
+                            Err(e) => {
+                                error!("failed to lift {} at {:#x}: {}", mne.opcode, mne.area.start, e);
+                                lifted.insert(mne.area.start, Vec::new());
+                            }
+                        }
+                    }
+
+                    if let Some(&(_, ref stmts)) = lifted.get(&mne.area.start).and_then(|v| v.iter().find(|x| x.0 == mne.opcode)) {
+                        mne.instructions = stmts.clone();
+                    }
+                }
+            }
+        }
+
+        self.unlifted = false;
+        Ok(())
+    }
+
+    /// Returns false if the function was created with `new_unlifted` and `lift` wasn't called yet.
+    pub fn is_lifted(&self) -> bool {
+        !self.unlifted
+    }
+
     /// Returns the start address of the first basic block in this function
     pub fn start(&self) -> u64 {
         self.entry_point().area.start
@@ -294,9 +817,7 @@ impl Function {
 
     /// New function starting at `start`, with name `name`, inside memory region `region` and UUID `uuid`.
     pub fn with_uuid<A: Architecture>(start: u64, uuid: &Uuid, region: &Region, name: Option<String>, init: A::Configuration) -> Result<Function> {
-        let mut f = Function::new::<A>(start, region, name, init)?;
-        f.uuid = uuid.clone();
-        Ok(f)
+        Self::build::<A>(start, Some(uuid.clone()), region, name, init, true)
     }
 
     /// Returns the UUID of this function
@@ -304,6 +825,11 @@ impl Function {
         &self.uuid
     }
 
+    /// Name of the memory region the function is part of
+    pub fn region(&self) -> &str {
+        &self.region
+    }
+
     /// The size of this function, in bytes (only counts the number of instructions, not padding bytes, or gaps for non-contiguous functions)
     pub fn len(&self) -> usize {
         self.size
@@ -339,9 +865,23 @@ impl Function {
 
     /// Returns a mutable reference to this functions control flow graph; **WARNING** this can cause instability if the entry point is not correctly updated
     pub fn cfg_mut(&mut self) -> &mut ControlFlowGraph {
+        self.index = None;
+        self.analyses.clear();
         &mut self.cflow_graph
     }
 
+    /// Returns a mutable reference to the node `vx` of the control flow graph. Unlike `cfg_mut` this keeps the cached analyses, so
+    /// passes that only rewrite the contents of basic blocks don't force them to be computed again.
+    pub fn vertex_label_mut(&mut self, vx: ControlFlowRef) -> Option<&mut ControlFlowTarget> {
+        self.index = None;
+        self.cflow_graph.vertex_label_mut(vx)
+    }
+
+    /// Returns a mutable reference to the guard of the edge `e`. Keeps the cached analyses.
+    pub fn edge_label_mut(&mut self, e: ControlFlowEdge) -> Option<&mut Guard> {
+        self.cflow_graph.edge_label_mut(e)
+    }
+
     /// Returns a reference to the entry point vertex in the cfg
     pub fn entry_point_ref(&self) -> ControlFlowRef {
         self.entry_point
@@ -352,6 +892,7 @@ impl Function {
     /// **WARNING** Make sure the vertex descriptor actually is the entry point _and_ points to a _resolved_ basic block, otherwise subsequent operations on this function will be undefined.
     pub fn set_entry_point_ref(&mut self, vx: ControlFlowRef) {
         self.entry_point = vx;
+        self.analyses.clear();
     }
 
     /// Returns a reference to the BasicBlock entry point of this function.
@@ -364,6 +905,7 @@ impl Function {
 
     /// Returns a mutable reference to the BasicBlock entry point of this function.
     pub fn entry_point_mut(&mut self) -> &mut BasicBlock {
+        self.index = None;
         match self.cflow_graph.vertex_label_mut(self.entry_point).unwrap() {
             &mut ControlFlowTarget::Resolved(ref mut bb) => bb,
             _ => panic!("Function {} has an unresolved entry point - this is a bug!", self.name) // can't dump cfg here because borrowed mutable ;)
@@ -678,14 +1220,43 @@ impl Function {
         self.basic_blocks().find(|&bb| bb.area.start <= a && bb.area.end > a)
     }
 
+    /// Returns the structure of the graph of this function in compressed sparse row form.
+    /// Traversals of the copy don't hash, but it can't be modified. Its vertices are labeled with
+    /// the `ControlFlowRef`s of this function. Cached like `block_order`, which is computed from it.
+    pub fn frozen_cfg(&self) -> Arc<FrozenControlFlowGraph> {
+        self.analyses.frozen_cfg(&self.cflow_graph)
+    }
+
     /// Returns all nodes in the graph of this function in post order.
     pub fn postorder(&self) -> Vec<ControlFlowRef> {
-        TreeIterator::new(
-            self.entry_point,
-            TraversalOrder::Postorder,
-            &self.cflow_graph,
-        )
-                .collect()
+        self.block_order().postorder()
+    }
+
+    /// Returns the nodes reachable from the entry point numbered in reverse postorder, along with their successors and
+    /// predecessors. Computed once and cached until the graph changes, like all other analyses below.
+    pub fn block_order(&self) -> Arc<BlockOrder> {
+        self.analyses.block_order(self.entry_point, &self.cflow_graph)
+    }
+
+    /// Returns the immediate dominators of the nodes in `block_order`, indexed like `BlockOrder::blocks`. The entry point is its
+    /// own dominator.
+    pub fn immediate_dominators(&self) -> Arc<Vec<Option<usize>>> {
+        self.analyses.immediate_dominators(self.entry_point, &self.cflow_graph)
+    }
+
+    /// Returns the dominance frontiers of the nodes in `block_order`, indexed like `BlockOrder::blocks`.
+    pub fn dominance_frontiers(&self) -> Arc<Vec<Vec<usize>>> {
+        self.analyses.dominance_frontiers(self.entry_point, &self.cflow_graph)
+    }
+
+    /// Returns the weak topological order of the graph of this function.
+    pub fn weak_topo_order(&self) -> Arc<HierarchicalOrdering<ControlFlowRef>> {
+        self.analyses.weak_topo_order(self.entry_point, &self.cflow_graph)
+    }
+
+    /// Returns the loop nesting forest of the graph of this function.
+    pub fn loop_forest(&self) -> Arc<LoopForest> {
+        self.analyses.loop_forest(self.entry_point, &self.cflow_graph)
     }
 
     /// Return a boxed iterator over every statement in this function
@@ -747,10 +1318,9 @@ impl Function {
 #[cfg(test)]
 mod tests {
     use super::*;
-    use {Architecture, BasicBlock, Bound, Disassembler, Guard, Match, Mnemonic, OpaqueLayer, Region, Result, Rvalue, State};
+    use {Architecture, BasicBlock, Bound, Disassembler, Guard, Lvalue, Match, Mnemonic, Name, OpaqueLayer, Operation, Region, Result, Rvalue, State, Statement};
     use panopticon_graph_algos::{AdjacencyMatrixGraphTrait, EdgeListGraphTrait, VertexListGraphTrait};
     use panopticon_graph_algos::{GraphTrait, MutableGraphTrait};
-    use std::borrow::Cow;
     use std::sync::Arc;
 
     #[derive(Clone,Debug)]
@@ -791,6 +1361,35 @@ mod tests {
         }
     }
 
+    #[derive(Clone,Debug)]
+    enum TestArchLazy {}
+    impl Architecture for TestArchLazy {
+        type Token = u8;
+        type Configuration = Arc<Disassembler<TestArchLazy>>;
+
+        fn prepare(_: &Region, _: &Self::Configuration) -> Result<Vec<(&'static str, u64, &'static str)>> {
+            unimplemented!()
+        }
+
+        fn decode(reg: &Region, addr: u64, cfg: &Self::Configuration) -> Result<Match<Self>> {
+            if let Some(s) = cfg.next_match(&mut reg.iter().seek(addr), addr, cfg.clone()) {
+                Ok(s.into())
+            } else {
+                Err("No match".into())
+            }
+        }
+
+        fn decode_mnemonics(reg: &Region, addr: u64, cfg: &Self::Configuration) -> Result<Match<Self>> {
+            let mut m = Self::decode(reg, addr, cfg)?;
+
+            for mne in m.mnemonics.iter_mut() {
+                mne.instructions.retain(|s| if let Operation::Call(_) = s.op { true } else { false });
+            }
+
+            Ok(m)
+        }
+    }
+
     #[test]
     fn new() {
         let f = Function::undefined(100, None, &Region::undefined("ram".to_owned(), 100), Some("test".to_owned()));
@@ -887,7 +1486,7 @@ mod tests {
         let vx4 = cfg.add_vertex(
             ControlFlowTarget::Unresolved(
                 Rvalue::Variable {
-                    name: Cow::Borrowed("a"),
+                    name: Name::new("a"),
                     size: 8,
                     offset: 0,
                     subscript: None,
@@ -1159,6 +1758,14 @@ mod tests {
         assert_eq!(func.name, "func_0x0".to_string());
         assert_eq!(Some(func.entry_point_ref()), Some(vx));
         assert!(func.cflow_graph.edge(vx, vx).is_some());
+
+        let frozen = func.frozen_cfg();
+        let fvx = frozen.vertex(0).unwrap();
+
+        assert_eq!(frozen.num_vertices(), 1);
+        assert_eq!(frozen.num_edges(), 1);
+        assert_eq!(frozen.vertex_label(fvx), Some(&vx));
+        assert!(frozen.edge(fvx, fvx).is_some());
     }
 
     #[test]
@@ -1264,6 +1871,160 @@ mod tests {
         assert!(func.cflow_graph.edge(bb1_vx.unwrap(), bb1_vx.unwrap()).is_some());
     }
 
+    #[test]
+    fn cont_splits_block() {
+        let main = new_disassembler!(TestArchShort =>
+            [ 0 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test0","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                st.jump(Rvalue::new_u32(1),Guard::always()).unwrap();
+                true
+            },
+            [ 1 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test1","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                st.jump(Rvalue::new_u32(2),Guard::always()).unwrap();
+                true
+            },
+            [ 2 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test2","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                true
+            },
+            [ 3 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test3","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                st.jump(Rvalue::new_u32(1),Guard::always()).unwrap();
+                st.jump(Rvalue::new_u32(4),Guard::always()).unwrap();
+                true
+            },
+            [ 4 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test4","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                st.jump(Rvalue::new_u32(5),Guard::always()).unwrap();
+                true
+            }
+        );
+
+        let data = OpaqueLayer::wrap(vec![0, 1, 2, 3, 4]);
+        let reg = Region::new("".to_string(), data);
+        let mut func = Function::new::<TestArchShort>(0, &reg, None, main.clone()).unwrap();
+
+        assert_eq!(func.cflow_graph.num_vertices(), 1);
+        assert_eq!(func.len(), 3);
+
+        func.cont::<TestArchShort>(3, &reg, main.clone()).unwrap();
+
+        let blocks = func.cflow_graph
+            .vertices()
+            .filter_map(
+                |vx| match func.cflow_graph.vertex_label(vx) {
+                    Some(&ControlFlowTarget::Resolved(ref bb)) => Some((bb.area.start, (vx, bb.area.end))),
+                    _ => None,
+                }
+            )
+            .collect::<BTreeMap<_, _>>();
+
+        assert_eq!(blocks.iter().map(|(&s, &(_, e))| (s, e)).collect::<Vec<_>>(), vec![(0, 1), (1, 3), (3, 4), (4, 5)]);
+        assert_eq!(func.entry_point_ref(), blocks[&3].0);
+        assert_eq!(func.start(), 3);
+        assert_eq!(func.len(), 5);
+        assert_eq!(func.cflow_graph.num_vertices(), 5);
+        assert_eq!(func.cflow_graph.num_edges(), 4);
+        assert!(func.cflow_graph.edge(blocks[&0].0, blocks[&1].0).is_some());
+        assert!(func.cflow_graph.edge(blocks[&3].0, blocks[&1].0).is_some());
+        assert!(func.cflow_graph.edge(blocks[&3].0, blocks[&4].0).is_some());
+
+        // jumps that were tried once aren't decoded again
+        assert!(func.index.as_ref().unwrap().pending.is_empty());
+
+        // decoding the same code again changes nothing
+        func.cont::<TestArchShort>(3, &reg, main).unwrap();
+        assert_eq!(func.cflow_graph.num_vertices(), 5);
+        assert_eq!(func.cflow_graph.num_edges(), 4);
+        assert_eq!(func.len(), 5);
+    }
+
+    #[test]
+    fn analyses() {
+        let main = new_disassembler!(TestArchShort =>
+            [ 0 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test0","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                st.jump(Rvalue::new_u32(1),Guard::always()).unwrap();
+                true
+            },
+            [ 1 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test1","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                st.jump(Rvalue::new_u32(2),Guard::always()).unwrap();
+                st.jump(Rvalue::new_u32(3),Guard::always()).unwrap();
+                true
+            },
+            [ 2 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test2","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                st.jump(Rvalue::new_u32(1),Guard::always()).unwrap();
+                true
+            },
+            [ 3 ] = |st: &mut State<TestArchShort>| {
+                st.mnemonic(1,"test3","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                true
+            }
+        );
+
+        let data = OpaqueLayer::wrap(vec![0, 1, 2, 3]);
+        let reg = Region::new("".to_string(), data);
+        let mut func = Function::new::<TestArchShort>(0, &reg, None, main.clone()).unwrap();
+        let blocks = func.cflow_graph
+            .vertices()
+            .filter_map(
+                |vx| match func.cflow_graph.vertex_label(vx) {
+                    Some(&ControlFlowTarget::Resolved(ref bb)) => Some((bb.area.start, vx)),
+                    _ => None,
+                }
+            )
+            .collect::<HashMap<_, _>>();
+
+        assert_eq!(blocks.len(), 4);
+
+        let order = func.block_order();
+        let b = |a: u64| order.index[&blocks[&a]];
+
+        assert_eq!(order.blocks.len(), 4);
+        assert_eq!(order.blocks[0], blocks[&0]);
+        assert_eq!(func.postorder(), order.blocks.iter().rev().cloned().collect::<Vec<_>>());
+        assert_eq!(order.predecessors[b(1)].len(), 2);
+
+        let idom = func.immediate_dominators();
+
+        assert_eq!(idom[b(0)], Some(b(0)));
+        assert_eq!(idom[b(1)], Some(b(0)));
+        assert_eq!(idom[b(2)], Some(b(1)));
+        assert_eq!(idom[b(3)], Some(b(1)));
+
+        let df = func.dominance_frontiers();
+
+        assert!(df[b(0)].is_empty());
+        assert_eq!(df[b(1)], vec![b(1)]);
+        assert_eq!(df[b(2)], vec![b(1)]);
+        assert!(df[b(3)].is_empty());
+
+        let loops = func.loop_forest();
+
+        assert_eq!(loops.heads, vec![blocks[&1]]);
+        assert_eq!(loops.parents, vec![None]);
+        assert!(loops.is_head(blocks[&1]));
+        assert!(!loops.is_head(blocks[&2]));
+        assert_eq!(loops.depth(blocks[&0]), 0);
+        assert_eq!(loops.depth(blocks[&2]), 1);
+        assert_eq!(loops.depth(blocks[&3]), 0);
+
+        // rewriting basic blocks keeps the results, changing the graph drops them
+        func.vertex_label_mut(blocks[&2]);
+        assert!(Arc::ptr_eq(&order, &func.block_order()));
+        assert!(Arc::ptr_eq(&loops, &func.clone().loop_forest()));
+
+        func.cfg_mut();
+        assert!(func.analyses.is_empty());
+        assert_eq!(*func.block_order(), *order);
+
+        func.cont::<TestArchShort>(0, &reg, main).unwrap();
+        assert!(func.analyses.is_empty());
+    }
+
     #[test]
     fn wide_token() {
         let def = OpaqueLayer::wrap(vec![0x11, 0x22, 0x33, 0x44, 0x55, 0x44]);
@@ -1437,4 +2198,47 @@ mod tests {
         assert!(func.cflow_graph.edge(bb1_vx.unwrap(), bb2_vx.unwrap()).is_some());
         assert!(func.cflow_graph.edge(bb2_vx.unwrap(), bb01_vx.unwrap()).is_some());
     }
+
+    #[test]
+    fn lift() {
+        let main = new_disassembler!(TestArchLazy =>
+            [ 0 ] = |st: &mut State<TestArchLazy>| {
+                let next = st.address + 1;
+                st.mnemonic(1,"mov","",vec!(),&|_| {
+                    Ok(vec![Statement{ op: Operation::Move(Rvalue::new_u8(1)), assignee: Lvalue::Variable{ name: Name::new("a"), size: 8, subscript: None } }])
+                }).unwrap();
+                st.jump(Rvalue::new_u64(next),Guard::always()).unwrap();
+                true
+            },
+            [ 1 ] = |st: &mut State<TestArchLazy>| {
+                let next = st.address + 1;
+                st.mnemonic(1,"call","",vec!(),&|_| {
+                    Ok(vec![Statement{ op: Operation::Call(Rvalue::new_u64(0x10)), assignee: Lvalue::Undefined }])
+                }).unwrap();
+                st.jump(Rvalue::new_u64(next),Guard::always()).unwrap();
+                true
+            },
+            [ 2 ] = |st: &mut State<TestArchLazy>| {
+                st.mnemonic(1,"ret","",vec!(),&|_| { Ok(vec![]) }).unwrap();
+                true
+            }
+        );
+
+        let reg = Region::new("".to_string(), OpaqueLayer::wrap(vec![0, 1, 2]));
+        let mut func = Function::new_unlifted::<TestArchLazy>(0, None, &reg, None, main.clone()).unwrap();
+
+        assert!(!func.is_lifted());
+        assert_eq!(func.len(), 3);
+        assert_eq!(func.statements().count(), 1);
+        assert_eq!(func.collect_call_addresses(), vec![0x10]);
+
+        func.lift::<TestArchLazy>(&reg, main.clone()).unwrap();
+        assert!(func.is_lifted());
+        assert_eq!(func.statements().count(), 2);
+        assert_eq!(func.collect_call_addresses(), vec![0x10]);
+
+        let eager = Function::new::<TestArchLazy>(0, &reg, None, main).unwrap();
+        assert!(eager.is_lifted());
+        assert_eq!(eager.statements().cloned().collect::<Vec<_>>(), func.statements().cloned().collect::<Vec<_>>());
+    }
 }
@@ -107,10 +107,10 @@
 //! ```
 
 use Result;
+use intern::Name;
 use quickcheck::{Arbitrary, Gen};
 use serde::{Serialize,Deserialize};
 
-use std::borrow::Cow;
 use std::cmp;
 use std::convert::From;
 use std::fmt::{Display, Error, Formatter, Debug};
@@ -127,7 +127,7 @@ pub enum Rvalue {
     /// Variable reference
     Variable {
         /// Variable name. Names starting with "__" are reserved.
-        name: Cow<'static, str>,
+        name: Name,
         /// SSA subscript. This can be set to None in most cases.
         subscript: Option<usize>,
         /// First bit of the variable we want to read. Can be set to 0 in most cases.
@@ -236,7 +236,7 @@ impl FromStr for Rvalue {
                 Some(s) => {
                     Ok(
                         Rvalue::Variable {
-                            name: Cow::Owned(s.to_string()),
+                            name: Name::new(s),
                             subscript: None,
                             offset: 0,
                             size: 0,
@@ -278,7 +278,7 @@ pub enum Lvalue {
     /// Variable reference
     Variable {
         /// Variable name. Names starting with "__" are reserved.
-        name: Cow<'static, str>,
+        name: Name,
         /// SSA subscript. This can be set to None in most cases.
         subscript: Option<usize>,
         /// Size of the variable in bits.
@@ -470,14 +470,14 @@ pub enum Operation<V>
     /// Calls the function located at the address pointed to by the operand.
     Call(V),
     /// Initializes a global variable.
-    Initialize(Cow<'static,str>,usize),
+    Initialize(Name,usize),
     /// Copies only a range of bit from the operand.
     Select(usize, V, V),
 
     /// Reads a memory cell
-    Load(Cow<'static,str>,Endianess,usize,V),
+    Load(Name,Endianess,usize,V),
     /// Writes a memory cell pointed by 1st V w/ 2nd V, returns Undef
-    Store(Cow<'static,str>,Endianess,usize,V,V),
+    Store(Name,Endianess,usize,V,V),
 
     /// SSA Phi function
     Phi(Vec<V>),
@@ -1228,7 +1228,7 @@ impl Arbitrary for Rvalue {
             0 => Rvalue::Undefined,
             1 => {
                 Rvalue::Variable {
-                    name: Cow::Owned(g.gen_ascii_chars().take(2).collect()),
+                    name: Name::from(g.gen_ascii_chars().take(2).collect::<String>()),
                     size: g.gen_range(1, 513),
                     subscript: Some(g.gen_range(0, 5)),
                     offset: g.gen_range(0, 512),
@@ -1246,7 +1246,7 @@ impl Arbitrary for Lvalue {
             0 => Lvalue::Undefined,
             1 => {
                 Lvalue::Variable {
-                    name: Cow::Owned(g.gen_ascii_chars().take(2).collect()),
+                    name: Name::from(g.gen_ascii_chars().take(2).collect::<String>()),
                     size: g.gen_range(1, 513),
                     subscript: Some(g.gen_range(0, 5)),
                 }
@@ -1281,12 +1281,12 @@ impl Arbitrary for Operation<Rvalue> {
             17 => Operation::SignExtend(g.gen(), Rvalue::arbitrary(g)),
 
             18 => Operation::Move(Rvalue::arbitrary(g)),
-            19 => Operation::Initialize(g.gen_ascii_chars().take(1).collect(),g.gen()),
+            19 => Operation::Initialize(Name::from(g.gen_ascii_chars().take(1).collect::<String>()),g.gen()),
 
             20 => Operation::Select(g.gen(), Rvalue::arbitrary(g), Rvalue::arbitrary(g)),
 
-            21 => Operation::Load(g.gen_ascii_chars().take(1).collect(), Endianess::arbitrary(g), g.gen(), Rvalue::arbitrary(g)),
-            22 => Operation::Store(g.gen_ascii_chars().take(1).collect(), Endianess::arbitrary(g), g.gen(), Rvalue::arbitrary(g), Rvalue::arbitrary(g)),
+            21 => Operation::Load(Name::from(g.gen_ascii_chars().take(1).collect::<String>()), Endianess::arbitrary(g), g.gen(), Rvalue::arbitrary(g)),
+            22 => Operation::Store(Name::from(g.gen_ascii_chars().take(1).collect::<String>()), Endianess::arbitrary(g), g.gen(), Rvalue::arbitrary(g), Rvalue::arbitrary(g)),
 
             23 => {
                 let cnt = g.gen_range(1, 6);
@@ -1402,7 +1402,7 @@ macro_rules! rreil_lvalue {
         { ($a).clone().into() };
     ($a:ident : $a_w:tt) => {
         $crate::Lvalue::Variable{
-            name: ::std::borrow::Cow::Borrowed(stringify!($a)),
+            name: $crate::Name::new(stringify!($a)),
             subscript: None,
             size: rreil_imm!($a_w)
         }
@@ -1421,7 +1421,7 @@ macro_rules! rreil_rvalue {
     };
     ($a:ident : $a_w:tt / $a_o:tt) => {
         $crate::Rvalue::Variable{
-            name: ::std::borrow::Cow::Borrowed(stringify!($a)),
+            name: $crate::Name::new(stringify!($a)),
             subscript: None,
             offset: rreil_imm!($a_o),
             size: rreil_imm!($a_w)
@@ -1429,7 +1429,7 @@ macro_rules! rreil_rvalue {
     };
     ($a:ident : $a_w:tt) => {
         $crate::Rvalue::Variable{
-            name: ::std::borrow::Cow::Borrowed(stringify!($a)),
+            name: $crate::Name::new(stringify!($a)),
             subscript: None,
             offset: 0,
             size: rreil_imm!($a_w)
@@ -1446,7 +1446,6 @@ macro_rules! rreil_imm {
 mod tests {
     use super::*;
     use {Architecture, Match, Region, Result};
-    use std::borrow::Cow;
 
     #[derive(Clone)]
     enum TestArchShort {}
@@ -1465,9 +1464,9 @@ mod tests {
 
     #[test]
     fn rreil_macro() {
-        let t0 = Lvalue::Variable { name: Cow::Borrowed("t0"), subscript: None, size: 12 };
+        let t0 = Lvalue::Variable { name: Name::new("t0"), subscript: None, size: 12 };
         let eax = Rvalue::Variable {
-            name: Cow::Borrowed("eax"),
+            name: Name::new("eax"),
             subscript: None,
             offset: 0,
             size: 12,
@@ -1614,11 +1613,11 @@ mod tests {
             },
 
             Statement {
-                op: Operation::Load(Cow::Borrowed("ram"), Endianess::Little, 8, Rvalue::Undefined),
+                op: Operation::Load(Name::new("ram"), Endianess::Little, 8, Rvalue::Undefined),
                 assignee: Lvalue::Undefined,
             },
             Statement {
-                op: Operation::Store(Cow::Borrowed("ram"), Endianess::Little, 8, Rvalue::Undefined, Rvalue::Undefined),
+                op: Operation::Store(Name::new("ram"), Endianess::Little, 8, Rvalue::Undefined, Rvalue::Undefined),
                 assignee: Lvalue::Undefined,
             },
 
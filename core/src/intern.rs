@@ -0,0 +1,228 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Process wide tables of variable names, opcodes and mnemonic format strings.
+//!
+//! A binary uses a few hundred distinct register and temporary names and opcodes, but every
+//! RREIL statement mentions some of them. Variable and memory names are stored as `Name`s, a
+//! pointer sized handle to a single, interned instance. Opcodes are kept as `Cow::Borrowed` of
+//! an interned string and the parsed format strings of mnemonics are shared the same way.
+//!
+//! Interned strings are never freed. The tables only grow with the number of distinct names.
+
+use MnemonicFormatToken;
+use serde::{Deserialize, Deserializer, Serialize, Serializer};
+use std::borrow::{Borrow, Cow};
+use std::cmp::Ordering;
+use std::collections::HashMap;
+use std::fmt;
+use std::hash::{Hash, Hasher};
+use std::ops::Deref;
+use std::sync::{Arc, RwLock};
+
+lazy_static! {
+    static ref NAMES: RwLock<HashMap<&'static str, Name>> = RwLock::new(HashMap::new());
+    static ref FORMATS: RwLock<HashMap<Vec<MnemonicFormatToken>, Arc<Vec<MnemonicFormatToken>>>> = RwLock::new(HashMap::new());
+}
+
+/// Interned string, used for the names of RREIL variables and memory regions.
+///
+/// A `Name` is as large as a pointer. Equal strings always yield the same `Name`, so comparing
+/// two of them doesn't look at the strings. Hashing and ordering do, like for `str`.
+#[derive(Clone,Copy)]
+pub struct Name(&'static String);
+
+impl Name {
+    /// Returns the `Name` of `s`.
+    pub fn new(s: &str) -> Name {
+        if let Some(&ret) = NAMES.read().unwrap().get(s) {
+            return ret;
+        }
+
+        let mut names = NAMES.write().unwrap();
+
+        if let Some(&ret) = names.get(s) {
+            return ret;
+        }
+
+        let ret = Name(Box::leak(Box::new(s.to_string())));
+
+        names.insert(ret.as_str(), ret);
+        ret
+    }
+
+    /// The interned string.
+    pub fn as_str(&self) -> &'static str {
+        self.0.as_str()
+    }
+}
+
+impl Deref for Name {
+    type Target = str;
+
+    fn deref(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl AsRef<str> for Name {
+    fn as_ref(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl Borrow<str> for Name {
+    fn borrow(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl PartialEq for Name {
+    fn eq(&self, other: &Name) -> bool {
+        self.0 as *const String == other.0 as *const String
+    }
+}
+
+impl Eq for Name {}
+
+impl<'a> PartialEq<&'a str> for Name {
+    fn eq(&self, other: &&'a str) -> bool {
+        self.as_str() == *other
+    }
+}
+
+impl PartialEq<str> for Name {
+    fn eq(&self, other: &str) -> bool {
+        self.as_str() == other
+    }
+}
+
+impl PartialEq<String> for Name {
+    fn eq(&self, other: &String) -> bool {
+        self.as_str() == other.as_str()
+    }
+}
+
+impl Hash for Name {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.as_str().hash(state)
+    }
+}
+
+impl PartialOrd for Name {
+    fn partial_cmp(&self, other: &Name) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for Name {
+    fn cmp(&self, other: &Name) -> Ordering {
+        self.as_str().cmp(other.as_str())
+    }
+}
+
+impl fmt::Debug for Name {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        fmt::Debug::fmt(self.as_str(), f)
+    }
+}
+
+impl fmt::Display for Name {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
+
+impl<'a> From<&'a str> for Name {
+    fn from(s: &'a str) -> Name {
+        Name::new(s)
+    }
+}
+
+impl From<String> for Name {
+    fn from(s: String) -> Name {
+        Name::new(&s)
+    }
+}
+
+impl<'a> From<Cow<'a, str>> for Name {
+    fn from(s: Cow<'a, str>) -> Name {
+        Name::new(&s)
+    }
+}
+
+impl Serialize for Name {
+    fn serialize<S: Serializer>(&self, s: S) -> ::std::result::Result<S::Ok, S::Error> {
+        s.serialize_str(self.as_str())
+    }
+}
+
+impl<'de> Deserialize<'de> for Name {
+    fn deserialize<D: Deserializer<'de>>(d: D) -> ::std::result::Result<Name, D::Error> {
+        Ok(Name::new(&String::deserialize(d)?))
+    }
+}
+
+/// Returns the interned copy of `s`. Equal strings always return the same instance.
+pub fn intern(s: &str) -> &'static str {
+    Name::new(s).as_str()
+}
+
+/// Returns the shared copy of the format string `fmt`.
+pub fn intern_format(fmt: Vec<MnemonicFormatToken>) -> Arc<Vec<MnemonicFormatToken>> {
+    if let Some(ret) = FORMATS.read().unwrap().get(&fmt) {
+        return ret.clone();
+    }
+
+    FORMATS.write().unwrap().entry(fmt.clone()).or_insert_with(|| Arc::new(fmt)).clone()
+}
+
+/// Deserializes a string into its interned copy. Use with `#[serde(deserialize_with)]`.
+pub fn deserialize<'de, D: Deserializer<'de>>(d: D) -> ::std::result::Result<Cow<'static, str>, D::Error> {
+    let s = String::deserialize(d)?;
+    Ok(Cow::Borrowed(intern(&s)))
+}
+
+/// Deserializes a format string into its shared copy. Use with `#[serde(deserialize_with)]`.
+pub fn deserialize_format<'de, D: Deserializer<'de>>(d: D) -> ::std::result::Result<Arc<Vec<MnemonicFormatToken>>, D::Error> {
+    Ok(intern_format(Vec::<MnemonicFormatToken>::deserialize(d)?))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn shared() {
+        let a = intern(&"intern_test".to_string());
+        let b = intern("intern_test");
+        let c = Name::from("intern_test".to_string());
+
+        assert_eq!(a, "intern_test");
+        assert_eq!(a.as_ptr(), b.as_ptr());
+        assert_eq!(c.as_ptr(), a.as_ptr());
+        assert_eq!(c, Name::new("intern_test"));
+        assert!(c != Name::new("intern_test2"));
+        assert!(Name::new("a") < Name::new("b"));
+        assert_eq!(format!("{} {:?}", c, c), "intern_test \"intern_test\"");
+        assert_eq!(::std::mem::size_of::<Name>(), ::std::mem::size_of::<usize>());
+
+        let f = MnemonicFormatToken::parse("{u}, {c:ram}".chars()).unwrap();
+        assert!(Arc::ptr_eq(&intern_format(f.clone()), &intern_format(f)));
+    }
+}
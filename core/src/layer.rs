@@ -41,11 +41,15 @@
 
 
 use Result;
+use memmap::{Mmap, Protection};
+use serde::{Deserialize, Deserializer, Serialize, Serializer};
+use serde::de::Error as DeError;
+use serde::ser::SerializeStruct;
 use std::collections::HashMap;
-use std::fs::File;
-use std::io::Read;
+use std::fmt;
+use std::fs;
 use std::ops::Range;
-use std::path::Path;
+use std::path::{Path, PathBuf};
 use std::sync::Arc;
 
 /// A cell represents a single, possible undefined, byte.
@@ -58,6 +62,124 @@ pub enum OpaqueLayer {
     Undefined(u64),
     /// Layer consisting of fixed byte values.
     Defined(Arc<Vec<u8>>),
+    /// Layer backed by a memory mapped file.
+    Mapped(MappedFile),
+}
+
+/// Read-only window into a memory mapped file.
+///
+/// Clones and sub-windows share the mapping, so slicing a file into many layers does not copy
+/// any bytes. Serialized as path, window and content hash instead of the bytes themselves.
+#[derive(Clone)]
+pub struct MappedFile {
+    path: Arc<PathBuf>,
+    map: Arc<Mmap>,
+    offset: usize,
+    len: usize,
+}
+
+impl MappedFile {
+    /// Maps the whole file at `p`. Fails for empty files.
+    pub fn open(p: &Path) -> Result<MappedFile> {
+        let path = fs::canonicalize(p).unwrap_or(p.to_path_buf());
+        let map = Mmap::open_path(&path, Protection::Read)?;
+        let len = map.len();
+
+        Ok(MappedFile { path: Arc::new(path), map: Arc::new(map), offset: 0, len: len })
+    }
+
+    /// Returns the bytes inside the window.
+    pub fn as_slice(&self) -> &[u8] {
+        // The mapping is private and read-only. Files modified by other processes while mapped
+        // are not supported.
+        unsafe { &self.map.as_slice()[self.offset..self.offset + self.len] }
+    }
+
+    /// Returns a window over `r`, relative to the start of `self`, sharing the mapping. Panics
+    /// if `r` is out of bounds.
+    pub fn slice(&self, r: Range<usize>) -> MappedFile {
+        assert!(r.start <= r.end && r.end <= self.len);
+        MappedFile {
+            path: self.path.clone(),
+            map: self.map.clone(),
+            offset: self.offset + r.start,
+            len: r.end - r.start,
+        }
+    }
+
+    /// Size of the window in bytes.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Path of the mapped file.
+    pub fn path(&self) -> &Path {
+        &self.path
+    }
+
+    /// FNV-1a hash of the window's contents. Used to check that the file did not change between
+    /// saving and loading a session.
+    pub fn hash(&self) -> u64 {
+        content_hash(self.as_slice())
+    }
+}
+
+fn content_hash(data: &[u8]) -> u64 {
+    let mut h = 0xcbf29ce484222325u64;
+
+    for b in data {
+        h ^= *b as u64;
+        h = h.wrapping_mul(0x100000001b3);
+    }
+
+    h
+}
+
+impl fmt::Debug for MappedFile {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        write!(f, "MappedFile({:?}, {:#x}..{:#x})", self.path, self.offset, self.offset + self.len)
+    }
+}
+
+impl Serialize for MappedFile {
+    fn serialize<S: Serializer>(&self, serializer: S) -> ::std::result::Result<S::Ok, S::Error> {
+        let mut st = serializer.serialize_struct("MappedFile", 4)?;
+
+        st.serialize_field("path", &*self.path)?;
+        st.serialize_field("offset", &(self.offset as u64))?;
+        st.serialize_field("len", &(self.len as u64))?;
+        st.serialize_field("hash", &self.hash())?;
+        st.end()
+    }
+}
+
+#[derive(Deserialize)]
+#[serde(rename="MappedFile")]
+struct MappedFileRef {
+    path: PathBuf,
+    offset: u64,
+    len: u64,
+    hash: u64,
+}
+
+impl<'de> Deserialize<'de> for MappedFile {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> ::std::result::Result<MappedFile, D::Error> {
+        let r = MappedFileRef::deserialize(deserializer)?;
+        let file = MappedFile::open(&r.path).map_err(|e| D::Error::custom(format!("{}: {}", r.path.display(), e)))?;
+        let end = r.offset.checked_add(r.len);
+
+        if end.is_none() || end.unwrap() > file.len() as u64 {
+            return Err(D::Error::custom(format!("{} is smaller than expected", r.path.display())));
+        }
+
+        let ret = file.slice(r.offset as usize..(r.offset + r.len) as usize);
+
+        if ret.hash() != r.hash {
+            Err(D::Error::custom(format!("{} was modified", r.path.display())))
+        } else {
+            Ok(ret)
+        }
+    }
 }
 
 /// Iterator over a range of `Cell`s.
@@ -217,6 +339,16 @@ impl OpaqueLayer {
         match *self {
             OpaqueLayer::Undefined(ref len) => LayerIter::Undefined(*len),
             OpaqueLayer::Defined(ref v) => LayerIter::Defined(Some(v)),
+            OpaqueLayer::Mapped(ref m) => LayerIter::Defined(Some(m.as_slice())),
+        }
+    }
+
+    /// Contents of the `Layer` as bytes or `None` if all `Cell`s are undefined.
+    pub fn as_slice(&self) -> Option<&[u8]> {
+        match *self {
+            OpaqueLayer::Undefined(_) => None,
+            OpaqueLayer::Defined(ref v) => Some(v),
+            OpaqueLayer::Mapped(ref m) => Some(m.as_slice()),
         }
     }
 
@@ -225,16 +357,20 @@ impl OpaqueLayer {
         match *self {
             OpaqueLayer::Undefined(ref len) => *len,
             OpaqueLayer::Defined(ref v) => v.len() as u64,
+            OpaqueLayer::Mapped(ref m) => m.len() as u64,
         }
     }
 
     /// Create a new `Layer` that replaces overlapped `Cell`s with the contents of the file at
-    /// `path`. The `Layer` will have the size of the file.
+    /// `path`. The `Layer` will have the size of the file. The file is mapped into memory, not
+    /// read.
     pub fn open(p: &Path) -> Result<OpaqueLayer> {
-        let mut buf: Vec<u8> = Vec::new();
-        let mut fd = File::open(p)?;
-        fd.read_to_end(&mut buf)?;
-        Ok(Self::wrap(buf))
+        if fs::metadata(p)?.len() == 0 {
+            // empty files cannot be mapped
+            Ok(Self::wrap(vec![]))
+        } else {
+            MappedFile::open(p).map(OpaqueLayer::Mapped)
+        }
     }
 
     /// Create a new `Layer` that replaces overlapped `Cell`s with the contents of `data`.
@@ -408,6 +544,35 @@ mod tests {
         assert_eq!(s.collect::<Vec<Cell>>(), e);
     }
 
+    #[test]
+    fn mapped() {
+        use std::fs::File;
+        use std::io::Write;
+
+        let path = ::std::env::temp_dir().join("panopticon-mapped-layer-test");
+        File::create(&path).unwrap().write_all(&[1, 2, 3, 4, 5, 6, 7, 8]).unwrap();
+
+        let file = MappedFile::open(&path).unwrap();
+        let l1 = OpaqueLayer::Mapped(file.slice(2..6));
+
+        assert_eq!(l1.len(), 4);
+        assert_eq!(l1.iter().collect::<Vec<Cell>>(), vec![Some(3), Some(4), Some(5), Some(6)]);
+
+        let buf = ::serde_cbor::to_vec(&l1).unwrap();
+        assert!(buf.len() < 100 + path.to_string_lossy().len());
+
+        let l2: OpaqueLayer = ::serde_cbor::from_slice(&buf).unwrap();
+        assert_eq!(l2.iter().collect::<Vec<Cell>>(), l1.iter().collect::<Vec<Cell>>());
+
+        drop(file);
+        drop(l1);
+        drop(l2);
+        File::create(&path).unwrap().write_all(&[1, 2, 0, 4, 5, 6, 7, 8]).unwrap();
+        assert!(::serde_cbor::from_slice::<OpaqueLayer>(&buf).is_err());
+
+        ::std::fs::remove_file(&path).unwrap();
+    }
+
     #[test]
     fn random_access_iter() {
         let l1 = OpaqueLayer::undefined(0xffffffff);
@@ -88,6 +88,9 @@ extern crate quickcheck;
 extern crate serde;
 #[macro_use] extern crate serde_derive;
 extern crate serde_cbor;
+extern crate memmap;
+#[macro_use]
+extern crate lazy_static;
 
 #[cfg(test)]
 extern crate env_logger;
@@ -96,6 +99,9 @@ extern crate env_logger;
 pub mod disassembler;
 pub use disassembler::{Architecture, Disassembler, Match, State};
 
+pub mod intern;
+pub use intern::{Name, intern};
+
 #[macro_use]
 pub mod il;
 pub use il::{Guard, Lvalue, Operation, Rvalue, Statement, execute, Endianess};
@@ -106,10 +112,10 @@ pub mod basic_block;
 pub use basic_block::BasicBlock;
 
 pub mod function;
-pub use function::{ControlFlowEdge, ControlFlowGraph, ControlFlowRef, ControlFlowTarget, Function, FunctionKind};
+pub use function::{ControlFlowEdge, ControlFlowGraph, ControlFlowRef, ControlFlowTarget, FrozenControlFlowGraph, Function, FunctionKind};
 
 pub mod program;
-pub use program::{CallGraph, CallGraphRef, CallTarget, Program};
+pub use program::{CallGraph, CallGraphRef, CallTarget, FrozenCallGraph, Program};
 
 pub mod project;
 pub use project::Project;
@@ -118,7 +124,13 @@ pub mod region;
 pub use region::{Region, World};
 
 pub mod layer;
-pub use layer::{Layer, LayerIter, OpaqueLayer};
+pub use layer::{Layer, LayerIter, MappedFile, OpaqueLayer};
+
+pub mod analysis_cache;
+pub use analysis_cache::{AnalysisCache, BlockOrder, LoopForest};
+
+pub mod decode_cache;
+pub use decode_cache::{DecodeCache, Decoded};
 
 pub mod result;
 pub use result::{Error, Result};
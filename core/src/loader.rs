@@ -17,18 +17,49 @@
  */
 
 //! Loader for 32 and 64-bit ELF, PE, and Mach-o files.
+//!
+//! Fat Mach-o binaries and static archives are loaded as a single `Project` with one `Program`
+//! per architecture slice or archive member, see `load_all`.
 
 
-use {Bound, CallTarget, Layer, Program, Project, Region, Result, Rvalue};
+use {Bound, CallTarget, Layer, MappedFile, OpaqueLayer, Program, Project, Region, Result, Rvalue};
 use goblin::{self, Hint, archive, elf, mach, pe};
-use goblin::elf::program_header;
+use goblin::elf::{program_header, section_header};
 
-use panopticon_graph_algos::MutableGraphTrait;
+use std::collections::{HashMap, HashSet};
 use std::fs::File;
-use std::io::{Cursor, Read, Seek, SeekFrom};
+use std::io::Cursor;
+use std::ops::Range;
 use std::path::Path;
 use uuid::Uuid;
 
+/// Mach-o segment protection flag for executable memory.
+const VM_PROT_EXECUTE: u32 = 0x4;
+/// PE section characteristic for sections with executable code.
+const IMAGE_SCN_CNT_CODE: u32 = 0x20;
+/// PE section characteristic for sections that can be executed.
+const IMAGE_SCN_MEM_EXECUTE: u32 = 0x2000_0000;
+/// ELF section index of symbols with an absolute value.
+const SHN_ABS: usize = 0xfff1;
+/// ELF section index of undefined symbols.
+const SHN_UNDEF: usize = 0;
+/// AMD64 relocation: 64 bit absolute address.
+const R_X86_64_64: u32 = 1;
+/// AMD64 relocation: 32 bit PC-relative address.
+const R_X86_64_PC32: u32 = 2;
+/// AMD64 relocation: 32 bit PC-relative address of a procedure's PLT entry.
+const R_X86_64_PLT32: u32 = 4;
+/// AMD64 relocation: 32 bit zero extended absolute address.
+const R_X86_64_32: u32 = 10;
+/// AMD64 relocation: 32 bit sign extended absolute address.
+const R_X86_64_32S: u32 = 11;
+/// IA32 relocation: 32 bit absolute address.
+const R_386_32: u32 = 1;
+/// IA32 relocation: 32 bit PC-relative address.
+const R_386_PC32: u32 = 2;
+/// IA32 relocation: 32 bit PC-relative address of a procedure's PLT entry.
+const R_386_PLT32: u32 = 4;
+
 /// CPU the binary file is intended for.
 #[derive(Clone,Copy,Debug)]
 pub enum Machine {
@@ -40,9 +71,39 @@ pub enum Machine {
     Ia32,
 }
 
+/// Contents of the file being loaded.
+enum Image<'a> {
+    /// Memory mapped file. Segments share the mapping.
+    Mapped(&'a MappedFile),
+    /// Bytes in memory. Segments are copied.
+    Bytes(&'a [u8]),
+}
+
+impl<'a> Image<'a> {
+    fn bytes(&self) -> &[u8] {
+        match *self {
+            Image::Mapped(m) => m.as_slice(),
+            Image::Bytes(b) => b,
+        }
+    }
+
+    /// Layer with the contents of `r`. Panics if `r` is out of bounds.
+    fn layer(&self, r: Range<usize>) -> Layer {
+        match *self {
+            Image::Mapped(m) => Layer::Opaque(OpaqueLayer::Mapped(m.slice(r))),
+            Image::Bytes(b) => Layer::wrap(b[r].to_vec()),
+        }
+    }
+}
+
 /// Parses a non-fat Mach-o binary from `bytes` at `offset` and creates a `Project` from it. Returns the `Project` instance and
 /// the CPU its intended for.
 pub fn load_mach(bytes: &[u8], offset: usize, name: String) -> Result<(Project, Machine)> {
+    load_mach_image(&Image::Bytes(bytes), offset, name)
+}
+
+fn load_mach_image(image: &Image, offset: usize, name: String) -> Result<(Project, Machine)> {
+    let bytes = image.bytes();
     let binary = mach::MachO::parse(&bytes, offset)?;
     debug!("mach: {:#?}", &binary);
     let mut base = 0x0;
@@ -68,6 +129,8 @@ pub fn load_mach(bytes: &[u8], offset: usize, name: String) -> Result<(Project,
         }
     };
 
+    let mut executable = Vec::new();
+
     for segment in &*binary.segments {
         let offset = segment.fileoff as usize;
         let filesize = segment.filesize as usize;
@@ -81,7 +144,6 @@ pub fn load_mach(bytes: &[u8], offset: usize, name: String) -> Result<(Project,
                         .into()
             );
         }
-        let section = &bytes[offset..offset + filesize];
         let start = segment.vmaddr;
         let end = start + segment.vmsize;
         let name = segment.name()?;
@@ -91,7 +153,10 @@ pub fn load_mach(bytes: &[u8], offset: usize, name: String) -> Result<(Project,
             segment.vmsize,
             start
         );
-        reg.cover(Bound::new(start, end), Layer::wrap(Vec::from(section)));
+        reg.cover(Bound::new(start, end), image.layer(offset..offset + filesize));
+        if segment.initprot & VM_PROT_EXECUTE != 0 {
+            executable.push(Bound::new(start, start + segment.filesize));
+        }
         if name == "__TEXT" {
             base = segment.vmaddr;
             debug!("Setting vm address base to {:#x}", base);
@@ -107,17 +172,19 @@ pub fn load_mach(bytes: &[u8], offset: usize, name: String) -> Result<(Project,
     let mut prog = Program::new("prog0");
     let mut proj = Project::new(name.clone(), reg);
 
+    prog.executable = executable;
+
     let entry = binary.entry;
 
     if entry != 0 {
-        prog.call_graph.add_vertex(CallTarget::Todo(Rvalue::new_u64(entry as u64), Some(name), Uuid::new_v4()));
+        prog.add_target(CallTarget::Todo(Rvalue::new_u64(entry as u64), Some(name), Uuid::new_v4()));
     }
 
     for export in binary.exports()? {
         if export.offset != 0 {
             debug!("adding: {:?}", &export);
-            prog.call_graph
-                .add_vertex(
+            prog
+                .add_target(
                     CallTarget::Todo(
                         Rvalue::new_u64(export.offset as u64 + base),
                         Some(export.name),
@@ -135,17 +202,17 @@ pub fn load_mach(bytes: &[u8], offset: usize, name: String) -> Result<(Project,
     debug!("Imports: {:?}", &proj.imports);
     prog.imports = proj.imports.clone();
     proj.comments.insert(("base".to_string(), entry), "main".to_string());
-    proj.code.push(prog);
+    proj.add_program(prog);
 
     Ok((proj, machine))
 }
 
 /// Parses an ELF 32/64-bit binary from `bytes` and creates a `Project` from it. Returns the `Project` instance and
 /// the CPU its intended for.
-fn load_elf(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
-    use std::collections::HashSet;
+fn load_elf(image: &Image, name: String) -> Result<(Project, Machine)> {
+    use std::cmp::max;
 
-    let mut cursor = Cursor::new(&bytes);
+    let bytes = image.bytes();
     let binary = elf::Elf::parse(&bytes)?;
     debug!("elf: {:#?}", &binary);
 
@@ -166,9 +233,12 @@ fn load_elf(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
         machine => return Err(format!("Unsupported machine: {}", machine).into()),
     };
 
+    let mut executable = Vec::new();
+
     for ph in &binary.program_headers {
         if ph.p_type == program_header::PT_LOAD {
-            let mut buf = vec![0u8; ph.p_filesz as usize];
+            let offset = ph.p_offset as usize;
+            let filesize = ph.p_filesz as usize;
 
             debug!(
                 "Load ELF {} bytes segment to {:#x}",
@@ -176,18 +246,126 @@ fn load_elf(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
                 ph.p_vaddr
             );
 
-            if cursor.seek(SeekFrom::Start(ph.p_offset)).ok() == Some(ph.p_offset) {
-                cursor.read_exact(&mut buf)?;
+            if offset.checked_add(filesize).map(|end| end <= bytes.len()).unwrap_or(false) {
                 reg.cover(
                     Bound::new(ph.p_vaddr, ph.p_vaddr + ph.p_filesz),
-                    Layer::wrap(buf),
+                    image.layer(offset..offset + filesize),
                 );
+                if ph.p_flags & program_header::PF_X != 0 {
+                    executable.push(Bound::new(ph.p_vaddr, ph.p_vaddr + ph.p_filesz));
+                }
             } else {
                 return Err("Failed to read segment".into());
             }
         }
     }
 
+    // relocatable objects, e.g. members of static libraries, have no segments. Their allocated
+    // sections are laid out one after another starting at address 0 and their relocations are
+    // applied against this layout.
+    let relocatable = binary.header.e_type == elf::header::ET_REL;
+    let mut section_base = HashMap::<usize, u64>::new();
+    let mut externs = Vec::<(u64, String)>::new();
+
+    if relocatable {
+        // EI_CLASS and EI_DATA of the identification bytes
+        let is_64 = bytes.get(4) == Some(&2);
+        let little_endian = bytes.get(5) != Some(&2);
+        let mut layout = Vec::new();
+        let mut next = 0u64;
+
+        for (idx, sh) in binary.section_headers.iter().enumerate() {
+            if sh.sh_flags & section_header::SHF_ALLOC as u64 == 0 || sh.sh_size == 0 {
+                continue;
+            }
+
+            let align = max(sh.sh_addralign, 1);
+            let start = (next + align - 1) / align * align;
+            let end = start + sh.sh_size;
+
+            if sh.sh_flags & section_header::SHF_EXECINSTR as u64 != 0 {
+                executable.push(Bound::new(start, end));
+            }
+
+            section_base.insert(idx, start);
+            layout.push((idx, start, end));
+            next = end;
+        }
+
+        // symbols defined in other objects get a slot in an area behind the sections, so calls
+        // to them don't end up pointing into the caller.
+        let mut next_extern = (next + 7) / 8 * 8;
+        let symbols = binary
+            .syms
+            .iter()
+            .map(
+                |sym| if let Some(&base) = section_base.get(&sym.st_shndx) {
+                    base + sym.st_value
+                } else if sym.st_shndx == SHN_ABS {
+                    sym.st_value
+                } else if sym.st_shndx == SHN_UNDEF && sym.st_name != 0 {
+                    let addr = next_extern;
+
+                    next_extern += 8;
+                    externs.push((addr, binary.strtab[sym.st_name].to_string()));
+                    addr
+                } else {
+                    0
+                }
+            )
+            .collect::<Vec<_>>();
+
+        let mut relocations = HashMap::<usize, Vec<Relocation>>::new();
+
+        for sh in &binary.section_headers {
+            if sh.sh_type == section_header::SHT_RELA || sh.sh_type == section_header::SHT_REL {
+                let target = sh.sh_info as usize;
+
+                if section_base.contains_key(&target) {
+                    let relocs = read_relocations(bytes, sh, is_64, little_endian)?;
+                    relocations.entry(target).or_insert_with(Vec::new).extend(relocs);
+                }
+            }
+        }
+
+        for (idx, start, end) in layout {
+            let sh = &binary.section_headers[idx];
+
+            if sh.sh_type == section_header::SHT_NOBITS {
+                continue;
+            }
+
+            let offset = sh.sh_offset as usize;
+            let size = sh.sh_size as usize;
+
+            if !offset.checked_add(size).map(|end| end <= bytes.len()).unwrap_or(false) {
+                return Err("Failed to read section".into());
+            }
+
+            debug!("Load ELF {} bytes section to {:#x}", size, start);
+
+            // sections with relocations are copied and patched, all others stay mapped
+            let layer = match relocations.get(&idx) {
+                Some(relocs) => {
+                    let mut data = bytes[offset..offset + size].to_vec();
+
+                    for reloc in relocs {
+                        let sym = symbols.get(reloc.symbol).cloned().unwrap_or(0);
+
+                        if !reloc.apply(machine, &mut data, start, sym, little_endian) {
+                            debug!("Ignoring relocation {:?} in section {}", reloc, idx);
+                        }
+                    }
+
+                    Layer::wrap(data)
+                }
+                None => image.layer(offset..offset + size),
+            };
+
+            reg.cover(Bound::new(start, end), layer);
+        }
+    }
+
     let name = if let &Some(ref soname) = &binary.soname {
         soname.to_string()
     } else {
@@ -199,17 +377,28 @@ fn load_elf(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
     let mut prog = Program::new("prog0");
     let mut proj = Project::new(name.clone(), reg);
 
-    prog.call_graph.add_vertex(CallTarget::Todo(Rvalue::new_u64(entry as u64), Some(name), Uuid::new_v4()));
+    prog.executable = executable;
+    if !relocatable {
+        prog.add_target(CallTarget::Todo(Rvalue::new_u64(entry as u64), Some(name), Uuid::new_v4()));
+    }
+
+    for (addr, name) in externs {
+        debug!("External symbol {} @ {:#x}", name, addr);
+        proj.imports.insert(addr, name);
+    }
+
+    // symbol values of relocatable objects are relative to their section
+    let sym_address = |sym: &elf::Sym| sym.st_value + section_base.get(&sym.st_shndx).cloned().unwrap_or(0);
 
     let add_sym = |prog: &mut Program, sym: &elf::Sym, name: &str| {
         let name = name.to_string();
-        let addr = sym.st_value;
+        let addr = sym_address(sym);
         debug!("Symbol: {} @ 0x{:x}: {:?}", name, addr, sym);
         if sym.is_function() {
             if sym.is_import() {
-                prog.call_graph.add_vertex(CallTarget::Symbolic(name, Uuid::new_v4()));
+                prog.add_target(CallTarget::Symbolic(name, Uuid::new_v4()));
             } else {
-                prog.call_graph.add_vertex(CallTarget::Todo(Rvalue::new_u64(addr), Some(name), Uuid::new_v4()));
+                prog.add_target(CallTarget::Todo(Rvalue::new_u64(addr), Some(name), Uuid::new_v4()));
             }
         }
     };
@@ -234,7 +423,7 @@ fn load_elf(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
         let name = &binary.dynstrtab[sym.st_name];
 
         add_sym(&mut prog, sym, name);
-        seen_syms.insert(sym.st_value);
+        seen_syms.insert(sym_address(sym));
 
         let name = &binary.dynstrtab[sym.st_name];
         if !resolve_import_address(&mut proj, &binary.pltrelocs, name) {
@@ -250,24 +439,125 @@ fn load_elf(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
     // add strippable symbol information
     for sym in &binary.syms {
         let name = &binary.strtab[sym.st_name];
-        if !seen_syms.contains(&sym.st_value) {
+        if !seen_syms.contains(&sym_address(sym)) {
             add_sym(&mut prog, sym, &name);
         }
-        seen_syms.insert(sym.st_value);
+        seen_syms.insert(sym_address(sym));
     }
     prog.imports = proj.imports.clone();
-    proj.comments.insert(("base".to_string(), entry), "main".to_string());
-    proj.code.push(prog);
+    if !relocatable {
+        proj.comments.insert(("base".to_string(), entry), "main".to_string());
+    }
+    proj.add_program(prog);
 
     Ok((proj, machine))
 }
 
+/// Entry of an ELF relocation section.
+#[derive(Debug)]
+struct Relocation {
+    /// Offset of the patched bytes into their section.
+    offset: u64,
+    /// Index of the symbol in the symbol table.
+    symbol: usize,
+    kind: u32,
+    /// Explicit addend. `None` if it is stored in the patched bytes.
+    addend: Option<i64>,
+}
+
+impl Relocation {
+    /// Patches `data`, the contents of a section loaded at `base`, with the address `sym` of the
+    /// relocation's symbol. Returns false if the relocation is not supported. Only the absolute and
+    /// PC-relative relocations of AMD64 and IA32 are.
+    fn apply(&self, machine: Machine, data: &mut [u8], base: u64, sym: u64, little_endian: bool) -> bool {
+        let pc = base.wrapping_add(self.offset);
+        let (width, pc_relative) = match (machine, self.kind) {
+            (Machine::Amd64, R_X86_64_64) => (8, false),
+            (Machine::Amd64, R_X86_64_32) | (Machine::Amd64, R_X86_64_32S) => (4, false),
+            (Machine::Amd64, R_X86_64_PC32) | (Machine::Amd64, R_X86_64_PLT32) => (4, true),
+            (Machine::Ia32, R_386_32) => (4, false),
+            (Machine::Ia32, R_386_PC32) | (Machine::Ia32, R_386_PLT32) => (4, true),
+            _ => return false,
+        };
+        let start = self.offset as usize;
+        let site = match start.checked_add(width).and_then(|end| data.get_mut(start..end)) {
+            Some(site) => site,
+            None => return false,
+        };
+        let addend = match self.addend {
+            Some(a) => a as u64,
+            None => read_uint(site, little_endian) as i32 as i64 as u64,
+        };
+        let value = if pc_relative { sym.wrapping_add(addend).wrapping_sub(pc) } else { sym.wrapping_add(addend) };
+
+        for i in 0..width {
+            let byte = (value >> (8 * i)) as u8;
+
+            if little_endian {
+                site[i] = byte;
+            } else {
+                site[width - 1 - i] = byte;
+            }
+        }
+
+        true
+    }
+}
+
+/// Reads the entries of the SHT_REL or SHT_RELA section `sh` of the ELF file in `bytes`.
+fn read_relocations(bytes: &[u8], sh: &section_header::SectionHeader, is_64: bool, little_endian: bool) -> Result<Vec<Relocation>> {
+    let explicit = sh.sh_type == section_header::SHT_RELA;
+    let word = if is_64 { 8 } else { 4 };
+    let entsize = match sh.sh_entsize as usize {
+        0 => if explicit { 3 * word } else { 2 * word },
+        n => n,
+    };
+    let offset = sh.sh_offset as usize;
+    let data = match offset.checked_add(sh.sh_size as usize).and_then(|end| bytes.get(offset..end)) {
+        Some(data) => data,
+        None => return Err("Failed to read relocation section".into()),
+    };
+
+    if entsize < if explicit { 3 * word } else { 2 * word } {
+        return Err(format!("Invalid relocation entry size: {}", entsize).into());
+    }
+
+    Ok(
+        data.chunks(entsize)
+            .filter(|e| e.len() == entsize)
+            .map(
+                |e| {
+                    let info = read_uint(&e[word..2 * word], little_endian);
+                    let (symbol, kind) = if is_64 { (info >> 32, info & 0xffff_ffff) } else { (info >> 8, info & 0xff) };
+                    let addend = if explicit {
+                        let a = read_uint(&e[2 * word..3 * word], little_endian);
+                        Some(if is_64 { a as i64 } else { a as u32 as i32 as i64 })
+                    } else {
+                        None
+                    };
+
+                    Relocation { offset: read_uint(&e[0..word], little_endian), symbol: symbol as usize, kind: kind as u32, addend: addend }
+                }
+            )
+            .collect()
+    )
+}
+
+/// Reads an unsigned integer as wide as `bytes`.
+fn read_uint(bytes: &[u8], little_endian: bool) -> u64 {
+    let fold = |acc: u64, &b: &u8| (acc << 8) | b as u64;
+
+    if little_endian { bytes.iter().rev().fold(0, fold) } else { bytes.iter().fold(0, fold) }
+}
+
 /// Parses a PE32/PE32+ file from `bytes` and create a project from it.
-fn load_pe(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
+fn load_pe(image: &Image, name: String) -> Result<(Project, Machine)> {
+    let bytes = image.bytes();
     let pe = pe::PE::parse(&bytes)?;
     debug!("pe: {:#?}", &pe);
     let image_base = pe.image_base as u64;
     let mut ram = Region::undefined("RAM".to_string(), 0x100000000);
+    let mut executable = Vec::new();
     for section in &pe.sections {
         let name = String::from_utf8_lossy(&section.name);
         debug!("section: {}", name);
@@ -287,7 +577,7 @@ fn load_pe(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
                     (Layer::undefined(0), 0)
                 } else {
                     debug!("mapped '{}': {:?}", name, offset..offset + size);
-                    (Layer::wrap(bytes[offset..offset + size].to_vec()), size as u64)
+                    (image.layer(offset..offset + size), size as u64)
                 }
             } else {
                 debug!("bss '{}'", name);
@@ -298,6 +588,9 @@ fn load_pe(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
         let end = image_base + virtual_address + size as u64;
         let bound = Bound::new(begin, end);
         debug!("bound: {:?}", &bound);
+        if section.characteristics & (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE) != 0 && size > 0 {
+            executable.push(bound.clone());
+        }
         if !ram.cover(bound, layer) {
             debug!("bad cover");
             return Err(format!("Cannot cover bound: {:?}", Bound::new(begin, end)).into());
@@ -308,8 +601,10 @@ fn load_pe(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
     let mut prog = Program::new("prog0");
     let mut proj = Project::new(name.to_string(), ram);
 
-    prog.call_graph
-        .add_vertex(
+    prog.executable = executable;
+
+    prog
+        .add_target(
             CallTarget::Todo(
                 Rvalue::new_u64(entry),
                 Some(name.to_string()),
@@ -319,8 +614,8 @@ fn load_pe(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
 
     for export in pe.exports {
         debug!("adding export: {:?}", &export);
-        prog.call_graph
-            .add_vertex(
+        prog
+            .add_target(
                 CallTarget::Todo(
                     Rvalue::new_u64(export.rva as u64 + image_base),
                     Some(export.name.to_string()),
@@ -335,41 +630,170 @@ fn load_pe(bytes: &[u8], name: String) -> Result<(Project, Machine)> {
             &import,
             import.rva + pe.image_base
         );
-        prog.call_graph.add_vertex(CallTarget::Symbolic(import.name.into_owned(), Uuid::new_v4()));
+        prog.add_target(CallTarget::Symbolic(import.name.into_owned(), Uuid::new_v4()));
     }
 
     proj.comments.insert(("base".to_string(), entry), "main".to_string());
-    proj.code.push(prog);
+    proj.add_program(prog);
     Ok((proj, Machine::Ia32))
 }
 
-/// Load an ELF or PE file from disk and creates a `Project` from it. Returns the `Project` instance and
-/// the CPU its intended for.
+/// Load an ELF, PE or Mach-o file from disk and creates a `Project` from it. Returns the `Project` instance and
+/// the CPU its intended for. Fails for fat Mach-o binaries and archives holding more than one loadable program,
+/// use `load_all` for these.
 pub fn load(path: &Path) -> Result<(Project, Machine)> {
+    let (proj, machines) = load_all(path)?;
+
+    if machines.len() == 1 {
+        Ok((proj, machines[0]))
+    } else {
+        Err(format!("{} contains {} programs, load them with load_all()", path.display(), machines.len()).into())
+    }
+}
+
+/// Load an ELF, PE or Mach-o file, a fat Mach-o binary or a static archive from disk and creates a `Project`
+/// from it. The project has one `Program` for each architecture slice or archive member that could be loaded.
+/// Returns the `Project` instance and the CPU of each of its programs, in the order of `Project::code`.
+///
+/// All slices and members share the mapping of the file. Each one gets its own `Region`, named after the member,
+/// that its `Program` refers to. The first one is the root region of the project. Members whose name was already
+/// taken by an earlier one are suffixed with their position in the file, e.g. `libc.a(init.o)#12`.
+pub fn load_all(path: &Path) -> Result<(Project, Vec<Machine>)> {
     let name = path.file_name().map(|x| x.to_string_lossy().to_string()).unwrap_or("(encoding error)".to_string());
     let mut fd = File::open(path)?;
     let peek = goblin::peek(&mut fd)?;
     if let Hint::Unknown(magic) = peek {
         Err(format!("Tried to load an unknown file. Magic: {}", magic).into())
     } else {
-        let mut bytes = Vec::new();
-        fd.read_to_end(&mut bytes)?;
+        // map the file instead of reading it; segments become windows into the mapping
+        let file = MappedFile::open(path)?;
+        let mut members = vec![];
+        let mut names = HashSet::<String>::new();
+        let mut unique = |member: String, position: usize| if names.insert(member.clone()) {
+            member
+        } else {
+            format!("{}#{}", member, position)
+        };
+
         match peek {
-            Hint::Elf(_) => load_elf(&bytes, name),
-            Hint::PE => load_pe(&bytes, name),
-            Hint::Mach(_) => load_mach(&bytes, 0, name),
-            Hint::MachFat(_) => Err("Cannot directly load a fat mach-o binary (e.g., which one do I load?)".into()),
+            Hint::MachFat(_) => {
+                let multi = mach::MultiArch::new(file.as_slice())?;
+
+                for (position, arch) in multi.arches()?.into_iter().enumerate() {
+                    let member = unique(format!("{}:{}", name, mach::cputype::cpu_type_to_str(arch.cputype)), position);
+                    let slice = match member_slice(&file, arch.offset as u64, arch.size as u64) {
+                        Some(slice) => slice,
+                        None => return Err(format!("Slice {} lies outside of the file", member).into()),
+                    };
+
+                    match load_mach_image(&Image::Mapped(&slice), 0, member.clone()) {
+                        Ok((proj, machine)) => members.push((member, proj, machine)),
+                        Err(e) => info!("Skipping {}: {}", member, e),
+                    }
+                }
+            }
             Hint::Archive => {
-                let archive = archive::Archive::parse(&bytes)?;
-                debug!("archive: {:#?}", &archive);
-                Err("Tried to load an archive, unsupported format".into())
+                let archive = archive::Archive::parse(file.as_slice())?;
+
+                for (position, member_name) in archive.members().into_iter().enumerate() {
+                    let member = unique(format!("{}({})", name, member_name), position);
+                    let slice = match archive.get(member_name) {
+                        Some(m) => member_slice(&file, m.offset as u64, m.size() as u64),
+                        None => None,
+                    };
+                    let slice = match slice {
+                        Some(slice) => slice,
+                        None => return Err(format!("Member {} lies outside of the file", member).into()),
+                    };
+
+                    // archives carry symbol tables and string tables as members too
+                    match load_image(&Image::Mapped(&slice), member.clone()) {
+                        Ok((proj, machine)) => members.push((member, proj, machine)),
+                        Err(e) => debug!("Skipping {}: {}", member, e),
+                    }
+                }
             }
             _ => {
-                println!(
-                    "Loader branch hit wildcard, should be unreachable (a new variant must have been added but code was not updated)",
-                );
-                unreachable!()
+                let (proj, machine) = load_image(&Image::Mapped(&file), name)?;
+                return Ok((proj, vec![machine]));
             }
         }
+
+        merge(name, members)
+    }
+}
+
+/// Window of `size` bytes at `offset` into `file`. None if the window is out of bounds.
+fn member_slice(file: &MappedFile, offset: u64, size: u64) -> Option<MappedFile> {
+    match offset.checked_add(size) {
+        Some(end) if end <= file.len() as u64 => Some(file.slice(offset as usize..end as usize)),
+        _ => None,
+    }
+}
+
+/// Loads the single ELF, PE or Mach-o file in `image`.
+fn load_image(image: &Image, name: String) -> Result<(Project, Machine)> {
+    let peek = goblin::peek(&mut Cursor::new(image.bytes()))?;
+
+    match peek {
+        Hint::Elf(_) => load_elf(image, name),
+        Hint::PE => load_pe(image, name),
+        Hint::Mach(_) => load_mach_image(image, 0, name),
+        Hint::MachFat(_) => Err("Fat mach-o binaries cannot be nested".into()),
+        Hint::Archive => Err("Archives cannot be nested".into()),
+        Hint::Unknown(magic) => Err(format!("Unknown file. Magic: {}", magic).into()),
+        _ => Err("Unsupported file format".into()),
+    }
+}
+
+/// Combines the projects of all `members` into one called `name`. The region of each member is renamed to
+/// the member name and the first one becomes the root region.
+fn merge(name: String, members: Vec<(String, Project, Machine)>) -> Result<(Project, Vec<Machine>)> {
+    let mut ret: Option<Project> = None;
+    let mut machines = Vec::with_capacity(members.len());
+
+    for (member, mut proj, machine) in members {
+        let mut reg = proj.region().clone();
+        let mut code = proj.code.split_off(0);
+        let old_name = reg.name().clone();
+
+        reg.set_name(member.clone());
+        for prog in code.iter_mut() {
+            prog.name = member.clone();
+            prog.region = Some(member.clone());
+        }
+
+        // loaders key comments by "base" or by the name of the region
+        let comments = proj.comments.drain().map(
+            |((r, a), c)| if r == "base" || r == old_name {
+                ((member.clone(), a), c)
+            } else {
+                ((r, a), c)
+            }
+        );
+
+        match ret {
+            Some(ref mut ret) => {
+                ret.data.add(reg);
+                ret.comments.extend(comments);
+                ret.imports.extend(proj.imports.drain());
+            }
+            None => {
+                let mut first = Project::new(name.clone(), reg);
+                first.comments.extend(comments);
+                first.imports.extend(proj.imports.drain());
+                ret = Some(first);
+            }
+        }
+
+        for prog in code {
+            ret.as_mut().unwrap().add_program(prog);
+        }
+        machines.push(machine);
+    }
+
+    match ret {
+        Some(proj) => Ok((proj, machines)),
+        None => Err(format!("{} contains no loadable programs", name).into()),
     }
 }
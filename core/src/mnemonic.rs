@@ -22,7 +22,7 @@
 //! descibing the mnemonic semantics.
 //!
 //! Mnemonics are CPU specific and Panopticon models them as simple as possible. Opcode are only
-//! strings and the operands only a list of RREIL values. In order to display the mnemonics
+//! (interned) strings and the operands only a list of RREIL values. In order to display the mnemonics
 //! correctly on the front-end mnemonics come with a format string. These tell Panopticon whenever
 //! a operand is a pointer or a value. They look like this: `{c:ram}, {u}`.
 //!
@@ -34,8 +34,11 @@ use Result;
 
 use Rvalue;
 use Statement;
+use intern::{self, intern, intern_format};
+use std::borrow::Cow;
 use std::ops::Range;
 use std::str::Chars;
+use std::sync::Arc;
 
 /// A non-empty address range [start,end).
 #[derive(Debug,Clone,PartialEq,Eq,Serialize,Deserialize)]
@@ -59,7 +62,7 @@ impl Bound {
 }
 
 /// Internal to `Mnemonic`
-#[derive(Clone,Debug,PartialEq,Eq,Serialize,Deserialize)]
+#[derive(Clone,Debug,PartialEq,Eq,Hash,Serialize,Deserialize)]
 pub enum MnemonicFormatToken {
     /// Internal to `Mnemonic`
     Literal(char),
@@ -141,18 +144,20 @@ impl MnemonicFormatToken {
 pub struct Mnemonic {
     /// Range of bytes the mnemonic occupies
     pub area: Bound,
-    /// Opcode part
-    pub opcode: String,
+    /// Opcode part, interned
+    #[serde(deserialize_with = "intern::deserialize")]
+    pub opcode: Cow<'static, str>,
     /// Operands
     pub operands: Vec<Rvalue>,
     /// RREIL code implementing the mnemonic
     pub instructions: Vec<Statement>,
-    /// Describes how the operands need to be printed
-    pub format_string: Vec<MnemonicFormatToken>,
+    /// Describes how the operands need to be printed. Shared by all mnemonics with the same format.
+    #[serde(deserialize_with = "intern::deserialize_format")]
+    pub format_string: Arc<Vec<MnemonicFormatToken>>,
 }
 
 impl Mnemonic {
-    /// Create a new mnemonic `code`.
+    /// Create a new mnemonic `code`. The opcode is interned.
     pub fn new<'a, I1, I2>(a: Range<u64>, code: String, fmt: String, ops: I1, instr: I2) -> Result<Mnemonic>
     where
         I1: Iterator<Item = &'a Rvalue>,
@@ -161,10 +166,10 @@ impl Mnemonic {
         Ok(
             Mnemonic {
                 area: Bound::new(a.start, a.end),
-                opcode: code,
+                opcode: Cow::Borrowed(intern(&code)),
                 operands: ops.cloned().collect(),
                 instructions: instr.cloned().collect(),
-                format_string: MnemonicFormatToken::parse(fmt.chars())?,
+                format_string: intern_format(MnemonicFormatToken::parse(fmt.chars())?),
             }
         )
     }
@@ -179,10 +184,10 @@ impl Mnemonic {
     pub fn dummy(a: Range<u64>) -> Mnemonic {
         Mnemonic {
             area: Bound::new(a.start, a.end),
-            opcode: "dummy".to_string(),
+            opcode: Cow::Borrowed("dummy"),
             operands: vec![],
             instructions: vec![],
-            format_string: vec![],
+            format_string: Arc::new(vec![]),
         }
     }
 }
@@ -190,8 +195,7 @@ impl Mnemonic {
 #[cfg(test)]
 mod tests {
     use super::*;
-    use {Lvalue, Operation, Rvalue, Statement};
-    use std::borrow::Cow;
+    use {Lvalue, Name, Operation, Rvalue, Statement};
 
     #[test]
     fn parse_format_string() {
@@ -250,7 +254,7 @@ mod tests {
         let ops1 = vec![
             Rvalue::new_u8(1),
             Rvalue::Variable {
-                name: Cow::Borrowed("a"),
+                name: Name::new("a"),
                 size: 3,
                 offset: 0,
                 subscript: None,
@@ -259,30 +263,30 @@ mod tests {
         let i1 = vec![
             Statement {
                 op: Operation::Add(Rvalue::new_u8(1), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(2) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(2) },
             },
             Statement {
                 op: Operation::Add(Rvalue::new_u8(4), Rvalue::new_u8(2)),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(1) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(1) },
             },
             Statement {
                 op: Operation::Phi(
                     vec![
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             size: 8,
                             offset: 0,
                             subscript: Some(2),
                         },
                         Rvalue::Variable {
-                            name: Cow::Borrowed("a"),
+                            name: Name::new("a"),
                             size: 8,
                             offset: 0,
                             subscript: Some(1),
                         },
                     ]
                 ),
-                assignee: Lvalue::Variable { name: Cow::Borrowed("a"), size: 8, subscript: Some(3) },
+                assignee: Lvalue::Variable { name: Name::new("a"), size: 8, subscript: Some(3) },
             },
         ];
         let mne1 = Mnemonic::new(
@@ -300,4 +304,27 @@ mod tests {
         assert_eq!(mne1.operands, ops1);
         assert_eq!(mne1.instructions, i1);
     }
+
+    #[test]
+    fn interned() {
+        use serde_cbor;
+
+        let ops = vec![Rvalue::Variable { name: Name::from("interned_a".to_string()), size: 8, offset: 0, subscript: None }];
+        let mne1 = Mnemonic::new(0..1, "interned_op".to_string(), "{u}".to_string(), ops.iter(), vec![].iter()).unwrap();
+        let mne2 = Mnemonic::new(1..2, "interned_op".to_string(), "{u}".to_string(), ops.iter(), vec![].iter()).unwrap();
+        let mne3 = serde_cbor::from_slice::<Mnemonic>(&serde_cbor::to_vec(&mne1).unwrap()).unwrap();
+
+        assert_eq!(mne1, mne3);
+        assert!(Arc::ptr_eq(&mne1.format_string, &mne2.format_string));
+        assert!(Arc::ptr_eq(&mne1.format_string, &mne3.format_string));
+
+        for mne in vec![mne1, mne2, mne3] {
+            assert_eq!(mne.opcode.as_ptr(), intern("interned_op").as_ptr());
+
+            match mne.operands[0] {
+                Rvalue::Variable { name, .. } => assert_eq!(name.as_ptr(), intern("interned_a").as_ptr()),
+                _ => unreachable!(),
+            }
+        }
+    }
 }
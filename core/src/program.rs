@@ -29,9 +29,12 @@
 //! error node.
 
 
-use {Function, Statement, Operation, Rvalue};
-use panopticon_graph_algos::{AdjacencyList, AdjacencyMatrixGraphTrait, GraphTrait, MutableGraphTrait, VertexListGraphTrait};
+use {Bound, ControlFlowTarget, Function, FunctionKind, Statement, Operation, Rvalue};
+use panopticon_graph_algos::{AdjacencyList, BidirectionalGraphTrait, CompressedGraph, GraphTrait, IncidenceGraphTrait, MutableGraphTrait, VertexListGraphTrait};
 use panopticon_graph_algos::adjacency_list::{AdjacencyListVertexDescriptor, VertexLabelIterator, VertexLabelMutIterator};
+use serde::{Deserialize, Deserializer};
+use std::collections::{HashMap, HashSet};
+use std::sync::{Mutex, MutexGuard};
 use uuid::Uuid;
 
 /// An iterator over every Function in this Program
@@ -114,18 +117,176 @@ impl CallTarget {
 pub type CallGraph = AdjacencyList<CallTarget, ()>;
 /// Stable reference to a call graph node
 pub type CallGraphRef = AdjacencyListVertexDescriptor;
+/// Read-only copy of the structure of a `CallGraph`, see `Program::frozen_call_graph`. Vertices
+/// are labeled with the node they correspond to in the call graph.
+pub type FrozenCallGraph = CompressedGraph<CallGraphRef, ()>;
 
 /// A collection of functions calling each other.
-#[derive(Serialize,Deserialize,Debug)]
+///
+/// Besides the call graph a program keeps lookup tables mapping UUIDs and entry points to call
+/// graph nodes. The graph can only be changed through `Program`'s methods. `insert`, `add_target`,
+/// `update_target` and `update_plt` keep the tables up to date. Functions handed out by
+/// `find_function_mut` and `find_function_by_uuid_mut` are dropped from the tables and re-added by
+/// the next lookup. `functions_mut` may touch every function and causes a full rebuild instead.
+#[derive(Serialize,Debug)]
 pub struct Program {
     /// Unique, immutable identifier
     pub uuid: Uuid,
     /// Human-readable name
     pub name: String,
     /// Graph of functions
-    pub call_graph: CallGraph,
+    call_graph: CallGraph,
     /// Symbolic References (Imports)
-    pub imports: ::std::collections::HashMap<u64, String>,
+    pub imports: HashMap<u64, String>,
+    /// Address ranges of the executable segments/sections, as far as the file format tells
+    pub executable: Vec<Bound>,
+    /// Name of the `Region` the program's code lives in. `None` for the root region of the
+    /// `Project`.
+    pub region: Option<String>,
+    #[serde(skip_serializing)]
+    index: Mutex<Index>,
+}
+
+/// Lookup tables over the call graph. Never serialized, rebuilt from the graph instead.
+#[derive(Debug,Default)]
+struct Index {
+    /// Number of call graph vertices when the index was last updated.
+    vertices: usize,
+    /// Set when call targets may have been changed without updating the index.
+    stale: bool,
+    /// Functions handed out mutably. Their entries were removed and are re-added by `refresh`.
+    dirty: Vec<CallGraphRef>,
+    /// Every call graph node by UUID.
+    by_uuid: HashMap<Uuid, CallGraphRef>,
+    /// Functions and todos with a constant address by entry point. Functions take precedence.
+    by_entry: HashMap<u64, CallGraphRef>,
+    /// Todos with a non-constant address.
+    indirect: HashMap<Rvalue, CallGraphRef>,
+    /// PLT stubs by the address of their PLT table entry.
+    stubs: HashMap<u64, Vec<CallGraphRef>>,
+}
+
+impl Index {
+    fn build(graph: &CallGraph) -> Index {
+        let mut index = Index::default();
+
+        for vx in graph.vertices() {
+            index.add(vx, graph.vertex_label(vx).unwrap());
+        }
+
+        index.vertices = graph.num_vertices();
+        index
+    }
+
+    /// Brings the tables up to date with `graph`. Only the dirty vertices are re-added unless
+    /// call targets were changed behind our back.
+    fn refresh(&mut self, graph: &CallGraph) {
+        if self.stale || self.vertices != graph.num_vertices() {
+            *self = Index::build(graph);
+        } else {
+            for vx in ::std::mem::replace(&mut self.dirty, Vec::new()) {
+                if let Some(ct) = graph.vertex_label(vx) {
+                    self.add(vx, ct);
+                }
+            }
+        }
+    }
+
+    fn add(&mut self, vx: CallGraphRef, ct: &CallTarget) {
+        self.by_uuid.insert(ct.uuid().clone(), vx);
+
+        match ct {
+            &CallTarget::Concrete(ref function) => {
+                if let Some(entry) = entry_of(function) {
+                    self.by_entry.insert(entry, vx);
+                }
+                if let &FunctionKind::Stub { plt_address, .. } = function.kind() {
+                    self.stubs.entry(plt_address).or_insert_with(Vec::new).push(vx);
+                }
+            }
+            &CallTarget::Todo(Rvalue::Constant { value, .. }, _, _) => {
+                self.by_entry.entry(value).or_insert(vx);
+            }
+            &CallTarget::Todo(ref rv, _, _) => {
+                self.indirect.entry(rv.clone()).or_insert(vx);
+            }
+            &CallTarget::Symbolic(_, _) => {}
+        }
+    }
+
+    fn remove(&mut self, vx: CallGraphRef, ct: &CallTarget) {
+        if self.by_uuid.get(ct.uuid()) == Some(&vx) {
+            self.by_uuid.remove(ct.uuid());
+        }
+
+        match ct {
+            &CallTarget::Concrete(ref function) => self.remove_function(vx, function),
+            &CallTarget::Todo(Rvalue::Constant { value, .. }, _, _) => {
+                if self.by_entry.get(&value) == Some(&vx) {
+                    self.by_entry.remove(&value);
+                }
+            }
+            &CallTarget::Todo(ref rv, _, _) => {
+                if self.indirect.get(rv) == Some(&vx) {
+                    self.indirect.remove(rv);
+                }
+            }
+            &CallTarget::Symbolic(_, _) => {}
+        }
+    }
+
+    /// Removes the entry point and PLT entries of `function`, leaving `by_uuid` alone.
+    fn remove_function(&mut self, vx: CallGraphRef, function: &Function) {
+        if let Some(entry) = entry_of(function) {
+            if self.by_entry.get(&entry) == Some(&vx) {
+                self.by_entry.remove(&entry);
+            }
+        }
+        if let &FunctionKind::Stub { plt_address, .. } = function.kind() {
+            if let Some(stubs) = self.stubs.get_mut(&plt_address) {
+                stubs.retain(|&x| x != vx);
+            }
+        }
+    }
+}
+
+/// Entry point of `function` or `None` if it wasn't disassembled yet.
+fn entry_of(function: &Function) -> Option<u64> {
+    match function.cfg().vertex_label(function.entry_point_ref()) {
+        Some(&ControlFlowTarget::Resolved(ref bb)) => Some(bb.area.start),
+        _ => None,
+    }
+}
+
+impl<'de> Deserialize<'de> for Program {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> ::std::result::Result<Program, D::Error> {
+        #[derive(Deserialize)]
+        #[serde(rename = "Program")]
+        struct Fields {
+            uuid: Uuid,
+            name: String,
+            call_graph: CallGraph,
+            imports: HashMap<u64, String>,
+            #[serde(default)]
+            executable: Vec<Bound>,
+            #[serde(default)]
+            region: Option<String>,
+        }
+
+        let fields = Fields::deserialize(deserializer)?;
+        let mut prog = Program {
+            uuid: fields.uuid,
+            name: fields.name,
+            call_graph: fields.call_graph,
+            imports: fields.imports,
+            executable: fields.executable,
+            region: fields.region,
+            index: Mutex::new(Index::default()),
+        };
+
+        prog.reindex();
+        Ok(prog)
+    }
 }
 
 impl<'a> IntoIterator for &'a Program {
@@ -143,10 +304,18 @@ impl Program {
             uuid: Uuid::new_v4(),
             name: n.to_string(),
             call_graph: CallGraph::new(),
-            imports: ::std::collections::HashMap::new(),
+            imports: HashMap::new(),
+            executable: Vec::new(),
+            region: None,
+            index: Mutex::new(Index::default()),
         }
     }
 
+    /// Graph of functions. Use `add_target`, `insert` or `update_target` to modify it.
+    pub fn call_graph(&self) -> &CallGraph {
+        &self.call_graph
+    }
+
     /// Returns a function if it matches the condition in the `filter` closure.
     pub fn find_function_by<'a, F: (Fn(&Function) -> bool)>(&'a self, filter: F) -> Option<&'a Function> {
         for ct in self.call_graph.vertex_labels() {
@@ -160,101 +329,160 @@ impl Program {
 
     /// Returns a mutable reference to the first function that matches the condition in the `filter` closure.
     pub fn find_function_mut<'a, F: (Fn(&Function) -> bool)>(&'a mut self, filter: F) -> Option<&'a mut Function> {
-        for ct in self.call_graph.vertex_labels_mut() {
-            match ct {
-                &mut CallTarget::Concrete(ref mut function) => if filter(function) { return Some(function) },
-                _ => (),
+        let maybe_vx = self.call_graph.vertices().find(
+            |&vx| match self.call_graph.vertex_label(vx) {
+                Some(&CallTarget::Concrete(ref function)) => filter(function),
+                _ => false,
             }
+        );
+
+        match maybe_vx {
+            Some(vx) => self.function_mut(vx),
+            None => None,
         }
-        None
     }
 
     /// Returns a reference to the function with an entry point starting at `start`.
     pub fn find_function_by_entry(&self, start: u64) -> Option<CallGraphRef> {
-        self.call_graph
-            .vertices()
-            .find(
-                |&x| match self.call_graph.vertex_label(x) {
-                    Some(&CallTarget::Concrete(ref s)) => {
-                        s.start() == start
-                    }
-                    _ => false,
-                }
-            )
+        let is_match = |vx: CallGraphRef| match self.call_graph.vertex_label(vx) {
+            Some(&CallTarget::Concrete(ref f)) => entry_of(f) == Some(start),
+            _ => false,
+        };
+
+        self.index().by_entry.get(&start).cloned().and_then(|vx| if is_match(vx) { Some(vx) } else { None })
+    }
+
+    /// Returns the function or todo item with entry point `start`. Functions are preferred over
+    /// todo items at the same address.
+    pub fn find_call_target_by_entry(&self, start: u64) -> Option<CallGraphRef> {
+        let is_match = |vx: CallGraphRef| match self.call_graph.vertex_label(vx) {
+            Some(&CallTarget::Concrete(ref f)) => entry_of(f) == Some(start),
+            Some(&CallTarget::Todo(Rvalue::Constant { value, .. }, _, _)) => value == start,
+            _ => false,
+        };
+
+        self.index().by_entry.get(&start).cloned().and_then(|vx| if is_match(vx) { Some(vx) } else { None })
     }
 
     /// Returns the function with UUID `a`.
     pub fn find_function_by_uuid<'a>(&'a self, a: &Uuid) -> Option<&'a Function> {
-        for ct in self.call_graph.vertex_labels() {
-            match ct {
-                &CallTarget::Concrete(ref s) => if s.uuid() == a { return Some(s) },
-                _ => (),
-            }
+        match self.find_call_target_by_uuid(a).and_then(|vx| self.call_graph.vertex_label(vx)) {
+            Some(&CallTarget::Concrete(ref f)) => Some(f),
+            _ => None,
         }
-        None
     }
 
     /// Returns the function with UUID `a`.
     pub fn find_function_by_uuid_mut<'a>(&'a mut self, a: &Uuid) -> Option<&'a mut Function> {
-        for ct in self.call_graph.vertex_labels_mut() {
-            match ct {
-                &mut CallTarget::Concrete(ref mut s) => if s.uuid() == a { return Some(s) },
-                _ => (),
+        match self.find_call_target_by_uuid(a) {
+            Some(vx) => self.function_mut(vx),
+            None => None,
+        }
+    }
+
+    /// Returns the function at `vx` after dropping it from the lookup tables. The next lookup
+    /// re-adds it with its then current entry point.
+    fn function_mut<'a>(&'a mut self, vx: CallGraphRef) -> Option<&'a mut Function> {
+        match self.call_graph.vertex_label_mut(vx) {
+            Some(&mut CallTarget::Concrete(ref mut f)) => {
+                let index = self.index.get_mut().unwrap();
+
+                // by_uuid stays valid, the UUID of a function never changes.
+                if !index.stale && !index.dirty.contains(&vx) {
+                    index.remove_function(vx, f);
+                    index.dirty.push(vx);
+                }
+                Some(f)
             }
+            _ => None,
         }
-        None
+    }
+
+    /// Adds `ct` to the call graph without connecting it to any other node.
+    pub fn add_target(&mut self, ct: CallTarget) -> CallGraphRef {
+        self.sync();
+
+        let vx = self.call_graph.add_vertex(ct);
+        let index = self.index.get_mut().unwrap();
+
+        index.add(vx, self.call_graph.vertex_label(vx).unwrap());
+        index.vertices += 1;
+        vx
+    }
+
+    /// Calls `f` with the call target `vx` and updates the lookup tables afterwards. Returns `None`
+    /// if `vx` is not part of the call graph.
+    pub fn update_target<R, F: FnOnce(&mut CallTarget) -> R>(&mut self, vx: CallGraphRef, f: F) -> Option<R> {
+        self.sync();
+
+        let index = self.index.get_mut().unwrap();
+        let ret = match self.call_graph.vertex_label_mut(vx) {
+            Some(ct) => {
+                index.remove(vx, ct);
+                f(ct)
+            }
+            None => return None,
+        };
+
+        index.add(vx, self.call_graph.vertex_label(vx).unwrap());
+        Some(ret)
     }
 
     /// Puts `function` into the call graph, returning the UUIDs of all _new_ `Todo`s
-    /// that are called by `function`
+    /// that are called by `function`.
+    ///
+    /// The function replaces the node with the same UUID. If there is none it takes over the `Todo`
+    /// at its entry point, keeping all edges from its callers.
     pub fn insert(&mut self, function: Function) -> Vec<Uuid> {
-        let maybe_vx = self.call_graph.vertices().find(|ct| self.call_graph.vertex_label(*ct).unwrap().uuid() == function.uuid());
+        self.sync();
 
         let calls = function.collect_calls();
+        let maybe_vx = {
+            let index = self.index.get_mut().unwrap();
+            let by_uuid = index.by_uuid.get(function.uuid()).cloned();
+            let by_entry = entry_of(&function).and_then(|entry| index.by_entry.get(&entry).cloned());
+
+            by_uuid.or_else(
+                || {
+                    by_entry.and_then(
+                        |vx| match self.call_graph.vertex_label(vx) {
+                            Some(&CallTarget::Todo(..)) => Some(vx),
+                            _ => None,
+                        }
+                    )
+                }
+            )
+        };
         let new_vx = if let Some(vx) = maybe_vx {
-            *self.call_graph.vertex_label_mut(vx).unwrap() = CallTarget::Concrete(function);
+            let ct = CallTarget::Concrete(function);
+            let old = ::std::mem::replace(self.call_graph.vertex_label_mut(vx).unwrap(), ct);
+            let index = self.index.get_mut().unwrap();
+
+            index.remove(vx, &old);
+            index.add(vx, self.call_graph.vertex_label(vx).unwrap());
             vx
         } else {
-            self.call_graph.add_vertex(CallTarget::Concrete(function))
+            self.add_target(CallTarget::Concrete(function))
         };
 
-        let mut other_funs = Vec::new();
+        let mut callees = self.call_graph.out_edges(new_vx).map(|e| self.call_graph.target(e)).collect::<HashSet<_>>();
         let mut todos = Vec::new();
 
         for a in calls {
-            let l = other_funs.len();
-
-            for w in self.call_graph.vertices() {
-                match self.call_graph.vertex_label(w) {
-                    Some(&CallTarget::Concrete(ref function)) => {
-                        if let Rvalue::Constant { ref value, .. } = a {
-                            if *value == function.start() {
-                                other_funs.push(w);
-                                break;
-                            }
-                        }
-                    }
-                    Some(&CallTarget::Todo(ref _a, _, _)) => {
-                        if *_a == a {
-                            other_funs.push(w);
-                            break;
-                        }
-                    }
-                    _ => {}
-                }
-            }
-
-            if l == other_funs.len() {
+            let known = match a {
+                Rvalue::Constant { value, .. } => self.index.get_mut().unwrap().by_entry.get(&value).cloned(),
+                ref a => self.index.get_mut().unwrap().indirect.get(a).cloned(),
+            };
+            let other_fun = if let Some(vx) = known {
+                vx
+            } else {
                 let uu = Uuid::new_v4();
-                let v = self.call_graph.add_vertex(CallTarget::Todo(a, None, uu));
 
-                self.call_graph.add_edge((), new_vx, v);
-                todos.push(uu);
-            }
-        }
+                todos.push(uu.clone());
+                self.add_target(CallTarget::Todo(a, None, uu))
+            };
 
-        for other_fun in other_funs {
-            if self.call_graph.edge(new_vx, other_fun) == None {
+            if callees.insert(other_fun) {
                 self.call_graph.add_edge((), new_vx, other_fun);
             }
         }
@@ -264,17 +492,54 @@ impl Program {
 
     /// Returns the function, todo item or symbolic reference with UUID `uu`.
     pub fn find_call_target_by_uuid<'a>(&'a self, uu: &Uuid) -> Option<CallGraphRef> {
-        for vx in self.call_graph.vertices() {
-            if let Some(lb) = self.call_graph.vertex_label(vx) {
-                if lb.uuid() == uu {
-                    return Some(vx);
+        let is_match = |vx: CallGraphRef| self.call_graph.vertex_label(vx).map(|ct| ct.uuid() == uu).unwrap_or(false);
+
+        self.index().by_uuid.get(uu).cloned().and_then(|vx| if is_match(vx) { Some(vx) } else { None })
+    }
+
+    /// Returns all call graph nodes calling `vx`, i.e. its reverse dependencies.
+    pub fn callers(&self, vx: CallGraphRef) -> Vec<CallGraphRef> {
+        if self.call_graph.vertex_label(vx).is_none() {
+            return vec![];
+        }
+
+        let mut ret = self.call_graph.in_edges(vx).map(|e| self.call_graph.source(e)).collect::<Vec<_>>();
+
+        ret.sort();
+        ret.dedup();
+        ret
+    }
+
+    /// Returns all PLT stubs of the import at `plt_address`. See `update_plt`.
+    pub fn find_stubs(&self, plt_address: u64) -> Vec<CallGraphRef> {
+        let is_match = |vx: CallGraphRef| match self.call_graph.vertex_label(vx) {
+            Some(&CallTarget::Concrete(ref f)) => {
+                match f.kind() {
+                    &FunctionKind::Stub { plt_address: a, .. } => a == plt_address,
+                    _ => false,
                 }
-            } else {
-                unreachable!();
             }
-        }
+            _ => false,
+        };
 
-        None
+        self.index().stubs.get(&plt_address).map(|v| v.iter().cloned().filter(|&vx| is_match(vx)).collect()).unwrap_or_default()
+    }
+
+    /// Copies the structure of the call graph into compressed sparse row form for fast traversals.
+    /// The vertices of the copy are labeled with their `CallGraphRef`s, in ascending order.
+    pub fn frozen_call_graph(&self) -> FrozenCallGraph {
+        let mut vertices = self.call_graph.vertices().collect::<Vec<_>>();
+
+        vertices.sort();
+
+        let index = vertices.iter().enumerate().map(|(i, &vx)| (vx, i)).collect::<HashMap<_, _>>();
+        let edges = vertices
+            .iter()
+            .enumerate()
+            .flat_map(|(i, &vx)| self.call_graph.out_edges(vx).map(|e| ((), i, index[&self.call_graph.target(e)])).collect::<Vec<_>>())
+            .collect();
+
+        CompressedGraph::new(vertices, edges)
     }
 
     /// Returns an iterator over every Function in this program
@@ -284,13 +549,18 @@ impl Program {
 
     /// Returns a mutable iterator over every Function in this program
     pub fn functions_mut(&mut self) -> FunctionMutIterator {
+        self.index.get_mut().unwrap().stale = true;
         FunctionMutIterator::new(&mut self.call_graph)
     }
     /// Calls [Function::set_plt](../function/struct.Function.html#method.set_plt) on all matching functions
     pub fn update_plt(&mut self) {
-        for ct in self.call_graph.vertex_labels_mut() {
-            match ct {
-                &mut CallTarget::Concrete(ref mut function) => {
+        self.sync();
+
+        let vertices = self.call_graph.vertices().collect::<Vec<_>>();
+
+        for vx in vertices {
+            match self.call_graph.vertex_label_mut(vx) {
+                Some(&mut CallTarget::Concrete(ref mut function)) => {
                     let address = {
                         let mut last = None;
                         let mut count = 0;
@@ -312,6 +582,11 @@ impl Program {
                         match self.imports.get(&address) {
                             Some(import) => {
                                 function.set_plt(import, address);
+
+                                let stubs = self.index.get_mut().unwrap().stubs.entry(address).or_insert_with(Vec::new);
+                                if !stubs.contains(&vx) {
+                                    stubs.push(vx);
+                                }
                             },
                             None => (),
                         }
@@ -321,6 +596,30 @@ impl Program {
             }
         }
     }
+
+    /// Whether the lookup tables are up to date.
+    #[cfg(test)]
+    fn is_indexed(&self) -> bool {
+        let index = self.index.lock().unwrap();
+        !index.stale && index.dirty.is_empty() && index.vertices == self.call_graph.num_vertices()
+    }
+
+    /// Lookup tables, brought up to date first.
+    fn index(&self) -> MutexGuard<Index> {
+        let mut index = self.index.lock().unwrap();
+
+        index.refresh(&self.call_graph);
+        index
+    }
+
+    /// Brings the lookup tables up to date before the call graph is changed.
+    fn sync(&mut self) {
+        self.index.get_mut().unwrap().refresh(&self.call_graph);
+    }
+
+    fn reindex(&mut self) {
+        *self.index.get_mut().unwrap() = Index::build(&self.call_graph);
+    }
 }
 
 #[cfg(test)]
@@ -387,6 +686,13 @@ mod tests {
         assert_eq!(prog.call_graph.edge(vx1, tvx), e2);
         assert_eq!(prog.call_graph.num_edges(), 2);
         assert_eq!(prog.call_graph.num_vertices(), 3);
+
+        let frozen = prog.frozen_call_graph();
+        let labels = frozen.vertex_labels().cloned().collect::<Vec<_>>();
+        let edges = frozen.edges().map(|e| (labels[frozen.source(e).0], labels[frozen.target(e).0])).collect::<Vec<_>>();
+
+        assert_eq!(labels, vec![tvx, vx0, vx1]);
+        assert_eq!(edges, vec![(tvx, vx0), (vx1, tvx)]);
     }
 
     #[test]
@@ -430,4 +736,148 @@ mod tests {
         assert_eq!(prog.call_graph.num_edges(), 1);
         assert_eq!(prog.call_graph.num_vertices(), 2);
     }
+
+    fn call(from: u64, to: u64) -> Mnemonic {
+        let stmts = vec![
+            Statement {
+                op: Operation::Call(Rvalue::new_u64(to)),
+                assignee: Lvalue::Undefined,
+            },
+        ];
+
+        Mnemonic::new(from..from + 1, "call".to_string(), "".to_string(), vec![].iter(), stmts.iter()).ok().unwrap()
+    }
+
+    fn function(start: u64, calls: &[u64]) -> Function {
+        let mut func = Function::undefined(start, None, &Region::undefined("ram".to_owned(), 100), None);
+        let mut mnes = calls.iter().enumerate().map(|(i, &to)| call(start + i as u64, to)).collect::<Vec<_>>();
+
+        if mnes.is_empty() {
+            mnes.push(Mnemonic::new(start..start + 1, "ret".to_string(), "".to_string(), vec![].iter(), vec![].iter()).ok().unwrap());
+        }
+
+        let vx = func.cfg_mut().add_vertex(ControlFlowTarget::Resolved(BasicBlock::from_vec(mnes)));
+        func.set_entry_point_ref(vx);
+        func
+    }
+
+    #[test]
+    fn insert_takes_over_todo_at_entry() {
+        let mut prog = Program::new("prog_test");
+        let f1 = function(0, &[10, 20]);
+        let f2 = function(5, &[10]);
+        let uu2 = f2.uuid().clone();
+
+        assert_eq!(prog.insert(f1).len(), 2);
+        assert_eq!(prog.insert(f2).len(), 0);
+
+        assert!(prog.find_call_target_by_uuid(&uu2).is_some());
+        assert_eq!(prog.find_function_by_entry(10), None);
+
+        // the function at 10 replaces the todo created by the caller at 0
+        let f3 = function(10, &[0]);
+        let uu3 = f3.uuid().clone();
+
+        assert_eq!(prog.insert(f3).len(), 0);
+        assert_eq!(prog.call_graph.num_vertices(), 4);
+        assert_eq!(prog.call_graph.num_edges(), 4);
+
+        let vx0 = prog.find_function_by_entry(0).unwrap();
+        let vx5 = prog.find_function_by_entry(5).unwrap();
+        let vx10 = prog.find_function_by_entry(10).unwrap();
+
+        assert_eq!(prog.find_call_target_by_uuid(&uu3), Some(vx10));
+        assert_eq!(prog.find_function_by_uuid(&uu3).map(|f| f.start()), Some(10));
+        assert_eq!(prog.callers(vx10), vec![vx0, vx5]);
+        assert_eq!(prog.callers(vx0), vec![vx10]);
+        assert_eq!(prog.callers(vx5), vec![]);
+    }
+
+    #[test]
+    fn index_survives_serialization() {
+        let mut prog = Program::new("prog_test");
+        let uu = Uuid::new_v4();
+
+        prog.add_target(CallTarget::Symbolic("puts".to_string(), uu.clone()));
+        prog.insert(function(0, &[10]));
+
+        let mut prog: Program = ::serde_cbor::from_slice(&::serde_cbor::to_vec(&prog).unwrap()).unwrap();
+        let vx0 = prog.find_function_by_entry(0).unwrap();
+
+        assert!(prog.is_indexed());
+        assert!(prog.find_call_target_by_uuid(&uu).is_some());
+        assert_eq!(prog.find_function_by_entry(10), None);
+
+        prog.insert(function(10, &[]));
+
+        let vx10 = prog.find_function_by_entry(10).unwrap();
+        assert_eq!(prog.callers(vx10), vec![vx0]);
+        assert_eq!(prog.call_graph.num_vertices(), 3);
+    }
+
+    #[test]
+    fn index_follows_updates() {
+        let mut prog = Program::new("prog_test");
+        let uu = Uuid::new_v4();
+        let vx = prog.add_target(CallTarget::Todo(Rvalue::new_u64(10), None, uu.clone()));
+
+        assert_eq!(prog.find_call_target_by_entry(10), Some(vx));
+        assert_eq!(prog.find_function_by_entry(10), None);
+
+        let func = function(10, &[]);
+        let uu2 = func.uuid().clone();
+
+        assert_eq!(prog.update_target(vx, |ct| *ct = CallTarget::Concrete(func)), Some(()));
+        assert!(prog.is_indexed());
+        assert_eq!(prog.find_function_by_entry(10), Some(vx));
+        assert_eq!(prog.find_call_target_by_uuid(&uu2), Some(vx));
+        assert_eq!(prog.find_call_target_by_uuid(&uu), None);
+
+        {
+            let f = prog.find_function_mut(|f| f.start() == 10).unwrap();
+            let bb = f.cfg_mut().add_vertex(ControlFlowTarget::Resolved(BasicBlock::from_vec(vec![Mnemonic::dummy(20..21)])));
+
+            f.set_entry_point_ref(bb);
+        }
+
+        assert!(!prog.is_indexed());
+        assert_eq!(prog.find_function_by_entry(10), None);
+        assert_eq!(prog.find_function_by_entry(20), Some(vx));
+        assert_eq!(prog.find_call_target_by_uuid(&uu2), Some(vx));
+    }
+
+    #[test]
+    fn mutable_lookup_reindexes_one_function() {
+        let mut prog = Program::new("prog_test");
+        let func = function(10, &[]);
+        let uu = func.uuid().clone();
+
+        prog.insert(func);
+        prog.insert(function(30, &[]));
+
+        let vx = prog.find_function_by_entry(10).unwrap();
+        let vx30 = prog.find_function_by_entry(30).unwrap();
+
+        {
+            let f = prog.find_function_by_uuid_mut(&uu).unwrap();
+            let bb = f.cfg_mut().add_vertex(ControlFlowTarget::Resolved(BasicBlock::from_vec(vec![Mnemonic::dummy(20..21)])));
+
+            f.set_entry_point_ref(bb);
+        }
+
+        {
+            let index = prog.index.lock().unwrap();
+
+            assert!(!index.stale);
+            assert_eq!(index.dirty, vec![vx]);
+            assert_eq!(index.by_uuid.get(&uu), Some(&vx));
+            assert_eq!(index.by_entry.get(&10), None);
+        }
+
+        assert_eq!(prog.find_function_by_entry(20), Some(vx));
+        assert!(prog.is_indexed());
+        assert_eq!(prog.find_function_by_entry(10), None);
+        assert_eq!(prog.find_function_by_entry(30), Some(vx30));
+        assert_eq!(prog.find_call_target_by_uuid(&uu), Some(vx));
+    }
 }
@@ -22,7 +22,7 @@
 
 
 use {CallGraphRef, Function, Program, Region, Result, World};
-use panopticon_graph_algos::GraphTrait;
+use panopticon_graph_algos::{GraphTrait, VertexListGraphTrait};
 use byteorder::{BigEndian, ReadBytesExt, WriteBytesExt};
 use flate2::Compression;
 use flate2::read::ZlibDecoder;
@@ -34,6 +34,7 @@ use std::collections::HashMap;
 use std::fs::File;
 use std::io::{Read, Write};
 use std::path::Path;
+use std::sync::Mutex;
 
 use uuid::Uuid;
 
@@ -42,7 +43,7 @@ use uuid::Uuid;
 pub struct Project {
     /// Human-readable name
     pub name: String,
-    /// Recognized code
+    /// Recognized code. Add programs with `add_program`.
     pub code: Vec<Program>,
     /// Memory regions
     pub data: World,
@@ -50,6 +51,11 @@ pub struct Project {
     pub comments: HashMap<(String, u64), String>,
     /// Symbolic References (Imports)
     pub imports: HashMap<u64, String>,
+    /// Position in `code` of the program owning a call target, by UUID of the call target. Filled
+    /// by `add_program` and by lookups missing it. Entries are checked before use because `code`
+    /// and the programs can be changed directly.
+    #[serde(skip)]
+    owners: Mutex<HashMap<Uuid, usize>>,
 }
 
 impl Project {
@@ -61,6 +67,40 @@ impl Project {
             data: World::new(r),
             comments: HashMap::new(),
             imports: HashMap::new(),
+            owners: Mutex::new(HashMap::new()),
+        }
+    }
+
+    /// Appends `prog` to the project's code and records which call targets it owns.
+    pub fn add_program(&mut self, prog: Program) {
+        let pos = self.code.len();
+        let owners = self.owners.get_mut().unwrap();
+
+        for ct in prog.call_graph().vertex_labels() {
+            owners.insert(ct.uuid().clone(), pos);
+        }
+
+        self.code.push(prog);
+    }
+
+    /// Position of the program owning the call target with UUID `uu`.
+    fn owner_of(code: &[Program], owners: &mut HashMap<Uuid, usize>, uu: &Uuid) -> Option<usize> {
+        let owns = |i: usize| code.get(i).map(|p| p.find_call_target_by_uuid(uu).is_some()).unwrap_or(false);
+
+        match owners.get(uu).cloned() {
+            Some(i) if owns(i) => return Some(i),
+            _ => {}
+        }
+
+        match (0..code.len()).find(|&i| owns(i)) {
+            Some(i) => {
+                owners.insert(uu.clone(), i);
+                Some(i)
+            }
+            None => {
+                owners.remove(uu);
+                None
+            }
         }
     }
 
@@ -70,6 +110,14 @@ impl Project {
         self.data.dependencies.vertex_label(self.data.root).unwrap()
     }
 
+    /// Returns the `Region` the code of `prog` lives in.
+    pub fn region_of(&self, prog: &Program) -> &Region {
+        match prog.region {
+            Some(ref name) => self.data.find(name).unwrap_or(self.region()),
+            None => self.region(),
+        }
+    }
+
     /// Reads a serialized project from disk.
     pub fn open(p: &Path) -> Result<Project> {
         let mut fd = match File::open(p) {
@@ -106,46 +154,33 @@ impl Project {
 
     /// Returns function and enclosing program with UUID `uu`
     pub fn find_function_by_uuid<'a>(&'a self, uu: &Uuid) -> Option<&'a Function> {
-        for p in self.code.iter() {
-            if let Some(f) = p.find_function_by_uuid(uu) {
-                return Some(f);
-            }
-        }
-
-        None
+        let pos = Self::owner_of(&self.code, &mut self.owners.lock().unwrap(), uu);
+        pos.and_then(|i| self.code[i].find_function_by_uuid(uu))
     }
 
     /// Returns function and enclosing program with UUID `uu`
     pub fn find_function_by_uuid_mut<'a>(&'a mut self, uu: &Uuid) -> Option<&'a mut Function> {
-        for p in self.code.iter_mut() {
-            if let Some(f) = p.find_function_by_uuid_mut(uu) {
-                return Some(f);
-            }
+        match Self::owner_of(&self.code, self.owners.get_mut().unwrap(), uu) {
+            Some(i) => self.code[i].find_function_by_uuid_mut(uu),
+            None => None,
         }
-
-        None
     }
 
     /// Returns function/reference and enclosing program with UUID `uu`
     pub fn find_call_target_by_uuid<'a>(&'a self, uu: &Uuid) -> Option<(CallGraphRef, &'a Program)> {
-        for p in self.code.iter() {
-            if let Some(ct) = p.find_call_target_by_uuid(uu) {
-                return Some((ct, p));
-            }
-        }
-
-        None
+        let pos = Self::owner_of(&self.code, &mut self.owners.lock().unwrap(), uu);
+        pos.and_then(|i| self.code[i].find_call_target_by_uuid(uu).map(|vx| (vx, &self.code[i])))
     }
 
     /// Returns function/reference and enclosing program with UUID `uu`
     pub fn find_call_target_by_uuid_mut<'a>(&'a mut self, uu: &Uuid) -> Option<(CallGraphRef, &'a mut Program)> {
-        for p in self.code.iter_mut() {
-            if let Some(ct) = p.find_call_target_by_uuid(uu) {
-                return Some((ct, p));
+        match Self::owner_of(&self.code, self.owners.get_mut().unwrap(), uu) {
+            Some(i) => {
+                let p = &mut self.code[i];
+                p.find_call_target_by_uuid(uu).map(move |vx| (vx, p))
             }
+            None => None,
         }
-
-        None
     }
 
     /// Serializes the project into the file at `p`. The format looks like this:
@@ -183,4 +218,49 @@ mod tests {
         assert_eq!(p.name, "test".to_string());
         assert_eq!(p.code.len(), 0);
     }
+
+    #[test]
+    fn region_of() {
+        let mut p = Project::new("test".to_string(), Region::undefined("base".to_string(), 128));
+        let mut prog = Program::new("slice");
+
+        p.data.add(Region::undefined("i386".to_string(), 64));
+        assert_eq!(p.region_of(&prog).name(), "base");
+
+        prog.region = Some("i386".to_string());
+        assert_eq!(p.region_of(&prog).size(), 64);
+
+        prog.region = Some("arm".to_string());
+        assert_eq!(p.region_of(&prog).name(), "base");
+    }
+
+    #[test]
+    fn find_function_by_uuid() {
+        let reg = Region::undefined("base".to_string(), 128);
+        let mut p = Project::new("test".to_string(), reg.clone());
+        let mut progs = vec![Program::new("a"), Program::new("b")];
+        let f0 = Function::undefined(0, None, &reg, None);
+        let f1 = Function::undefined(1, None, &reg, None);
+        let f2 = Function::undefined(2, None, &reg, None);
+        let (uu0, uu1, uu2) = (f0.uuid().clone(), f1.uuid().clone(), f2.uuid().clone());
+
+        progs[0].insert(f0);
+        progs[1].insert(f1);
+        for prog in progs {
+            p.add_program(prog);
+        }
+
+        assert_eq!(p.owners.lock().unwrap().get(&uu1), Some(&1));
+        assert_eq!(p.find_function_by_uuid(&uu0).map(|f| f.uuid().clone()), Some(uu0));
+        assert_eq!(p.find_call_target_by_uuid(&uu1).map(|(_, prog)| prog.name.clone()), Some("b".to_string()));
+
+        // changed behind the project's back
+        p.code.swap(0, 1);
+        p.code[1].insert(f2);
+
+        assert_eq!(p.find_call_target_by_uuid(&uu1).map(|(_, prog)| prog.name.clone()), Some("b".to_string()));
+        assert_eq!(p.find_function_by_uuid_mut(&uu2).map(|f| f.uuid().clone()), Some(uu2.clone()));
+        assert_eq!(p.owners.lock().unwrap().get(&uu2), Some(&1));
+        assert!(p.find_function_by_uuid(&Uuid::new_v4()).is_none());
+    }
 }
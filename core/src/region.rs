@@ -50,9 +50,10 @@
 //! This region is named "undef" and is just 4k of undefined cells
 
 
-use {Bound, Layer, LayerIter, OpaqueLayer, Result};
+use {Bound, DecodeCache, Layer, LayerIter, OpaqueLayer, Result};
 use panopticon_graph_algos::{AdjacencyList, GraphTrait, IncidenceGraphTrait, MutableGraphTrait, VertexListGraphTrait};
 use panopticon_graph_algos::adjacency_list::{AdjacencyListEdgeDescriptor, AdjacencyListVertexDescriptor};
+use serde::{Deserialize, Deserializer};
 use std::collections::HashSet;
 use std::path::Path;
 use std::sync::Arc;
@@ -62,11 +63,50 @@ use std::sync::Arc;
 /// `Region`s are a stack of [`Layer`](../layer/index.html) inside a single address space. The
 /// `Region` is the primary way panopticon handles data. They can be created from files or
 /// in-memory buffers.
-#[derive(Clone,Debug,Serialize,Deserialize)]
+#[derive(Clone,Debug,Serialize)]
 pub struct Region {
     stack: Vec<(Bound, Layer)>,
     name: String,
     size: u64,
+    /// Flattened view of the stack: uncovered, defined parts of opaque layers, sorted by start
+    /// address. Rebuilt on every `cover`.
+    #[serde(skip_serializing)]
+    runs: Vec<Run>,
+    /// Decoded instructions, shared by all clones. Replaced on every `cover`.
+    #[serde(skip_serializing)]
+    cache: Arc<DecodeCache>,
+}
+
+/// Continuous range of defined `Cell`s that come from a single opaque layer.
+#[derive(Clone,Debug)]
+struct Run {
+    area: Bound,
+    layer: usize,
+    offset: usize,
+}
+
+impl<'de> Deserialize<'de> for Region {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> ::std::result::Result<Region, D::Error> {
+        #[derive(Deserialize)]
+        #[serde(rename = "Region")]
+        struct Fields {
+            stack: Vec<(Bound, Layer)>,
+            name: String,
+            size: u64,
+        }
+
+        let fields = Fields::deserialize(deserializer)?;
+        let mut reg = Region {
+            stack: fields.stack,
+            name: fields.name,
+            size: fields.size,
+            runs: vec![],
+            cache: Arc::new(DecodeCache::default()),
+        };
+
+        reg.rebuild_runs();
+        Ok(reg)
+    }
 }
 
 /// Graph that models overlapping regions.
@@ -111,7 +151,16 @@ impl Region {
     pub fn new(name: String, root: OpaqueLayer) -> Region {
         let l = root.len();
         let b = Layer::Opaque(root);
-        Region { stack: vec![(Bound::new(0, l), b)], name: name, size: l }
+        let mut reg = Region {
+            stack: vec![(Bound::new(0, l), b)],
+            name: name,
+            size: l,
+            runs: vec![],
+            cache: Arc::new(DecodeCache::default()),
+        };
+
+        reg.rebuild_runs();
+        reg
     }
 
     /// Applies `layer` to the cells inside `area`.
@@ -128,6 +177,8 @@ impl Region {
             }
 
             self.stack.push((b, l));
+            self.rebuild_runs();
+            self.cache = Arc::new(DecodeCache::new(self.cache.limit()));
             true
         } else {
             false
@@ -162,7 +213,95 @@ impl Region {
         ret
     }
 
-    fn add<'a>(a: (Bound, &'a Layer), v: Vec<(Bound, &'a Layer)>) -> Vec<(Bound, &'a Layer)> {
+    /// Returns the defined bytes starting at `start` up to the next `Layer` boundary or undefined
+    /// `Cell`. Cells overwritten by a writable `Layer` are never included. The returned slice is
+    /// empty if `start` is not covered by a defined opaque `Layer`.
+    pub fn bytes_at(&self, start: u64) -> &[u8] {
+        let idx = match self.runs.binary_search_by(|r| r.area.start.cmp(&start)) {
+            Ok(i) => i,
+            Err(0) => return &[],
+            Err(i) => i - 1,
+        };
+        let run = &self.runs[idx];
+
+        if start >= run.area.end {
+            return &[];
+        }
+
+        match self.stack[run.layer].1.as_opaque().and_then(|o| o.as_slice()) {
+            Some(data) => {
+                let from = run.offset + (start - run.area.start) as usize;
+                let to = run.offset + (run.area.end - run.area.start) as usize;
+
+                &data[from..to]
+            }
+            None => &[],
+        }
+    }
+
+    /// All defined bytes of the `Region`, sorted by address. Each slice is a continuous part of a
+    /// single opaque `Layer`, adjacent slices may come from different `Layer`s. Cells overwritten
+    /// by a writable `Layer` are left out, same as `bytes_at`.
+    pub fn defined_bytes(&self) -> Vec<(u64, &[u8])> {
+        self.runs
+            .iter()
+            .filter_map(
+                |run| {
+                    self.stack[run.layer]
+                        .1
+                        .as_opaque()
+                        .and_then(|o| o.as_slice())
+                        .map(|data| (run.area.start, &data[run.offset..run.offset + (run.area.end - run.area.start) as usize]))
+                }
+            )
+            .collect()
+    }
+
+    /// Iterator over all `Cell`s starting at `start`. If at least `min_len` defined `Cell`s can
+    /// be read from a single `Layer` the iterator walks that `Layer`'s bytes directly and ends at
+    /// its boundary. Otherwise this is the same as `iter().seek(start)`.
+    ///
+    /// Decoders pass the length of the longest instruction as `min_len`.
+    pub fn iter_at(&self, start: u64, min_len: usize) -> LayerIter {
+        let bytes = self.bytes_at(start);
+
+        if !bytes.is_empty() && bytes.len() >= min_len {
+            LayerIter::Defined(Some(bytes))
+        } else {
+            self.iter().seek(start)
+        }
+    }
+
+    fn rebuild_runs(&mut self) {
+        let mut areas = Vec::new();
+
+        for (idx, x) in self.stack.iter().enumerate() {
+            areas = Self::add((x.0.clone(), idx), areas);
+        }
+
+        let mut runs = areas
+            .into_iter()
+            .filter_map(
+                |(area, idx)| {
+                    let &(ref covered, ref layer) = &self.stack[idx];
+                    let defined = layer.as_opaque().and_then(|o| o.as_slice()).map(|d| d.len() as u64);
+
+                    match defined {
+                        Some(len) if area.end - covered.start <= len && area.start < area.end => {
+                            let offset = (area.start - covered.start) as usize;
+                            Some(Run { area: area, layer: idx, offset: offset })
+                        }
+                        _ => None,
+                    }
+                }
+            )
+            .collect::<Vec<_>>();
+
+        runs.sort_by(|a, b| a.area.start.cmp(&b.area.start));
+        self.runs = runs;
+    }
+
+    fn add<T: Clone>(a: (Bound, T), v: Vec<(Bound, T)>) -> Vec<(Bound, T)> {
         let mut ret = v.iter()
             .fold(
                 Vec::new(), |mut acc, x| {
@@ -177,7 +316,7 @@ impl Region {
                         // a covers start of x
                         let bound = Bound::new(a.0.end, x.0.end);
                         if bound.start < bound.end {
-                            acc.push((bound, x.1));
+                            acc.push((bound, x.1.clone()));
                         }
                         acc
                     } else if a.0.start > x.0.start && a.0.end >= x.0.end {
@@ -185,7 +324,7 @@ impl Region {
                         let bound = Bound::new(x.0.start, a.0.start);
 
                         if bound.start < bound.end {
-                            acc.push((bound, x.1));
+                            acc.push((bound, x.1.clone()));
                         }
                         acc
                     } else {
@@ -193,10 +332,10 @@ impl Region {
                         let bound1 = Bound::new(x.0.start, a.0.start);
                         let bound2 = Bound::new(a.0.end, x.0.end);
                         if bound1.start < bound1.end {
-                            acc.push((bound1, x.1));
+                            acc.push((bound1, x.1.clone()));
                         }
                         if bound2.start < bound2.end {
-                            acc.push((bound2, x.1));
+                            acc.push((bound2, x.1.clone()));
                         }
                         acc
                     }
@@ -230,6 +369,16 @@ impl Region {
     pub fn name(&self) -> &String {
         &self.name
     }
+
+    /// Renames the `Region`. Functions disassembled before keep the old name.
+    pub fn set_name(&mut self, name: String) {
+        self.name = name;
+    }
+
+    /// Cache of instructions decoded inside this `Region`.
+    pub fn decode_cache(&self) -> &DecodeCache {
+        &self.cache
+    }
 }
 
 impl World {
@@ -241,6 +390,17 @@ impl World {
         World { dependencies: g, root: b }
     }
 
+    /// Adds `reg` to `self` without overlapping any other `Region`. Used for independent address
+    /// spaces like the slices of a fat Mach-O binary.
+    pub fn add(&mut self, reg: Region) -> RegionRef {
+        self.dependencies.add_vertex(reg)
+    }
+
+    /// Returns the `Region` called `name`.
+    pub fn find(&self, name: &str) -> Option<&Region> {
+        self.dependencies.vertices().filter_map(|vx| self.dependencies.vertex_label(vx)).find(|r| r.name() == name)
+    }
+
     /// Vector of all `Region` in `self` and their uncovered area
     pub fn projection(&self) -> Vec<(Bound, RegionRef)> {
         let mut ret = Vec::<(Bound, RegionRef)>::new();
@@ -338,6 +498,47 @@ mod tests {
         assert!(s1.all(|x| x.is_none()));
     }
 
+    #[test]
+    fn bytes_at() {
+        let mut st = Region::undefined("".to_string(), 16);
+        let mut patch = Layer::writable();
+
+        patch.write(0, Some(42));
+        assert!(st.cover(Bound::new(2, 10), Layer::wrap(vec![1, 2, 3, 4, 5, 6, 7, 8])));
+        assert!(st.cover(Bound::new(5, 7), Layer::wrap(vec![10, 11])));
+        assert!(st.cover(Bound::new(8, 9), patch));
+
+        assert!(st.bytes_at(0).is_empty());
+        assert_eq!(st.bytes_at(2), &[1, 2, 3]);
+        assert_eq!(st.bytes_at(4), &[3]);
+        assert_eq!(st.bytes_at(5), &[10, 11]);
+        assert_eq!(st.bytes_at(7), &[6]);
+        assert!(st.bytes_at(8).is_empty());
+        assert_eq!(st.bytes_at(9), &[8]);
+        assert!(st.bytes_at(10).is_empty());
+        assert!(st.bytes_at(100).is_empty());
+
+        // falls back to the cell iterator across layer boundaries
+        assert_eq!(st.iter_at(2, 3).collect::<Vec<_>>(), vec![Some(1), Some(2), Some(3)]);
+        assert_eq!(st.iter_at(2, 4).take(4).collect::<Vec<_>>(), vec![Some(1), Some(2), Some(3), Some(10)]);
+        assert_eq!(st.iter_at(7, 1).collect::<Vec<_>>(), vec![Some(6)]);
+        assert_eq!(st.iter_at(7, 2).take(3).collect::<Vec<_>>(), vec![Some(6), Some(42), Some(8)]);
+    }
+
+    #[test]
+    fn defined_bytes() {
+        let mut st = Region::undefined("".to_string(), 16);
+        let mut patch = Layer::writable();
+
+        patch.write(0, Some(42));
+        assert!(st.cover(Bound::new(2, 10), Layer::wrap(vec![1, 2, 3, 4, 5, 6, 7, 8])));
+        assert!(st.cover(Bound::new(5, 7), Layer::wrap(vec![10, 11])));
+        assert!(st.cover(Bound::new(8, 9), patch));
+
+        let expect: Vec<(u64, &[u8])> = vec![(2, &[1, 2, 3]), (5, &[10, 11]), (7, &[6]), (9, &[8])];
+        assert_eq!(st.defined_bytes(), expect);
+    }
+
     #[test]
     fn flatten() {
         let mut st = Region::undefined("".to_string(), 140);
@@ -0,0 +1,124 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Measures liveness analysis and SSA conversion.
+//!
+//! Usage: cargo run --release --example ssa [BINARY...]
+//!
+//! Disassembles every function with a symbol in each BINARY (default: the ELF and PE files in
+//! test-data) and prints the time `liveness` and `ssa_convertion` take for all of them.
+
+extern crate panopticon_core;
+extern crate panopticon_data_flow;
+extern crate panopticon_graph_algos;
+extern crate panopticon_amd64;
+extern crate panopticon_avr;
+
+use panopticon_amd64 as amd64;
+use panopticon_avr as avr;
+use panopticon_core::{Architecture, CallTarget, Function, Machine, Region, Result, Rvalue, loader};
+use panopticon_data_flow::{liveness, ssa_convertion};
+use panopticon_graph_algos::VertexListGraphTrait;
+use std::env;
+use std::path::Path;
+use std::time::{Duration, Instant};
+
+/// Number of times each measurement is repeated. The fastest run is reported.
+const ROUNDS: usize = 5;
+
+fn disassemble<A: Architecture>(entries: &[(u64, Option<String>)], reg: &Region, config: A::Configuration) -> Vec<Function> {
+    entries.iter().filter_map(|&(entry, ref name)| Function::new::<A>(entry, reg, name.clone(), config.clone()).ok()).collect()
+}
+
+fn load(path: &Path) -> Result<Vec<Function>> {
+    let (proj, machine) = loader::load(path)?;
+    let reg = proj.region();
+    let mut entries = vec![];
+
+    for prog in proj.code.iter() {
+        for ct in prog.call_graph().vertex_labels() {
+            if let &CallTarget::Todo(Rvalue::Constant { value, .. }, ref name, _) = ct {
+                entries.push((value, name.clone()));
+            }
+        }
+    }
+
+    entries.sort();
+    entries.dedup_by_key(|x| x.0);
+
+    Ok(
+        match machine {
+            Machine::Avr => disassemble::<avr::Avr>(&entries, reg, avr::Mcu::atmega103()),
+            Machine::Ia32 => disassemble::<amd64::Amd64>(&entries, reg, amd64::Mode::Protected),
+            Machine::Amd64 => disassemble::<amd64::Amd64>(&entries, reg, amd64::Mode::Long),
+        }
+    )
+}
+
+fn fastest<F: FnMut() -> Duration>(mut f: F) -> f64 {
+    let best = (0..ROUNDS).map(|_| f()).min().unwrap();
+
+    best.as_secs() as f64 + best.subsec_nanos() as f64 * 1e-9
+}
+
+fn main() {
+    let mut paths = env::args().skip(1).collect::<Vec<_>>();
+
+    if paths.is_empty() {
+        for p in &["static", "libfoo.so", "sosse", "hello-world", "test.exe"] {
+            paths.push(format!("../test-data/{}", p));
+        }
+    }
+
+    println!("{:>24} {:>10} {:>10} {:>10} {:>10}", "binary", "functions", "statements", "liveness", "ssa");
+
+    for path in paths {
+        let funcs = match load(Path::new(&path)) {
+            Ok(funcs) => funcs,
+            Err(e) => {
+                println!("failed to load {}: {}", path, e);
+                continue;
+            }
+        };
+        let stmts = funcs.iter().map(|f| f.statements().count()).sum::<usize>();
+        let live = fastest(
+            || {
+                let start = Instant::now();
+
+                for f in funcs.iter() {
+                    liveness(f);
+                }
+                start.elapsed()
+            }
+        );
+        let ssa = fastest(
+            || {
+                let mut copies = funcs.clone();
+                let start = Instant::now();
+
+                for f in copies.iter_mut() {
+                    let _ = ssa_convertion(f);
+                }
+                start.elapsed()
+            }
+        );
+        let name = Path::new(&path).file_name().map(|x| x.to_string_lossy().to_string()).unwrap_or(path.clone());
+
+        println!("{:>24} {:>10} {:>10} {:>10.3} {:>10.3}", name, funcs.len(), stmts, live, ssa);
+    }
+}
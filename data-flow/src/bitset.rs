@@ -0,0 +1,188 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Dense sets of small integers.
+
+/// Set of `usize` stored as a bit vector. Grows on insert, so sets of the same universe can have
+/// different lengths.
+#[derive(Clone,Debug,Default)]
+pub struct BitSet {
+    words: Vec<u64>,
+}
+
+impl BitSet {
+    /// Creates an empty set.
+    pub fn new() -> BitSet {
+        BitSet { words: Vec::new() }
+    }
+
+    /// Creates an empty set that can hold `0..len` without growing.
+    pub fn with_capacity(len: usize) -> BitSet {
+        BitSet { words: Vec::with_capacity((len + 63) / 64) }
+    }
+
+    /// Adds `i`. Returns false if `i` was already in the set.
+    pub fn insert(&mut self, i: usize) -> bool {
+        let (w, b) = (i / 64, 1u64 << (i % 64));
+
+        if w >= self.words.len() {
+            self.words.resize(w + 1, 0);
+        }
+
+        let ret = self.words[w] & b == 0;
+        self.words[w] |= b;
+        ret
+    }
+
+    /// Removes `i`. Returns false if `i` wasn't in the set.
+    pub fn remove(&mut self, i: usize) -> bool {
+        let (w, b) = (i / 64, 1u64 << (i % 64));
+
+        match self.words.get_mut(w) {
+            Some(word) if *word & b != 0 => {
+                *word &= !b;
+                true
+            }
+            _ => false,
+        }
+    }
+
+    /// True if `i` is in the set.
+    pub fn contains(&self, i: usize) -> bool {
+        self.words.get(i / 64).map(|w| w & (1u64 << (i % 64)) != 0).unwrap_or(false)
+    }
+
+    /// True if the set has no elements.
+    pub fn is_empty(&self) -> bool {
+        self.words.iter().all(|&w| w == 0)
+    }
+
+    /// Number of elements.
+    pub fn len(&self) -> usize {
+        self.words.iter().map(|w| w.count_ones() as usize).sum()
+    }
+
+    /// Removes all elements.
+    pub fn clear(&mut self) {
+        for w in self.words.iter_mut() {
+            *w = 0;
+        }
+    }
+
+    /// Adds all elements of `other`. Returns true if the set changed.
+    pub fn union_with(&mut self, other: &BitSet) -> bool {
+        self.union_with_difference(other, &BitSet::new())
+    }
+
+    /// Adds all elements of `other` that are not in `minus`. Returns true if the set changed.
+    /// This is the transfer function of most bit vector problems: `self ∪= other ∖ minus`.
+    pub fn union_with_difference(&mut self, other: &BitSet, minus: &BitSet) -> bool {
+        let mut changed = false;
+
+        if self.words.len() < other.words.len() {
+            self.words.resize(other.words.len(), 0);
+        }
+
+        for (i, &o) in other.words.iter().enumerate() {
+            let m = minus.words.get(i).cloned().unwrap_or(0);
+            let new = self.words[i] | (o & !m);
+
+            changed |= new != self.words[i];
+            self.words[i] = new;
+        }
+
+        changed
+    }
+
+    /// Iterates the elements in ascending order.
+    pub fn iter(&self) -> BitSetIterator {
+        BitSetIterator { words: &self.words, index: 0, current: self.words.first().cloned().unwrap_or(0) }
+    }
+}
+
+impl PartialEq for BitSet {
+    fn eq(&self, other: &BitSet) -> bool {
+        let (short, long) = if self.words.len() < other.words.len() { (self, other) } else { (other, self) };
+
+        short.words.iter().zip(long.words.iter()).all(|(a, b)| a == b) && long.words[short.words.len()..].iter().all(|&w| w == 0)
+    }
+}
+
+impl Eq for BitSet {}
+
+/// Iterator over the elements of a `BitSet`.
+pub struct BitSetIterator<'a> {
+    words: &'a [u64],
+    index: usize,
+    current: u64,
+}
+
+impl<'a> Iterator for BitSetIterator<'a> {
+    type Item = usize;
+
+    fn next(&mut self) -> Option<usize> {
+        while self.current == 0 {
+            self.index += 1;
+            if self.index >= self.words.len() {
+                return None;
+            }
+            self.current = self.words[self.index];
+        }
+
+        let bit = self.current.trailing_zeros() as usize;
+
+        self.current &= self.current - 1;
+        Some(self.index * 64 + bit)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn bitset() {
+        let mut a = BitSet::new();
+        let mut b = BitSet::with_capacity(10);
+
+        assert!(a.is_empty());
+        assert!(a.insert(3));
+        assert!(!a.insert(3));
+        assert!(a.insert(130));
+        assert!(b.insert(64));
+        assert!(b.insert(3));
+        assert_eq!(a.iter().collect::<Vec<_>>(), vec![3, 130]);
+        assert_eq!(a.len(), 2);
+
+        let mut c = BitSet::new();
+
+        assert!(c.union_with_difference(&a, &b));
+        assert_eq!(c.iter().collect::<Vec<_>>(), vec![130]);
+        assert!(c.union_with(&b));
+        assert!(!c.union_with(&b));
+        assert_eq!(c.iter().collect::<Vec<_>>(), vec![3, 64, 130]);
+
+        assert!(c.remove(130));
+        assert!(!c.remove(130));
+        assert!(!c.contains(130));
+        assert_eq!(c, b);
+        c.clear();
+        assert!(c.is_empty());
+        assert_eq!(c, BitSet::new());
+    }
+}
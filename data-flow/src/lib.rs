@@ -24,8 +24,14 @@
 extern crate panopticon_core;
 extern crate panopticon_graph_algos;
 
+mod bitset;
+pub use bitset::{BitSet, BitSetIterator};
+
+mod variables;
+pub use variables::{NameHasher, Variables};
+
 mod liveness;
-pub use liveness::{liveness, liveness_sets};
+pub use liveness::{BlockSets, liveness, liveness_sets};
 
 mod ssa;
 pub use ssa::{flag_operations, ssa_convertion, type_check};
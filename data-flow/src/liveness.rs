@@ -16,121 +16,169 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-use panopticon_core::{ControlFlowRef, ControlFlowTarget, Function, Guard, Lvalue, Operation, Rvalue, Statement};
+use {BitSet, Variables};
+use panopticon_core::{BlockOrder, ControlFlowRef, ControlFlowTarget, Function, Guard, Lvalue, Name, Operation, Result, Rvalue, Statement};
 use panopticon_graph_algos::{GraphTrait, IncidenceGraphTrait};
-use std::borrow::Cow;
-use std::collections::{HashMap, HashSet};
-use std::iter::FromIterator;
+use std::collections::{HashMap, HashSet, VecDeque};
+use std::sync::Arc;
+
+/// VarKill and UEVar sets of all basic blocks reachable from the entry point of a function. Variables
+/// are interned and blocks are numbered in reverse postorder, so all sets are bit vectors.
+#[derive(Clone,Debug)]
+pub struct BlockSets {
+    /// Variables of the function.
+    pub variables: Variables,
+    /// Basic blocks in reverse postorder and their successors/predecessors, shared with the
+    /// analysis cache of the function.
+    pub order: Arc<BlockOrder>,
+    /// True for resolved basic blocks, false for unresolved jump targets.
+    pub resolved: Vec<bool>,
+    /// Variables written in each block.
+    pub varkill: Vec<BitSet>,
+    /// Variables read in each block before they are written.
+    pub uevar: Vec<BitSet>,
+}
 
-/// Computes the set of killed (VarKill) and upward exposed variables (UEvar) for each basic block
-/// in `func`. Returns (VarKill,UEvar).
-pub fn liveness_sets(func: &Function) -> (HashMap<ControlFlowRef, HashSet<Cow<'static, str>>>, HashMap<ControlFlowRef, HashSet<Cow<'static, str>>>) {
-    let mut uevar = HashMap::<ControlFlowRef, HashSet<&str>>::new();
-    let mut varkill = HashMap::<ControlFlowRef, HashSet<Cow<'static, str>>>::new();
-    let ord = func.postorder();
-    let cfg = func.cfg();
-
-    // init UEVar and VarKill sets
-    for &vx in ord.iter() {
-        let uev = uevar.entry(vx).or_insert(HashSet::<&str>::new());
-        let vk = varkill.entry(vx).or_insert(HashSet::<Cow<'static, str>>::new());
-
-        if let Some(&ControlFlowTarget::Resolved(ref bb)) = cfg.vertex_label(vx) {
-            for mne in bb.mnemonics.iter() {
-                for rv in mne.operands.iter() {
-                    if let &Rvalue::Variable { ref name, .. } = rv {
-                        if !vk.contains(name) {
-                            uev.insert(name);
+impl BlockSets {
+    /// Computes the sets of `func`. Fails if a RREIL operation has no arguments.
+    pub fn new(func: &Function) -> Result<BlockSets> {
+        Self::scan(func, true)
+    }
+
+    fn scan(func: &Function, check: bool) -> Result<BlockSets> {
+        let cfg = func.cfg();
+        let order = func.block_order();
+        let num = order.blocks.len();
+        let mut ret = BlockSets {
+            variables: Variables::new(),
+            order: order.clone(),
+            resolved: vec![false; num],
+            varkill: vec![BitSet::new(); num],
+            uevar: vec![BitSet::new(); num],
+        };
+
+        for (b, &vx) in order.blocks.iter().enumerate() {
+            let vars = &mut ret.variables;
+            let uev = &mut ret.uevar[b];
+            let vk = &mut ret.varkill[b];
+
+            if let Some(&ControlFlowTarget::Resolved(ref bb)) = cfg.vertex_label(vx) {
+                ret.resolved[b] = true;
+
+                for mne in bb.mnemonics.iter() {
+                    for rv in mne.operands.iter() {
+                        if let &Rvalue::Variable { ref name, size, .. } = rv {
+                            let id = vars.intern(name, size);
+
+                            if !vk.contains(id) {
+                                uev.insert(id);
+                            }
                         }
                     }
-                }
 
-                for instr in mne.instructions.iter() {
-                    let &Statement { ref op, ref assignee } = instr;
+                    for instr in mne.instructions.iter() {
+                        let &Statement { ref op, ref assignee } = instr;
+                        let operands = op.operands();
+
+                        if check && operands.is_empty() {
+                            return Err("Operation w/o arguments".into());
+                        }
+
+                        // Phi functions neither use nor define variables, they're only interned
+                        // to know their sizes
+                        let is_phi = if let &Operation::Phi(_) = op { true } else { false };
 
-                    if let &Operation::Phi(_) = op {
-;
-                    } else {
-                        for &rv in op.operands().iter() {
-                            if let &Rvalue::Variable { ref name, .. } = rv {
-                                if !vk.contains(name) {
-                                    uev.insert(name);
+                        for &rv in operands.iter() {
+                            if let &Rvalue::Variable { ref name, size, .. } = rv {
+                                let id = vars.intern(name, size);
+
+                                if !is_phi && !vk.contains(id) {
+                                    uev.insert(id);
                                 }
                             }
                         }
 
-                        if let &Lvalue::Variable { ref name, .. } = assignee {
-                            vk.insert(name.clone());
+                        if let &Lvalue::Variable { ref name, size, .. } = assignee {
+                            let id = vars.intern(name, size);
+
+                            if !is_phi {
+                                vk.insert(id);
+                            }
                         }
                     }
                 }
             }
-        }
 
-        for e in cfg.out_edges(vx) {
-            if let Some(&Guard::Predicate { flag: Rvalue::Variable { ref name, .. }, .. }) = cfg.edge_label(e) {
-                if !vk.contains(name) {
-                    uev.insert(name);
+            for e in cfg.out_edges(vx) {
+                if let Some(&Guard::Predicate { flag: Rvalue::Variable { ref name, size, .. }, .. }) = cfg.edge_label(e) {
+                    let id = vars.intern(name, size);
+
+                    if !vk.contains(id) {
+                        uev.insert(id);
+                    }
                 }
             }
         }
-    }
 
-    (varkill, HashMap::from_iter(uevar.iter().map(|(&k, v)| (k, HashSet::from_iter(v.iter().map(|x| Cow::Owned(x.to_string())))))))
-}
-
-/// Computes for each basic block in `func` the set of live variables using simple fixed point
-/// iteration.
-pub fn liveness(func: &Function) -> HashMap<ControlFlowRef, HashSet<Cow<'static, str>>> {
-    let (varkill, uevar) = liveness_sets(func);
-    let mut liveout = HashMap::<ControlFlowRef, HashSet<&str>>::new();
-    let ord = func.postorder();
-    let cfg = func.cfg();
-
-    for &vx in ord.iter() {
-        if let Some(&ControlFlowTarget::Resolved(_)) = cfg.vertex_label(vx) {
-            liveout.insert(vx, HashSet::<&str>::new());
-        }
+        Ok(ret)
     }
 
-    // compute LiveOut sets
-    let mut fixpoint = false;
-    while !fixpoint {
-        let mut new_liveout = HashMap::<ControlFlowRef, HashSet<&str>>::new();
-
-        fixpoint = true;
-        for &vx in ord.iter() {
-            let mut s = HashSet::<&str>::new();
-
-            if let Some(&ControlFlowTarget::Resolved(_)) = cfg.vertex_label(vx) {
-                for e in cfg.out_edges(vx) {
-                    let m = cfg.target(e);
-
-                    for x in uevar[&m].iter() {
-                        s.insert(x);
-                    }
+    /// Computes the set of variables live at the end of each block. Solved with a worklist that
+    /// starts in postorder and revisits the predecessors of blocks whose live-in set changed.
+    pub fn live_out(&self) -> Vec<BitSet> {
+        let num = self.order.blocks.len();
+        // LiveIn(b) = UEVar(b) ∪ (LiveOut(b) ∖ VarKill(b)), only UEVar for unresolved blocks
+        let mut livein = self.uevar.clone();
+        let mut liveout = vec![BitSet::new(); num];
+        let mut queued = vec![true; num];
+        let mut worklist = (0..num).rev().collect::<VecDeque<_>>();
+
+        while let Some(b) = worklist.pop_front() {
+            let mut changed = false;
+
+            queued[b] = false;
+            for &s in self.order.successors[b].iter() {
+                changed |= liveout[b].union_with(&livein[s]);
+            }
 
-                    if let Some(&ControlFlowTarget::Resolved(_)) = cfg.vertex_label(m) {
-                        for x in liveout[&m].iter() {
-                            if !varkill[&m].contains(*x) {
-                                s.insert(x);
-                            }
-                        }
+            if changed && self.resolved[b] && livein[b].union_with_difference(&liveout[b], &self.varkill[b]) {
+                for &p in self.order.predecessors[b].iter() {
+                    if !queued[p] {
+                        queued[p] = true;
+                        worklist.push_back(p);
                     }
                 }
-
-                if liveout[&vx] != s {
-                    fixpoint = false;
-                }
-
-                new_liveout.insert(vx, s);
             }
         }
 
-        liveout = new_liveout;
+        liveout
     }
 
-    HashMap::from_iter(liveout.iter().map(|(&k, v)| (k, HashSet::from_iter(v.iter().map(|x| Cow::Owned(x.to_string()))))))
+    /// Converts a set of variable IDs back to names.
+    pub fn names(&self, set: &BitSet) -> HashSet<Name> {
+        set.iter().map(|id| self.variables.name(id).clone()).collect()
+    }
+}
+
+/// Computes the set of killed (VarKill) and upward exposed variables (UEvar) for each basic block
+/// in `func`. Returns (VarKill,UEvar).
+pub fn liveness_sets(func: &Function) -> (HashMap<ControlFlowRef, HashSet<Name>>, HashMap<ControlFlowRef, HashSet<Name>>) {
+    let sets = BlockSets::scan(func, false).expect("unchecked scans never fail");
+    let varkill = sets.order.blocks.iter().zip(sets.varkill.iter()).map(|(&vx, vk)| (vx, sets.names(vk))).collect();
+    let uevar = sets.order.blocks.iter().zip(sets.uevar.iter()).map(|(&vx, uev)| (vx, sets.names(uev))).collect();
+
+    (varkill, uevar)
+}
+
+/// Computes for each basic block in `func` the set of live variables.
+pub fn liveness(func: &Function) -> HashMap<ControlFlowRef, HashSet<Name>> {
+    let sets = BlockSets::scan(func, false).expect("unchecked scans never fail");
+    let liveout = sets.live_out();
+
+    (0..sets.order.blocks.len())
+        .filter(|&b| sets.resolved[b])
+        .map(|b| (sets.order.blocks[b], sets.names(&liveout[b])))
+        .collect()
 }
 
 #[cfg(test)]
@@ -139,15 +187,14 @@ mod tests {
     use panopticon_core::{BasicBlock, ControlFlowGraph, ControlFlowTarget, Function, Guard, Lvalue, Mnemonic, Operation, Rvalue, Statement, Region};
     use panopticon_graph_algos::{GraphTrait, MutableGraphTrait, VertexListGraphTrait};
     use ssa::{phi_functions, rename_variables};
-    use std::borrow::Cow;
     use std::collections::HashSet;
     use std::iter::FromIterator;
 
     #[test]
     fn live() {
-        let i = Lvalue::Variable { name: Cow::Borrowed("i"), size: 32, subscript: None };
-        let s = Lvalue::Variable { name: Cow::Borrowed("s"), size: 32, subscript: None };
-        let x = Lvalue::Variable { name: Cow::Borrowed("x"), size: 1, subscript: None };
+        let i = Lvalue::Variable { name: Name::new("i"), size: 32, subscript: None };
+        let s = Lvalue::Variable { name: Name::new("s"), size: 32, subscript: None };
+        let x = Lvalue::Variable { name: Name::new("x"), size: 1, subscript: None };
         let mne0 = Mnemonic::new(
             0..1,
             "b0".to_string(),
@@ -267,41 +314,41 @@ mod tests {
         *func.cfg_mut() = cfg;
         func.set_entry_point_ref(v0);
 
-        let all = HashSet::from_iter(vec![Cow::Borrowed("i"), Cow::Borrowed("s")]);
+        let all = HashSet::from_iter(vec![Name::new("i"), Name::new("s")]);
         let (vk, ue) = liveness_sets(&func);
 
         assert_eq!(ue.len(), 5);
         assert_eq!(ue.get(&v0), Some(&HashSet::new()));
         assert_eq!(
             ue.get(&v1),
-            Some(&HashSet::from_iter(vec![Cow::Borrowed("i")]))
+            Some(&HashSet::from_iter(vec![Name::new("i")]))
         );
         assert_eq!(ue.get(&v2), Some(&HashSet::new()));
         assert_eq!(
             ue.get(&v3),
-            Some(&HashSet::from_iter(vec![Cow::Borrowed("i"), Cow::Borrowed("s")]))
+            Some(&HashSet::from_iter(vec![Name::new("i"), Name::new("s")]))
         );
         assert_eq!(
             ue.get(&v4),
-            Some(&HashSet::from_iter(vec![Cow::Borrowed("s")]))
+            Some(&HashSet::from_iter(vec![Name::new("s")]))
         );
 
         assert_eq!(vk.len(), 5);
         assert_eq!(
             vk.get(&v0),
-            Some(&HashSet::from_iter(vec![Cow::Borrowed("i")]))
+            Some(&HashSet::from_iter(vec![Name::new("i")]))
         );
         assert_eq!(
             vk.get(&v1),
-            Some(&HashSet::from_iter(vec![Cow::Borrowed("x")]))
+            Some(&HashSet::from_iter(vec![Name::new("x")]))
         );
         assert_eq!(
             vk.get(&v2),
-            Some(&HashSet::from_iter(vec![Cow::Borrowed("s")]))
+            Some(&HashSet::from_iter(vec![Name::new("s")]))
         );
         assert_eq!(
             vk.get(&v3),
-            Some(&HashSet::from_iter(vec![Cow::Borrowed("x"), Cow::Borrowed("i"), Cow::Borrowed("s")]))
+            Some(&HashSet::from_iter(vec![Name::new("x"), Name::new("i"), Name::new("s")]))
         );
         assert_eq!(vk.get(&v4), Some(&HashSet::new()));
 
@@ -317,14 +364,14 @@ mod tests {
 
     #[test]
     fn phi() {
-        let a = Lvalue::Variable { name: Cow::Borrowed("a"), size: 32, subscript: None };
-        let b = Lvalue::Variable { name: Cow::Borrowed("b"), size: 32, subscript: None };
-        let c = Lvalue::Variable { name: Cow::Borrowed("c"), size: 32, subscript: None };
-        let d = Lvalue::Variable { name: Cow::Borrowed("d"), size: 32, subscript: None };
-        let y = Lvalue::Variable { name: Cow::Borrowed("y"), size: 32, subscript: None };
-        let z = Lvalue::Variable { name: Cow::Borrowed("z"), size: 32, subscript: None };
-        let i = Lvalue::Variable { name: Cow::Borrowed("i"), size: 32, subscript: None };
-        let f = Lvalue::Variable { name: Cow::Borrowed("f"), size: 1, subscript: None };
+        let a = Lvalue::Variable { name: Name::new("a"), size: 32, subscript: None };
+        let b = Lvalue::Variable { name: Name::new("b"), size: 32, subscript: None };
+        let c = Lvalue::Variable { name: Name::new("c"), size: 32, subscript: None };
+        let d = Lvalue::Variable { name: Name::new("d"), size: 32, subscript: None };
+        let y = Lvalue::Variable { name: Name::new("y"), size: 32, subscript: None };
+        let z = Lvalue::Variable { name: Name::new("z"), size: 32, subscript: None };
+        let i = Lvalue::Variable { name: Name::new("i"), size: 32, subscript: None };
+        let f = Lvalue::Variable { name: Name::new("f"), size: 1, subscript: None };
 
         let mne0 = Mnemonic::new(
             0..1,
@@ -581,11 +628,11 @@ mod tests {
 
         assert!(phi_functions(&mut func).is_ok());
 
-        let a0 = Lvalue::Variable { name: Cow::Borrowed("a"), size: 32, subscript: None };
-        let b0 = Lvalue::Variable { name: Cow::Borrowed("b"), size: 32, subscript: None };
-        let c0 = Lvalue::Variable { name: Cow::Borrowed("c"), size: 32, subscript: None };
-        let d0 = Lvalue::Variable { name: Cow::Borrowed("d"), size: 32, subscript: None };
-        let i0 = Lvalue::Variable { name: Cow::Borrowed("i"), size: 32, subscript: None };
+        let a0 = Lvalue::Variable { name: Name::new("a"), size: 32, subscript: None };
+        let b0 = Lvalue::Variable { name: Name::new("b"), size: 32, subscript: None };
+        let c0 = Lvalue::Variable { name: Name::new("c"), size: 32, subscript: None };
+        let d0 = Lvalue::Variable { name: Name::new("d"), size: 32, subscript: None };
+        let i0 = Lvalue::Variable { name: Name::new("i"), size: 32, subscript: None };
 
         // bb0
         if let Some(&ControlFlowTarget::Resolved(ref bb)) = func.cfg().vertex_label(v0) {
@@ -691,14 +738,14 @@ mod tests {
 
     #[test]
     fn rename() {
-        let a = Lvalue::Variable { name: Cow::Borrowed("a"), size: 32, subscript: None };
-        let b = Lvalue::Variable { name: Cow::Borrowed("b"), size: 32, subscript: None };
-        let c = Lvalue::Variable { name: Cow::Borrowed("c"), size: 32, subscript: None };
-        let d = Lvalue::Variable { name: Cow::Borrowed("d"), size: 32, subscript: None };
-        let y = Lvalue::Variable { name: Cow::Borrowed("y"), size: 32, subscript: None };
-        let z = Lvalue::Variable { name: Cow::Borrowed("z"), size: 32, subscript: None };
-        let i = Lvalue::Variable { name: Cow::Borrowed("i"), size: 32, subscript: None };
-        let f = Lvalue::Variable { name: Cow::Borrowed("f"), size: 1, subscript: None };
+        let a = Lvalue::Variable { name: Name::new("a"), size: 32, subscript: None };
+        let b = Lvalue::Variable { name: Name::new("b"), size: 32, subscript: None };
+        let c = Lvalue::Variable { name: Name::new("c"), size: 32, subscript: None };
+        let d = Lvalue::Variable { name: Name::new("d"), size: 32, subscript: None };
+        let y = Lvalue::Variable { name: Name::new("y"), size: 32, subscript: None };
+        let z = Lvalue::Variable { name: Name::new("z"), size: 32, subscript: None };
+        let i = Lvalue::Variable { name: Name::new("i"), size: 32, subscript: None };
+        let f = Lvalue::Variable { name: Name::new("f"), size: 1, subscript: None };
 
         let mne0 = Mnemonic::new(
             0..1,
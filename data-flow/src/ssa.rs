@@ -16,22 +16,20 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-use liveness_sets;
-use panopticon_core::{ControlFlowEdge, ControlFlowGraph, ControlFlowRef, ControlFlowTarget, Function, Guard, Lvalue, Mnemonic, Operation, Result, Rvalue,
+use {BitSet, BlockSets, Variables, liveness_sets};
+use panopticon_core::{ControlFlowEdge, ControlFlowRef, ControlFlowTarget, Function, Guard, Lvalue, Mnemonic, Name, Operation, Result, Rvalue,
                       Statement};
-use panopticon_graph_algos::{BidirectionalGraphTrait, EdgeListGraphTrait, GraphTrait, IncidenceGraphTrait, MutableGraphTrait, VertexListGraphTrait};
-use panopticon_graph_algos::dominator::{dominance_frontiers, immediate_dominator};
-use std::borrow::Cow;
+use panopticon_graph_algos::{EdgeListGraphTrait, GraphTrait, IncidenceGraphTrait, VertexListGraphTrait};
 use std::cmp::max;
 use std::collections::{HashMap, HashSet};
-use std::iter::FromIterator;
+use std::sync::Arc;
 
 /// Does a simple sanity check on all RREIL statements in `func`, returns every variable name
 /// found and its maximal size in bits.
-pub fn type_check(func: &Function) -> Result<HashMap<Cow<'static, str>, usize>> {
-    let mut ret = HashMap::<Cow<'static, str>, usize>::new();
+pub fn type_check(func: &Function) -> Result<HashMap<Name, usize>> {
+    let mut ret = HashMap::<Name, usize>::new();
     let cfg = func.cfg();
-    fn set_len(v: &Rvalue, ret: &mut HashMap<Cow<'static, str>, usize>) {
+    fn set_len(v: &Rvalue, ret: &mut HashMap<Name, usize>) {
         match v {
             &Rvalue::Variable { ref name, ref size, .. } => {
                 let val = *max(ret.get(name).unwrap_or(&0), size);
@@ -76,10 +74,10 @@ pub fn type_check(func: &Function) -> Result<HashMap<Cow<'static, str>, usize>>
 
 /// Computes the set of gloable variables in `func` and their points of usage. Globales are
 /// variables that are used in multiple basic blocks. Returns (Globals,Usage).
-pub fn global_names(func: &Function) -> (HashSet<Cow<'static, str>>, HashMap<Cow<'static, str>, HashSet<ControlFlowRef>>) {
+pub fn global_names(func: &Function) -> (HashSet<Name>, HashMap<Name, HashSet<ControlFlowRef>>) {
     let (varkill, uevar) = liveness_sets(func);
-    let mut usage = HashMap::<Cow<'static, str>, HashSet<ControlFlowRef>>::new();
-    let mut globals = HashSet::<Cow<'static, str>>::new();
+    let mut usage = HashMap::<Name, HashSet<ControlFlowRef>>::new();
+    let mut globals = HashSet::<Name>::new();
 
     for (_, uev) in uevar {
         for v in uev {
@@ -96,11 +94,74 @@ pub fn global_names(func: &Function) -> (HashSet<Cow<'static, str>>, HashMap<Cow
     (globals, usage)
 }
 
+/// Immediate dominators of the blocks in `sets`, indexed like `sets.order.blocks`. The entry
+/// point is its own dominator.
+fn dense_dominators(func: &Function, sets: &BlockSets) -> Result<Arc<Vec<Option<usize>>>> {
+    if sets.order.blocks.len() != func.cfg().num_vertices() {
+        return Err("No all basic blocks are reachable from function entry point".into());
+    }
+
+    Ok(func.immediate_dominators())
+}
+
 /// Inserts SSA Phi functions at junction points in the control flow graph of `func`. The
 /// algorithm produces the semi-pruned SSA form found in Cooper, Torczon: "Engineering a Compiler".
 pub fn phi_functions(func: &mut Function) -> Result<()> {
-    let lens = type_check(func)?;
-    let (globals, usage) = global_names(func);
+    let sets = BlockSets::new(func)?;
+
+    dense_dominators(func, &sets)?;
+    insert_phis(func, &sets)
+}
+
+fn insert_phis(func: &mut Function, sets: &BlockSets) -> Result<()> {
+    use std::mem;
+
+    let num = sets.order.blocks.len();
+    let vars = &sets.variables;
+    let frontiers = func.dominance_frontiers();
+
+    // globals are the variables used in a block without being defined there first
+    let mut globals = BitSet::with_capacity(vars.len());
+    let mut defsites = vec![Vec::<usize>::new(); vars.len()];
+
+    for uev in sets.uevar.iter() {
+        globals.union_with(uev);
+    }
+
+    for (b, vk) in sets.varkill.iter().enumerate() {
+        for v in vk.iter() {
+            if globals.contains(v) {
+                defsites[v].push(b);
+            }
+        }
+    }
+
+    // blocks are stamped with the last variable that got a Phi / was queued there
+    let mut phis = vec![Vec::<usize>::new(); num];
+    let mut has_phi = vec![usize::max_value(); num];
+    let mut queued = vec![usize::max_value(); num];
+
+    for v in globals.iter() {
+        let mut worklist = defsites[v].clone();
+
+        for &b in worklist.iter() {
+            queued[b] = v;
+        }
+
+        while let Some(w) = worklist.pop() {
+            for &d in frontiers[w].iter() {
+                if sets.resolved[d] && has_phi[d] != v {
+                    has_phi[d] = v;
+                    phis[d].push(v);
+
+                    if queued[d] != v {
+                        queued[d] = v;
+                        worklist.push(d);
+                    }
+                }
+            }
+        }
+    }
 
     // initalize all variables - TODO: I believe this should be inside of disassemble, no? E.g., creating a Function, then disassemble, is essentially a malformed object.
     {
@@ -109,25 +170,14 @@ pub fn phi_functions(func: &mut Function) -> Result<()> {
         let instrs = globals
             .iter()
             .map(
-                |nam| {
-                    let len = lens.get(nam).ok_or(format!("No length for variable {}", nam))?;
-
-                    Ok(
-                        Statement {
-                            op: Operation::Move(Rvalue::Undefined),
-                            assignee: Lvalue::Variable { size: *len, name: nam.clone(), subscript: None },
-                        }
-                    )
+                |v| {
+                    Statement {
+                        op: Operation::Move(Rvalue::Undefined),
+                        assignee: Lvalue::Variable { size: vars.size(v), name: vars.name(v).clone(), subscript: None },
+                    }
                 }
             )
             .collect::<Vec<_>>();
-
-        if instrs.iter().find(|x| x.is_err()).is_some() {
-            let e = instrs.into_iter().find(|x| x.is_err());
-            return Err(e.unwrap().err().unwrap());
-        }
-
-        let instrs = instrs.into_iter().map(|x| x.ok().unwrap()).collect::<Vec<_>>();
         let mne = Mnemonic::new(
             pos..pos,
             "__init".to_string(),
@@ -141,56 +191,42 @@ pub fn phi_functions(func: &mut Function) -> Result<()> {
         bb.mnemonics.insert(0, mne);
     }
 
-    let idom = immediate_dominator(func.entry_point_ref(), func.cfg());
-    if idom.len() != func.cfg().num_vertices() {
-        return Err("No all basic blocks are reachable from function entry point".into());
-    }
+    for (d, vs) in phis.into_iter().enumerate() {
+        if vs.is_empty() {
+            continue;
+        }
 
-    let df = dominance_frontiers(&idom, func.cfg());
-    let mut phis = HashSet::<(&Cow<'static, str>, ControlFlowRef)>::new();
-    let mut cfg = &mut func.cfg_mut();
+        let arg_num = sets.order.predecessors[d].len();
 
-    for v in globals.iter() {
-        let mut worklist = if let Some(wl) = usage.get(v) {
-            wl.clone()
-        } else {
-            HashSet::new()
-        };
-
-        while !worklist.is_empty() {
-            let w = worklist.iter().next().unwrap().clone();
-            let frontiers = df.get(&w).ok_or("Incomplete dominance frontier set")?;
-
-            worklist.remove(&w);
-            for d in frontiers.iter() {
-                let arg_num = cfg.in_edges(*d).filter_map(|p| usage.get(v).map(|b| b.contains(&cfg.source(p)))).count();
-                if let Some(&mut ControlFlowTarget::Resolved(ref mut bb)) = cfg.vertex_label_mut(*d) {
-                    if !phis.contains(&(v, *d)) {
-
-                        let pos = bb.area.start;
-                        let len = lens.get(v).ok_or(format!("No length for variable {}", v))?;
-                        let mne = Mnemonic::new(
+        if let Some(&mut ControlFlowTarget::Resolved(ref mut bb)) = func.vertex_label_mut(sets.order.blocks[d]) {
+            let pos = bb.area.start;
+            let mut mnes = vs.into_iter()
+                .map(
+                    |v| {
+                        let (name, len) = (vars.name(v), vars.size(v));
+
+                        Mnemonic::new(
                             pos..pos,
                             "__phi".to_string(),
                             "".to_string(),
                             vec![].iter(),
                             vec![
                                 Statement {
-                                    op: Operation::Phi(vec![Rvalue::Variable{ offset: 0, size: *len, name: v.clone(), subscript: None };arg_num]),
-                                    assignee: Lvalue::Variable { size: *len, name: v.clone(), subscript: None },
+                                    op: Operation::Phi(vec![Rvalue::Variable{ offset: 0, size: len, name: name.clone(), subscript: None };arg_num]),
+                                    assignee: Lvalue::Variable { size: len, name: name.clone(), subscript: None },
                                 },
                             ]
                                 .iter(),
                         )
                             .ok()
-                            .unwrap();
-
-                        bb.mnemonics.insert(0, mne);
-                        phis.insert((v, *d));
-                        worklist.insert(*d);
+                            .unwrap()
                     }
-                }
-            }
+                )
+                .collect::<Vec<_>>();
+            let rest = mem::replace(&mut bb.mnemonics, Vec::new());
+
+            mnes.extend(rest);
+            bb.mnemonics = mnes;
         }
     }
 
@@ -201,37 +237,84 @@ pub fn phi_functions(func: &mut Function) -> Result<()> {
 /// Cooper, Torczon: "Engineering a Compiler". The function expects that Phi functions to be
 /// already inserted.
 pub fn rename_variables(func: &mut Function) -> Result<()> {
-    let (globals, _) = global_names(func);
-    let mut stack = HashMap::<Cow<'static, str>, Vec<usize>>::from_iter(globals.iter().map(|x| (x.clone(), Vec::new())));
-    let mut counter = HashMap::<Cow<'static, str>, usize>::new();
-    let idom = immediate_dominator(func.entry_point_ref(), func.cfg());
+    let sets = BlockSets::new(func)?;
+    let idom = dense_dominators(func, &sets)?;
 
-    if idom.len() != func.cfg().num_vertices() {
-        return Err("No all basic blocks are reachable from function entry point".into());
+    rename(func, &sets, &idom)
+}
+
+/// Renaming state: a stack of subscripts and the next free subscript for each variable.
+struct Names<'a> {
+    variables: &'a Variables,
+    stack: Vec<Vec<usize>>,
+    counter: Vec<usize>,
+}
+
+impl<'a> Names<'a> {
+    fn new_name(&mut self, name: &str) -> Option<usize> {
+        self.variables.get(name).map(
+            |v| {
+                let i = self.counter[v];
+
+                self.counter[v] += 1;
+                self.stack[v].push(i);
+                i
+            }
+        )
     }
 
-    fn new_name(n: &Cow<'static, str>, counter: &mut HashMap<Cow<'static, str>, usize>, stack: &mut HashMap<Cow<'static, str>, Vec<usize>>) -> usize {
-        let i = *counter.entry(n.clone()).or_insert(0);
+    fn top(&self, name: &str) -> Option<usize> {
+        self.variables.get(name).and_then(|v| self.stack[v].last().cloned())
+    }
 
-        counter.get_mut(n).map(|x| *x += 1);
-        stack.entry(n.clone()).or_insert(Vec::new()).push(i);
+    fn pop(&mut self, name: &str) {
+        if let Some(v) = self.variables.get(name) {
+            self.stack[v].pop();
+        }
+    }
+}
 
-        i
+fn rename(func: &mut Function, sets: &BlockSets, idom: &[Option<usize>]) -> Result<()> {
+    let num = sets.order.blocks.len();
+    let mut names = Names { variables: &sets.variables, stack: vec![Vec::new(); sets.variables.len()], counter: vec![0; sets.variables.len()] };
+    let mut children = vec![Vec::<usize>::new(); num];
+    let entry = match sets.order.index.get(&func.entry_point_ref()) {
+        Some(&b) => b,
+        None => return Ok(()),
+    };
+
+    for (b, &d) in idom.iter().enumerate() {
+        if let (Some(d), true) = (d, b != entry) {
+            children[d].push(b);
+        }
     }
-    fn rename(
-        b: ControlFlowRef,
-        counter: &mut HashMap<Cow<'static, str>, usize>,
-        stack: &mut HashMap<Cow<'static, str>, Vec<usize>>,
-        cfg: &mut ControlFlowGraph,
-        idom: &HashMap<ControlFlowRef, ControlFlowRef>,
-    ) -> Result<()> {
-        if let Some(&mut ControlFlowTarget::Resolved(ref mut bb)) = cfg.vertex_label_mut(b) {
+
+    // walks the dominator tree. (b, false) renames b, (b, true) pops the names defined in b after
+    // all blocks dominated by b are done.
+    let mut todo = vec![(entry, false)];
+
+    while let Some((b, leave)) = todo.pop() {
+        let vx = sets.order.blocks[b];
+
+        if leave {
+            if let Some(&mut ControlFlowTarget::Resolved(ref mut bb)) = func.vertex_label_mut(vx) {
+                bb.execute(
+                    |i| match i {
+                        &Statement { assignee: Lvalue::Variable { ref name, .. }, .. } => names.pop(name),
+                        _ => {}
+                    }
+                );
+            }
+            continue;
+        }
+
+        if let Some(&mut ControlFlowTarget::Resolved(ref mut bb)) = func.vertex_label_mut(vx) {
             bb.rewrite(
                 |i| match i {
                     &mut Statement {
                         op: Operation::Phi(_),
                         assignee: Lvalue::Variable { ref name, ref mut subscript, .. },
-                    } => *subscript = Some(new_name(name, counter, stack)),
+                    } => *subscript = names.new_name(name),
                     _ => {}
                 }
             );
@@ -240,7 +323,7 @@ pub fn rename_variables(func: &mut Function) -> Result<()> {
                 if mne.opcode != "__phi" {
                     for o in mne.operands.iter_mut() {
                         if let &mut Rvalue::Variable { ref name, ref mut subscript, .. } = o {
-                            *subscript = stack.get(name).and_then(|x| x.last()).cloned();
+                            *subscript = names.top(name);
                         }
                     }
 
@@ -252,12 +335,12 @@ pub fn rename_variables(func: &mut Function) -> Result<()> {
                         } else {
                             for o in op.operands_mut() {
                                 if let &mut Rvalue::Variable { ref name, ref mut subscript, .. } = o {
-                                    *subscript = stack[name].last().cloned();
+                                    *subscript = names.top(name);
                                 }
                             }
 
                             if let &mut Lvalue::Variable { ref name, ref mut subscript, .. } = assignee {
-                                *subscript = Some(new_name(name, counter, stack));
+                                *subscript = names.new_name(name);
                             }
                         }
                     }
@@ -265,16 +348,16 @@ pub fn rename_variables(func: &mut Function) -> Result<()> {
             }
         }
 
-        let mut succ = cfg.out_edges(b).collect::<Vec<_>>();
+        let mut succ = func.cfg().out_edges(vx).collect::<Vec<_>>();
         succ.sort();
 
         for s in succ {
-            if let Some(&mut Guard::Predicate { flag: Rvalue::Variable { ref name, ref mut subscript, .. }, .. }) = cfg.edge_label_mut(s) {
-                *subscript = stack[name].last().cloned();
+            if let Some(&mut Guard::Predicate { flag: Rvalue::Variable { ref name, ref mut subscript, .. }, .. }) = func.edge_label_mut(s) {
+                *subscript = names.top(name);
             }
 
-            let v = cfg.target(s);
-            match cfg.vertex_label_mut(v) {
+            let v = func.cfg().target(s);
+            match func.vertex_label_mut(v) {
                 Some(&mut ControlFlowTarget::Resolved(ref mut bb)) => {
                     bb.rewrite(
                         |i| match i {
@@ -282,7 +365,7 @@ pub fn rename_variables(func: &mut Function) -> Result<()> {
                                 for o in ops.iter_mut() {
                                     if let &mut Rvalue::Variable { ref name, ref mut subscript, .. } = o {
                                         if subscript.is_none() {
-                                            *subscript = stack[name].last().cloned();
+                                            *subscript = names.top(name);
                                             break;
                                         }
                                     }
@@ -292,44 +375,33 @@ pub fn rename_variables(func: &mut Function) -> Result<()> {
                         }
                     );
                 }
-                Some(&mut ControlFlowTarget::Unresolved(Rvalue::Variable { ref name, ref mut subscript, .. })) => *subscript = stack[name].last().cloned(),
+                Some(&mut ControlFlowTarget::Unresolved(Rvalue::Variable { ref name, ref mut subscript, .. })) => *subscript = names.top(name),
                 _ => {}
             }
         }
 
-        for (k, _) in idom.iter().filter(|&(_, &v)| v == b) {
-            if *k != b {
-                rename(*k, counter, stack, cfg, idom)?;
-            }
+        todo.push((b, true));
+        for &c in children[b].iter().rev() {
+            todo.push((c, false));
         }
-
-        if let Some(&mut ControlFlowTarget::Resolved(ref mut bb)) = cfg.vertex_label_mut(b) {
-            bb.execute(
-                |i| match i {
-                    &Statement { assignee: Lvalue::Variable { ref name, .. }, .. } => {
-                        stack.get_mut(name).map(|x| x.pop());
-                    }
-                    _ => {}
-                }
-            );
-        }
-
-        Ok(())
     }
 
-    rename(
-        func.entry_point_ref(),
-        &mut counter,
-        &mut stack,
-        func.cfg_mut(),
-        &idom,
-    )
+    Ok(())
 }
 
-/// Convert `func` into semi-pruned SSA form.
+/// Convert `func` into semi-pruned SSA form. Fails if `func` wasn't lifted to RREIL yet.
 pub fn ssa_convertion(func: &mut Function) -> Result<()> {
-    phi_functions(func)?;
-    rename_variables(func)
+    if !func.is_lifted() {
+        return Err(format!("function {} has no RREIL code yet", func.name).into());
+    }
+
+    // Phi functions don't change the control flow graph or add variables, so the sets and
+    // dominators stay valid for renaming
+    let sets = BlockSets::new(func)?;
+    let idom = dense_dominators(func, &sets)?;
+
+    insert_phis(func, &sets)?;
+    rename(func, &sets, &idom)
 }
 
 /// Computes for every control flow guard the dependend RREIL operation via reverse data flow
@@ -375,19 +447,18 @@ mod tests {
     use super::*;
     use panopticon_core::{BasicBlock, ControlFlowGraph, ControlFlowTarget, Function, Guard, Lvalue, Mnemonic, Operation, Region, Rvalue, Statement};
     use panopticon_graph_algos::{GraphTrait, MutableGraphTrait, VertexListGraphTrait};
-    use std::borrow::Cow;
     use std::collections::HashSet;
 
     #[test]
     fn phi() {
-        let a = Lvalue::Variable { name: Cow::Borrowed("a"), size: 32, subscript: None };
-        let b = Lvalue::Variable { name: Cow::Borrowed("b"), size: 32, subscript: None };
-        let c = Lvalue::Variable { name: Cow::Borrowed("c"), size: 32, subscript: None };
-        let d = Lvalue::Variable { name: Cow::Borrowed("d"), size: 32, subscript: None };
-        let y = Lvalue::Variable { name: Cow::Borrowed("y"), size: 32, subscript: None };
-        let z = Lvalue::Variable { name: Cow::Borrowed("z"), size: 32, subscript: None };
-        let i = Lvalue::Variable { name: Cow::Borrowed("i"), size: 32, subscript: None };
-        let f = Lvalue::Variable { name: Cow::Borrowed("f"), size: 1, subscript: None };
+        let a = Lvalue::Variable { name: Name::new("a"), size: 32, subscript: None };
+        let b = Lvalue::Variable { name: Name::new("b"), size: 32, subscript: None };
+        let c = Lvalue::Variable { name: Name::new("c"), size: 32, subscript: None };
+        let d = Lvalue::Variable { name: Name::new("d"), size: 32, subscript: None };
+        let y = Lvalue::Variable { name: Name::new("y"), size: 32, subscript: None };
+        let z = Lvalue::Variable { name: Name::new("z"), size: 32, subscript: None };
+        let i = Lvalue::Variable { name: Name::new("i"), size: 32, subscript: None };
+        let f = Lvalue::Variable { name: Name::new("f"), size: 1, subscript: None };
 
         let mne0 = Mnemonic::new(
             0..1,
@@ -644,11 +715,11 @@ mod tests {
 
         assert!(phi_functions(&mut func).is_ok());
 
-        let a0 = Lvalue::Variable { name: Cow::Borrowed("a"), size: 32, subscript: None };
-        let b0 = Lvalue::Variable { name: Cow::Borrowed("b"), size: 32, subscript: None };
-        let c0 = Lvalue::Variable { name: Cow::Borrowed("c"), size: 32, subscript: None };
-        let d0 = Lvalue::Variable { name: Cow::Borrowed("d"), size: 32, subscript: None };
-        let i0 = Lvalue::Variable { name: Cow::Borrowed("i"), size: 32, subscript: None };
+        let a0 = Lvalue::Variable { name: Name::new("a"), size: 32, subscript: None };
+        let b0 = Lvalue::Variable { name: Name::new("b"), size: 32, subscript: None };
+        let c0 = Lvalue::Variable { name: Name::new("c"), size: 32, subscript: None };
+        let d0 = Lvalue::Variable { name: Name::new("d"), size: 32, subscript: None };
+        let i0 = Lvalue::Variable { name: Name::new("i"), size: 32, subscript: None };
 
         // bb0
         if let Some(&ControlFlowTarget::Resolved(ref bb)) = func.cfg().vertex_label(v0) {
@@ -754,14 +825,14 @@ mod tests {
 
     #[test]
     fn rename() {
-        let a = Lvalue::Variable { name: Cow::Borrowed("a"), size: 32, subscript: None };
-        let b = Lvalue::Variable { name: Cow::Borrowed("b"), size: 32, subscript: None };
-        let c = Lvalue::Variable { name: Cow::Borrowed("c"), size: 32, subscript: None };
-        let d = Lvalue::Variable { name: Cow::Borrowed("d"), size: 32, subscript: None };
-        let y = Lvalue::Variable { name: Cow::Borrowed("y"), size: 32, subscript: None };
-        let z = Lvalue::Variable { name: Cow::Borrowed("z"), size: 32, subscript: None };
-        let i = Lvalue::Variable { name: Cow::Borrowed("i"), size: 32, subscript: None };
-        let f = Lvalue::Variable { name: Cow::Borrowed("f"), size: 1, subscript: None };
+        let a = Lvalue::Variable { name: Name::new("a"), size: 32, subscript: None };
+        let b = Lvalue::Variable { name: Name::new("b"), size: 32, subscript: None };
+        let c = Lvalue::Variable { name: Name::new("c"), size: 32, subscript: None };
+        let d = Lvalue::Variable { name: Name::new("d"), size: 32, subscript: None };
+        let y = Lvalue::Variable { name: Name::new("y"), size: 32, subscript: None };
+        let z = Lvalue::Variable { name: Name::new("z"), size: 32, subscript: None };
+        let i = Lvalue::Variable { name: Name::new("i"), size: 32, subscript: None };
+        let f = Lvalue::Variable { name: Name::new("f"), size: 1, subscript: None };
 
         let mne0 = Mnemonic::new(
             0..1,
@@ -0,0 +1,130 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Interned variable names.
+//!
+//! The data flow algorithms number the variables of a function densely, so that sets of variables
+//! become bit vectors and maps from variables become plain vectors.
+
+use panopticon_core::Name;
+use std::cmp::max;
+use std::collections::HashMap;
+use std::hash::{BuildHasherDefault, Hasher};
+
+/// FNV-1a. Variable names are short register names, SipHash spends more time setting up than
+/// hashing them.
+#[derive(Clone,Copy)]
+pub struct NameHasher(u64);
+
+impl Default for NameHasher {
+    fn default() -> NameHasher {
+        NameHasher(0xcbf29ce484222325)
+    }
+}
+
+impl Hasher for NameHasher {
+    fn write(&mut self, bytes: &[u8]) {
+        for b in bytes {
+            self.0 ^= *b as u64;
+            self.0 = self.0.wrapping_mul(0x100000001b3);
+        }
+    }
+
+    fn finish(&self) -> u64 {
+        self.0
+    }
+}
+
+/// Maps the variable names of a function to dense IDs `0..len()`. Also records the largest size
+/// each variable is used with.
+#[derive(Clone,Debug,Default)]
+pub struct Variables {
+    names: Vec<Name>,
+    sizes: Vec<usize>,
+    ids: HashMap<Name, usize, BuildHasherDefault<NameHasher>>,
+}
+
+impl Variables {
+    /// Creates an empty table.
+    pub fn new() -> Variables {
+        Variables::default()
+    }
+
+    /// Returns the ID of `name`, assigning the next free one if `name` is new. Updates the maximal
+    /// size of the variable with `size`.
+    pub fn intern(&mut self, name: &Name, size: usize) -> usize {
+        if let Some(&id) = self.ids.get(name.as_ref()) {
+            self.sizes[id] = max(self.sizes[id], size);
+            return id;
+        }
+
+        let id = self.names.len();
+
+        self.names.push(name.clone());
+        self.sizes.push(size);
+        self.ids.insert(name.clone(), id);
+        id
+    }
+
+    /// ID of `name`, if known.
+    pub fn get(&self, name: &str) -> Option<usize> {
+        self.ids.get(name).cloned()
+    }
+
+    /// Name of variable `id`. Panics if `id` is out of range.
+    pub fn name(&self, id: usize) -> &Name {
+        &self.names[id]
+    }
+
+    /// Largest size in bits variable `id` was used with. Panics if `id` is out of range.
+    pub fn size(&self, id: usize) -> usize {
+        self.sizes[id]
+    }
+
+    /// Number of interned variables.
+    pub fn len(&self) -> usize {
+        self.names.len()
+    }
+
+    /// True if no variable was interned yet.
+    pub fn is_empty(&self) -> bool {
+        self.names.is_empty()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn intern() {
+        let mut vars = Variables::new();
+        let a = vars.intern(&Name::new("a"), 8);
+        let b = vars.intern(&Name::from("b".to_string()), 1);
+
+        assert_eq!((a, b), (0, 1));
+        assert_eq!(vars.intern(&Name::from("a".to_string()), 32), a);
+        assert_eq!(vars.intern(&Name::new("a"), 16), a);
+        assert_eq!(vars.len(), 2);
+        assert_eq!(vars.size(a), 32);
+        assert_eq!(vars.size(b), 1);
+        assert_eq!(vars.name(b), "b");
+        assert_eq!(vars.get("b"), Some(b));
+        assert_eq!(vars.get("c"), None);
+    }
+}
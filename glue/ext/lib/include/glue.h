@@ -52,6 +52,21 @@ struct SidebarItem {
 	const char* uuid;
 };
 
+struct SearchResult {
+	const char* kind;
+	const char* function;
+	const char* name;
+	uint64_t address;
+	const char* text;
+};
+
+struct StringItem {
+	uint64_t address;
+	const char* encoding;
+	const char* text;
+	uint32_t xrefs;
+};
+
 struct RecentSession {
 	const char* title;
 	const char* kind;
@@ -75,6 +90,12 @@ typedef int32_t (*SetValueForFunc)(const char* uuid, const char* variable, const
 typedef int32_t (*UndoFunc)();
 typedef int32_t (*RedoFunc)();
 
+// search
+typedef int32_t (*SearchFunc)(const char* query);
+
+// strings
+typedef int32_t (*FetchStringsFunc)(const char* prefix, uint32_t first, uint32_t count);
+
 class QSideBarItem : public QObject {
 	Q_OBJECT
 public:
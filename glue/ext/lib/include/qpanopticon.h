@@ -27,6 +27,8 @@
 #include <cstdint>
 
 #include "qsidebar.h"
+#include "qsearchresults.h"
+#include "qstrings.h"
 #include "qrecentsession.h"
 #include "glue.h"
 
@@ -53,6 +55,12 @@ public:
   Q_PROPERTY(unsigned int sidebarSortRole READ getSidebarSortRole WRITE setSidebarSortRole NOTIFY sidebarSortRoleChanged)
   Q_PROPERTY(bool sidebarSortAscending READ getSidebarSortAscending WRITE setSidebarSortAscending NOTIFY sidebarSortAscendingChanged)
 
+  // search
+  Q_PROPERTY(QSearchResults* searchResults READ getSearchResults NOTIFY searchResultsChanged)
+
+  // strings
+  Q_PROPERTY(QStrings* strings READ getStrings NOTIFY stringsChanged)
+
   // basic block metrics
   Q_PROPERTY(unsigned int basicBlockPadding READ getBasicBlockPadding NOTIFY basicBlockPaddingChanged)
   Q_PROPERTY(unsigned int basicBlockMargin READ getBasicBlockMargin NOTIFY basicBlockMarginChanged)
@@ -67,6 +75,8 @@ public:
 
   // tasks
   Q_PROPERTY(QString layoutTask READ getLayoutTask NOTIFY layoutTaskChanged)
+  // program name -> { "done": functions finished, "queued": functions found }
+  Q_PROPERTY(QVariantMap analysisProgress READ getAnalysisProgress NOTIFY analysisProgressChanged)
 
   bool hasRecentSessions(void) const;
   QString getCurrentSession(void) const;
@@ -77,6 +87,10 @@ public:
   unsigned int getSidebarSortRole(void) const;
   bool getSidebarSortAscending(void) const;
 
+  QSearchResults* getSearchResults(void) const;
+
+  QStrings* getStrings(void) const;
+
   int getBasicBlockPadding(void) const;
   int getBasicBlockMargin(void) const;
   int getBasicBlockLineHeight(void) const;
@@ -88,6 +102,7 @@ public:
   bool getCanRedo(void) const;
 
   QString getLayoutTask(void) const;
+  QVariantMap getAnalysisProgress(void) const;
 
   // C to Rust functions
   static SubscribeToFunc staticSubscribeTo;
@@ -99,6 +114,8 @@ public:
   static SetValueForFunc staticSetValueFor;
   static UndoFunc staticUndo;
   static RedoFunc staticRedo;
+  static SearchFunc staticSearch;
+  static FetchStringsFunc staticFetchStrings;
 
   // Singleton instance
   static QPanopticon* staticInstance;
@@ -120,6 +137,12 @@ public slots:
   int undo();
   int redo();
 
+  // search
+  int search(QString query);
+
+  // strings
+  int filterStrings(QString prefix);
+
   void setSidebarSortRole(unsigned int);
   void setSidebarSortAscending(bool);
 
@@ -127,6 +150,7 @@ public slots:
   void updateCurrentSession(QString path);
   void updateRecentSession(QRecentSession* sess);
   void updateLayoutTask(QString task);
+  void updateAnalysisProgress(QString program, unsigned int done, unsigned int queued);
 
 signals:
   void recentSessionsChanged(void);
@@ -138,6 +162,10 @@ signals:
   void sidebarSortRoleChanged(void);
   void sidebarSortAscendingChanged(void);
 
+  void searchResultsChanged(void);
+
+  void stringsChanged(void);
+
   void basicBlockPaddingChanged(void);
   void basicBlockMarginChanged(void);
   void basicBlockLineHeightChanged(void);
@@ -149,13 +177,17 @@ signals:
   void canRedoChanged(void);
 
   void layoutTaskChanged(void);
+  void analysisProgressChanged(void);
 
 protected:
   QVariantList m_recentSessions;
   QString m_currentSession;
   QSidebar* m_sidebar;
   QSortFilterProxyModel* m_sortedSidebar;
+  QSearchResults* m_searchResults;
+  QStrings* m_strings;
   bool m_canUndo;
   bool m_canRedo;
   QString m_layoutTask;
+  QVariantMap m_analysisProgress;
 };
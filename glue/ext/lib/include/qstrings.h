@@ -0,0 +1,70 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QAbstractListModel>
+#include <QModelIndex>
+#include <QVariant>
+#include <QVector>
+
+#include <tuple>
+#include <set>
+#include <unordered_map>
+
+#pragma once
+
+// Strings found in the memory image. Only the count of all strings matching the current prefix
+// is known up front, rows are fetched from the backend a page at a time when they're first shown.
+// Only the pages closest to the last one received are kept.
+class QStrings : public QAbstractListModel {
+	Q_OBJECT
+
+public:
+	static const unsigned int PageSize = 256;
+	static const unsigned int MaxPages = 64;
+
+	QStrings(QObject* parent = 0);
+	virtual ~QStrings();
+
+	Q_PROPERTY(QString prefix READ getPrefix NOTIFY prefixChanged)
+	Q_PROPERTY(unsigned int total READ getTotal NOTIFY totalChanged)
+
+	QString getPrefix(void) const;
+	unsigned int getTotal(void) const;
+
+	virtual int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	virtual QVariant data(const QModelIndex& idx, int role = Qt::DisplayRole) const override;
+	virtual QHash<int, QByteArray> roleNames(void) const override;
+
+public slots:
+	void reset(QString prefix);
+	void insert(QString prefix,unsigned int total,unsigned int first,QVector<qulonglong> addresses,
+	            QVector<QString> encodings,QVector<QString> texts,QVector<unsigned int> xrefs);
+
+signals:
+	void prefixChanged(void);
+	void totalChanged(void);
+
+protected:
+	void requestPage(unsigned int page) const;
+
+	QString m_prefix;
+	unsigned int m_total;
+	std::unordered_map<unsigned int,std::vector<std::tuple<qulonglong,QString,QString,unsigned int>>> m_pages;
+	mutable std::set<unsigned int> m_requested;
+};
@@ -143,6 +143,79 @@ extern "C" void update_sidebar_items(const SidebarItem** items) {
 	}
 }
 
+extern "C" void update_search_results(const char* query, const SearchResult** items) {
+	size_t idx = 0;
+	QPanopticon *panop = QPanopticon::staticInstance;
+	if(!panop) return;
+
+	QSearchResults *results = panop->getSearchResults();
+	QString query_str(query);
+
+	while(items && items[idx]) {
+		const SearchResult *item = items[idx];
+
+		results->metaObject()->invokeMethod(
+				results,
+				"insert",
+				Qt::QueuedConnection,
+				Q_ARG(QString,query_str),
+				Q_ARG(QString,QString(item->kind)),
+				Q_ARG(QString,QString(item->function)),
+				Q_ARG(QString,QString(item->name)),
+				Q_ARG(qulonglong,item->address),
+				Q_ARG(QString,QString(item->text)));
+		++idx;
+	}
+}
+
+extern "C" void update_strings(const char* prefix, uint32_t total, uint32_t first, const StringItem** items) {
+	QPanopticon *panop = QPanopticon::staticInstance;
+	if(!panop) return;
+
+	QStrings *strings = panop->getStrings();
+	QVector<qulonglong> addresses;
+	QVector<QString> encodings;
+	QVector<QString> texts;
+	QVector<unsigned int> xrefs;
+	size_t idx = 0;
+
+	while(items && items[idx]) {
+		const StringItem *item = items[idx];
+
+		addresses.append(item->address);
+		encodings.append(QString(item->encoding));
+		texts.append(QString(item->text));
+		xrefs.append(item->xrefs);
+		++idx;
+	}
+
+	strings->metaObject()->invokeMethod(
+			strings,
+			"insert",
+			Qt::QueuedConnection,
+			Q_ARG(QString,QString(prefix)),
+			Q_ARG(unsigned int,total),
+			Q_ARG(unsigned int,first),
+			Q_ARG(QVector<qulonglong>,addresses),
+			Q_ARG(QVector<QString>,encodings),
+			Q_ARG(QVector<QString>,texts),
+			Q_ARG(QVector<unsigned int>,xrefs));
+}
+
+extern "C" void update_analysis_progress(const char* program, uint32_t done, uint32_t queued) {
+	QPanopticon *panop = QPanopticon::staticInstance;
+
+	if(panop) {
+		panop->metaObject()->invokeMethod(
+				panop,
+				"updateAnalysisProgress",
+				Qt::QueuedConnection,
+				Q_ARG(QString,QString(program)),
+				Q_ARG(unsigned int,done),
+				Q_ARG(unsigned int,queued));
+	}
+}
+
 extern "C" void update_undo_redo(int8_t undo, int8_t redo) {
 	QPanopticon *panop = QPanopticon::staticInstance;
 
@@ -184,7 +257,8 @@ extern "C" void start_gui_loop(const char *dir, const char* f, const RecentSessi
 															 GetFunctionFunc gf, SubscribeToFunc st,
 															 OpenProgramFunc op, SaveSessionFunc ss,
 															 CommentOnFunc co, RenameFunctionFunc rf, SetValueForFunc svf,
-															 UndoFunc u, RedoFunc r) {
+															 UndoFunc u, RedoFunc r, SearchFunc s,
+															 FetchStringsFunc fs) {
 	int argc = 1;
 	char *argv[1] = { "Panopticon" };
 
@@ -201,6 +275,8 @@ extern "C" void start_gui_loop(const char *dir, const char* f, const RecentSessi
 	QPanopticon::staticSetValueFor = svf;
 	QPanopticon::staticUndo = u;
 	QPanopticon::staticRedo = r;
+	QPanopticon::staticSearch = s;
+	QPanopticon::staticFetchStrings = fs;
 	QPanopticon::staticInitialFile = QString(f);
 
 	for(size_t idx = 0; sess[idx]; ++idx) {
@@ -212,6 +288,7 @@ extern "C" void start_gui_loop(const char *dir, const char* f, const RecentSessi
 	qRegisterMetaType<QVector<QPointF>>();
 	qRegisterMetaType<QVector<unsigned int>>();
 	qRegisterMetaType<QVector<QString>>();
+	qRegisterMetaType<QVector<qulonglong>>();
 	qmlRegisterType<QControlFlowGraph>("Panopticon", 1, 0, "ControlFlowGraph");
 	qmlRegisterSingletonType<QPanopticon>("Panopticon", 1, 0, "Panopticon", qpanopticon_provider);
 
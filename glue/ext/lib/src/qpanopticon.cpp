@@ -41,13 +41,16 @@ RenameFunctionFunc QPanopticon::staticRenameFunction = nullptr;
 SetValueForFunc QPanopticon::staticSetValueFor = nullptr;
 UndoFunc QPanopticon::staticUndo = nullptr;
 RedoFunc QPanopticon::staticRedo = nullptr;
+SearchFunc QPanopticon::staticSearch = nullptr;
+FetchStringsFunc QPanopticon::staticFetchStrings = nullptr;
 QPanopticon* QPanopticon::staticInstance = nullptr;
 QString QPanopticon::staticInitialFile = QString();
 std::vector<QRecentSession*> QPanopticon::staticRecentSessions = {};
 
 QPanopticon::QPanopticon()
 : m_recentSessions(), m_currentSession(""),
-	m_sidebar(new QSidebar(this)), m_sortedSidebar(new QSortFilterProxyModel(this)), m_canUndo(false), m_canRedo(false)
+	m_sidebar(new QSidebar(this)), m_sortedSidebar(new QSortFilterProxyModel(this)),
+	m_searchResults(new QSearchResults(this)), m_strings(new QStrings(this)), m_canUndo(false), m_canRedo(false)
 {
   m_sortedSidebar->setSourceModel(m_sidebar);
 
@@ -68,6 +71,10 @@ QSortFilterProxyModel* QPanopticon::getSortedSidebar(void) const { return m_sort
 unsigned int QPanopticon::getSidebarSortRole(void) const { return m_sortedSidebar->sortRole(); }
 bool QPanopticon::getSidebarSortAscending(void) const { return m_sortedSidebar->sortOrder() == Qt::AscendingOrder; }
 
+QSearchResults* QPanopticon::getSearchResults(void) const { return m_searchResults; }
+
+QStrings* QPanopticon::getStrings(void) const { return m_strings; }
+
 int QPanopticon::getBasicBlockPadding(void) const { return 3; }
 int QPanopticon::getBasicBlockMargin(void) const { return 8; }
 int QPanopticon::getBasicBlockLineHeight(void) const { return 17; }
@@ -79,6 +86,7 @@ bool QPanopticon::getCanUndo(void) const { return m_canUndo; }
 bool QPanopticon::getCanRedo(void) const { return m_canRedo; }
 
 QString QPanopticon::getLayoutTask(void) const { return m_layoutTask; }
+QVariantMap QPanopticon::getAnalysisProgress(void) const { return m_analysisProgress; }
 
 void QPanopticon::setSidebarSortRole(unsigned int role) {
   m_sortedSidebar->setSortRole(role);
@@ -121,6 +129,16 @@ int QPanopticon::redo() {
 	return QPanopticon::staticRedo();
 }
 
+int QPanopticon::search(QString query) {
+	m_searchResults->reset(query);
+	return QPanopticon::staticSearch(query.toStdString().c_str());
+}
+
+int QPanopticon::filterStrings(QString prefix) {
+	m_strings->reset(prefix);
+	return QPanopticon::staticFetchStrings(prefix.toStdString().c_str(),0,QStrings::PageSize);
+}
+
 void QPanopticon::updateUndoRedo(bool undo, bool redo) {
 	m_canUndo = undo;
 	m_canRedo = redo;
@@ -144,3 +162,12 @@ void QPanopticon::updateLayoutTask(QString task) {
   m_layoutTask = task;
   emit layoutTaskChanged();
 }
+
+void QPanopticon::updateAnalysisProgress(QString program, unsigned int done, unsigned int queued) {
+  QVariantMap progress;
+
+  progress.insert("done", done);
+  progress.insert("queued", queued);
+  m_analysisProgress.insert(program, progress);
+  emit analysisProgressChanged();
+}
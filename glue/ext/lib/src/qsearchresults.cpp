@@ -0,0 +1,87 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDebug>
+#include "qsearchresults.h"
+
+QSearchResults::QSearchResults(QObject* parent) : QAbstractListModel(parent), m_query(""), m_items() {}
+
+QSearchResults::~QSearchResults() {}
+
+QString QSearchResults::getQuery(void) const { return m_query; }
+
+int QSearchResults::rowCount(const QModelIndex& parent) const {
+	return m_items.size();
+}
+
+QVariant QSearchResults::data(const QModelIndex& idx, int role) const {
+	if(idx.column() != 0 || idx.row() >= m_items.size())
+		return QVariant();
+
+	switch(role) {
+		case Qt::DisplayRole:
+		case Qt::UserRole:
+			return QVariant(std::get<4>(m_items[idx.row()]));
+		case Qt::UserRole + 1:
+			return QVariant(std::get<0>(m_items[idx.row()]));
+		case Qt::UserRole + 2:
+			return QVariant(std::get<1>(m_items[idx.row()]));
+		case Qt::UserRole + 3:
+			return QVariant(std::get<2>(m_items[idx.row()]));
+		case Qt::UserRole + 4:
+			return QVariant(QString("0x%1").arg(std::get<3>(m_items[idx.row()]),0,16));
+		case Qt::UserRole + 5:
+			return QVariant(std::get<3>(m_items[idx.row()]));
+		default:
+			return QVariant();
+	}
+}
+
+QHash<int, QByteArray> QSearchResults::roleNames(void) const {
+	QHash<int, QByteArray> ret;
+
+	ret.insert(Qt::UserRole, QByteArray("text"));
+	ret.insert(Qt::UserRole + 1, QByteArray("kind"));
+	ret.insert(Qt::UserRole + 2, QByteArray("uuid"));
+	ret.insert(Qt::UserRole + 3, QByteArray("name"));
+	ret.insert(Qt::UserRole + 4, QByteArray("address"));
+	ret.insert(Qt::UserRole + 5, QByteArray("offset"));
+
+	return ret;
+}
+
+void QSearchResults::reset(QString query) {
+	beginResetModel();
+	m_items.clear();
+	m_query = query;
+	endResetModel();
+
+	emit queryChanged();
+}
+
+void QSearchResults::insert(QString query,QString kind,QString uuid,QString name,qulonglong address,QString text) {
+	// results of an older query still in the event queue
+	if(query != m_query)
+		return;
+
+	size_t idx = m_items.size();
+
+	beginInsertRows(QModelIndex(), idx, idx);
+	m_items.push_back(std::make_tuple(kind,uuid,name,address,text));
+	endInsertRows();
+}
@@ -0,0 +1,145 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDebug>
+#include <cstdlib>
+#include "qstrings.h"
+#include "qpanopticon.h"
+
+QStrings::QStrings(QObject* parent) : QAbstractListModel(parent), m_prefix(""), m_total(0), m_pages(), m_requested() {}
+
+QStrings::~QStrings() {}
+
+QString QStrings::getPrefix(void) const { return m_prefix; }
+unsigned int QStrings::getTotal(void) const { return m_total; }
+
+int QStrings::rowCount(const QModelIndex& parent) const {
+	return m_total;
+}
+
+QVariant QStrings::data(const QModelIndex& idx, int role) const {
+	if(idx.column() != 0 || idx.row() < 0 || static_cast<unsigned int>(idx.row()) >= m_total)
+		return QVariant();
+
+	unsigned int page = idx.row() / PageSize;
+	unsigned int row = idx.row() % PageSize;
+	auto iter = m_pages.find(page);
+
+	if(iter == m_pages.end()) {
+		requestPage(page);
+		return QVariant();
+	}
+
+	if(row >= iter->second.size())
+		return QVariant();
+
+	auto const& item = iter->second[row];
+
+	switch(role) {
+		case Qt::DisplayRole:
+		case Qt::UserRole:
+			return QVariant(std::get<2>(item));
+		case Qt::UserRole + 1:
+			return QVariant(QString("0x%1").arg(std::get<0>(item),0,16));
+		case Qt::UserRole + 2:
+			return QVariant(std::get<0>(item));
+		case Qt::UserRole + 3:
+			return QVariant(std::get<1>(item));
+		case Qt::UserRole + 4:
+			return QVariant(std::get<3>(item));
+		default:
+			return QVariant();
+	}
+}
+
+QHash<int, QByteArray> QStrings::roleNames(void) const {
+	QHash<int, QByteArray> ret;
+
+	ret.insert(Qt::UserRole, QByteArray("text"));
+	ret.insert(Qt::UserRole + 1, QByteArray("address"));
+	ret.insert(Qt::UserRole + 2, QByteArray("offset"));
+	ret.insert(Qt::UserRole + 3, QByteArray("encoding"));
+	ret.insert(Qt::UserRole + 4, QByteArray("xrefs"));
+
+	return ret;
+}
+
+void QStrings::requestPage(unsigned int page) const {
+	// already on its way
+	if(!m_requested.insert(page).second)
+		return;
+
+	if(QPanopticon::staticFetchStrings)
+		QPanopticon::staticFetchStrings(m_prefix.toStdString().c_str(),page * PageSize,PageSize);
+}
+
+void QStrings::reset(QString prefix) {
+	beginResetModel();
+	m_pages.clear();
+	m_requested.clear();
+	m_total = 0;
+	m_prefix = prefix;
+	endResetModel();
+
+	emit prefixChanged();
+	emit totalChanged();
+}
+
+void QStrings::insert(QString prefix,unsigned int total,unsigned int first,QVector<qulonglong> addresses,
+                      QVector<QString> encodings,QVector<QString> texts,QVector<unsigned int> xrefs) {
+	// rows for an older prefix still in the event queue
+	if(prefix != m_prefix)
+		return;
+
+	// the backend found new strings, all cached rows are stale
+	if(total != m_total) {
+		beginResetModel();
+		m_pages.clear();
+		m_requested.clear();
+		m_total = total;
+		endResetModel();
+
+		emit totalChanged();
+	}
+
+	unsigned int page = first / PageSize;
+	std::vector<std::tuple<qulonglong,QString,QString,unsigned int>> rows;
+
+	for(int idx = 0; idx < addresses.size(); ++idx) {
+		rows.push_back(std::make_tuple(addresses[idx],encodings[idx],texts[idx],xrefs[idx]));
+	}
+
+	m_requested.erase(page);
+	m_pages[page] = std::move(rows);
+
+	// drop the pages farthest away from the one just received
+	while(m_pages.size() > MaxPages) {
+		auto victim = m_pages.begin();
+
+		for(auto iter = m_pages.begin(); iter != m_pages.end(); ++iter) {
+			if(std::abs(static_cast<long>(iter->first) - static_cast<long>(page)) >
+			   std::abs(static_cast<long>(victim->first) - static_cast<long>(page)))
+				victim = iter;
+		}
+
+		m_pages.erase(victim);
+	}
+
+	if(!addresses.empty())
+		emit dataChanged(index(first),index(first + addresses.size() - 1));
+}
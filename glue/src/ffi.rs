@@ -16,7 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-use types::{CBasicBlockLine, CRecentSession, CSidebarItem};
+use types::{CBasicBlockLine, CRecentSession, CSearchResult, CSidebarItem, CStringItem};
 
 extern "C" {
     pub fn start_gui_loop(
@@ -32,6 +32,8 @@ extern "C" {
         set_value_for: extern "C" fn(*const i8, *const i8, *const i8) -> i32,
         undo: extern "C" fn() -> i32,
         redo: extern "C" fn() -> i32,
+        search: extern "C" fn(*const i8) -> i32,
+        fetch_strings: extern "C" fn(*const i8, u32, u32) -> i32,
     );
 
     // thread-safe
@@ -53,6 +55,15 @@ extern "C" {
     // thread-safe
     pub fn update_sidebar_items(items: *const *const CSidebarItem);
 
+    // thread-safe
+    pub fn update_search_results(query: *const i8, items: *const *const CSearchResult);
+
+    // thread-safe
+    pub fn update_strings(prefix: *const i8, total: u32, first: u32, items: *const *const CStringItem);
+
+    // thread-safe
+    pub fn update_analysis_progress(program: *const i8, done: u32, queued: u32);
+
     // thread-safe
     pub fn update_undo_redo(undo: i8, redo: i8);
 
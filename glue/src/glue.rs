@@ -17,12 +17,13 @@
  */
 
 use errors::*;
-use ffi::{start_gui_loop, update_current_session, update_function_edges, update_function_node, update_layout_task, update_sidebar_items, update_undo_redo};
+use ffi::{start_gui_loop, update_analysis_progress, update_current_session, update_function_edges, update_function_node, update_layout_task, update_search_results, update_sidebar_items, update_strings,
+          update_undo_redo};
 use panopticon_core::Function;
 use std::ffi::{CStr, CString};
 use std::path::{Path, PathBuf};
 use std::ptr;
-use types::{CBasicBlockLine, CRecentSession, CSidebarItem};
+use types::{CBasicBlockLine, CRecentSession, CSearchResult, CSidebarItem, CStringItem};
 
 use uuid::Uuid;
 
@@ -34,6 +35,8 @@ pub trait Glue {
     fn comment_on(address: u64, comment: &str) -> Result<()>;
     fn rename_function(uuid: &Uuid, name: &str) -> Result<()>;
     fn set_value_for(uuid: &Uuid, variable: &str, value: &str) -> Result<()>;
+    fn search(query: &str) -> Result<()>;
+    fn fetch_strings(prefix: &str, first: u32, count: u32) -> Result<()>;
     fn undo() -> Result<()>;
     fn redo() -> Result<()>;
 
@@ -59,6 +62,8 @@ pub trait Glue {
                 Self::set_value_for_plumbing,
                 Self::undo_plumbing,
                 Self::redo_plumbing,
+                Self::search_plumbing,
+                Self::fetch_strings_plumbing,
             );
         }
 
@@ -127,6 +132,36 @@ pub trait Glue {
         Ok(())
     }
 
+    fn send_search_results(query: &CString, results: &[CSearchResult]) -> Result<()> {
+        let mut ptrs: Vec<*const CSearchResult> = results.iter().map(|i| -> *const CSearchResult { i }).collect();
+
+        ptrs.push(ptr::null());
+        unsafe {
+            update_search_results(query.as_ptr(), ptrs.as_slice().as_ptr());
+        }
+
+        Ok(())
+    }
+
+    fn send_strings(prefix: &CString, total: u32, first: u32, items: &[CStringItem]) -> Result<()> {
+        let mut ptrs: Vec<*const CStringItem> = items.iter().map(|i| -> *const CStringItem { i }).collect();
+
+        ptrs.push(ptr::null());
+        unsafe {
+            update_strings(prefix.as_ptr(), total, first, ptrs.as_slice().as_ptr());
+        }
+
+        Ok(())
+    }
+
+    fn send_analysis_progress(program: &CString, done: u32, queued: u32) -> Result<()> {
+        unsafe {
+            update_analysis_progress(program.as_ptr(), done, queued);
+        }
+
+        Ok(())
+    }
+
     fn send_undo_redo_update(undo: bool, redo: bool) -> Result<()> {
         unsafe {
             update_undo_redo(if undo { 1 } else { 0 }, if redo { 1 } else { 0 });
@@ -263,6 +298,28 @@ pub trait Glue {
         }
     }
 
+    extern "C" fn search_plumbing(query: *const i8) -> i32 {
+        let query = unsafe { CStr::from_ptr(query) }.to_string_lossy().to_string();
+        match Self::search(&query) {
+            Ok(()) => 0,
+            Err(s) => {
+                error!("search(): {}", s);
+                -1
+            }
+        }
+    }
+
+    extern "C" fn fetch_strings_plumbing(prefix: *const i8, first: u32, count: u32) -> i32 {
+        let prefix = unsafe { CStr::from_ptr(prefix) }.to_string_lossy().to_string();
+        match Self::fetch_strings(&prefix, first, count) {
+            Ok(()) => 0,
+            Err(s) => {
+                error!("fetch_strings(): {}", s);
+                -1
+            }
+        }
+    }
+
     extern "C" fn undo_plumbing() -> i32 {
         match Self::undo() {
             Ok(()) => 0,
@@ -45,4 +45,4 @@ mod glue;
 pub use glue::Glue;
 
 mod types;
-pub use types::{CBasicBlockLine, CBasicBlockOperand};
+pub use types::{CBasicBlockLine, CBasicBlockOperand, CSearchResult, CStringItem};
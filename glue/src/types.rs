@@ -139,6 +139,78 @@ impl Drop for CBasicBlockLine {
     }
 }
 
+#[repr(C)]
+pub struct CSearchResult {
+    kind: *const i8,
+    function: *const i8,
+    name: *const i8,
+    address: u64,
+    text: *const i8,
+}
+
+impl CSearchResult {
+    pub fn new(kind: String, function: String, name: String, address: u64, text: String) -> Result<CSearchResult> {
+        let kind = CString::new(kind.into_bytes())?;
+        let function = CString::new(function.into_bytes())?;
+        let name = CString::new(name.into_bytes())?;
+        let text = CString::new(text.into_bytes())?;
+
+        Ok(
+            CSearchResult {
+                kind: kind.into_raw(),
+                function: function.into_raw(),
+                name: name.into_raw(),
+                address: address,
+                text: text.into_raw(),
+            }
+        )
+    }
+}
+
+impl Drop for CSearchResult {
+    fn drop(&mut self) {
+        unsafe {
+            CString::from_raw(self.kind as *mut i8);
+            CString::from_raw(self.function as *mut i8);
+            CString::from_raw(self.name as *mut i8);
+            CString::from_raw(self.text as *mut i8);
+        }
+    }
+}
+
+#[repr(C)]
+pub struct CStringItem {
+    address: u64,
+    encoding: *const i8,
+    text: *const i8,
+    xrefs: u32,
+}
+
+impl CStringItem {
+    pub fn new(address: u64, encoding: String, text: String, xrefs: u32) -> Result<CStringItem> {
+        let encoding = CString::new(encoding.into_bytes())?;
+        let text = CString::new(text.into_bytes())?;
+
+        Ok(
+            CStringItem {
+                address: address,
+                encoding: encoding.into_raw(),
+                text: text.into_raw(),
+                xrefs: xrefs,
+            }
+        )
+    }
+}
+
+impl Drop for CStringItem {
+    fn drop(&mut self) {
+        unsafe {
+            CString::from_raw(self.encoding as *mut i8);
+            CString::from_raw(self.text as *mut i8);
+        }
+    }
+}
+
 #[repr(C)]
 pub struct CRecentSession {
     title: *const i8,
@@ -0,0 +1,111 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Compares traversals of adjacency lists and compressed graphs.
+//!
+//! Usage: cargo run --release --example freeze [BLOCKS]
+//!
+//! Builds a graph shaped like a control flow graph with BLOCKS vertices (default: 100000) and
+//! prints how long freezing it and running common algorithms on both representations takes.
+
+extern crate panopticon_graph_algos;
+
+use panopticon_graph_algos::{AdjacencyList, BidirectionalGraphTrait, CompressedGraph, GraphTrait, IncidenceGraphTrait, MutableGraphTrait, VertexListGraphTrait};
+use panopticon_graph_algos::dominator::immediate_dominator;
+use panopticon_graph_algos::order::weak_topo_order;
+use std::env;
+use std::fmt::Debug;
+use std::time::Instant;
+
+fn seconds(start: Instant) -> f64 {
+    let d = start.elapsed();
+
+    d.as_secs() as f64 + d.subsec_nanos() as f64 * 1e-9
+}
+
+/// Sums the vertex labels in depth first order, a stand-in for a data flow pass.
+fn walk<'a, G: 'a + GraphTrait<'a, usize, ()> + IncidenceGraphTrait<'a, usize, ()>>(root: G::Vertex, graph: &'a G, num: usize, index: &Fn(G::Vertex) -> usize) -> usize {
+    let mut seen = vec![false; num];
+    let mut todo = vec![root];
+    let mut ret = 0;
+
+    while let Some(vx) = todo.pop() {
+        if !seen[index(vx)] {
+            seen[index(vx)] = true;
+            ret += *graph.vertex_label(vx).unwrap();
+            todo.extend(graph.out_edges(vx).map(|e| graph.target(e)));
+        }
+    }
+
+    ret
+}
+
+fn run<'a, G>(name: &str, root: G::Vertex, graph: &'a G, index: &Fn(G::Vertex) -> usize)
+where
+    G: 'a + GraphTrait<'a, usize, ()> + IncidenceGraphTrait<'a, usize, ()> + VertexListGraphTrait<'a, usize, ()> + BidirectionalGraphTrait<'a, usize, ()>,
+    G::Vertex: Debug,
+{
+    let num = graph.num_vertices();
+    let start = Instant::now();
+
+    for _ in 0..10 {
+        walk(root, graph, num, index);
+    }
+
+    let walk_time = seconds(start);
+    let start = Instant::now();
+
+    immediate_dominator(root, graph);
+
+    let dom_time = seconds(start);
+    let start = Instant::now();
+
+    weak_topo_order(root, graph);
+
+    let wto_time = seconds(start);
+
+    println!("{:>16} {:>10.3} {:>10.3} {:>10.3}", name, walk_time, dom_time, wto_time);
+}
+
+fn main() {
+    let num = env::args().nth(1).and_then(|x| x.parse::<usize>().ok()).unwrap_or(100_000);
+    let mut list = AdjacencyList::<usize, ()>::new();
+    let vertices = (0..num).map(|i| list.add_vertex(i)).collect::<Vec<_>>();
+
+    // if-then-else diamonds inside small loops
+    for i in 0..num {
+        if i + 1 < num {
+            list.add_edge((), vertices[i], vertices[i + 1]);
+        }
+        if i % 4 == 0 && i + 2 < num {
+            list.add_edge((), vertices[i], vertices[i + 2]);
+        }
+        if i % 16 == 15 {
+            list.add_edge((), vertices[i], vertices[i - 15]);
+        }
+    }
+
+    let start = Instant::now();
+    let (frozen, _) = CompressedGraph::freeze(list.clone());
+
+    println!("froze {} vertices in {:.3}s", num, seconds(start));
+    println!("{:>16} {:>10} {:>10} {:>10}", "graph", "10x walk", "dominator", "wto");
+
+    run("adjacency list", vertices[0], &list, &|vx| vx.0);
+    run("compressed", frozen.vertex(0).unwrap(), &frozen, &|vx| vx.0);
+}
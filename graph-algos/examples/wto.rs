@@ -0,0 +1,132 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Stress test for the weak topological ordering.
+//!
+//! Usage: cargo run --release --example wto [BLOCKS]
+//!
+//! Builds synthetic control flow graphs with BLOCKS vertices (default: 100000) and prints the
+//! time `weak_topo_order` needs for each.
+
+extern crate panopticon_graph_algos;
+
+use panopticon_graph_algos::{AdjacencyList, MutableGraphTrait};
+use panopticon_graph_algos::adjacency_list::AdjacencyListVertexDescriptor;
+use panopticon_graph_algos::order::{HierarchicalOrdering, weak_topo_order};
+use std::cmp::{max, min};
+use std::env;
+use std::time::Instant;
+
+/// Builds a graph with `num` vertices and the edges `edges` returns for each vertex index.
+/// Returns the graph and its first vertex.
+fn graph<F: Fn(usize) -> Vec<usize>>(num: usize, edges: F) -> (AdjacencyList<usize, ()>, AdjacencyListVertexDescriptor) {
+    let mut g = AdjacencyList::new();
+    let vertices = (0..num).map(|i| g.add_vertex(i)).collect::<Vec<_>>();
+
+    for (i, &vx) in vertices.iter().enumerate() {
+        for j in edges(i) {
+            g.add_edge((), vx, vertices[j]);
+        }
+    }
+
+    (g, vertices[0])
+}
+
+/// Number of components and depth of the deepest one.
+fn shape<T: Clone>(h: &HierarchicalOrdering<T>) -> (usize, usize) {
+    let mut todo = vec![(h, 0)];
+    let mut ret = (0, 0);
+
+    while let Some((h, depth)) = todo.pop() {
+        if let &HierarchicalOrdering::Component(ref v) = h {
+            ret.0 += 1;
+            ret.1 = max(ret.1, depth);
+            todo.extend(v.iter().map(|x| (&**x, depth + 1)));
+        }
+    }
+
+    ret
+}
+
+fn main() {
+    let num = env::args().nth(1).and_then(|x| x.parse::<usize>().ok()).unwrap_or(100_000);
+    let nesting = min(100, num / 2);
+    let graphs = vec![
+        // one loop spanning all blocks. The depth first search goes num levels deep
+        ("chain", graph(num, |i| if i + 1 < num { vec![i + 1] } else { vec![1] })),
+        // `nesting` loops nested into each other
+        (
+            "nested",
+            graph(
+                num,
+                |i| {
+                    let mut ret = vec![];
+
+                    if i + 1 < num {
+                        ret.push(i + 1);
+                    }
+                    if i >= num - nesting {
+                        ret.push(num - 1 - i);
+                    }
+                    ret
+                }
+            ),
+        ),
+        // control flow flattening: a dispatcher jumps to all blocks, each jumps back
+        ("flattened", graph(num, |i| if i == 0 { (1..num).collect() } else { vec![0] })),
+        // if-then-else diamonds inside small loops of 16 blocks
+        (
+            "diamonds",
+            graph(
+                num,
+                |i| {
+                    let mut ret = vec![];
+
+                    if i + 1 < num {
+                        ret.push(i + 1);
+                    }
+                    if i % 4 == 0 && i + 2 < num {
+                        ret.push(i + 2);
+                    }
+                    if i % 16 == 15 {
+                        ret.push(i - 15);
+                    }
+                    ret
+                }
+            ),
+        ),
+    ];
+
+    println!("{:>10} {:>10} {:>12} {:>8} {:>10}", "graph", "blocks", "components", "depth", "seconds");
+
+    for (name, (g, root)) in graphs {
+        let start = Instant::now();
+        let wto = weak_topo_order(root, &g);
+        let time = start.elapsed();
+        let (comps, depth) = shape(&wto);
+
+        println!(
+            "{:>10} {:>10} {:>12} {:>8} {:>10.3}",
+            name,
+            num,
+            comps,
+            depth,
+            time.as_secs() as f64 + time.subsec_nanos() as f64 * 1e-9
+        );
+    }
+}
@@ -0,0 +1,410 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Immutable graphs in compressed sparse row format.
+//!
+//! A `CompressedGraph` stores vertex and edge labels in two vectors. Edges are sorted by their
+//! source vertex, so the outgoing edges of a vertex are a contiguous range of edge numbers.
+//! Incoming edges are a contiguous slice of a second array. Graphs that are finished and only
+//! read afterwards can be frozen into this format to save memory and make traversals cache
+//! friendly.
+
+use adjacency_list::{AdjacencyList, AdjacencyListVertexDescriptor};
+use std;
+use std::collections::HashMap;
+use std::ops::Range;
+use traits::*;
+
+#[derive(PartialEq,Eq,Hash,Copy,Clone,Debug,PartialOrd,Ord,Serialize,Deserialize)]
+pub struct CompressedGraphVertexDescriptor(pub usize);
+
+#[derive(PartialEq,Eq,Hash,Copy,Clone,Debug,PartialOrd,Ord,Serialize,Deserialize)]
+pub struct CompressedGraphEdgeDescriptor(pub usize);
+
+#[derive(Clone,Debug,Serialize,Deserialize)]
+pub struct CompressedGraph<V, E> {
+    vertex_labels: Vec<V>,
+    /// Edge labels, sorted by source vertex.
+    edge_labels: Vec<E>,
+    /// Source and target vertex of each edge.
+    edges: Vec<(u32, u32)>,
+    /// The outgoing edges of vertex `v` are `out_offsets[v]..out_offsets[v + 1]`.
+    out_offsets: Vec<u32>,
+    /// The incoming edges of vertex `v` are `in_edges[in_offsets[v]..in_offsets[v + 1]]`.
+    in_offsets: Vec<u32>,
+    in_edges: Vec<u32>,
+}
+
+impl<V, E> CompressedGraph<V, E> {
+    /// Builds a graph from labeled vertices and `(label, from, to)` edges. Edges with the same
+    /// source keep their relative order. Panics if an edge references a vertex that doesn't exist
+    /// or the graph has more than 2^32 vertices or edges.
+    pub fn new(vertices: Vec<V>, edges: Vec<(E, usize, usize)>) -> Self {
+        let num_vx = vertices.len();
+        let num_e = edges.len();
+
+        assert!(num_vx < u32::max_value() as usize && num_e < u32::max_value() as usize);
+
+        // counting sort by source vertex
+        let mut out_offsets = vec![0u32; num_vx + 1];
+        let mut in_offsets = vec![0u32; num_vx + 1];
+
+        for &(_, from, to) in edges.iter() {
+            assert!(from < num_vx && to < num_vx);
+            out_offsets[from + 1] += 1;
+            in_offsets[to + 1] += 1;
+        }
+
+        for v in 0..num_vx {
+            out_offsets[v + 1] += out_offsets[v];
+            in_offsets[v + 1] += in_offsets[v];
+        }
+
+        let mut slots = out_offsets.clone();
+        let mut sorted = (0..num_e).map(|_| None).collect::<Vec<Option<(E, u32, u32)>>>();
+
+        for (lb, from, to) in edges {
+            let i = slots[from] as usize;
+
+            slots[from] += 1;
+            sorted[i] = Some((lb, from as u32, to as u32));
+        }
+
+        let mut edge_labels = Vec::with_capacity(num_e);
+        let mut edges = Vec::with_capacity(num_e);
+
+        for e in sorted {
+            let (lb, from, to) = e.unwrap();
+
+            edge_labels.push(lb);
+            edges.push((from, to));
+        }
+
+        let mut slots = in_offsets.clone();
+        let mut in_edges = vec![0u32; num_e];
+
+        for (i, &(_, to)) in edges.iter().enumerate() {
+            in_edges[slots[to as usize] as usize] = i as u32;
+            slots[to as usize] += 1;
+        }
+
+        CompressedGraph {
+            vertex_labels: vertices,
+            edge_labels: edge_labels,
+            edges: edges,
+            out_offsets: out_offsets,
+            in_offsets: in_offsets,
+            in_edges: in_edges,
+        }
+    }
+
+    /// Freezes `graph`. Vertices are numbered in the order of their descriptors, the returned
+    /// vector maps the new vertex numbers to the old descriptors. Outgoing edges keep their order.
+    pub fn freeze(mut graph: AdjacencyList<V, E>) -> (Self, Vec<AdjacencyListVertexDescriptor>) {
+        let mut descs = graph.vertices().collect::<Vec<_>>();
+
+        descs.sort();
+
+        let index = descs.iter().enumerate().map(|(i, &vx)| (vx, i)).collect::<HashMap<_, _>>();
+        let mut edges = Vec::with_capacity(graph.num_edges());
+
+        for &vx in descs.iter() {
+            for e in graph.out_edges(vx).collect::<Vec<_>>() {
+                let to = index[&graph.target(e)];
+
+                if let Some(lb) = graph.remove_edge(e) {
+                    edges.push((lb, index[&vx], to));
+                }
+            }
+        }
+
+        let vertices = descs.iter().filter_map(|&vx| graph.remove_vertex(vx)).collect::<Vec<_>>();
+
+        (CompressedGraph::new(vertices, edges), descs)
+    }
+
+    /// Vertex number `i`.
+    pub fn vertex(&self, i: usize) -> Option<CompressedGraphVertexDescriptor> {
+        if i < self.vertex_labels.len() { Some(CompressedGraphVertexDescriptor(i)) } else { None }
+    }
+}
+
+impl<V: Clone, E: Clone> CompressedGraph<V, E> {
+    /// Copies `graph`. Vertices are numbered in the order of their descriptors, the returned
+    /// vector maps the new vertex numbers to the vertices of `graph`. Outgoing edges keep their
+    /// order.
+    pub fn from_graph<'a, G>(graph: &'a G) -> (Self, Vec<G::Vertex>)
+    where
+        V: 'a,
+        E: 'a,
+        G: 'a + Graph<'a, V, E> + IncidenceGraph<'a, V, E> + VertexListGraph<'a, V, E> + EdgeListGraph<'a, V, E>,
+    {
+        let mut descs = graph.vertices().collect::<Vec<_>>();
+
+        descs.sort();
+
+        let index = descs.iter().enumerate().map(|(i, &vx)| (vx, i)).collect::<HashMap<_, _>>();
+        let mut edges = Vec::with_capacity(graph.num_edges());
+
+        for (i, &vx) in descs.iter().enumerate() {
+            for e in graph.out_edges(vx) {
+                if let Some(lb) = graph.edge_label(e) {
+                    edges.push((lb.clone(), i, index[&graph.target(e)]));
+                }
+            }
+        }
+
+        let vertices = descs.iter().filter_map(|&vx| graph.vertex_label(vx).cloned()).collect::<Vec<_>>();
+
+        (CompressedGraph::new(vertices, edges), descs)
+    }
+}
+
+impl<'a, V, E> Graph<'a, V, E> for CompressedGraph<V, E> {
+    type Vertex = CompressedGraphVertexDescriptor;
+    type Edge = CompressedGraphEdgeDescriptor;
+
+    #[inline]
+    fn vertex_label(&self, n: Self::Vertex) -> Option<&V> {
+        self.vertex_labels.get(n.0)
+    }
+
+    fn edge_label(&self, e: Self::Edge) -> Option<&E> {
+        self.edge_labels.get(e.0)
+    }
+
+    fn source(&self, e: Self::Edge) -> Self::Vertex {
+        CompressedGraphVertexDescriptor(self.edges[e.0].0 as usize)
+    }
+
+    fn target(&self, e: Self::Edge) -> Self::Vertex {
+        CompressedGraphVertexDescriptor(self.edges[e.0].1 as usize)
+    }
+}
+
+/// Outgoing or incoming edges of a vertex.
+#[derive(Clone,Debug)]
+pub enum CompressedGraphIncidence<'a> {
+    /// Outgoing edges are numbered consecutively.
+    Out(Range<usize>),
+    /// Incoming edges are listed in a separate array.
+    In(std::slice::Iter<'a, u32>),
+}
+
+impl<'a> Iterator for CompressedGraphIncidence<'a> {
+    type Item = CompressedGraphEdgeDescriptor;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        let e = match self {
+            &mut CompressedGraphIncidence::Out(ref mut r) => r.next(),
+            &mut CompressedGraphIncidence::In(ref mut i) => i.next().map(|&e| e as usize),
+        };
+
+        e.map(CompressedGraphEdgeDescriptor)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        match self {
+            &CompressedGraphIncidence::Out(ref r) => r.size_hint(),
+            &CompressedGraphIncidence::In(ref i) => i.size_hint(),
+        }
+    }
+}
+
+impl<'a, V, E> IncidenceGraph<'a, V, E> for CompressedGraph<V, E> {
+    type Incidence = CompressedGraphIncidence<'a>;
+
+    fn out_degree(&self, v: Self::Vertex) -> usize {
+        (self.out_offsets[v.0 + 1] - self.out_offsets[v.0]) as usize
+    }
+
+    fn out_edges(&'a self, v: Self::Vertex) -> Self::Incidence {
+        CompressedGraphIncidence::Out(self.out_offsets[v.0] as usize..self.out_offsets[v.0 + 1] as usize)
+    }
+}
+
+impl<'a, V, E> BidirectionalGraph<'a, V, E> for CompressedGraph<V, E> {
+    fn in_degree(&self, v: Self::Vertex) -> usize {
+        (self.in_offsets[v.0 + 1] - self.in_offsets[v.0]) as usize
+    }
+
+    fn degree(&self, v: Self::Vertex) -> usize {
+        self.in_degree(v) + self.out_degree(v)
+    }
+
+    fn in_edges(&'a self, v: Self::Vertex) -> Self::Incidence {
+        CompressedGraphIncidence::In(self.in_edges[self.in_offsets[v.0] as usize..self.in_offsets[v.0 + 1] as usize].iter())
+    }
+}
+
+#[derive(Debug)]
+pub struct CompressedGraphAdjacency {
+    adj: Vec<CompressedGraphVertexDescriptor>,
+}
+
+impl Iterator for CompressedGraphAdjacency {
+    type Item = CompressedGraphVertexDescriptor;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        self.adj.pop()
+    }
+}
+
+impl<'a, V, E> AdjacencyGraph<'a, V, E> for CompressedGraph<V, E> {
+    type Adjacency = CompressedGraphAdjacency;
+
+    fn adjacent_vertices(&'a self, v: Self::Vertex) -> Self::Adjacency {
+        let i = self.out_edges(v).map(|x| self.target(x));
+        let o = self.in_edges(v).map(|x| self.source(x));
+        let mut raw = i.chain(o).collect::<Vec<_>>();
+
+        raw.sort();
+        raw.dedup();
+
+        CompressedGraphAdjacency { adj: raw }
+    }
+}
+
+impl<'a, V: 'a, E> VertexListGraph<'a, V, E> for CompressedGraph<V, E> {
+    type Vertices = std::iter::Map<Range<usize>, fn(usize) -> Self::Vertex>;
+    type VertexLabels = std::slice::Iter<'a, V>;
+
+    fn num_vertices(&self) -> usize {
+        self.vertex_labels.len()
+    }
+
+    fn vertices(&'a self) -> Self::Vertices {
+        (0..self.vertex_labels.len()).map(CompressedGraphVertexDescriptor)
+    }
+
+    fn vertex_labels(&'a self) -> Self::VertexLabels {
+        self.vertex_labels.iter()
+    }
+}
+
+impl<'a, V, E: 'a> EdgeListGraph<'a, V, E> for CompressedGraph<V, E> {
+    type Edges = std::iter::Map<Range<usize>, fn(usize) -> Self::Edge>;
+    type EdgeLabels = std::slice::Iter<'a, E>;
+
+    fn num_edges(&self) -> usize {
+        self.edge_labels.len()
+    }
+
+    fn edges(&'a self) -> Self::Edges {
+        (0..self.edge_labels.len()).map(CompressedGraphEdgeDescriptor)
+    }
+
+    fn edge_labels(&'a self) -> Self::EdgeLabels {
+        self.edge_labels.iter()
+    }
+}
+
+impl<'a, V, E> AdjacencyMatrixGraph<'a, V, E> for CompressedGraph<V, E> {
+    fn edge(&'a self, from: Self::Vertex, to: Self::Vertex) -> Option<Self::Edge> {
+        self.out_edges(from).find(|&e| self.target(e) == to)
+    }
+}
+
+impl<'a, V: 'a, E> IntoIterator for &'a CompressedGraph<V, E> {
+    type Item = &'a V;
+    type IntoIter = std::slice::Iter<'a, V>;
+
+    fn into_iter(self) -> Self::IntoIter {
+        self.vertex_labels.iter()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use adjacency_list::AdjacencyList;
+    use dominator::immediate_dominator;
+    use order::weak_topo_order;
+
+    fn sample() -> AdjacencyList<usize, &'static str> {
+        let mut g = AdjacencyList::new();
+        let v = (0..5).map(|i| g.add_vertex(i)).collect::<Vec<_>>();
+
+        g.add_edge("a", v[0], v[1]);
+        g.add_edge("b", v[0], v[2]);
+        g.add_edge("c", v[1], v[3]);
+        g.add_edge("d", v[2], v[3]);
+        g.add_edge("e", v[3], v[0]);
+        g.add_edge("f", v[3], v[4]);
+        g.add_edge("g", v[4], v[4]);
+        g
+    }
+
+    #[test]
+    fn freeze() {
+        let list = sample();
+        let (copy, vx1) = CompressedGraph::from_graph(&list);
+        let (frozen, vx2) = CompressedGraph::freeze(list.clone());
+
+        assert_eq!(vx1, vx2);
+        assert_eq!(frozen.num_vertices(), 5);
+        assert_eq!(frozen.num_edges(), 7);
+        assert_eq!(copy.vertex_labels().cloned().collect::<Vec<_>>(), frozen.vertex_labels().cloned().collect::<Vec<_>>());
+        assert_eq!(copy.edge_labels().cloned().collect::<Vec<_>>(), frozen.edge_labels().cloned().collect::<Vec<_>>());
+
+        for (i, &old) in vx1.iter().enumerate() {
+            let vx = frozen.vertex(i).unwrap();
+            let out = |e| (*frozen.edge_label(e).unwrap(), *frozen.vertex_label(frozen.target(e)).unwrap());
+            let inc = |e| (*frozen.edge_label(e).unwrap(), *frozen.vertex_label(frozen.source(e)).unwrap());
+            let old_out = list.out_edges(old).map(|e| (*list.edge_label(e).unwrap(), *list.vertex_label(list.target(e)).unwrap())).collect::<Vec<_>>();
+            let mut old_in = list.in_edges(old).map(|e| (*list.edge_label(e).unwrap(), *list.vertex_label(list.source(e)).unwrap())).collect::<Vec<_>>();
+            let mut new_in = frozen.in_edges(vx).map(&inc).collect::<Vec<_>>();
+
+            old_in.sort();
+            new_in.sort();
+
+            assert_eq!(frozen.vertex_label(vx), list.vertex_label(old));
+            assert_eq!(frozen.out_edges(vx).map(&out).collect::<Vec<_>>(), old_out);
+            assert_eq!(new_in, old_in);
+            assert_eq!(frozen.out_degree(vx), list.out_degree(old));
+            assert_eq!(frozen.in_degree(vx), list.in_degree(old));
+
+            for e in frozen.out_edges(vx) {
+                assert_eq!(frozen.source(e), vx);
+                assert_eq!(frozen.edge(vx, frozen.target(e)).map(|e| frozen.target(e)), Some(frozen.target(e)));
+            }
+        }
+
+        assert_eq!(frozen.vertex(5), None);
+        assert_eq!(
+            frozen.adjacent_vertices(frozen.vertex(3).unwrap()).collect::<Vec<_>>(),
+            vec![4, 2, 1, 0].into_iter().map(CompressedGraphVertexDescriptor).collect::<Vec<_>>()
+        );
+    }
+
+    #[test]
+    fn algorithms() {
+        let list = sample();
+        let (frozen, vx) = CompressedGraph::freeze(list.clone());
+        let idom = immediate_dominator(frozen.vertex(0).unwrap(), &frozen);
+        let old_idom = immediate_dominator(vx[0], &list);
+
+        assert_eq!(idom.len(), old_idom.len());
+        for (v, d) in idom {
+            assert_eq!(old_idom[&vx[v.0]], vx[d.0]);
+        }
+
+        let wto = format!("{:?}", weak_topo_order(frozen.vertex(0).unwrap(), &frozen)).replace("CompressedGraph", "AdjacencyList");
+        assert_eq!(wto, format!("{:?}", weak_topo_order(vx[0], &list)));
+    }
+}
@@ -16,163 +16,258 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-use bit_set::BitSet;
-use search::{TraversalOrder, TreeIterator};
+//! Dominator trees and dominance frontiers.
+//!
+//! The algorithms work on graphs whose vertices are numbered `0..n` and whose edges are given as
+//! successor lists. The functions taking a `Graph` number its vertices once and translate the
+//! result back.
+
 use std::collections::HashMap;
-use std::iter::FromIterator;
+use std::mem;
 use traits::{BidirectionalGraph, Graph, VertexListGraph};
 
-pub fn dominators<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + BidirectionalGraph<'a, V, E> + VertexListGraph<'a, V, E>>(
-    start: G::Vertex,
+const NONE: usize = ::std::usize::MAX;
+
+/// Numbers the vertices of `graph` and returns them along with their successor lists.
+fn dense_graph<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + BidirectionalGraph<'a, V, E> + VertexListGraph<'a, V, E>>
+    (
     graph: &'a G,
-) -> HashMap<G::Vertex, Vec<G::Vertex>> {
-    let vertex_idx = HashMap::<G::Vertex, usize>::from_iter(graph.vertices().enumerate().map(|(a, b)| (b, a)));
-    let vertex_ridx = HashMap::<usize, G::Vertex>::from_iter(graph.vertices().enumerate());
-    let mut fixpoint = false;
-    let mut all_set = BitSet::new();
+) -> (Vec<G::Vertex>, HashMap<G::Vertex, usize>, Vec<Vec<usize>>) {
+    let vertices = graph.vertices().collect::<Vec<_>>();
+    let index = vertices.iter().enumerate().map(|(i, &vx)| (vx, i)).collect::<HashMap<_, _>>();
+    let successors = vertices.iter().map(|&vx| graph.out_edges(vx).map(|e| index[&graph.target(e)]).collect()).collect();
 
-    for vx in 0..vertex_idx.len() {
-        all_set.insert(vx);
-    }
+    (vertices, index, successors)
+}
 
-    let mut cur_dom = vec![all_set; vertex_idx.len()];
+/// Immediate dominators of the vertices `0..successors.len()` of a graph given as successor lists.
+/// The start vertex is its own immediate dominator, vertices not reachable from `start` have
+/// none.
+///
+/// Lengauer, Tarjan: "A Fast Algorithm for Finding Dominators in a Flowgraph". This is the simple
+/// version with path compression, O(m log n). The depth first search and the path compression
+/// use explicit stacks.
+pub fn dense_immediate_dominators(start: usize, successors: &[Vec<usize>]) -> Vec<Option<usize>> {
+    let mut ret = vec![None; successors.len()];
+
+    if start >= successors.len() {
+        return ret;
+    }
 
-    while !fixpoint {
-        let mut next_dom = vec![BitSet::new(); vertex_idx.len()];
+    // number the reachable vertices in depth first preorder. All following arrays are indexed by
+    // this number.
+    let mut dfnum = vec![NONE; successors.len()];
+    let mut vertex = vec![start];
+    let mut parent = vec![0];
+    let mut stack = vec![(start, 0)];
 
-        for vx in graph.vertices() {
-            let mut my_dom: Option<BitSet> = None;
+    dfnum[start] = 0;
 
-            if vx != start {
-                for e in graph.in_edges(vx) {
-                    let prev = &cur_dom[vertex_idx[&graph.source(e)]];
+    while let Some(&(v, i)) = stack.last() {
+        if let Some(&w) = successors[v].get(i) {
+            stack.last_mut().unwrap().1 += 1;
 
-                    if let Some(ref mut s) = my_dom {
-                        s.intersect_with(&prev);
-                    } else {
-                        my_dom = Some(prev.clone());
-                    }
-                }
+            if dfnum[w] == NONE {
+                dfnum[w] = vertex.len();
+                parent.push(dfnum[v]);
+                vertex.push(w);
+                stack.push((w, 0));
             }
+        } else {
+            stack.pop();
+        }
+    }
 
-            let mut final_dom = my_dom.unwrap_or(BitSet::new());
-            let vx_idx = vertex_idx[&vx];
+    let num = vertex.len();
+    let mut preds = vec![Vec::new(); num];
 
-            final_dom.insert(vx_idx);
-            next_dom[vx_idx] = final_dom;
+    for (d, &v) in vertex.iter().enumerate() {
+        for &w in successors[v].iter() {
+            preds[dfnum[w]].push(d);
         }
+    }
 
-        fixpoint = next_dom == cur_dom;
-        cur_dom = next_dom;
+    let mut semi = (0..num).collect::<Vec<_>>();
+    let mut label = (0..num).collect::<Vec<_>>();
+    let mut ancestor = vec![NONE; num];
+    let mut idom = vec![0; num];
+    let mut bucket = vec![Vec::new(); num];
+    let mut path = Vec::new();
+
+    for w in (1..num).rev() {
+        for &v in preds[w].iter() {
+            let u = eval(v, &mut ancestor, &mut label, &semi, &mut path);
+
+            if semi[u] < semi[w] {
+                semi[w] = semi[u];
+            }
+        }
+
+        let p = parent[w];
+
+        bucket[semi[w]].push(w);
+        ancestor[w] = p;
+
+        for v in mem::replace(&mut bucket[p], Vec::new()) {
+            let u = eval(v, &mut ancestor, &mut label, &semi, &mut path);
+
+            idom[v] = if semi[u] < semi[v] { u } else { p };
+        }
     }
 
-    let mut ret = HashMap::<G::Vertex, Vec<G::Vertex>>::new();
-    for (vx, idx) in vertex_idx.iter() {
-        let mut res = cur_dom[*idx].iter().map(|a| vertex_ridx[&a]).collect::<Vec<G::Vertex>>();
+    for w in 1..num {
+        if idom[w] != semi[w] {
+            idom[w] = idom[idom[w]];
+        }
+    }
 
-        res.sort();
-        ret.insert(*vx, res);
+    for (d, &v) in vertex.iter().enumerate() {
+        ret[v] = Some(vertex[idom[d]]);
     }
 
     ret
 }
 
+/// Returns the vertex with the smallest semidominator on the forest path from `v` to its root and
+/// compresses the path. `path` is scratch space.
+fn eval(v: usize, ancestor: &mut Vec<usize>, label: &mut Vec<usize>, semi: &[usize], path: &mut Vec<usize>) -> usize {
+    if ancestor[v] == NONE {
+        return v;
+    }
+
+    path.clear();
+
+    let mut x = v;
+
+    while ancestor[ancestor[x]] != NONE {
+        path.push(x);
+        x = ancestor[x];
+    }
+
+    // update from the root down, so the ancestor of each vertex is already compressed
+    for &y in path.iter().rev() {
+        let a = ancestor[y];
+
+        if semi[label[a]] < semi[label[y]] {
+            label[y] = label[a];
+        }
+        ancestor[y] = ancestor[a];
+    }
+
+    label[v]
+}
+
+/// Dominance frontiers of the vertices `0..successors.len()` of a graph given as successor lists
+/// and the immediate dominators computed by `dense_immediate_dominators`. Vertices not reachable
+/// from the start vertex have an empty frontier. The frontiers are sorted. Self loops are ignored
+/// and the start vertex is never part of its own frontier.
+///
 /// Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm"
-pub fn dominance_frontiers<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + BidirectionalGraph<'a, V, E> + VertexListGraph<'a, V, E>>
-    (
-    idom: &HashMap<G::Vertex, G::Vertex>,
-    graph: &'a G,
-) -> HashMap<G::Vertex, Vec<G::Vertex>> {
-    let mut ret = HashMap::<G::Vertex, Vec<G::Vertex>>::from_iter(graph.vertices().map(|v| (v, vec![])));
-
-    for b in graph.vertices() {
-        let pred = {
-            let mut ret = graph.in_edges(b).map(|e| graph.source(e)).filter(|&x| x != b).collect::<Vec<G::Vertex>>();
-            ret.sort();
-            ret.dedup();
-            ret
-        };
+pub fn dense_dominance_frontiers(idom: &[Option<usize>], successors: &[Vec<usize>]) -> Vec<Vec<usize>> {
+    let mut preds = vec![Vec::new(); successors.len()];
+    let mut ret = vec![Vec::new(); successors.len()];
+
+    for (v, succ) in successors.iter().enumerate() {
+        if idom[v].is_some() {
+            for &s in succ.iter().filter(|&&s| s != v) {
+                preds[s].push(v);
+            }
+        }
+    }
+
+    for (b, pred) in preds.iter_mut().enumerate() {
+        pred.sort();
+        pred.dedup();
 
-        if pred.len() >= 2 {
-            for p in pred {
+        if let (Some(d), true) = (idom[b], pred.len() >= 2) {
+            for &p in pred.iter() {
                 let mut runner = p;
 
-                while runner != idom[&b] {
-                    ret.entry(runner).or_insert(vec![]).push(b);
-                    runner = idom[&runner];
+                while runner != d {
+                    ret[runner].push(b);
+                    runner = idom[runner].unwrap();
                 }
             }
         }
     }
 
-    for (_, v) in ret.iter_mut() {
-        v.sort();
-        v.dedup();
+    for f in ret.iter_mut() {
+        f.sort();
+        f.dedup();
     }
 
     ret
 }
 
-/// Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm"
-pub fn immediate_dominator<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + BidirectionalGraph<'a, V, E> + VertexListGraph<'a, V, E>>(
+/// Dominator sets of all vertices in `graph`. Each set is sorted and includes the vertex itself.
+/// Vertices not reachable from `start` are only dominated by themselves.
+pub fn dominators<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + BidirectionalGraph<'a, V, E> + VertexListGraph<'a, V, E>>(
     start: G::Vertex,
     graph: &'a G,
-) -> HashMap<G::Vertex, G::Vertex> {
-    let postorder = TreeIterator::new(start, TraversalOrder::Postorder, graph).collect::<Vec<_>>();
-    let po_idx = HashMap::<G::Vertex, usize>::from_iter(postorder.iter().enumerate().map(|(a, b)| (b.clone(), a)));
-    fn intersect<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + BidirectionalGraph<'a, V, E> + VertexListGraph<'a, V, E>>(
-        b1: G::Vertex,
-        b2: G::Vertex,
-        po_idx: &HashMap<G::Vertex, usize>,
-        postorder: &Vec<G::Vertex>,
-        ret: &HashMap<G::Vertex, G::Vertex>,
-    ) -> G::Vertex {
-        let mut f1 = po_idx[&b1];
-        let mut f2 = po_idx[&b2];
-
-        while f1 != f2 {
-            while f1 < f2 {
-                f1 = po_idx[&ret[&postorder[f1]]];
-            }
-            while f2 < f1 {
-                f2 = po_idx[&ret[&postorder[f2]]];
-            }
-        }
-
-        postorder[f1]
-    };
+) -> HashMap<G::Vertex, Vec<G::Vertex>> {
+    let (vertices, index, successors) = dense_graph(graph);
+    let idom = index.get(&start).map(|&s| dense_immediate_dominators(s, &successors)).unwrap_or(vec![None; vertices.len()]);
+    let mut ret = HashMap::<G::Vertex, Vec<G::Vertex>>::with_capacity(vertices.len());
 
-    let mut ret = HashMap::<G::Vertex, G::Vertex>::new();
-    let mut fixpoint = false;
+    for (v, &vx) in vertices.iter().enumerate() {
+        let mut dom = vec![vx];
+        let mut runner = v;
 
-    ret.insert(start, start);
+        while let Some(d) = idom[runner] {
+            if d == runner {
+                break;
+            }
+            dom.push(vertices[d]);
+            runner = d;
+        }
 
-    while !fixpoint {
-        fixpoint = true;
+        dom.sort();
+        ret.insert(vx, dom);
+    }
 
-        for b in postorder.iter().rev().filter(|&&v| v != start) {
-            let pred = {
-                let mut ret = graph.in_edges(*b).map(|e| graph.source(e)).filter(|&x| x != *b).collect::<Vec<G::Vertex>>();
-                ret.sort();
-                ret.dedup();
-                ret
-            };
-            let mut new_idom = *pred.iter().find(|&x| ret.contains_key(x)).unwrap();
+    ret
+}
 
-            for p in pred.iter().filter(move |&&x| x != new_idom) {
-                if ret.contains_key(&p) {
-                    new_idom = intersect::<V, E, G>(*p, new_idom, &po_idx, &postorder, &ret);
-                }
+/// Dominance frontiers of all vertices in `graph`, given the immediate dominators returned by
+/// `immediate_dominator`.
+///
+/// Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm"
+pub fn dominance_frontiers<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + BidirectionalGraph<'a, V, E> + VertexListGraph<'a, V, E>>
+    (
+    idom: &HashMap<G::Vertex, G::Vertex>,
+    graph: &'a G,
+) -> HashMap<G::Vertex, Vec<G::Vertex>> {
+    let (vertices, index, successors) = dense_graph(graph);
+    let dense_idom = vertices.iter().map(|vx| idom.get(vx).and_then(|d| index.get(d)).cloned()).collect::<Vec<_>>();
+    let frontiers = dense_dominance_frontiers(&dense_idom, &successors);
+
+    vertices
+        .iter()
+        .zip(frontiers.into_iter())
+        .map(
+            |(&vx, f)| {
+                let mut f = f.into_iter().map(|d| vertices[d]).collect::<Vec<_>>();
+
+                f.sort();
+                (vx, f)
             }
+        )
+        .collect()
+}
 
-            if ret.get(b) != Some(&new_idom) {
-                ret.insert(*b, new_idom);
-                fixpoint = false;
-            }
-        }
-    }
+/// Immediate dominators of all vertices in `graph` reachable from `start`. The start vertex is
+/// its own immediate dominator.
+pub fn immediate_dominator<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + BidirectionalGraph<'a, V, E> + VertexListGraph<'a, V, E>>(
+    start: G::Vertex,
+    graph: &'a G,
+) -> HashMap<G::Vertex, G::Vertex> {
+    let (vertices, index, successors) = dense_graph(graph);
+    let idom = match index.get(&start) {
+        Some(&s) => dense_immediate_dominators(s, &successors),
+        None => return HashMap::new(),
+    };
 
-    ret
+    vertices.iter().zip(idom.into_iter()).filter_map(|(&vx, d)| d.map(|d| (vx, vertices[d]))).collect()
 }
 
 #[cfg(test)]
@@ -324,4 +419,85 @@ mod tests {
         assert_eq!(fron[&e], vec![f]);
         assert_eq!(fron[&f], vec![]);
     }
+
+    #[test]
+    fn dense() {
+        // xorshift, to get the same "random" graphs every time
+        let mut state = 0x2545f4914f6cdd1du64;
+        let mut rand = move |n: usize| {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            (state % n as u64) as usize
+        };
+
+        for round in 0..50 {
+            let num = 1 + round;
+            let mut successors = vec![Vec::new(); num];
+
+            for _ in 0..(num * 2) {
+                let (a, b) = (rand(num), rand(num));
+                successors[a].push(b);
+            }
+
+            // vertices reachable from 0 without passing `skip`
+            let reach = |skip: usize| {
+                let mut seen = vec![false; num];
+                let mut todo = vec![0];
+
+                while let Some(v) = todo.pop() {
+                    if v != skip && !seen[v] {
+                        seen[v] = true;
+                        todo.extend(successors[v].iter().cloned());
+                    }
+                }
+                seen
+            };
+            let reachable = reach(num);
+            // dom[d][v] is true if d dominates v
+            let dom = (0..num).map(|d| reach(d).into_iter().zip(reachable.iter()).map(|(r, &a)| a && !r).collect::<Vec<_>>()).collect::<Vec<_>>();
+            let idom = dense_immediate_dominators(0, &successors);
+
+            assert_eq!(idom[0], Some(0));
+
+            for v in 1..num {
+                if !reachable[v] {
+                    assert_eq!(idom[v], None);
+                    continue;
+                }
+
+                let i = idom[v].unwrap();
+
+                assert!(i != v && dom[i][v]);
+                for d in (0..num).filter(|&d| d != v && dom[d][v]) {
+                    assert!(dom[d][i]);
+                }
+            }
+
+            // w is in the frontier of v if v dominates a predecessor of w but not strictly w. Like
+            // in Cooper et.al. self loops are ignored and the start vertex is never part of
+            // its own frontier.
+            let frontiers = dense_dominance_frontiers(&idom, &successors);
+
+            for v in 0..num {
+                let mut expected = vec![];
+
+                if reachable[v] {
+                    for p in (0..num).filter(|&p| dom[v][p]) {
+                        for &w in successors[p].iter().filter(|&&w| w != p && (v, w) != (0, 0)) {
+                            let preds = (0..num).filter(|&x| x != w && reachable[x] && successors[x].contains(&w)).count();
+
+                            if preds >= 2 && (v == w || !dom[v][w]) {
+                                expected.push(w);
+                            }
+                        }
+                    }
+                }
+
+                expected.sort();
+                expected.dedup();
+                assert_eq!(frontiers[v], expected);
+            }
+        }
+    }
 }
@@ -22,16 +22,17 @@ pub mod dominator;
 pub mod order;
 pub mod adjacency_list;
 pub mod adjacency_matrix;
+pub mod compressed_graph;
 
 extern crate serde;
 #[macro_use] extern crate serde_derive;
-extern crate bit_set;
 
 #[cfg(test)]
 extern crate rmp_serde;
 
 pub use adjacency_list::AdjacencyList;
 pub use adjacency_matrix::AdjacencyMatrix;
+pub use compressed_graph::CompressedGraph;
 pub use traits::AdjacencyGraph as AdjacencyGraphTrait;
 pub use traits::AdjacencyMatrixGraph as AdjacencyMatrixGraphTrait;
 pub use traits::BidirectionalGraph as BidirectionalGraphTrait;
@@ -28,7 +28,36 @@ pub enum HierarchicalOrdering<T: Clone> {
     Element(T),
 }
 
+/// Call frames of `weak_topo_order`.
+enum Frame {
+    /// Bourdoncle's `visit`, stopped at the `edge`th outgoing edge of `vertex`.
+    Visit {
+        vertex: usize,
+        edge: usize,
+        head: usize,
+        is_loop: bool,
+    },
+    /// Bourdoncle's `component`, stopped at the `edge`th outgoing edge of `vertex`.
+    Component { vertex: usize, edge: usize },
+    /// Returns `head` from a `Visit` frame after the component it started is done.
+    Return { head: usize },
+}
+
+impl Frame {
+    fn visit(vertex: usize, stack: &mut Vec<usize>, dfn: &mut [usize], num: &mut usize) -> Frame {
+        stack.push(vertex);
+        *num += 1;
+        dfn[vertex] = *num;
+
+        Frame::Visit { vertex: vertex, edge: 0, head: *num, is_loop: false }
+    }
+}
+
 /// Bourdoncle: "Efficient chaotic iteration strategies with widenings"
+///
+/// The recursion of the original algorithm is replaced by an explicit stack of call frames and
+/// the vertices are numbered densely, so that large or deeply nested graphs neither overflow the
+/// stack nor spend their time hashing.
 pub fn weak_topo_order<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + IncidenceGraph<'a, V, E> + VertexListGraph<'a, V, E>>(
     root: G::Vertex,
     graph: &'a G,
@@ -36,95 +65,105 @@ pub fn weak_topo_order<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + IncidenceGraph<'a
 where
     G::Vertex: Debug,
 {
-    fn visit<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + IncidenceGraph<'a, V, E> + VertexListGraph<'a, V, E>>(
-        vx: G::Vertex,
-        graph: &'a G,
-        ret: &mut Vec<Box<HierarchicalOrdering<G::Vertex>>>,
-        stack: &mut Vec<G::Vertex>,
-        dfn: &mut HashMap<G::Vertex, usize>,
-        num: &mut usize,
-    ) -> usize
-    where
-        <G as Graph<'a, V, E>>::Vertex: Debug,
-    {
-        stack.push(vx.clone());
-
-        let mut _loop = false;
+    let vertices = graph.vertices().collect::<Vec<_>>();
+    let index = HashMap::<G::Vertex, usize>::from_iter(vertices.iter().enumerate().map(|(i, &vx)| (vx, i)));
+    let successors = vertices.iter().map(|&vx| graph.out_edges(vx).map(|e| index[&graph.target(e)]).collect::<Vec<_>>()).collect::<Vec<_>>();
+    let mut dfn = vec![0; vertices.len()];
+    let mut num = 0;
+    let mut stack = Vec::new();
+    // partitions of all components currently being built. They're assembled in reverse.
+    let mut partitions = vec![Vec::<Box<HierarchicalOrdering<G::Vertex>>>::new()];
+    // value returned by the last `Visit` frame
+    let mut returned = None;
+    let mut frames = vec![Frame::visit(index[&root], &mut stack, &mut dfn, &mut num)];
 
-        *num += 1;
-        dfn.insert(vx.clone(), *num);
-        let mut head = dfn[&vx];
-
-        for e in graph.out_edges(vx) {
-            let succ = graph.target(e);
-            let min = if dfn[&succ] == 0 {
-                visit(succ, graph, ret, stack, dfn, num)
-            } else {
-                dfn[&succ]
-            };
-
-            if min <= head {
-                head = min;
-                _loop = true;
-            }
-        }
+    while let Some(frame) = frames.pop() {
+        match frame {
+            Frame::Visit { vertex, mut edge, mut head, mut is_loop } => {
+                if let Some(min) = returned.take() {
+                    if min <= head {
+                        head = min;
+                        is_loop = true;
+                    }
+                    edge += 1;
+                }
+
+                while let Some(&succ) = successors[vertex].get(edge) {
+                    if dfn[succ] == 0 {
+                        break;
+                    }
+
+                    if dfn[succ] <= head {
+                        head = dfn[succ];
+                        is_loop = true;
+                    }
+                    edge += 1;
+                }
+
+                if let Some(&succ) = successors[vertex].get(edge) {
+                    frames.push(Frame::Visit { vertex: vertex, edge: edge, head: head, is_loop: is_loop });
+                    frames.push(Frame::visit(succ, &mut stack, &mut dfn, &mut num));
+                    continue;
+                }
+
+                if head == dfn[vertex] {
+                    dfn[vertex] = usize::MAX;
+                    let mut element = stack.pop().unwrap();
+
+                    if is_loop {
+                        while element != vertex {
+                            dfn[element] = 0;
+                            element = stack.pop().unwrap();
+                        }
 
-        if head == dfn[&vx] {
-            dfn.insert(vx.clone(), usize::MAX);
-            let mut element = stack.pop().unwrap();
+                        partitions.push(Vec::new());
+                        frames.push(Frame::Return { head: head });
+                        frames.push(Frame::Component { vertex: vertex, edge: 0 });
+                        continue;
+                    }
 
-            if _loop {
-                while element != vx {
-                    dfn.insert(element.clone(), 0);
-                    element = stack.pop().unwrap();
+                    partitions.last_mut().unwrap().push(Box::new(HierarchicalOrdering::Element(vertices[vertex])));
                 }
 
-                ret.insert(0, Box::new(component(vx, graph, stack, dfn, num)));
-            } else {
-                ret.insert(0, Box::new(HierarchicalOrdering::Element(vx)));
+                returned = Some(head);
             }
-        }
+            Frame::Component { vertex, mut edge } => {
+                if returned.take().is_some() {
+                    edge += 1;
+                }
 
-        head
-    }
+                while successors[vertex].get(edge).map(|&succ| dfn[succ] != 0).unwrap_or(false) {
+                    edge += 1;
+                }
+
+                if let Some(&succ) = successors[vertex].get(edge) {
+                    frames.push(Frame::Component { vertex: vertex, edge: edge });
+                    frames.push(Frame::visit(succ, &mut stack, &mut dfn, &mut num));
+                    continue;
+                }
+
+                let mut partition = partitions.pop().unwrap();
 
-    fn component<'a, V: 'a, E, G: 'a + Graph<'a, V, E> + IncidenceGraph<'a, V, E> + VertexListGraph<'a, V, E>>(
-        vx: G::Vertex,
-        graph: &'a G,
-        stack: &mut Vec<G::Vertex>,
-        dfn: &mut HashMap<G::Vertex, usize>,
-        num: &mut usize,
-    ) -> HierarchicalOrdering<G::Vertex>
-    where
-        <G as Graph<'a, V, E>>::Vertex: Debug,
-    {
-        let mut ret = Vec::<Box<HierarchicalOrdering<G::Vertex>>>::new();
-
-        for e in graph.out_edges(vx) {
-            let succ = graph.target(e);
-            if dfn[&succ] == 0 {
-                visit(succ, graph, &mut ret, stack, dfn, num);
+                partition.push(Box::new(HierarchicalOrdering::Element(vertices[vertex])));
+                partition.reverse();
+                partitions.last_mut().unwrap().push(Box::new(HierarchicalOrdering::Component(partition)));
+            }
+            Frame::Return { head } => {
+                returned = Some(head);
             }
         }
-
-        ret.insert(0, Box::new(HierarchicalOrdering::Element(vx)));
-        HierarchicalOrdering::Component(ret)
     }
 
-    let mut dfn = HashMap::<G::Vertex, usize>::from_iter(graph.vertices().map(|v| (v, 0)));
-    let mut num = 0;
-    let mut ret = Vec::<Box<HierarchicalOrdering<G::Vertex>>>::new();
-    let mut stack = Vec::new();
-
-    visit(root, graph, &mut ret, &mut stack, &mut dfn, &mut num);
+    let mut ret = partitions.pop().unwrap();
 
+    ret.reverse();
     HierarchicalOrdering::Component(ret)
 }
 
 #[cfg(test)]
 mod tests {
     use super::*;
-    use adjacency_list::AdjacencyList;
+    use adjacency_list::{AdjacencyList, AdjacencyListVertexDescriptor};
     use traits::MutableGraph;
 
     #[test]
@@ -270,4 +309,120 @@ mod tests {
         let got = weak_topo_order(vx1a, &g);
         assert!(got == expected1 || got == expected2);
     }
+
+    /// Bourdoncle's recursive formulation, to compare against.
+    fn recursive_wto(root: usize, successors: &[Vec<usize>]) -> HierarchicalOrdering<usize> {
+        fn visit(vx: usize, succ: &[Vec<usize>], ret: &mut Vec<Box<HierarchicalOrdering<usize>>>, stack: &mut Vec<usize>, dfn: &mut [usize], num: &mut usize) -> usize {
+            stack.push(vx);
+            *num += 1;
+            dfn[vx] = *num;
+
+            let mut head = dfn[vx];
+            let mut is_loop = false;
+
+            for &s in succ[vx].iter() {
+                let min = if dfn[s] == 0 { visit(s, succ, ret, stack, dfn, num) } else { dfn[s] };
+
+                if min <= head {
+                    head = min;
+                    is_loop = true;
+                }
+            }
+
+            if head == dfn[vx] {
+                dfn[vx] = usize::MAX;
+                let mut element = stack.pop().unwrap();
+
+                if is_loop {
+                    while element != vx {
+                        dfn[element] = 0;
+                        element = stack.pop().unwrap();
+                    }
+
+                    let mut comp = vec![];
+
+                    for &s in succ[vx].iter() {
+                        if dfn[s] == 0 {
+                            visit(s, succ, &mut comp, stack, dfn, num);
+                        }
+                    }
+
+                    comp.insert(0, Box::new(HierarchicalOrdering::Element(vx)));
+                    ret.insert(0, Box::new(HierarchicalOrdering::Component(comp)));
+                } else {
+                    ret.insert(0, Box::new(HierarchicalOrdering::Element(vx)));
+                }
+            }
+
+            head
+        }
+
+        let mut ret = vec![];
+
+        visit(root, successors, &mut ret, &mut vec![], &mut vec![0; successors.len()], &mut 0);
+        HierarchicalOrdering::Component(ret)
+    }
+
+    fn to_indices(h: HierarchicalOrdering<AdjacencyListVertexDescriptor>, vertices: &[AdjacencyListVertexDescriptor]) -> HierarchicalOrdering<usize> {
+        match h {
+            HierarchicalOrdering::Element(vx) => HierarchicalOrdering::Element(vertices.iter().position(|&x| x == vx).unwrap()),
+            HierarchicalOrdering::Component(v) => HierarchicalOrdering::Component(v.into_iter().map(|x| Box::new(to_indices(*x, vertices))).collect()),
+        }
+    }
+
+    #[test]
+    fn wto_recursive() {
+        // xorshift, to get the same "random" graphs every time
+        let mut state = 0x9e3779b97f4a7c15u64;
+        let mut rand = move |n: usize| {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            (state % n as u64) as usize
+        };
+
+        for round in 0..100 {
+            let num = 1 + round / 2;
+            let mut g = AdjacencyList::<(), ()>::new();
+            let vertices = (0..num).map(|_| g.add_vertex(())).collect::<Vec<_>>();
+            let mut successors = vec![Vec::new(); num];
+
+            for _ in 0..(num * 2) {
+                let (a, b) = (rand(num), rand(num));
+
+                if g.add_edge((), vertices[a], vertices[b]).is_some() {
+                    successors[a].push(b);
+                }
+            }
+
+            // the graph decides the order of the outgoing edges
+            for (a, succ) in successors.iter_mut().enumerate() {
+                *succ = g.out_edges(vertices[a]).map(|e| vertices.iter().position(|&x| x == g.target(e)).unwrap()).collect();
+            }
+
+            assert_eq!(to_indices(weak_topo_order(vertices[0], &g), &vertices), recursive_wto(0, &successors));
+        }
+    }
+
+    #[test]
+    fn wto_deep() {
+        let mut g = AdjacencyList::<(), ()>::new();
+        let vertices = (0..100_000).map(|_| g.add_vertex(())).collect::<Vec<_>>();
+
+        for w in vertices.windows(2) {
+            g.add_edge((), w[0], w[1]);
+        }
+        g.add_edge((), vertices[99_999], vertices[1]);
+
+        match weak_topo_order(vertices[0], &g) {
+            HierarchicalOrdering::Component(ref v) if v.len() == 2 => {
+                assert_eq!(*v[0], HierarchicalOrdering::Element(vertices[0]));
+                match *v[1] {
+                    HierarchicalOrdering::Component(ref c) => assert_eq!(c.len(), 99_999),
+                    _ => unreachable!(),
+                }
+            }
+            _ => unreachable!(),
+        }
+    }
 }
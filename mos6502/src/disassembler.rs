@@ -16,10 +16,18 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-use panopticon_core::{Architecture, Guard, Lvalue, Match, Region, Result, Rvalue, State, Statement};
-use std::borrow::Cow;
+use panopticon_core::{Architecture, Disassembler, Guard, Lvalue, Match, Name, Region, Result, Rvalue, State, Statement};
+use std::sync::Arc;
 use syntax;
 
+/// Length of the longest 6502 instruction in bytes (opcode and 16 bit operand).
+const MAX_INSTRUCTION_LEN: usize = 3;
+
+lazy_static! {
+    /// Rule trie compiled once and shared by all threads.
+    static ref DISASSEMBLER: Arc<Disassembler<Mos>> = syntax::disassembler();
+}
+
 #[derive(Clone,Debug)]
 pub enum Mos {}
 
@@ -54,44 +62,52 @@ impl Architecture for Mos {
 
     fn decode(reg: &Region, addr: u64, cfg: &Self::Configuration) -> Result<Match<Self>> {
         info!("disass @ {:x}", addr);
-        let disass = syntax::disassembler();
 
-        if let Some(st) = disass.next_match(&mut reg.iter().seek(addr), addr, cfg.clone()) {
+        if let Some(st) = DISASSEMBLER.next_match(&mut reg.iter_at(addr, MAX_INSTRUCTION_LEN), addr, cfg.clone()) {
             info!("    res: {:?}", st);
             Ok(st.into())
         } else {
             Err("Unrecognized instruction".into())
         }
     }
+
+    fn cache_key(cfg: &Self::Configuration) -> Option<u64> {
+        // operand state is only set while decoding a single instruction
+        if cfg.arg.is_none() && cfg.rel.is_none() {
+            Some(0)
+        } else {
+            None
+        }
+    }
 }
 
 // 8 bit main register
 lazy_static! {
-    pub static ref A: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("A"), size: 8, subscript: None };
+    pub static ref A: Lvalue = Lvalue::Variable{ name: Name::new("A"), size: 8, subscript: None };
 }
 
 // 8 bit index registers
 lazy_static! {
-    pub static ref X: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("X"), size: 8, subscript: None };
-    pub static ref Y: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("Y"), size: 8, subscript: None };
-    pub static ref SP: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("SP"), size: 8, subscript: None };
+    pub static ref X: Lvalue = Lvalue::Variable{ name: Name::new("X"), size: 8, subscript: None };
+    pub static ref Y: Lvalue = Lvalue::Variable{ name: Name::new("Y"), size: 8, subscript: None };
+    pub static ref SP: Lvalue = Lvalue::Variable{ name: Name::new("SP"), size: 8, subscript: None };
 }
 
 /*
 // 16 bit program counter
 lazy_static! {
-    pub static ref PC: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("PC"), size: 16, subscript: None };
+    pub static ref PC: Lvalue = Lvalue::Variable{ name: Name::new("PC"), size: 16, subscript: None };
 }
 */
 
 // flags
 lazy_static! {
-    pub static ref N: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("N"), size: 1, subscript: None };
-    pub static ref V: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("V"), size: 1, subscript: None };
-    //pub static ref D: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("D"), size: 1, subscript: None };
-    //pub static ref I: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("I"), size: 1, subscript: None };
-    pub static ref Z: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("Z"), size: 1, subscript: None };
-    pub static ref C: Lvalue = Lvalue::Variable{ name: Cow::Borrowed("C"), size: 1, subscript: None };
+    pub static ref N: Lvalue = Lvalue::Variable{ name: Name::new("N"), size: 1, subscript: None };
+    pub static ref V: Lvalue = Lvalue::Variable{ name: Name::new("V"), size: 1, subscript: None };
+    //pub static ref D: Lvalue = Lvalue::Variable{ name: Name::new("D"), size: 1, subscript: None };
+    //pub static ref I: Lvalue = Lvalue::Variable{ name: Name::new("I"), size: 1, subscript: None };
+    pub static ref Z: Lvalue = Lvalue::Variable{ name: Name::new("Z"), size: 1, subscript: None };
+    pub static ref C: Lvalue = Lvalue::Variable{ name: Name::new("C"), size: 1, subscript: None };
 }
 
 #[derive(Clone,Debug)]
@@ -239,7 +255,7 @@ pub fn zpage_offset(opcode: &'static str, _arg1: &Lvalue, sem: fn(&mut Variant,
                 unreachable!()
             };
             let addr = Lvalue::Variable {
-                name: Cow::Owned(format!("${:02X},{}", base_val, index_nam)),
+                name: Name::from(format!("${:02X},{}", base_val, index_nam)),
                 size: 16,
                 subscript: None,
             };
@@ -294,13 +310,13 @@ pub fn zpage_index(opcode: &'static str, _arg1: Lvalue, sem: fn(&mut Variant, Rv
             };
             let addr = if index == rreil_lvalue!{ X:8 } {
                 Lvalue::Variable {
-                    name: Cow::Owned(format!("(${:02X},{})", base_val, index_nam)),
+                    name: Name::from(format!("(${:02X},{})", base_val, index_nam)),
                     size: 16,
                     subscript: None,
                 }
             } else {
                 Lvalue::Variable {
-                    name: Cow::Owned(format!("(${:02X}),{}", base_val, index_nam)),
+                    name: Name::from(format!("(${:02X}),{}", base_val, index_nam)),
                     size: 16,
                     subscript: None,
                 }
@@ -383,7 +399,7 @@ pub fn absolute_offset(opcode: &'static str, _arg1: &Lvalue, sem: fn(&mut Varian
                 unreachable!()
             };
             let addr = Lvalue::Variable {
-                name: Cow::Owned(format!("${:04X},{}", base_val, index_nam)),
+                name: Name::from(format!("${:04X},{}", base_val, index_nam)),
                 size: 16,
                 subscript: None,
             };
@@ -459,7 +475,6 @@ mod tests {
     use super::*;
     use super::syntax::disassembler;
     use panopticon_core::{Region, Rvalue};
-    use std::borrow::Cow;
 
     #[test]
     fn all() {
@@ -471,7 +486,7 @@ mod tests {
              "lda",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -481,7 +496,7 @@ mod tests {
              "lda",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -492,7 +507,7 @@ mod tests {
              "lda",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -502,7 +517,7 @@ mod tests {
              "lda",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80,X)"),
+                    name: Name::new("($80,X)"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -512,7 +527,7 @@ mod tests {
              "lda",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80),Y"),
+                    name: Name::new("($80),Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -526,7 +541,7 @@ mod tests {
              "ldx",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -537,7 +552,7 @@ mod tests {
              "ldx",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,Y"),
+                    name: Name::new("$80,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -551,7 +566,7 @@ mod tests {
              "ldy",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -562,7 +577,7 @@ mod tests {
              "ldy",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -575,7 +590,7 @@ mod tests {
              "sta",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -585,7 +600,7 @@ mod tests {
              "sta",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -596,7 +611,7 @@ mod tests {
              "sta",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -606,7 +621,7 @@ mod tests {
              "sta",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80,X)"),
+                    name: Name::new("($80,X)"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -616,7 +631,7 @@ mod tests {
              "sta",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80),Y"),
+                    name: Name::new("($80),Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -630,7 +645,7 @@ mod tests {
              "stx",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,Y"),
+                    name: Name::new("$80,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -644,7 +659,7 @@ mod tests {
              "sty",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -666,7 +681,7 @@ mod tests {
              "and",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -676,7 +691,7 @@ mod tests {
              "and",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -687,7 +702,7 @@ mod tests {
              "and",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -697,7 +712,7 @@ mod tests {
              "and",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80,X)"),
+                    name: Name::new("($80,X)"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -707,7 +722,7 @@ mod tests {
              "and",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80),Y"),
+                    name: Name::new("($80),Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -721,7 +736,7 @@ mod tests {
              "ora",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -731,7 +746,7 @@ mod tests {
              "ora",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -742,7 +757,7 @@ mod tests {
              "ora",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -752,7 +767,7 @@ mod tests {
              "ora",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80,X)"),
+                    name: Name::new("($80,X)"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -762,7 +777,7 @@ mod tests {
              "ora",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80),Y"),
+                    name: Name::new("($80),Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -776,7 +791,7 @@ mod tests {
              "eor",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -786,7 +801,7 @@ mod tests {
              "eor",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -797,7 +812,7 @@ mod tests {
              "eor",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -807,7 +822,7 @@ mod tests {
              "eor",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80,X)"),
+                    name: Name::new("($80,X)"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -817,7 +832,7 @@ mod tests {
              "eor",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80),Y"),
+                    name: Name::new("($80),Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -831,7 +846,7 @@ mod tests {
              "adc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -841,7 +856,7 @@ mod tests {
              "adc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -852,7 +867,7 @@ mod tests {
              "adc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -862,7 +877,7 @@ mod tests {
              "adc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80,X)"),
+                    name: Name::new("($80,X)"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -872,7 +887,7 @@ mod tests {
              "adc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80),Y"),
+                    name: Name::new("($80),Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -886,7 +901,7 @@ mod tests {
              "sbc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -896,7 +911,7 @@ mod tests {
              "sbc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -907,7 +922,7 @@ mod tests {
              "sbc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -917,7 +932,7 @@ mod tests {
              "sbc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80,X)"),
+                    name: Name::new("($80,X)"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -927,7 +942,7 @@ mod tests {
              "sbc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80),Y"),
+                    name: Name::new("($80),Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -940,7 +955,7 @@ mod tests {
              "inc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -951,7 +966,7 @@ mod tests {
              "inc",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -964,7 +979,7 @@ mod tests {
              "dec",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -975,7 +990,7 @@ mod tests {
              "dec",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -997,7 +1012,7 @@ mod tests {
              "asl",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1008,7 +1023,7 @@ mod tests {
              "asl",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1022,7 +1037,7 @@ mod tests {
              "lsr",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1033,7 +1048,7 @@ mod tests {
              "lsr",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1047,7 +1062,7 @@ mod tests {
              "rol",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1058,7 +1073,7 @@ mod tests {
              "rol",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1072,7 +1087,7 @@ mod tests {
              "ror",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1083,7 +1098,7 @@ mod tests {
              "ror",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1097,7 +1112,7 @@ mod tests {
              "cmp",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,X"),
+                    name: Name::new("$8000,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1107,7 +1122,7 @@ mod tests {
              "cmp",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$8000,Y"),
+                    name: Name::new("$8000,Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1118,7 +1133,7 @@ mod tests {
              "cmp",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("$80,X"),
+                    name: Name::new("$80,X"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1128,7 +1143,7 @@ mod tests {
              "cmp",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80,X)"),
+                    name: Name::new("($80,X)"),
                     subscript: None,
                     size: 16,
                     offset: 0,
@@ -1138,7 +1153,7 @@ mod tests {
              "cmp",
              vec![
                 Rvalue::Variable {
-                    name: Cow::Borrowed("($80),Y"),
+                    name: Name::new("($80),Y"),
                     subscript: None,
                     size: 16,
                     offset: 0,
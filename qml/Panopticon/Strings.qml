@@ -0,0 +1,192 @@
+import QtQuick 2.4
+import QtQuick.Controls 1.3 as Ctrl
+import QtQuick.Layouts 1.1
+import QtQuick.Controls.Styles 1.4 as Style
+import Panopticon 1.0
+
+Rectangle {
+  id: root
+  color: "white"
+
+  Accessible.name: "Strings"
+  Accessible.role: Accessible.Pane
+
+  Rectangle {
+    id: filterBar
+    anchors.left: parent.left
+    anchors.right: parent.right
+    anchors.top: parent.top
+    height: 40
+    color: "#f5f5f5"
+
+    Ctrl.TextField {
+      id: filterField
+      anchors.fill: parent
+      anchors.margins: 6
+
+      placeholderText: "Filter by prefix"
+      verticalAlignment: Text.AlignVCenter
+      font { pointSize: 11; family: "Source Sans Pro" }
+      style: Style.TextFieldStyle {
+        background: Rectangle {
+          anchors.fill: parent
+          border {
+            width: 1
+            color: filterField.activeFocus ? "#157fcc" : "#d8dae4"
+          }
+          color: "white"
+        }
+      }
+
+      // the backend answers with the first page of matching strings
+      onTextChanged: { Panopticon.filterStrings(filterField.text) }
+    }
+
+    Rectangle {
+      anchors.bottom: parent.bottom
+      width: parent.width
+      height: 1
+      color: "#d8dae4"
+    }
+  }
+
+  Ctrl.TableView {
+    id: listView
+    anchors.left: parent.left
+    anchors.right: parent.right
+    anchors.top: filterBar.bottom
+    anchors.bottom: parent.bottom
+
+    backgroundVisible: false
+    alternatingRowColors: false
+    model: Panopticon.strings
+    frameVisible: false
+    horizontalScrollBarPolicy: Qt.ScrollBarAlwaysOff
+    visible: Panopticon.strings.total > 0
+
+    style: Style.TableViewStyle {
+      transientScrollBars: true
+      handle: Item {
+        implicitWidth: 14
+        implicitHeight: 26
+        Rectangle {
+          color: "#a2a2a2"
+          radius: 3
+          anchors.fill: parent
+          anchors.topMargin: 6
+          anchors.leftMargin: 4
+          anchors.rightMargin: 4
+          anchors.bottomMargin: 6
+        }
+      }
+      scrollBarBackground: Item {
+        implicitWidth: 1
+        implicitHeight: 26
+      }
+      incrementControl: Item {}
+      decrementControl: Item {}
+    }
+    rowDelegate: Rectangle {
+      height: 24
+      color: styleData.selected ? "#a2a2a2" : "transparent"
+
+      Rectangle {
+        width: parent.width
+        height: 0
+        anchors.bottom: parent.bottom
+        color: "#ededed"
+      }
+    }
+
+    itemDelegate: Item {
+      onParentChanged: {
+        if(parent) {
+          anchors.verticalCenter = parent.verticalCenter
+        }
+      }
+
+      Ctrl.Label {
+        anchors.fill: parent
+        anchors.leftMargin: 5
+        anchors.rightMargin: 5
+
+        color: styleData.textColor
+        elide: styleData.elideMode
+        // rows of pages not yet received from the backend are empty
+        text: styleData.value !== undefined ? styleData.value : ""
+        verticalAlignment: Text.AlignVCenter
+        font {
+          pointSize: 11
+          family: styleData.column === 1 ? "Source Code Pro" : "Source Sans Pro"
+        }
+      }
+    }
+    headerDelegate: Rectangle {
+      implicitHeight: 30
+      color: "#f5f5f5"
+
+      Rectangle {
+        anchors.right: parent.right
+        width: 1
+        height: parent.height
+        color: "#d8dae4"
+      }
+
+      Rectangle {
+        anchors.bottom: parent.bottom
+        width: parent.width
+        height: 1
+        color: "#d8dae4"
+      }
+
+      Ctrl.Label {
+        anchors.fill: parent
+        anchors.leftMargin: 5
+        anchors.rightMargin: 5
+
+        text: styleData.value
+        verticalAlignment: Text.AlignVCenter
+        color: "#666"
+        font {
+          pointSize: 10
+          family: "Source Sans Pro"
+          weight: Font.Bold
+        }
+      }
+    }
+
+    Ctrl.TableViewColumn {
+      role: "address"
+      title: "Address"
+      width: 100
+    }
+    Ctrl.TableViewColumn {
+      role: "text"
+      title: "String"
+      width: Math.max(150, listView.width - 260)
+    }
+    Ctrl.TableViewColumn {
+      role: "encoding"
+      title: "Encoding"
+      width: 80
+    }
+    Ctrl.TableViewColumn {
+      role: "xrefs"
+      title: "Refs"
+      width: 60
+    }
+  }
+
+  Ctrl.Label {
+    anchors.centerIn: parent
+    width: 140
+    font {
+      family: "Source Sans Pro"; pointSize: 20;
+    }
+    visible: Panopticon.strings.total == 0
+    text: filterField.text === "" ? "No strings found" : "No matching strings"
+    color: "#a2a2a2"
+    horizontalAlignment: Text.AlignHCenter
+    wrapMode: Text.WordWrap
+  }
+}
@@ -93,6 +93,13 @@ Ctrl.ApplicationWindow {
 					onTriggered: { controlflow.centerEntryPoint() }
 				}
 			}
+			Ctrl.MenuItem {
+				action: Ctrl.Action {
+					text: "Strings"
+					enabled: Panopticon.currentSession != ""
+					onTriggered: { workspace.state = "stringsState" }
+				}
+			}
 		}
 
 		Ctrl.Menu {
@@ -141,11 +148,19 @@ Ctrl.ApplicationWindow {
 				name: "functionState"
 				PropertyChanges { target: controlflow; visible: true }
 				PropertyChanges { target: welcome; visible: false }
+				PropertyChanges { target: strings; visible: false }
 			},
 			State {
 				name: "welcomeState"
 				PropertyChanges { target: controlflow; visible: false }
 				PropertyChanges { target: welcome; visible: true }
+				PropertyChanges { target: strings; visible: false }
+			},
+			State {
+				name: "stringsState"
+				PropertyChanges { target: controlflow; visible: false }
+				PropertyChanges { target: welcome; visible: false }
+				PropertyChanges { target: strings; visible: true }
 			}
 		]
 
@@ -182,6 +197,14 @@ Ctrl.ApplicationWindow {
       }
 		}
 
+		Strings {
+			id: strings
+			anchors.left: bar.right
+			anchors.right: parent.right
+			anchors.top: parent.top
+			anchors.bottom: parent.bottom
+		}
+
 		LinearGradient {
 			id: gradient
 			anchors.left: parent.left
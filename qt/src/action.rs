@@ -17,12 +17,13 @@
  */
 
 use errors::*;
-use panopticon_abstract_interp::{Kset, approximate};
+use panopticon_abstract_interp::{Interpretation, Kset};
 use panopticon_core::{BasicBlock, ControlFlowTarget, Function, Lvalue, Rvalue};
 use panopticon_graph_algos::GraphTrait;
 use singleton::{AbstractInterpretation, Panopticon, VarName};
 use std::collections::{HashMap, HashSet};
 use std::iter::{FromIterator, IntoIterator};
+use std::sync::Arc;
 use uuid::Uuid;
 
 #[derive(Clone)]
@@ -39,16 +40,16 @@ pub enum Action {
 }
 
 impl Action {
-    pub fn new_comment(panopticon: &mut Panopticon, address: u64, comment: String) -> Result<Action> {
-        let maybe_func = panopticon.functions.iter().find(|f| f.1.find_basic_block_at(address).is_some());
+    pub fn new_comment(panopticon: &Panopticon, address: u64, comment: String) -> Result<Action> {
+        let maybe_func = panopticon.functions.read().iter().find(|f| f.find_basic_block_at(address).is_some()).map(|f| f.uuid().clone());
 
         match maybe_func {
-            Some((uuid, _)) => {
+            Some(uuid) => {
                 Ok(
                     Action::Comment {
-                        function: uuid.clone(),
+                        function: uuid,
                         address: address,
-                        before: panopticon.control_flow_comments.get(&address).cloned().unwrap_or("".to_string()),
+                        before: panopticon.control_flow_comments.read().get(&address).cloned().unwrap_or("".to_string()),
                         after: comment,
                     }
                 )
@@ -57,25 +58,26 @@ impl Action {
         }
     }
 
-    pub fn new_rename(panopticon: &mut Panopticon, func: Uuid, name: String) -> Result<Action> {
+    pub fn new_rename(panopticon: &Panopticon, func: Uuid, name: String) -> Result<Action> {
         Ok(
             Action::Rename {
                 function: func,
-                before: panopticon.functions.get(&func).map(|f| f.name.clone()).unwrap_or("".to_string()),
+                before: panopticon.functions.read().get(&func).map(|f| f.name.clone()).unwrap_or("".to_string()),
                 after: name,
             }
         )
     }
 
-    pub fn new_setvalue(panopticon: &mut Panopticon, func: Uuid, variable: VarName, value: Option<Vec<u64>>) -> Result<Action> {
+    pub fn new_setvalue(panopticon: &Panopticon, func: Uuid, variable: VarName, value: Option<Vec<u64>>) -> Result<Action> {
         use panopticon_data_flow::type_check;
-        let function = panopticon.functions.get(&func).unwrap();
-        let lens = type_check(function)?;
+        panopticon.lift_function(&func)?;
+        let function = panopticon.functions.read().get(&func).cloned().unwrap();
+        let lens = type_check(&function)?;
         let len = lens.get(&variable.name).unwrap();
-        let value = value.map(|x| Kset::Set(x.into_iter().map(|x| (x, *len)).collect()));
+        let value = value.map(|x| Kset::from_values(x.into_iter().map(|x| (x, *len))));
 
-        let before = panopticon.control_flow_values.get(&func);
-        let mut input = before.map(|x| x.input.clone()).unwrap_or(HashMap::new());
+        let before = panopticon.control_flow_values.read().get(&func).cloned();
+        let mut input = before.as_ref().map(|x| x.input.clone()).unwrap_or(HashMap::new());
 
         if let Some(ref value) = value {
             input.insert(variable.clone(), value.clone());
@@ -89,49 +91,57 @@ impl Action {
             let output = {
                 let i = input.iter().map(|(k, v)| ((k.name.clone(), k.subscript), v.clone()));
                 let fixed = HashMap::from_iter(i);
+                // the cached inputs differ from `input` after undo and redo. Only the differences
+                // are propagated.
+                let interp = match panopticon.interpretations.lock().remove(&func) {
+                    Some(mut interp) => {
+                        interp.set_inputs(&fixed);
+                        interp
+                    }
+                    None => Interpretation::with_inputs(&function, &fixed),
+                };
+                let output = interp.values();
 
-                approximate(function, &fixed)?
+                panopticon.interpretations.lock().insert(func.clone(), interp);
+                output
             };
-            let o = output
-                .into_iter()
-                .filter_map(
-                    |(k, v)| match k {
-                        Lvalue::Variable { name, subscript: Some(subscript), .. } => Some((VarName { name: name, subscript: subscript }, v)),
-                        Lvalue::Variable { subscript: None, .. } => None,
-                        Lvalue::Undefined { .. } => None,
-                    }
-                );
 
-            Some(AbstractInterpretation { input: input, output: HashMap::from_iter(o) })
+            Some(AbstractInterpretation::new(input, output))
         };
 
-        let function = panopticon.functions.get(&func).unwrap();
-        let addrs = diff_abstract_interpretations(after.as_ref(), before, &function);
+        let addrs = diff_abstract_interpretations(after.as_ref(), before.as_ref(), &function);
 
         Ok(
             Action::SetValue {
                 function: func,
                 variable: variable,
-                before: before.cloned(),
+                before: before,
                 after: after,
                 modified_basic_blocks: addrs,
             }
         )
     }
 
-    pub fn undo(&self, panopticon: &mut Panopticon) -> Result<()> {
+    pub fn undo(&self, panopticon: &Panopticon) -> Result<()> {
         match self {
             &Action::Comment { ref function, address, ref before, ref after } => {
-                debug_assert!(panopticon.control_flow_comments.get(&address).unwrap_or(&"".to_string()) == after);
-                panopticon.control_flow_comments.insert(address, before.clone());
+                {
+                    let mut cmnts = panopticon.control_flow_comments.write();
+
+                    debug_assert!(cmnts.get(&address).unwrap_or(&"".to_string()) == after);
+                    Arc::make_mut(&mut *cmnts).insert(address, before.clone());
+                }
+                panopticon.search.lock().index.set_comment(function, address, before.clone());
                 panopticon.update_control_flow_nodes(function, Some(&vec![address]))
             }
             &Action::Rename { ref function, ref before, .. } => {
-                if let Some(func) = panopticon.functions.get_mut(function) {
+                if let Some(func) = panopticon.functions.write().get_mut(function) {
                     func.name = before.clone();
                 }
+                panopticon.search.lock().index.rename_function(function, before.clone());
 
-                for (uuid, addr) in panopticon.resolved_calls.get_vec(function).cloned().unwrap_or(vec![]) {
+                let callers = panopticon.calls.lock().resolved.get_vec(function).cloned().unwrap_or(vec![]);
+                for (uuid, addr) in callers {
                     panopticon.update_control_flow_nodes(&uuid, Some(&[addr]))?;
                 }
 
@@ -140,28 +150,35 @@ impl Action {
             }
             &Action::SetValue { ref function, ref before, ref modified_basic_blocks, .. } => {
                 if let &Some(ref before) = before {
-                    panopticon.control_flow_values.insert(function.clone(), before.clone());
+                    panopticon.control_flow_values.write().insert(function.clone(), before.clone());
                 } else {
-                    panopticon.control_flow_values.remove(function);
+                    panopticon.control_flow_values.write().remove(function);
                 }
                 panopticon.update_control_flow_nodes(function, Some(modified_basic_blocks))
             }
         }
     }
 
-    pub fn redo(&self, panopticon: &mut Panopticon) -> Result<()> {
+    pub fn redo(&self, panopticon: &Panopticon) -> Result<()> {
         match self {
             &Action::Comment { ref function, address, ref before, ref after } => {
-                debug_assert!(panopticon.control_flow_comments.get(&address).unwrap_or(&"".to_string()) == before);
-                panopticon.control_flow_comments.insert(address, after.clone());
+                {
+                    let mut cmnts = panopticon.control_flow_comments.write();
+
+                    debug_assert!(cmnts.get(&address).unwrap_or(&"".to_string()) == before);
+                    Arc::make_mut(&mut *cmnts).insert(address, after.clone());
+                }
+                panopticon.search.lock().index.set_comment(function, address, after.clone());
                 panopticon.update_control_flow_nodes(function, Some(&vec![address]))
             }
             &Action::Rename { ref function, ref after, .. } => {
-                if let Some(func) = panopticon.functions.get_mut(function) {
+                if let Some(func) = panopticon.functions.write().get_mut(function) {
                     func.name = after.clone();
                 }
+                panopticon.search.lock().index.rename_function(function, after.clone());
 
-                for (uuid, addr) in panopticon.resolved_calls.get_vec(function).cloned().unwrap_or(vec![]) {
+                let callers = panopticon.calls.lock().resolved.get_vec(function).cloned().unwrap_or(vec![]);
+                for (uuid, addr) in callers {
                     panopticon.update_control_flow_nodes(&uuid, Some(&[addr]))?;
                 }
 
@@ -169,9 +186,9 @@ impl Action {
             }
             &Action::SetValue { ref function, ref after, ref modified_basic_blocks, .. } => {
                 if let &Some(ref after) = after {
-                    panopticon.control_flow_values.insert(function.clone(), after.clone());
+                    panopticon.control_flow_values.write().insert(function.clone(), after.clone());
                 } else {
-                    panopticon.control_flow_values.remove(function);
+                    panopticon.control_flow_values.write().remove(function);
                 }
                 panopticon.update_control_flow_nodes(function, Some(modified_basic_blocks))
             }
@@ -0,0 +1,209 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Abstract interpretation of all functions in the background.
+//!
+//! Functions are queued as they're disassembled. A single low priority thread lifts them and
+//! computes their `Kset` values, so constants and the targets of indirect jumps are known by the
+//! time a function is opened. Each function gets a fixed budget of steps, functions exceeding it
+//! are left without values. Values the user pinned take precedence over the results kept here.
+
+use panopticon_abstract_interp::{Interpretation, Kset};
+use panopticon_core::Function;
+use parking_lot::{Condvar, Mutex, RwLock};
+use singleton::AbstractInterpretation;
+use std::collections::{HashMap, HashSet, VecDeque};
+use uuid::Uuid;
+
+/// Statements the interpreter may execute per function.
+pub const STEP_BUDGET: usize = 500_000;
+
+struct State {
+    queue: VecDeque<Uuid>,
+    queued: HashSet<Uuid>,
+    /// Incremented by `cancel`. Results of jobs taken from the queue before are dropped.
+    generation: usize,
+    started: bool,
+}
+
+/// Queue of functions waiting to be interpreted and the results of the ones that were.
+pub struct BackgroundValues {
+    state: Mutex<State>,
+    wakeup: Condvar,
+    results: RwLock<HashMap<Uuid, AbstractInterpretation>>,
+}
+
+impl BackgroundValues {
+    pub fn new() -> BackgroundValues {
+        BackgroundValues {
+            state: Mutex::new(State { queue: VecDeque::new(), queued: HashSet::new(), generation: 0, started: false }),
+            wakeup: Condvar::new(),
+            results: RwLock::new(HashMap::new()),
+        }
+    }
+
+    /// Drops the result of `uuid` and queues the function to be interpreted again.
+    pub fn queue(&self, uuid: &Uuid) {
+        self.results.write().remove(uuid);
+
+        let mut state = self.state.lock();
+
+        if state.queued.insert(uuid.clone()) {
+            state.queue.push_back(uuid.clone());
+            self.wakeup.notify_one();
+        }
+    }
+
+    /// Drops the result of `uuid` without queuing it again.
+    pub fn remove(&self, uuid: &Uuid) {
+        self.results.write().remove(uuid);
+    }
+
+    /// Returns true the first time it's called. Used to start the worker thread only once.
+    pub fn start(&self) -> bool {
+        let mut state = self.state.lock();
+        let first = !state.started;
+
+        state.started = true;
+        first
+    }
+
+    /// Takes the next function off the queue, blocking until there is one. Returns the current
+    /// generation alongside, to be passed to `insert`.
+    pub fn pop(&self) -> (Uuid, usize) {
+        let mut state = self.state.lock();
+
+        loop {
+            if let Some(uuid) = state.queue.pop_front() {
+                state.queued.remove(&uuid);
+                return (uuid, state.generation);
+            }
+
+            self.wakeup.wait(&mut state);
+        }
+    }
+
+    /// Stores the values of `uuid` computed by a job of `generation`. Returns false if the queue
+    /// was cancelled or the function queued again in the meantime.
+    pub fn insert(&self, uuid: Uuid, generation: usize, values: AbstractInterpretation) -> bool {
+        let state = self.state.lock();
+
+        if state.generation != generation || state.queued.contains(&uuid) {
+            return false;
+        }
+
+        self.results.write().insert(uuid, values);
+        true
+    }
+
+    /// Values of `uuid`, if it was interpreted already.
+    pub fn get(&self, uuid: &Uuid) -> Option<AbstractInterpretation> {
+        self.results.read().get(uuid).cloned()
+    }
+
+    /// True if jobs of `generation` are still wanted.
+    pub fn is_current(&self, generation: usize) -> bool {
+        self.state.lock().generation == generation
+    }
+
+    /// Empties the queue and forgets all results. A job already running is finished, but its
+    /// result is thrown away.
+    pub fn cancel(&self) {
+        let mut state = self.state.lock();
+
+        state.queue.clear();
+        state.queued.clear();
+        state.generation += 1;
+        self.results.write().clear();
+    }
+}
+
+/// Lowers the priority of the calling thread, so the GUI and the disassembler win over it. Only
+/// Linux sets priorities per thread, elsewhere the whole process would be affected.
+#[cfg(target_os = "linux")]
+pub fn lower_thread_priority() {
+    unsafe {
+        ::libc::nice(10);
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+pub fn lower_thread_priority() {}
+
+/// Interprets `func` without pinned values. Returns `None` if it exceeds `STEP_BUDGET`.
+pub fn interpret(func: &Function) -> Option<AbstractInterpretation> {
+    match Interpretation::<Kset>::with_budget(func, &HashMap::new(), STEP_BUDGET) {
+        Ok(interp) => {
+            let c = interp.convergence();
+
+            debug!(
+                "values for {}: {} steps, {} components in {} iterations (at most {}), {} widenings, {} over iteration budget",
+                func.name,
+                c.steps,
+                c.components,
+                c.iterations,
+                c.max_iterations,
+                c.widenings,
+                c.exhausted
+            );
+            Some(AbstractInterpretation::new(HashMap::new(), interp.values()))
+        }
+        Err(e) => {
+            debug!("no values for {}: {}", func.name, e);
+            None
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn queue() {
+        let bg = BackgroundValues::new();
+        let a = Uuid::new_v4();
+        let b = Uuid::new_v4();
+
+        bg.queue(&a);
+        bg.queue(&b);
+        bg.queue(&a);
+
+        let (x, generation) = bg.pop();
+
+        assert_eq!(x, a);
+        assert!(bg.insert(a, generation, AbstractInterpretation::new(HashMap::new(), HashMap::new())));
+        assert!(bg.get(&a).is_some());
+
+        // queued again while being interpreted
+        let (x, generation) = bg.pop();
+
+        assert_eq!(x, b);
+        bg.queue(&b);
+        assert!(!bg.insert(b, generation, AbstractInterpretation::new(HashMap::new(), HashMap::new())));
+
+        let (_, generation) = bg.pop();
+
+        bg.cancel();
+        assert!(!bg.is_current(generation));
+        assert!(!bg.insert(b, generation, AbstractInterpretation::new(HashMap::new(), HashMap::new())));
+        assert!(bg.get(&a).is_none());
+        assert!(bg.start());
+        assert!(!bg.start());
+    }
+}
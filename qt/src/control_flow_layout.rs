@@ -25,11 +25,10 @@ use panopticon_abstract_interp::Kset;
 use panopticon_core::{ControlFlowTarget, Function, Guard, Mnemonic, Rvalue};
 use panopticon_graph_algos::{EdgeListGraphTrait, GraphTrait, IncidenceGraphTrait, VertexListGraphTrait};
 use panopticon_graph_algos::adjacency_list::{AdjacencyListEdgeDescriptor, AdjacencyListVertexDescriptor};
-use singleton::{AbstractInterpretation, VarName};
+use singleton::{AbstractInterpretation, Functions, VarName};
 use std::collections::{HashMap, HashSet};
 use std::iter::FromIterator;
 use sugiyama;
-use uuid::Uuid;
 
 #[derive(Clone)]
 pub struct ControlFlowLayout {
@@ -62,7 +61,7 @@ impl ControlFlowLayout {
         func: &Function,
         comments: &HashMap<u64, String>,
         values: Option<&AbstractInterpretation>,
-        functions: &HashMap<Uuid, Function>,
+        functions: &Functions,
         char_width: usize,
         padding: usize,
         margin: usize,
@@ -95,7 +94,7 @@ impl ControlFlowLayout {
                 .filter_map(|vx| func.cfg().vertex_label(vx).map(|lb| (vx, lb)))
                 .filter_map(
                     |(vx, lb)| {
-                        let maybe_lines = Self::get_node_data(lb, comments, values, functions).ok();
+                        let maybe_lines = Self::get_node_data(lb, func.region(), comments, values, functions).ok();
                         let is_entry = func.entry_point_ref() == vx;
 
                         maybe_lines.map(|v| (vx, (is_entry, v)))
@@ -245,7 +244,7 @@ impl ControlFlowLayout {
         func: &Function,
         comments: &HashMap<u64, String>,
         values: Option<&AbstractInterpretation>,
-        functions: &HashMap<Uuid, Function>,
+        functions: &Functions,
         char_width: usize,
         padding: usize,
         margin: usize,
@@ -299,7 +298,7 @@ impl ControlFlowLayout {
         func: &Function,
         comments: &HashMap<u64, String>,
         values: Option<&AbstractInterpretation>,
-        functions: &HashMap<Uuid, Function>,
+        functions: &Functions,
     ) -> Result<Vec<i32>> {
         let mut ret = vec![];
 
@@ -313,7 +312,7 @@ impl ControlFlowLayout {
             if hit {
                 let cfg = &func.cfg();
                 let lb = cfg.vertex_label(vx).ok_or(::panopticon_core::Error("missing label in cfg".into()))?;
-                *lines = Self::get_node_data(lb, comments, values, functions)?;
+                *lines = Self::get_node_data(lb, func.region(), comments, values, functions)?;
                 ret.push(vx.0 as i32);
             }
         }
@@ -396,9 +395,10 @@ impl ControlFlowLayout {
 
     fn get_node_data(
         ct: &ControlFlowTarget,
+        region: &str,
         comments: &HashMap<u64, String>,
         values: Option<&AbstractInterpretation>,
-        functions: &HashMap<Uuid, Function>,
+        functions: &Functions,
     ) -> Result<Vec<BasicBlockLine>> {
         match ct {
             &ControlFlowTarget::Resolved(ref bb) => {
@@ -411,7 +411,7 @@ impl ControlFlowLayout {
                             Some(mne)
                         }
                     )
-                    .filter_map(|mne| Self::get_basic_block_line(mne, comments, values, functions).ok());
+                    .filter_map(|mne| Self::get_basic_block_line(mne, region, comments, values, functions).ok());
                 Ok(i.collect())
             }
             &ControlFlowTarget::Unresolved(ref rv) => Ok(vec![Self::get_value_line(rv, values)]),
@@ -492,16 +492,18 @@ impl ControlFlowLayout {
         }
     }
 
+    /// Formats `mnemonic`. Calls are resolved against the functions in `region`.
     pub fn get_basic_block_line(
         mnemonic: &Mnemonic,
+        region: &str,
         comments: &HashMap<u64, String>,
         values: Option<&AbstractInterpretation>,
-        functions: &HashMap<Uuid, Function>,
+        functions: &Functions,
     ) -> Result<BasicBlockLine> {
         use panopticon_core::MnemonicFormatToken;
 
         let mut ret = BasicBlockLine {
-            opcode: mnemonic.opcode.clone(),
+            opcode: mnemonic.opcode.to_string(),
             region: "".to_string(),
             offset: mnemonic.area.start,
             comment: comments.get(&mnemonic.area.start).unwrap_or(&"".to_string()).to_string(),
@@ -543,10 +545,7 @@ impl ControlFlowLayout {
                             Some(Rvalue::Constant { value: c, size: s }) => {
                                 let val = if s < 64 { c % (1u64 << s) } else { c };
                                 let (display, data) = if is_code {
-                                    let maybe_func = functions
-                                        .iter()
-                                        .find(|&(_, f)| val == f.start());
-                                    if let Some((_, called_func)) = maybe_func {
+                                    if let Some(called_func) = functions.get_by_entry(region, val) {
                                         (called_func.name.clone(), format!("{}", called_func.uuid()))
                                     } else {
                                         (format!("0x{:x}", val), "".to_string())
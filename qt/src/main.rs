@@ -54,6 +54,8 @@ mod singleton;
 mod control_flow_layout;
 mod paths;
 mod action;
+mod background;
+mod search;
 mod qt;
 mod errors {
     error_chain! {
@@ -209,7 +209,6 @@ fn transform_and_send_function(uuid: &Uuid, only_entry: bool, do_nodes: bool, do
     let uuid = uuid.clone();
 
     PANOPTICON
-        .lock()
         .layout_function_async(&uuid)
         .and_then(
             move |(nodes, edges)| {
@@ -250,6 +249,8 @@ pub struct Qt;
 
 impl Glue for Qt {
     fn get_function(uuid: &Uuid, only_entry: bool, do_nodes: bool, do_edges: bool) -> glue::Result<()> {
+        // the user will most likely follow one of the calls next
+        PANOPTICON.prioritize_callees(uuid);
         Self::send_layout_task(&CString::new(uuid.to_string()).unwrap()).unwrap();
 
         let task = transform_and_send_function(&uuid, only_entry, do_nodes, do_edges).then(
@@ -281,30 +282,38 @@ impl Glue for Qt {
     }
 
     fn open_program(path: &str) -> glue::Result<()> {
-        PANOPTICON.lock().open_program(path.to_string()).map_err(|e| format!("{}", e).into())
+        PANOPTICON.open_program(path.to_string()).map_err(|e| format!("{}", e).into())
     }
 
     fn save_session(path: &str) -> glue::Result<()> {
-        PANOPTICON.lock().save_session(path.to_string()).map_err(|e| format!("{}", e).into())
+        PANOPTICON.save_session(path.to_string()).map_err(|e| format!("{}", e).into())
     }
 
     fn comment_on(address: u64, comment: &str) -> glue::Result<()> {
-        PANOPTICON.lock().comment_on(address, comment.to_string()).map_err(|e| format!("{}", e).into())
+        PANOPTICON.comment_on(address, comment.to_string()).map_err(|e| format!("{}", e).into())
     }
 
     fn rename_function(uuid: &Uuid, name: &str) -> glue::Result<()> {
-        PANOPTICON.lock().rename_function(uuid.to_string(), name.to_string()).map_err(|e| format!("{}", e).into())
+        PANOPTICON.rename_function(uuid.to_string(), name.to_string()).map_err(|e| format!("{}", e).into())
     }
 
     fn set_value_for(uuid: &Uuid, variable: &str, value: &str) -> glue::Result<()> {
-        PANOPTICON.lock().set_value_for(uuid.to_string(), variable.to_string(), value.to_string()).map_err(|e| format!("{}", e).into())
+        PANOPTICON.set_value_for(uuid.to_string(), variable.to_string(), value.to_string()).map_err(|e| format!("{}", e).into())
+    }
+
+    fn search(query: &str) -> glue::Result<()> {
+        PANOPTICON.search(query.to_string()).map_err(|e| format!("{}", e).into())
+    }
+
+    fn fetch_strings(prefix: &str, first: u32, count: u32) -> glue::Result<()> {
+        PANOPTICON.fetch_strings(prefix.to_string(), first, count).map_err(|e| format!("{}", e).into())
     }
 
     fn undo() -> glue::Result<()> {
-        PANOPTICON.lock().undo().map_err(|e| format!("{}", e).into())
+        PANOPTICON.undo().map_err(|e| format!("{}", e).into())
     }
 
     fn redo() -> glue::Result<()> {
-        PANOPTICON.lock().redo().map_err(|e| format!("{}", e).into())
+        PANOPTICON.redo().map_err(|e| format!("{}", e).into())
     }
 }
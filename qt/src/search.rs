@@ -0,0 +1,477 @@
+/*
+ * Panopticon - A libre disassembler
+ * Copyright (C) 2017  Panopticon authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Inverted index over function names, disassembly and comments.
+//!
+//! Every searchable string (a function name, the text of one instruction or a comment) is stored
+//! as a document. Documents are split into lower case words, each word maps to a sorted list of
+//! document ids. A query is answered by intersecting the lists of its words, the last word of a
+//! query matches any indexed word it is a prefix of. Queries containing punctuation like
+//! `rsp+0x40` are additionally matched against the documents' text with whitespace removed.
+
+use panopticon_core::{Function, Mnemonic, MnemonicFormatToken, Rvalue};
+use std::collections::{BTreeMap, HashMap};
+use uuid::Uuid;
+
+/// Upper limit of results returned for a single query.
+pub const MAX_SEARCH_RESULTS: usize = 10000;
+
+#[derive(Clone,Copy,Debug,PartialEq,Eq)]
+pub enum SearchKind {
+    Function,
+    Instruction,
+    Comment,
+}
+
+impl SearchKind {
+    pub fn to_str(&self) -> &'static str {
+        match self {
+            &SearchKind::Function => "function",
+            &SearchKind::Instruction => "instruction",
+            &SearchKind::Comment => "comment",
+        }
+    }
+}
+
+#[derive(Clone,Debug)]
+pub struct SearchResult {
+    pub kind: SearchKind,
+    pub function: Uuid,
+    pub address: u64,
+    pub text: String,
+}
+
+#[derive(Clone,Debug)]
+struct Document {
+    result: SearchResult,
+    // lower case text w/o whitespace, used to match queries with punctuation
+    compact: String,
+}
+
+/// Parsed search query.
+#[derive(Clone,Debug,PartialEq,Eq)]
+pub struct Query {
+    text: String,
+    words: Vec<String>,
+    prefix: Option<String>,
+    pattern: Option<String>,
+}
+
+impl Query {
+    pub fn new(s: &str) -> Query {
+        let mut words = tokenize(s);
+        let prefix = words.pop();
+        let pattern = if s.chars().any(|c| !c.is_whitespace() && !is_word_char(c)) {
+            Some(compact(s))
+        } else {
+            None
+        };
+
+        words.sort();
+        words.dedup();
+
+        Query {
+            text: s.to_string(),
+            words: words,
+            prefix: prefix,
+            pattern: pattern,
+        }
+    }
+
+    /// The query as entered by the user.
+    pub fn as_str(&self) -> &str {
+        &self.text
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.prefix.is_none() && self.pattern.is_none()
+    }
+
+    fn matches(&self, doc: &Document) -> bool {
+        if let Some(ref pattern) = self.pattern {
+            if !doc.compact.contains(pattern.as_str()) {
+                return false;
+            }
+        }
+
+        let words = tokenize(&doc.result.text);
+
+        self.words.iter().all(|w| words.contains(w)) && self.prefix.as_ref().map(|p| words.iter().any(|w| w.starts_with(p.as_str()))).unwrap_or(true)
+    }
+}
+
+fn is_word_char(c: char) -> bool {
+    c.is_alphanumeric() || c == '_'
+}
+
+fn tokenize(s: &str) -> Vec<String> {
+    s.split(|c| !is_word_char(c)).filter(|w| !w.is_empty()).map(|w| w.to_lowercase()).collect()
+}
+
+fn compact(s: &str) -> String {
+    s.chars().filter(|c| !c.is_whitespace()).flat_map(char::to_lowercase).collect()
+}
+
+/// Renders `mnemonic` the way it is displayed in the control flow graph, without values or
+/// resolved function names.
+pub fn mnemonic_text(mnemonic: &Mnemonic) -> String {
+    let mut ret = mnemonic.opcode.to_string();
+    let mut ops = mnemonic.operands.iter();
+
+    if !mnemonic.format_string.is_empty() {
+        ret.push(' ');
+    }
+
+    for tok in mnemonic.format_string.iter() {
+        match tok {
+            &MnemonicFormatToken::Literal(c) => ret.push(c),
+            &MnemonicFormatToken::Variable { .. } |
+            &MnemonicFormatToken::Pointer { .. } => {
+                match ops.next() {
+                    Some(&Rvalue::Constant { value, size }) => {
+                        let value = if size < 64 { value % (1u64 << size) } else { value };
+                        ret += &format!("0x{:x}", value);
+                    }
+                    Some(&Rvalue::Variable { ref name, .. }) => ret += name,
+                    Some(&Rvalue::Undefined) | None => ret.push('?'),
+                }
+            }
+        }
+    }
+
+    ret
+}
+
+/// Incrementally built inverted index.
+pub struct SearchIndex {
+    documents: Vec<Option<Document>>,
+    words: BTreeMap<String, Vec<u32>>,
+    by_function: HashMap<Uuid, Vec<u32>>,
+    comments: HashMap<u64, u32>,
+    removed: usize,
+}
+
+impl SearchIndex {
+    pub fn new() -> SearchIndex {
+        SearchIndex {
+            documents: Vec::new(),
+            words: BTreeMap::new(),
+            by_function: HashMap::new(),
+            comments: HashMap::new(),
+            removed: 0,
+        }
+    }
+
+    /// Number of searchable documents.
+    pub fn len(&self) -> usize {
+        self.documents.len() - self.removed
+    }
+
+    /// Indexes name and instructions of `func`, replacing all previously indexed documents of it.
+    /// Comments are left untouched.
+    pub fn insert_function(&mut self, func: &Function) {
+        let uuid = func.uuid().clone();
+
+        for id in self.by_function.get(&uuid).cloned().unwrap_or(vec![]) {
+            let is_comment = self.documents[id as usize].as_ref().map(|d| d.result.kind == SearchKind::Comment).unwrap_or(false);
+
+            if !is_comment {
+                self.remove(id);
+            }
+        }
+
+        self.insert(SearchKind::Function, uuid, func.start(), func.name.clone());
+
+        for bb in func.basic_blocks() {
+            for mne in bb.mnemonics() {
+                self.insert(SearchKind::Instruction, uuid, mne.area.start, mnemonic_text(mne));
+            }
+        }
+    }
+
+    /// Replaces the indexed name of function `uuid`.
+    pub fn rename_function(&mut self, uuid: &Uuid, name: String) {
+        let maybe_doc = self.by_function.get(uuid).and_then(
+            |ids| {
+                ids.iter().cloned().find(|&id| self.documents[id as usize].as_ref().map(|d| d.result.kind == SearchKind::Function).unwrap_or(false))
+            }
+        );
+
+        if let Some(id) = maybe_doc {
+            let address = self.documents[id as usize].as_ref().unwrap().result.address;
+
+            self.remove(id);
+            self.insert(SearchKind::Function, uuid.clone(), address, name);
+        }
+    }
+
+    /// Sets the comment at `address` inside `function`. An empty comment removes it from the index.
+    pub fn set_comment(&mut self, function: &Uuid, address: u64, comment: String) {
+        if let Some(id) = self.comments.remove(&address) {
+            self.remove(id);
+        }
+
+        if !comment.is_empty() {
+            let id = self.insert(SearchKind::Comment, function.clone(), address, comment);
+            self.comments.insert(address, id);
+        }
+    }
+
+    /// Removes all documents of function `uuid`, including its comments.
+    pub fn remove_function(&mut self, uuid: &Uuid) {
+        for id in self.by_function.remove(uuid).unwrap_or(vec![]) {
+            let comment = self.documents[id as usize].as_ref().and_then(
+                |d| if d.result.kind == SearchKind::Comment {
+                    Some(d.result.address)
+                } else {
+                    None
+                }
+            );
+
+            if let Some(address) = comment {
+                self.comments.remove(&address);
+            }
+
+            self.remove(id);
+        }
+    }
+
+    /// Returns up to `MAX_SEARCH_RESULTS` documents matching `query`, in the order they were indexed.
+    pub fn search(&self, query: &Query) -> Vec<SearchResult> {
+        if query.is_empty() {
+            return vec![];
+        }
+
+        let mut lists = Vec::with_capacity(query.words.len() + 1);
+
+        for w in query.words.iter() {
+            match self.words.get(w) {
+                Some(ids) => lists.push(ids.clone()),
+                None => return vec![],
+            }
+        }
+
+        if let Some(ref prefix) = query.prefix {
+            let mut ids = vec![];
+
+            for (_, v) in self.words.range(prefix.clone()..).take_while(|&(k, _)| k.starts_with(prefix.as_str())) {
+                ids.extend(v.iter().cloned());
+            }
+
+            ids.sort();
+            ids.dedup();
+            lists.push(ids);
+        }
+
+        let candidates: Box<Iterator<Item = u32>> = if lists.is_empty() {
+            Box::new(0..self.documents.len() as u32)
+        } else {
+            lists.sort_by_key(|l| l.len());
+            let mut ids = lists[0].clone();
+
+            for l in lists[1..].iter() {
+                ids = intersect(&ids, l);
+            }
+
+            Box::new(ids.into_iter())
+        };
+
+        candidates
+            .filter_map(|id| self.documents[id as usize].as_ref())
+            .filter(|d| query.pattern.is_none() || query.matches(d))
+            .map(|d| d.result.clone())
+            .take(MAX_SEARCH_RESULTS)
+            .collect()
+    }
+
+    /// Returns all documents of function `uuid` matching `query`. Used to update the results of a
+    /// running query with newly indexed functions.
+    pub fn search_function(&self, query: &Query, uuid: &Uuid) -> Vec<SearchResult> {
+        if query.is_empty() {
+            return vec![];
+        }
+
+        self.by_function
+            .get(uuid)
+            .map(|ids| ids.iter().filter_map(|&id| self.documents[id as usize].as_ref()).filter(|d| query.matches(d)).map(|d| d.result.clone()).collect())
+            .unwrap_or(vec![])
+    }
+
+    fn insert(&mut self, kind: SearchKind, function: Uuid, address: u64, text: String) -> u32 {
+        // Posting lists are cleaned up lazily, once half of the documents are gone.
+        if self.removed > 1024 && self.removed * 2 > self.documents.len() {
+            self.rebuild();
+        }
+
+        let id = self.documents.len() as u32;
+
+        for w in tokenize(&text) {
+            let ids = self.words.entry(w).or_insert_with(Vec::new);
+
+            // ids are handed out in increasing order, posting lists stay sorted.
+            if ids.last() != Some(&id) {
+                ids.push(id);
+            }
+        }
+
+        self.by_function.entry(function).or_insert_with(Vec::new).push(id);
+        self.documents.push(
+            Some(
+                Document {
+                    compact: compact(&text),
+                    result: SearchResult { kind: kind, function: function, address: address, text: text },
+                }
+            )
+        );
+
+        id
+    }
+
+    fn remove(&mut self, id: u32) {
+        if let Some(doc) = self.documents[id as usize].take() {
+            if let Some(ids) = self.by_function.get_mut(&doc.result.function) {
+                ids.retain(|&x| x != id);
+            }
+            self.removed += 1;
+        }
+    }
+
+    fn rebuild(&mut self) {
+        let docs = ::std::mem::replace(&mut self.documents, Vec::new());
+
+        self.words.clear();
+        self.by_function.clear();
+        self.comments.clear();
+        self.removed = 0;
+
+        for doc in docs.into_iter().filter_map(|d| d) {
+            let kind = doc.result.kind;
+            let address = doc.result.address;
+            let id = self.insert(kind, doc.result.function, address, doc.result.text);
+
+            if kind == SearchKind::Comment {
+                self.comments.insert(address, id);
+            }
+        }
+    }
+}
+
+fn intersect(a: &[u32], b: &[u32]) -> Vec<u32> {
+    let mut ret = Vec::with_capacity(::std::cmp::min(a.len(), b.len()));
+    let mut i = 0;
+    let mut j = 0;
+
+    while i < a.len() && j < b.len() {
+        if a[i] < b[j] {
+            i += 1;
+        } else if a[i] > b[j] {
+            j += 1;
+        } else {
+            ret.push(a[i]);
+            i += 1;
+            j += 1;
+        }
+    }
+
+    ret
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use panopticon_core::{BasicBlock, ControlFlowTarget, Function, Mnemonic, Region, Rvalue};
+    use panopticon_graph_algos::MutableGraphTrait;
+
+    fn function(name: &str, start: u64, mnes: Vec<Mnemonic>) -> Function {
+        let reg = Region::undefined("ram".to_string(), 0x1000);
+        let mut func = Function::undefined(start, None, &reg, Some(name.to_string()));
+        let vx = func.cfg_mut().add_vertex(ControlFlowTarget::Resolved(BasicBlock::from_vec(mnes)));
+
+        func.set_entry_point_ref(vx);
+        func
+    }
+
+    fn mov(addr: u64, off: u64) -> Mnemonic {
+        let ops = vec![Rvalue::Variable { name: "rsp".into(), subscript: None, size: 64, offset: 0 }, Rvalue::new_u64(off)];
+        Mnemonic::new(addr..addr + 1, "mov".to_string(), "[{u} + {u}], rax".to_string(), ops.iter(), vec![].iter()).unwrap()
+    }
+
+    #[test]
+    fn render_mnemonic() {
+        assert_eq!(mnemonic_text(&mov(0, 0x40)), "mov [rsp + 0x40], rax");
+        let nop = Mnemonic::new(0..1, "nop".to_string(), "".to_string(), vec![].iter(), vec![].iter()).unwrap();
+
+        assert_eq!(mnemonic_text(&nop), "nop");
+    }
+
+    #[test]
+    fn find_operands() {
+        let mut idx = SearchIndex::new();
+        let func = function("main", 0x100, vec![mov(0x100, 0x40), mov(0x101, 0x8), mov(0x102, 0x400)]);
+
+        idx.insert_function(&func);
+        assert_eq!(idx.len(), 4);
+
+        let res = idx.search(&Query::new("rsp+0x8"));
+        assert_eq!(res.len(), 1);
+        assert_eq!(res[0].address, 0x101);
+        assert_eq!(res[0].kind, SearchKind::Instruction);
+
+        assert_eq!(idx.search(&Query::new("rsp + 0x40")).len(), 2);
+        assert_eq!(idx.search(&Query::new("[rsp + 0x40]")).len(), 1);
+
+        assert_eq!(idx.search(&Query::new("MOV")).len(), 3);
+        assert_eq!(idx.search(&Query::new("rsp 0x4")).len(), 2);
+        assert_eq!(idx.search(&Query::new("mai")).len(), 1);
+        assert_eq!(idx.search(&Query::new("push")).len(), 0);
+        assert_eq!(idx.search(&Query::new("")).len(), 0);
+    }
+
+    #[test]
+    fn comments_and_renames() {
+        let mut idx = SearchIndex::new();
+        let func = function("main", 0x100, vec![mov(0x100, 0x40)]);
+        let uuid = func.uuid().clone();
+
+        idx.insert_function(&func);
+        idx.set_comment(&uuid, 0x100, "TODO: check bounds".to_string());
+        assert_eq!(idx.search(&Query::new("todo")).len(), 1);
+
+        idx.set_comment(&uuid, 0x100, "done".to_string());
+        assert_eq!(idx.search(&Query::new("todo")).len(), 0);
+        assert_eq!(idx.search_function(&Query::new("done"), &uuid).len(), 1);
+
+        idx.set_comment(&uuid, 0x100, "".to_string());
+        assert_eq!(idx.search(&Query::new("done")).len(), 0);
+
+        idx.rename_function(&uuid, "parse_header".to_string());
+        assert_eq!(idx.search(&Query::new("main")).len(), 0);
+        assert_eq!(idx.search(&Query::new("parse_h")).len(), 1);
+
+        for i in 0..3000 {
+            idx.set_comment(&uuid, 0x100, format!("revision {}", i));
+        }
+        assert_eq!(idx.len(), 3);
+        assert_eq!(idx.search(&Query::new("revision 2999")).len(), 1);
+        assert_eq!(idx.search(&Query::new("revision 2998")).len(), 0);
+
+        idx.remove_function(&uuid);
+        assert_eq!(idx.len(), 0);
+        assert_eq!(idx.search(&Query::new("mov")).len(), 0);
+    }
+}
@@ -17,25 +17,30 @@
  */
 
 use action::Action;
+use background::{self, BackgroundValues};
 use control_flow_layout::{BasicBlockLine, ControlFlowLayout};
 use errors::*;
 use futures::{Future, future};
 use multimap::MultiMap;
-use panopticon_abstract_interp::Kset;
-use panopticon_core::{Function, Program, Project, Region, loader};
+use panopticon_abstract_interp::{Interpretation, Kset};
+use panopticon_analysis::{Encoding, MIN_STRING_LENGTH, Priorities, StringIndex};
+use panopticon_core::{Function, Lvalue, Name, Program, Project, Region, Rvalue, loader};
 use panopticon_glue::Glue;
-use panopticon_graph_algos::{GraphTrait, VertexListGraphTrait};
-use parking_lot::Mutex;
+use panopticon_graph_algos::VertexListGraphTrait;
+use parking_lot::{Mutex, RwLock};
 use qt;
 use qt::Qt;
-use std::borrow::Cow;
+use search::{Query, SearchIndex, SearchResult};
 use std::collections::HashMap;
+use std::collections::hash_map::Values;
+use std::iter::FromIterator;
+use std::sync::Arc;
 use std::thread;
 use uuid::Uuid;
 
 #[derive(PartialEq,Eq,Clone,Debug,Hash)]
 pub struct VarName {
-    pub name: Cow<'static, str>,
+    pub name: Name,
     pub subscript: usize,
 }
 
@@ -45,141 +50,331 @@ pub struct AbstractInterpretation {
     pub output: HashMap<VarName, Kset>,
 }
 
+impl AbstractInterpretation {
+    /// Pairs `input` with the SSA variables in `values`.
+    pub fn new(input: HashMap<VarName, Kset>, values: HashMap<Lvalue, Kset>) -> AbstractInterpretation {
+        let output = values
+            .into_iter()
+            .filter_map(
+                |(k, v)| match k {
+                    Lvalue::Variable { name, subscript: Some(subscript), .. } => Some((VarName { name: name, subscript: subscript }, v)),
+                    Lvalue::Variable { subscript: None, .. } => None,
+                    Lvalue::Undefined { .. } => None,
+                }
+            );
+
+        AbstractInterpretation { input: input, output: HashMap::from_iter(output) }
+    }
+}
+
 lazy_static!{
-    pub static ref PANOPTICON: Mutex<Panopticon> = {
-        Mutex::new(Panopticon::default())
+    pub static ref PANOPTICON: Panopticon = {
+        Panopticon::default()
     };
 }
 
 pub type NodePosition = (usize, f32, f32, bool, Vec<BasicBlockLine>);
 pub type EdgePosition = (usize, &'static str, String, (f32, f32), (f32, f32), Vec<(f32, f32, f32, f32)>);
 
-pub struct Panopticon {
-    pub control_flow_layouts: HashMap<Uuid, ControlFlowLayout>,
+/// Disassembled functions by UUID and entry point. Functions are shared with running layouts, so
+/// a function is only copied if it's modified while being laid out. Entry points are only unique
+/// inside a region, archives and fat binaries load each member into its own one.
+pub struct Functions {
+    by_uuid: HashMap<Uuid, Arc<Function>>,
+    by_entry: HashMap<(String, u64), Uuid>,
+}
+
+impl Functions {
+    pub fn new() -> Functions {
+        Functions { by_uuid: HashMap::new(), by_entry: HashMap::new() }
+    }
+
+    pub fn get(&self, uuid: &Uuid) -> Option<&Arc<Function>> {
+        self.by_uuid.get(uuid)
+    }
+
+    pub fn get_mut(&mut self, uuid: &Uuid) -> Option<&mut Function> {
+        self.by_uuid.get_mut(uuid).map(Arc::make_mut)
+    }
+
+    pub fn get_by_entry(&self, region: &str, entry: u64) -> Option<&Arc<Function>> {
+        self.by_entry.get(&(region.to_string(), entry)).and_then(|uu| self.by_uuid.get(uu))
+    }
+
+    pub fn insert(&mut self, func: Arc<Function>) {
+        self.by_entry.insert((func.region().to_string(), func.start()), func.uuid().clone());
+        self.by_uuid.insert(func.uuid().clone(), func);
+    }
+
+    pub fn iter(&self) -> Values<Uuid, Arc<Function>> {
+        self.by_uuid.values()
+    }
+
+    /// The functions whose entry point is a constant operand of a mnemonic in `func`, i.e. all
+    /// functions a layout of `func` may show.
+    pub fn referenced_by(&self, func: &Function) -> Functions {
+        let mut ret = Functions::new();
+
+        for bb in func.basic_blocks() {
+            for mne in bb.mnemonics.iter() {
+                for op in mne.operands.iter() {
+                    if let &Rvalue::Constant { value, size } = op {
+                        let value = if size < 64 { value % (1u64 << size) } else { value };
+
+                        if let Some(f) = self.get_by_entry(func.region(), value) {
+                            ret.insert(f.clone());
+                        }
+                    }
+                }
+            }
+        }
+
+        ret
+    }
+}
+
+/// Call sites of functions, used to update the callers when a callee is renamed or disassembled.
+pub struct Calls {
+    pub unresolved: MultiMap<Option<(String, u64)>, (Uuid, u64)>, // (region, callee) -> caller
+    pub resolved: MultiMap<Uuid, (Uuid, u64)>, // callee -> caller
+}
 
-    pub control_flow_comments: HashMap<u64, String>,
-    pub control_flow_values: HashMap<Uuid, AbstractInterpretation>,
+pub struct Session {
+    /// Regions of a freshly loaded file. The first one is the root region.
+    pub regions: Vec<Region>,
+    /// Names and regions of the programs in a freshly loaded file.
+    pub programs: Vec<(String, Option<String>)>,
+    pub project: Option<Arc<Project>>,
+    /// Disassembly queues of the programs in a freshly loaded file, by region name.
+    pub priorities: HashMap<String, Priorities>,
+}
 
-    pub functions: HashMap<Uuid, Function>,
-    pub by_entry: HashMap<u64, Uuid>,
-    pub unresolved_calls: MultiMap<Option<u64>, (Uuid, u64)>,
-    pub resolved_calls: MultiMap<Uuid, (Uuid, u64)>, // callee -> caller
-    pub region: Option<Region>,
-    pub project: Option<Project>,
+pub struct Search {
+    pub index: SearchIndex,
+    pub query: Option<Query>,
+}
 
+pub struct History {
     pub undo_stack: Vec<Action>,
     pub undo_stack_top: usize,
+}
 
-    pub layout_task: Option<future::BoxFuture<ControlFlowLayout, Error>>,
+/// Application state shared by the GUI and the disassembly thread.
+///
+/// Every part is locked on its own, so e.g. the disassembly thread adding a function doesn't have
+/// to wait for a comment edit. Locks are only held to read or update the state, never while laying
+/// out functions or writing files. If more than one lock is needed they're taken in the order of
+/// the fields below.
+pub struct Panopticon {
+    pub history: Mutex<History>,
+    pub calls: Mutex<Calls>,
+    pub control_flow_layouts: Mutex<HashMap<Uuid, ControlFlowLayout>>,
+    pub functions: RwLock<Functions>,
+
+    /// Comments by address. Writers replace the map, readers keep working on the snapshot they
+    /// started with.
+    pub control_flow_comments: RwLock<Arc<HashMap<u64, String>>>,
+    pub control_flow_values: RwLock<HashMap<Uuid, AbstractInterpretation>>,
+    /// Fixed points of the functions values were set in. Changing a value only updates what
+    /// depends on it. Removed when a function is replaced.
+    pub interpretations: Mutex<HashMap<Uuid, Interpretation<Kset>>>,
+    /// Values of all functions without user input, computed by a background thread.
+    pub background_values: BackgroundValues,
+
+    pub search: Mutex<Search>,
+
+    /// Strings of the memory image and the code referencing them.
+    pub strings: RwLock<StringIndex>,
+    pub session: Mutex<Session>,
 }
 
 impl Panopticon {
-    pub fn layout_function_async(&mut self, uuid: &Uuid) -> future::BoxFuture<(Vec<NodePosition>, Vec<EdgePosition>), Error> {
-        if !self.control_flow_layouts.contains_key(&uuid) {
-            let func = self.functions.get(&uuid).unwrap();
-            let cmnts = &self.control_flow_comments;
-            let values = self.control_flow_values.get(&uuid);
-            let funcs = &self.functions;
-            let uuid2 = uuid.clone();
-
-            ControlFlowLayout::new_async(func, cmnts, values, funcs, 8, 3, 8, 26, 17, 150)
-                .and_then(
-                    move |cfl| {
-                        let uuid = uuid2;
-                        let nodes = cfl.get_all_nodes();
-                        let edges = cfl.get_all_edges();
-
-                        PANOPTICON.lock().control_flow_layouts.insert(uuid, cfl);
-                        future::ok((nodes, edges))
-                    }
-                )
-                .boxed()
-        } else {
-            let cfl = &self.control_flow_layouts.get(uuid).unwrap();
+    pub fn layout_function_async(&self, uuid: &Uuid) -> future::BoxFuture<(Vec<NodePosition>, Vec<EdgePosition>), Error> {
+        if let Some(cfl) = self.control_flow_layouts.lock().get(uuid) {
             let nodes = cfl.get_all_nodes();
             let edges = cfl.get_all_edges();
 
-            future::ok((nodes, edges)).boxed()
+            return future::ok((nodes, edges)).boxed();
         }
+
+        let uuid2 = uuid.clone();
+
+        self.start_layout(uuid)
+            .and_then(
+                move |cfl| {
+                    let uuid = uuid2;
+                    let nodes = cfl.get_all_nodes();
+                    let edges = cfl.get_all_edges();
+
+                    PANOPTICON.control_flow_layouts.lock().insert(uuid, cfl);
+                    future::ok((nodes, edges))
+                }
+            )
+            .boxed()
     }
 
-    fn get_function<'a>(&'a mut self, uuid: &Uuid) -> Result<&'a mut ControlFlowLayout> {
-        if !self.control_flow_layouts.contains_key(&uuid) {
-            let func = self.functions.get(&uuid).unwrap();
-            let cmnts = &self.control_flow_comments;
-            let values = self.control_flow_values.get(&uuid);
-            let funcs = &self.functions;
-            let cfl = ControlFlowLayout::new(func, cmnts, values, funcs, 8, 3, 8, 26, 17, 150)?;
+    /// Collects everything needed to lay out `uuid`. The returned future does the actual layout
+    /// without holding any locks.
+    fn start_layout(&self, uuid: &Uuid) -> future::BoxFuture<ControlFlowLayout, Error> {
+        // operands are shown with their SSA subscripts if possible
+        if let Err(e) = self.lift_function(uuid) {
+            error!("failed to lift {}: {}", uuid, e);
+        }
+
+        let cmnts = self.control_flow_comments.read().clone();
+        let values = self.function_values(uuid);
+        // building the node data takes a while, the lock is only held to take a snapshot of the
+        // function and its callees
+        let (func, callees) = {
+            let funcs = self.functions.read();
 
-            self.control_flow_layouts.insert(uuid.clone(), cfl);
+            match funcs.get(uuid) {
+                Some(func) => (func.clone(), funcs.referenced_by(func)),
+                None => return future::err(format!("unknown function {}", uuid).into()).boxed(),
+            }
+        };
+
+        ControlFlowLayout::new_async(&func, &cmnts, values.as_ref(), &callees, 8, 3, 8, 26, 17, 150)
+    }
+
+    fn get_function(&self, uuid: &Uuid) -> Result<Vec<NodePosition>> {
+        if let Some(cfl) = self.control_flow_layouts.lock().get(uuid) {
+            return Ok(cfl.get_all_nodes());
         }
 
-        Ok(self.control_flow_layouts.get_mut(&uuid).unwrap())
+        let cfl = self.start_layout(uuid).wait()?;
+        let nodes = cfl.get_all_nodes();
+
+        self.control_flow_layouts.lock().insert(uuid.clone(), cfl);
+        Ok(nodes)
     }
 
-    pub fn get_function_nodes(&mut self, uuid: String) -> Result<Vec<NodePosition>> {
+    pub fn get_function_nodes(&self, uuid: String) -> Result<Vec<NodePosition>> {
         let uuid = Uuid::parse_str(&uuid)?;
-        let cfl = self.get_function(&uuid)?;
 
-        Ok(cfl.get_all_nodes())
+        self.get_function(&uuid)
     }
 
-    pub fn open_program(&mut self, path: String) -> Result<()> {
+    pub fn open_program(&self, path: String) -> Result<()> {
         use std::path::Path;
         use panopticon_core::{CallTarget, Machine};
         use panopticon_amd64 as amd64;
         use panopticon_avr as avr;
-        use panopticon_analysis::pipeline;
+        use panopticon_analysis::prioritized_pipeline;
         use futures::Stream;
         use std::ffi::CString;
 
         debug!("open_program() path={}", path);
 
+        self.background_values.cancel();
+        self.start_background_values();
+
         if let Ok(proj) = Project::open(&Path::new(&path)) {
             if !proj.code.is_empty() {
                 {
-                    let cg = &proj.code[0].call_graph;
+                    let funcs = proj.code
+                        .iter()
+                        .flat_map(|prog| prog.call_graph().vertex_labels())
+                        .filter_map(
+                            |ct| match ct {
+                                &CallTarget::Concrete(ref func) => Some(func.clone()),
+                                _ => None,
+                            }
+                        )
+                        .collect::<Vec<_>>();
 
-                    for f in cg.vertices() {
-                        if let Some(&CallTarget::Concrete(ref func)) = cg.vertex_label(f) {
-                            self.functions.insert(func.uuid().clone(), func.clone());
-                            Qt::update_sidebar(&[func.clone()]);
+                    {
+                        let mut search = self.search.lock();
+                        for func in funcs.iter() {
+                            search.index.insert_function(func);
+                        }
+                    }
+                    {
+                        let mut functions = self.functions.write();
+                        for func in funcs.iter() {
+                            functions.insert(Arc::new(func.clone()));
                         }
                     }
+                    for func in funcs.iter() {
+                        self.background_values.queue(func.uuid());
+                    }
+
+                    Qt::update_sidebar(&funcs);
+
+                    let reg = proj.region().clone();
+                    let funcs = funcs.into_iter().filter(|func| func.region() == reg.name()).collect::<Vec<_>>();
+                    thread::spawn(move || PANOPTICON.index_strings(&reg, &funcs));
                 }
 
-                self.project = Some(proj);
+                self.session.lock().project = Some(Arc::new(proj));
                 Ok(Qt::send_current_session(CString::new(path.as_bytes())?)?)
             } else {
                 Ok(())
             }
-        } else if let Ok((mut proj, machine)) = loader::load(&Path::new(&path)) {
-            let maybe_prog = proj.code.pop();
-            let reg = proj.region().clone();
-
-            if let Some(prog) = maybe_prog {
-                let prog = ::std::sync::Arc::new(prog);
-                let pipe = match machine {
-                    Machine::Avr => pipeline::<avr::Avr>(prog, reg.clone(), avr::Mcu::atmega103()),
-                    Machine::Ia32 => pipeline::<amd64::Amd64>(prog, reg.clone(), amd64::Mode::Protected),
-                    Machine::Amd64 => pipeline::<amd64::Amd64>(prog, reg.clone(), amd64::Mode::Long),
-                };
-                self.region = Some(reg);
-
-                thread::spawn(
-                    || -> Result<()> {
-                        info!("disassembly thread started");
-                        for i in pipe.wait() {
-                            if let Ok(func) = i {
-                                PANOPTICON.lock().new_function(func.clone())?;
-                                Qt::update_sidebar(&[func]);
+        } else if let Ok((mut proj, machines)) = loader::load_all(&Path::new(&path)) {
+            let programs = proj.code.split_off(0);
+
+            if !programs.is_empty() {
+                // fat binaries and archives: one pipeline per slice or member, all running at once
+                let root = proj.region().clone();
+                let regions = proj.data
+                    .dependencies
+                    .vertex_labels()
+                    .filter(|reg| reg.name() != root.name())
+                    .cloned()
+                    .collect::<Vec<_>>();
+                let names = programs.iter().map(|prog| (prog.name.clone(), prog.region.clone())).collect::<Vec<_>>();
+                let mut pipes = Vec::with_capacity(programs.len());
+
+                for (prog, machine) in programs.into_iter().zip(machines.into_iter()) {
+                    let reg = proj.region_of(&prog).clone();
+                    let name = prog.name.clone();
+                    let prog = Arc::new(prog);
+                    let (pipe, prio) = match machine {
+                        Machine::Avr => prioritized_pipeline::<avr::Avr>(prog, reg.clone(), avr::Mcu::atmega103()),
+                        Machine::Ia32 => prioritized_pipeline::<amd64::Amd64>(prog, reg.clone(), amd64::Mode::Protected),
+                        Machine::Amd64 => prioritized_pipeline::<amd64::Amd64>(prog, reg.clone(), amd64::Mode::Long),
+                    };
+
+                    pipes.push((name, reg.name().clone(), pipe, prio));
+                }
+
+                {
+                    let mut session = self.session.lock();
+
+                    session.regions = vec![root.clone()];
+                    session.regions.extend(regions);
+                    session.programs = names;
+                    session.priorities = pipes.iter().map(|&(_, ref reg, _, ref prio)| (reg.clone(), prio.clone())).collect();
+                }
+
+                for (name, reg, pipe, prio) in pipes {
+                    let strings = if &reg == root.name() { Some(root.clone()) } else { None };
+
+                    thread::spawn(
+                        move || -> Result<()> {
+                            let program = CString::new(name.as_bytes())?;
+                            let mut done = 0;
+
+                            info!("disassembly thread for {} started", name);
+                            // before the first function arrives so its references are recorded
+                            if let Some(ref reg) = strings {
+                                PANOPTICON.index_strings(reg, &[])?;
                             }
-                        }
-                        info!("disassembly thread finished");
+                            for i in pipe.wait() {
+                                if let Ok(func) = i {
+                                    PANOPTICON.new_function(func.clone())?;
+                                    Qt::update_sidebar(&[func]);
+                                    done += 1;
+                                    Qt::send_analysis_progress(&program, done, prio.queued() as u32)?;
+                                }
+                            }
+                            info!("disassembly thread for {} finished", name);
 
-                        Ok(())
-                    }
-                );
+                            Ok(())
+                        }
+                    );
+                }
 
                 use paths::session_directory;
                 use tempdir::TempDir;
@@ -210,7 +405,119 @@ impl Panopticon {
         }
     }
 
-    pub fn comment_on(&mut self, addr: u64, comment: String) -> Result<()> {
+    /// Generates the RREIL code of `uuid` and converts it into SSA form if the disassembler left
+    /// it out.
+    pub fn lift_function(&self, uuid: &Uuid) -> Result<()> {
+        let func = match self.functions.read().get(uuid) {
+            Some(func) if !func.is_lifted() => func.clone(),
+            _ => return Ok(()),
+        };
+        let prio = match self.session.lock().priorities.get(func.region()).cloned() {
+            Some(prio) => prio,
+            None => return Err(format!("function {} can't be lifted", uuid).into()),
+        };
+        let mut func = (*func).clone();
+
+        prio.lift(&mut func)?;
+
+        let mut functions = self.functions.write();
+
+        // keep edits made while lifting
+        if let Some(old) = functions.get(uuid) {
+            if old.is_lifted() {
+                return Ok(());
+            }
+            func.name = old.name.clone();
+        }
+        functions.insert(Arc::new(func));
+        self.interpretations.lock().remove(uuid);
+        self.background_values.remove(uuid);
+
+        Ok(())
+    }
+
+    /// Values shown for `uuid`: the ones computed from the user's input if there is any, the
+    /// ones computed in the background otherwise.
+    pub fn function_values(&self, uuid: &Uuid) -> Option<AbstractInterpretation> {
+        let values = self.control_flow_values.read().get(uuid).cloned();
+
+        values.or_else(|| self.background_values.get(uuid))
+    }
+
+    /// Starts the thread working off `background_values` unless it's running already.
+    fn start_background_values(&self) {
+        if !self.background_values.start() {
+            return;
+        }
+
+        let ret = thread::Builder::new().name("values".to_string()).spawn(
+            || {
+                background::lower_thread_priority();
+
+                loop {
+                    let (uuid, generation) = PANOPTICON.background_values.pop();
+
+                    if let Err(e) = PANOPTICON.interpret_in_background(&uuid, generation) {
+                        debug!("no values for {}: {}", uuid, e);
+                    }
+                }
+            }
+        );
+
+        if let Err(e) = ret {
+            error!("failed to start background interpretation: {}", e);
+        }
+    }
+
+    /// Lifts `uuid` and computes its values without user input. Open control flow graphs are
+    /// updated with the result.
+    fn interpret_in_background(&self, uuid: &Uuid, generation: usize) -> Result<()> {
+        if !self.background_values.is_current(generation) {
+            return Ok(());
+        }
+
+        self.lift_function(uuid)?;
+
+        let func = match self.functions.read().get(uuid) {
+            Some(func) if func.is_lifted() => func.clone(),
+            _ => return Ok(()),
+        };
+        let values = match background::interpret(&func) {
+            Some(values) => values,
+            None => return Ok(()),
+        };
+        // the function may have been replaced while it was interpreted
+        let current = self.functions.read().get(uuid).map(|f| Arc::ptr_eq(f, &func)).unwrap_or(false);
+
+        if current && self.background_values.insert(uuid.clone(), generation, values) && !self.control_flow_values.read().contains_key(uuid) {
+            let addrs = func.basic_blocks().map(|bb| bb.area.start).collect::<Vec<_>>();
+
+            self.update_control_flow_nodes(uuid, Some(&addrs))?;
+        }
+
+        Ok(())
+    }
+
+    /// Moves the functions called by `uuid` to the front of the disassembly queue.
+    pub fn prioritize_callees(&self, uuid: &Uuid) {
+        let func = match self.functions.read().get(uuid) {
+            Some(func) => func.clone(),
+            None => return,
+        };
+        let prio = match self.session.lock().priorities.get(func.region()).cloned() {
+            Some(prio) => prio,
+            None => return,
+        };
+        let functions = self.functions.read();
+
+        for addr in func.collect_call_addresses() {
+            if functions.get_by_entry(func.region(), addr).is_none() {
+                prio.prioritize(addr);
+            }
+        }
+    }
+
+    pub fn comment_on(&self, addr: u64, comment: String) -> Result<()> {
         debug!("comment_on(): address={}, comment={}", addr, comment);
 
         let act = Action::new_comment(self, addr, comment.clone())?;
@@ -219,7 +526,7 @@ impl Panopticon {
         Ok(())
     }
 
-    pub fn rename_function(&mut self, uuid: String, name: String) -> Result<()> {
+    pub fn rename_function(&self, uuid: String, name: String) -> Result<()> {
         debug!("rename_function(): uuid={}, name={}", uuid, name);
 
         let func = Uuid::parse_str(&uuid)?;
@@ -229,7 +536,7 @@ impl Panopticon {
         Ok(())
     }
 
-    pub fn set_value_for(&mut self, func: String, variable: String, value: String) -> Result<()> {
+    pub fn set_value_for(&self, func: String, variable: String, value: String) -> Result<()> {
         use std::str::FromStr;
 
         let toks: Vec<String> = variable.split('_').map(str::to_string).collect();
@@ -284,22 +591,134 @@ impl Panopticon {
         }
     }
 
-    pub fn save_session(&mut self, path: String) -> Result<()> {
+    pub fn search(&self, query: String) -> Result<()> {
+        use std::ffi::CString;
+
+        debug!("search() query={}", query);
+
+        let q = Query::new(&query);
+        let results = {
+            let mut search = self.search.lock();
+            let results = search.index.search(&q);
+
+            search.query = if q.is_empty() { None } else { Some(q) };
+            results
+        };
+
+        self.send_search_results(&CString::new(query.as_bytes())?, results)
+    }
+
+    /// Finds all strings in `region` and the references to them in `funcs`. Replaces the current
+    /// string index and sends the first page of strings to the GUI.
+    pub fn index_strings(&self, region: &Region, funcs: &[Function]) -> Result<()> {
+        let mut strings = StringIndex::scan(region, MIN_STRING_LENGTH);
+
+        for func in funcs {
+            strings.add_xrefs(func);
+        }
+
+        info!("found {} strings", strings.len());
+        *self.strings.write() = strings;
+        self.fetch_strings("".to_string(), 0, 256)
+    }
+
+    /// Sends `count` strings starting with `prefix` to the GUI, skipping the first `first` ones.
+    /// All strings are sent in address order if `prefix` is empty, otherwise they're sorted.
+    pub fn fetch_strings(&self, prefix: String, first: u32, count: u32) -> Result<()> {
+        use panopticon_glue::CStringItem;
+        use std::cmp::min;
+        use std::ffi::CString;
+
+        debug!("fetch_strings() prefix={} first={} count={}", prefix, first, count);
+
+        let (total, items) = {
+            let strings = self.strings.read();
+            let matches = strings.with_prefix(&prefix);
+            let total = if prefix.is_empty() { strings.len() } else { matches.len() };
+            let end = min(total, first as usize + count as usize);
+            let items = (min(total, first as usize)..end)
+                .map(|row| if prefix.is_empty() { row } else { matches[row] as usize })
+                .filter_map(
+                    |i| match strings.get(i) {
+                        Some(s) => {
+                            let enc = match s.encoding {
+                                Encoding::Ascii => "ascii",
+                                Encoding::Utf16 => "utf-16",
+                            };
+
+                            CStringItem::new(s.address, enc.to_string(), strings.text(i).to_string(), strings.num_xrefs(i) as u32).ok()
+                        }
+                        None => None,
+                    }
+                )
+                .collect::<Vec<_>>();
+
+            (total as u32, items)
+        };
+
+        Ok(Qt::send_strings(&CString::new(prefix.as_bytes())?, total, first, &items)?)
+    }
+
+    fn send_search_results(&self, query: &::std::ffi::CString, results: Vec<SearchResult>) -> Result<()> {
+        use panopticon_glue::CSearchResult;
+
+        // results are sent in batches, the GUI shows the first matches while the rest is still transferred
+        for chunk in results.chunks(256) {
+            let items = {
+                let functions = self.functions.read();
+
+                chunk
+                    .iter()
+                    .filter_map(
+                        |r| {
+                            let name = functions.get(&r.function).map(|f| f.name.clone()).unwrap_or_default();
+                            CSearchResult::new(r.kind.to_str().to_string(), r.function.to_string(), name, r.address, r.text.clone()).ok()
+                        }
+                    )
+                    .collect::<Vec<_>>()
+            };
+
+            Qt::send_search_results(query, &items)?;
+        }
+
+        Ok(())
+    }
+
+    pub fn save_session(&self, path: String) -> Result<()> {
         use std::path::Path;
 
         debug!("save_session() path={}", path);
 
-        if let Some(ref proj) = self.project {
+        let (project, regions, programs) = {
+            let session = self.session.lock();
+            (session.project.clone(), session.regions.clone(), session.programs.clone())
+        };
+
+        if let Some(proj) = project {
             proj.snapshot(&Path::new(&path))?;
-        } else if let Some(ref region) = self.region {
-            let mut proj = Project::new("(none)".to_string(), region.clone());
-            let mut prog = Program::new("(none");
+        } else if let Some(root) = regions.first() {
+            let mut proj = Project::new("(none)".to_string(), root.clone());
+            let funcs = self.functions.read().iter().cloned().collect::<Vec<_>>();
 
-            for f in self.functions.iter() {
-                prog.insert(f.1.clone());
+            for reg in regions.iter().skip(1) {
+                proj.data.add(reg.clone());
+            }
+
+            for (name, region) in programs {
+                let mut prog = Program::new(&name);
+
+                {
+                    let reg = region.as_ref().unwrap_or(root.name());
+
+                    for f in funcs.iter().filter(|f| f.region() == reg) {
+                        prog.insert((**f).clone());
+                    }
+                }
+
+                prog.region = region;
+                proj.add_program(prog);
             }
 
-            proj.code.push(prog);
             proj.snapshot(&Path::new(&path))?;
         } else {
             return Err(format!("Saving failed: no session to save").into());
@@ -308,39 +727,41 @@ impl Panopticon {
         Ok(())
     }
 
-    pub fn undo(&mut self) -> Result<()> {
-        let top = self.undo_stack_top;
+    pub fn undo(&self) -> Result<()> {
+        let mut history = self.history.lock();
+        let top = history.undo_stack_top;
 
-        if top == 0 || self.undo_stack.get(top - 1).is_none() {
+        if top == 0 || history.undo_stack.get(top - 1).is_none() {
             return Err(format!("call to undo() when canUndo() is false").into());
         }
 
-        let act = self.undo_stack[top - 1].clone();
+        let act = history.undo_stack[top - 1].clone();
         act.undo(self)?;
 
-        self.undo_stack_top = top - 1;
+        history.undo_stack_top = top - 1;
 
         Ok(Qt::send_undo_redo_update(top - 1 != 0, true)?)
     }
 
-    pub fn redo(&mut self) -> Result<()> {
-        let top = self.undo_stack_top;
+    pub fn redo(&self) -> Result<()> {
+        let mut history = self.history.lock();
+        let top = history.undo_stack_top;
 
-        if self.undo_stack.get(top).is_none() {
+        if history.undo_stack.get(top).is_none() {
             return Err(format!("call to redo() when canRedo() is false").into());
         }
 
-        let act = self.undo_stack[top].clone();
+        let act = history.undo_stack[top].clone();
         act.redo(self)?;
 
-        self.undo_stack_top = top + 1;
+        history.undo_stack_top = top + 1;
 
-        let len = self.undo_stack.len();
+        let len = history.undo_stack.len();
 
         Ok(Qt::send_undo_redo_update(true, top + 1 < len)?)
     }
 
-    pub fn update_control_flow_nodes(&mut self, uuid: &Uuid, addrs: Option<&[u64]>) -> Result<()> {
+    pub fn update_control_flow_nodes(&self, uuid: &Uuid, addrs: Option<&[u64]>) -> Result<()> {
         use std::ffi::CString;
         use panopticon_glue::{CBasicBlockLine, CBasicBlockOperand};
 
@@ -350,15 +771,19 @@ impl Panopticon {
             addrs
         );
 
-        let ids = if let Some(ref mut cfl) = self.control_flow_layouts.get_mut(uuid) {
-            let func = self.functions.get(&uuid).unwrap();
-            let cmnts = &self.control_flow_comments;
-            let values = self.control_flow_values.get(&uuid);
-            let funcs = &self.functions;
+        let ids = {
+            let mut layouts = self.control_flow_layouts.lock();
 
-            cfl.update_nodes(addrs, func, cmnts, values, funcs)?
-        } else {
-            vec![]
+            if let Some(ref mut cfl) = layouts.get_mut(uuid) {
+                let funcs = self.functions.read();
+                let func = funcs.get(&uuid).unwrap();
+                let cmnts = self.control_flow_comments.read().clone();
+                let values = self.function_values(uuid);
+
+                cfl.update_nodes(addrs, func, &cmnts, values.as_ref(), &funcs)?
+            } else {
+                vec![]
+            }
         };
 
         if !qt::SUBSCRIBED_FUNCTIONS.lock().contains(uuid) {
@@ -402,59 +827,88 @@ impl Panopticon {
         Ok(())
     }
 
-    pub fn update_sidebar(&mut self, uuid: &Uuid) -> Result<()> {
+    pub fn update_sidebar(&self, uuid: &Uuid) -> Result<()> {
         debug!("update_sidebar() func={}", uuid);
 
-        let func = self.functions.get(uuid).cloned();
+        let func = self.functions.read().get(uuid).cloned();
         match func {
             Some(func) => {
-                Qt::update_sidebar(&[func]);
+                Qt::update_sidebar(&[(*func).clone()]);
                 Ok(())
             }
             None => Err(format!("unknown function {}", uuid).into()),
         }
     }
 
-    pub fn new_function(&mut self, func: Function) -> Result<()> {
+    pub fn new_function(&self, func: Function) -> Result<()> {
         use panopticon_core::{Operation, Rvalue, Statement};
 
+        let func = Arc::new(func);
+        let uuid = func.uuid().clone();
         let pairs = {
-            for bb in func.basic_blocks() {
-                for statement in bb.statements() {
-                    if let &Statement { op: Operation::Call(ref rv), .. } = statement {
-                        match rv {
-                            &Rvalue::Constant { value, .. } => {
-                                // their addr
-                                let maybe_callee = self.by_entry.get(&value);
-
-                                if let Some(callee) = maybe_callee {
-                                    self.resolved_calls.insert(callee.clone(), (func.uuid().clone(), bb.area.start));
-                                } else {
-                                    self.unresolved_calls.insert(Some(value), (func.uuid().clone(), bb.area.start));
+            let mut calls = self.calls.lock();
+
+            {
+                let functions = self.functions.read();
+
+                for bb in func.basic_blocks() {
+                    for statement in bb.statements() {
+                        if let &Statement { op: Operation::Call(ref rv), .. } = statement {
+                            match rv {
+                                &Rvalue::Constant { value, .. } => {
+                                    // their addr
+                                    let maybe_callee = functions.get_by_entry(func.region(), value);
+
+                                    if let Some(callee) = maybe_callee {
+                                        calls.resolved.insert(callee.uuid().clone(), (func.uuid().clone(), bb.area.start));
+                                    } else {
+                                        let callee = (func.region().to_string(), value);
+                                        calls.unresolved.insert(Some(callee), (func.uuid().clone(), bb.area.start));
+                                    }
                                 }
+                                _ => calls.unresolved.insert(None, (func.uuid().clone(), bb.area.start)),
                             }
-                            _ => self.unresolved_calls.insert(None, (func.uuid().clone(), bb.area.start)),
                         }
                     }
                 }
             }
 
-            let entry = func.start();
+            let entry = (func.region().to_string(), func.start());
             // my addr
-            let pairs_owned = self.unresolved_calls.remove(&Some(entry)).unwrap_or(vec![]).into_iter();
-            let pairs_ref = self.unresolved_calls.get_vec(&None).cloned().unwrap_or(vec![]).into_iter();
-
-            self.by_entry.insert(entry, func.uuid().clone());
+            let pairs_owned = calls.unresolved.remove(&Some(entry)).unwrap_or(vec![]).into_iter();
+            let pairs_ref = calls.unresolved.get_vec(&None).cloned().unwrap_or(vec![]).into_iter();
 
             for (uuid, addr) in pairs_owned.clone() {
-                self.resolved_calls.insert(func.uuid().clone(), (uuid.clone(), addr));
+                calls.resolved.insert(func.uuid().clone(), (uuid.clone(), addr));
             }
 
-            self.functions.insert(func.uuid().clone(), func);
+            self.functions.write().insert(func.clone());
+            self.interpretations.lock().remove(&uuid);
+            self.background_values.queue(&uuid);
 
             pairs_owned.chain(pairs_ref).collect::<Vec<_>>()
         };
 
+        // stream matches of the newly indexed function into the results of a running query
+        let results = {
+            let mut search = self.search.lock();
+
+            search.index.insert_function(&func);
+            search.query.as_ref().map(|query| (query.as_str().to_string(), search.index.search_function(query, &uuid)))
+        };
+
+        // strings are only indexed in the root region
+        let root = self.session.lock().regions.first().map(|reg| reg.name().clone());
+        if root.map(|name| name == func.region()).unwrap_or(true) {
+            self.strings.write().add_xrefs(&func);
+        }
+
+        if let Some((query, results)) = results {
+            use std::ffi::CString;
+
+            self.send_search_results(&CString::new(query.as_bytes())?, results)?;
+        }
+
         for (uuid, addr) in pairs.into_iter() {
             self.update_control_flow_nodes(&uuid, Some(&[addr])).unwrap();
         }
@@ -462,17 +916,18 @@ impl Panopticon {
         Ok(())
     }
 
-    fn push_action(&mut self, act: Action) -> Result<()> {
-        let top = self.undo_stack_top;
+    fn push_action(&self, act: Action) -> Result<()> {
+        let mut history = self.history.lock();
+        let top = history.undo_stack_top;
 
         act.redo(self)?;
 
-        self.undo_stack.truncate(top);
-        self.undo_stack.push(act);
-        self.undo_stack_top = self.undo_stack.len();
+        history.undo_stack.truncate(top);
+        history.undo_stack.push(act);
+        history.undo_stack_top = history.undo_stack.len();
 
-        let top = self.undo_stack_top;
-        let len = self.undo_stack.len();
+        let top = history.undo_stack_top;
+        let len = history.undo_stack.len();
 
         Ok(Qt::send_undo_redo_update(top != 0, top < len)?)
     }
@@ -481,18 +936,17 @@ impl Panopticon {
 impl Default for Panopticon {
     fn default() -> Panopticon {
         Panopticon {
-            control_flow_layouts: HashMap::new(),
-            control_flow_comments: HashMap::new(),
-            control_flow_values: HashMap::new(),
-            functions: HashMap::new(),
-            by_entry: HashMap::new(),
-            unresolved_calls: MultiMap::new(),
-            resolved_calls: MultiMap::new(),
-            project: None,
-            region: None,
-            undo_stack: Vec::new(),
-            undo_stack_top: 0,
-            layout_task: None,
+            history: Mutex::new(History { undo_stack: Vec::new(), undo_stack_top: 0 }),
+            calls: Mutex::new(Calls { unresolved: MultiMap::new(), resolved: MultiMap::new() }),
+            control_flow_layouts: Mutex::new(HashMap::new()),
+            functions: RwLock::new(Functions::new()),
+            control_flow_comments: RwLock::new(Arc::new(HashMap::new())),
+            control_flow_values: RwLock::new(HashMap::new()),
+            interpretations: Mutex::new(HashMap::new()),
+            background_values: BackgroundValues::new(),
+            search: Mutex::new(Search { index: SearchIndex::new(), query: None }),
+            strings: RwLock::new(StringIndex::new()),
+            session: Mutex::new(Session { regions: vec![], programs: vec![], project: None, priorities: HashMap::new() }),
         }
     }
 }
@@ -508,7 +962,31 @@ mod tests {
 
     #[test]
     fn open_save() {
-        let mut panop = Panopticon::default();
+        let panop = Panopticon::default();
         panop.open_program("../test-data/save.panop".to_string()).unwrap();
     }
+
+    #[test]
+    fn functions_copy_on_write() {
+        use panopticon_core::{BasicBlock, ControlFlowTarget, Mnemonic};
+        use panopticon_graph_algos::MutableGraphTrait;
+
+        let mut func = Function::undefined(0x100, None, &Region::undefined("ram".to_string(), 0x200), Some("f".to_string()));
+        let mne = Mnemonic::new(0x100..0x101, "ret".to_string(), "".to_string(), vec![].iter(), vec![].iter()).unwrap();
+        let vx = func.cfg_mut().add_vertex(ControlFlowTarget::Resolved(BasicBlock::from_vec(vec![mne])));
+        func.set_entry_point_ref(vx);
+
+        let uuid = func.uuid().clone();
+        let mut functions = Functions::new();
+
+        functions.insert(Arc::new(func));
+
+        let snapshot = functions.get(&uuid).cloned().unwrap();
+        functions.get_mut(&uuid).unwrap().name = "g".to_string();
+
+        assert_eq!(snapshot.name, "f");
+        assert_eq!(functions.get_by_entry("ram", 0x100).map(|f| f.name.clone()), Some("g".to_string()));
+        assert!(functions.get_by_entry("ram", 0x101).is_none());
+        assert!(functions.get_by_entry("flash", 0x100).is_none());
+    }
 }